@@ -0,0 +1,86 @@
+/*file: advInterval.c
+ *
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "advInterval.h"
+
+
+static struct
+{
+    uint16_t interval;        // current interval
+    bool     isDense;         // current period is dense one
+    bool     isWaitConnect;   // first connection after restart not yet happened
+    uint32_t restartTime;
+    uint32_t connectTimeAvg;  // ms
+}intervalState;
+
+
+void advIntervalInit(uint32_t time)
+{
+    intervalState.connectTimeAvg = ADV_INTERVAL_CONNECT_INIT;
+    advIntervalRestart(time);
+}
+
+
+// power on, disconnect or new advertising process: start from dense interval again
+void advIntervalRestart(uint32_t time)
+{
+    intervalState.interval      = ADV_INTERVAL_MIN;
+    intervalState.isDense       = true;
+    intervalState.isWaitConnect = true;
+    intervalState.restartTime   = time;
+}
+
+
+uint32_t advIntervalGetDenseTime(void)
+{
+    uint32_t denseTime = (2 * intervalState.connectTimeAvg + 999) / 1000;
+
+    if(denseTime < ADV_INTERVAL_DENSE_MIN)
+    {
+        return ADV_INTERVAL_DENSE_MIN;
+    }
+    if(denseTime > ADV_INTERVAL_DENSE_MAX)
+    {
+        return ADV_INTERVAL_DENSE_MAX;
+    }
+    return denseTime;
+}
+
+
+advIntervalT advIntervalGet(void)
+{
+    advIntervalT rez =
+    {
+        .interval = intervalState.interval,
+        .period   = intervalState.isDense ? advIntervalGetDenseTime() : ADV_INTERVAL_STEP_PERIOD,
+    };
+    return rez;
+}
+
+
+// advertising period is over without connection
+void advIntervalNext(void)
+{
+    intervalState.isDense  = false;
+    intervalState.interval = (intervalState.interval > ADV_INTERVAL_MAX / 2) ? ADV_INTERVAL_MAX :
+                                                                              intervalState.interval * 2;
+}
+
+
+// host is found: secured connection, connections rejected by reconnect scan phase are not counted
+void advIntervalConnected(uint32_t time)
+{
+    int32_t sample;
+
+    if(!intervalState.isWaitConnect)
+    {
+        return;
+    }
+    intervalState.isWaitConnect = false;
+    sample = time - intervalState.restartTime;
+    intervalState.connectTimeAvg += (sample - (int32_t)intervalState.connectTimeAvg) >> ADV_INTERVAL_AVERAGE_SHIFT;
+}
@@ -0,0 +1,39 @@
+/*file: advInterval.h
+ *
+ * Advertising interval policy for reconnect.
+ * After power on or disconnect advertising starts dense (ADV_INTERVAL_MIN) and keeps it during dense time,
+ * then interval is doubled on each advertising period up to ADV_INTERVAL_MAX.
+ * Dense time is learned: twice the averaged time from restart to first accepted (secured) connection, so hosts
+ * that are usually found quickly don't keep radio on dense interval for long.
+ * Interval in units of 0.625 ms, period in seconds (as ble_advertising module config), time in ms (getTime()).
+*/
+
+#ifndef ADVINTERVAL_H_
+#define ADVINTERVAL_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#define ADV_INTERVAL_MIN             0x0020    // 20 ms, minimum for connectable advertising
+#define ADV_INTERVAL_MAX             0x0640    // 1 s
+#define ADV_INTERVAL_STEP_PERIOD     5         // s, period of each backed off interval
+#define ADV_INTERVAL_DENSE_MIN       2         // s
+#define ADV_INTERVAL_DENSE_MAX       30        // s
+#define ADV_INTERVAL_CONNECT_INIT    5000      // ms, initial average time to first connection
+#define ADV_INTERVAL_AVERAGE_SHIFT   2         // average += (sample - average)/4
+
+typedef struct
+{
+    uint16_t interval;
+    uint16_t period;
+}advIntervalT;
+
+
+void         advIntervalInit     (uint32_t time);
+void         advIntervalRestart  (uint32_t time);
+advIntervalT advIntervalGet      (void);
+void         advIntervalNext     (void);
+void         advIntervalConnected(uint32_t time);
+uint32_t     advIntervalGetDenseTime(void);
+
+#endif
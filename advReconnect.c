@@ -0,0 +1,612 @@
+/*file: advReconnect.c
+ *
+*/
+
+#include "stdint.h"
+#include "string.h"
+#include "stdbool.h"
+
+#include "advReconnect.h"
+#include "orderProcessing.h"
+#include "systemTime.h"
+#include "reconnectTrace.h"
+
+#include "nrf_log.h"
+
+#define DETECTED_DEV_FREE    ADV_RECONNECT_PEER_INVALID   // peer ID 0xFF is valid
+
+
+typedef enum
+{
+    DEV_SCANNING,
+    DEV_CONNECTION,
+}connPhase;
+
+
+static struct
+{
+    connPhase phase;
+    uint16_t  listDetectedDev[ADV_RECONNECT_PEER_QUANTITY];
+    uint8_t   quantityDetectedDev;
+    uint8_t   connectCnt;
+    uint8_t   loopCnt;
+    bool      isConnectAny;  // direct connection loops are over, any bonded device is accepted
+}advDirOrdConnState =
+{
+    .listDetectedDev = {[0 ... ADV_RECONNECT_PEER_QUANTITY-1] = DETECTED_DEV_FREE}
+};
+
+static struct
+{
+    advTypeT      currentAdvType;
+    orderT        deviceOrder;
+    timerCallbacT stopScanAdvTimerCallback;
+    uint32_t      scaningTimeout;
+    bool          isScanDetected;
+    uint16_t      whitelistPeers[ADV_RECONNECT_PEER_QUANTITY];      // wanted white list
+    uint32_t      whitelistPeerCnt;
+    uint16_t      appliedPeers[ADV_RECONNECT_PEER_QUANTITY];        // white list given to peer manager
+    uint32_t      appliedPeerCnt;
+    bool          isApplied;                                        // false - applied list is unknown
+    advWhitelistStatT whitelistStat;
+    advConnectStrategyT strategy;
+    uint32_t      connectStartTime;
+    advScanStopRuleT scanRule;
+    timerCallbacT scanQuietTimerCallback;
+    uint32_t      lastDetectTime;
+} reconnectState =
+{
+    .currentAdvType = ADV_IDLE,
+    .strategy       = ADV_CONNECT_SERIAL,
+    .scanRule       = {.isTopStop = ADV_SCAN_STOP_TOP, .topK = ADV_SCAN_STOP_TOP_K, .quietTime = ADV_SCAN_STOP_QUIET_TIME},
+};
+
+
+static void advScanQuietCB(void *context);
+
+
+static void advDetectedClear(void)
+{
+    for(uint8_t cnt = 0; cnt < ADV_RECONNECT_PEER_QUANTITY; cnt++)
+    {
+        advDirOrdConnState.listDetectedDev[cnt] = DETECTED_DEV_FREE;
+    }
+    advDirOrdConnState.quantityDetectedDev = 0;
+}
+
+
+static bool advWhitelistIsApplied(uint16_t peerId)
+{
+    for(uint32_t cnt = 0; cnt < reconnectState.appliedPeerCnt; cnt++)
+    {
+        if(reconnectState.appliedPeers[cnt] == peerId)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// push wanted white list only when it differs from applied one (as set, order doesn't matter for SoftDevice),
+// so consecutive changes between two commits cost one apply
+static void advWhitelistCommit(void)
+{
+    uint32_t added = 0;
+
+    for(uint32_t cnt = 0; cnt < reconnectState.whitelistPeerCnt; cnt++)
+    {
+        if(!advWhitelistIsApplied(reconnectState.whitelistPeers[cnt]))
+        {
+            added++;
+        }
+    }
+    // lists hold no duplicates, so equal size and nothing added - nothing removed
+    if(reconnectState.isApplied && added == 0 && reconnectState.whitelistPeerCnt == reconnectState.appliedPeerCnt)
+    {
+        reconnectState.whitelistStat.applySkipped++;
+        return;
+    }
+    NRF_LOG_INFO("WL apply +%d -%d", added, reconnectState.appliedPeerCnt + added - reconnectState.whitelistPeerCnt);
+    advReconnectWhitelistSet(reconnectState.whitelistPeers, reconnectState.whitelistPeerCnt);
+    memcpy(reconnectState.appliedPeers, reconnectState.whitelistPeers, sizeof(reconnectState.appliedPeers));
+    reconnectState.appliedPeerCnt = reconnectState.whitelistPeerCnt;
+    reconnectState.isApplied      = true;
+    reconnectState.whitelistStat.applyPerformed++;
+}
+
+
+// starts from idle state, so it can be repeated (host simulator runs); strategy and scan rule are kept
+void advReconnectInit(orderT deviceOrderIn)
+{
+    reconnectState.deviceOrder      = deviceOrderIn;
+    reconnectState.currentAdvType   = ADV_IDLE;
+    reconnectState.whitelistPeerCnt = 0;
+    reconnectState.appliedPeerCnt   = 0;
+    reconnectState.isApplied        = false;
+    memset(&reconnectState.whitelistStat, 0, sizeof(reconnectState.whitelistStat));
+    memset(&advDirOrdConnState, 0, sizeof(advDirOrdConnState));
+    advDetectedClear();
+    // timers are kept, systemTime has no free of callbacks
+    if(reconnectState.stopScanAdvTimerCallback == NULL)
+    {
+        reconnectState.stopScanAdvTimerCallback = timerGetCallback(advReconnectScanStopCB, NULL);
+        reconnectState.scanQuietTimerCallback   = timerGetCallback(advScanQuietCB, NULL);
+    }
+    timerStop(reconnectState.stopScanAdvTimerCallback);
+    timerStop(reconnectState.scanQuietTimerCallback);
+}
+
+
+advTypeT advReconnectGetType(void)
+{
+    return reconnectState.currentAdvType;
+}
+
+
+// takes effect from next connection phase
+void advReconnectSetStrategy(advConnectStrategyT strategy)
+{
+    reconnectState.strategy = strategy;
+}
+
+
+advConnectStrategyT advReconnectGetStrategy(void)
+{
+    return reconnectState.strategy;
+}
+
+
+uint32_t advReconnectWhitelistGetQuantity(void)
+{
+    return reconnectState.whitelistPeerCnt;
+}
+
+
+// new bond OR bond update of peer that is already on the list (its address/IRK may be changed)
+bool advReconnectWhitelistAdd(uint16_t peerId)
+{
+    uint32_t cnt = 0;
+
+    for(; cnt < reconnectState.whitelistPeerCnt; cnt++)
+    {
+        if(reconnectState.whitelistPeers[cnt] == peerId)
+        {
+            break;
+        }
+    }
+    if(cnt < reconnectState.whitelistPeerCnt)
+    {
+        reconnectState.isApplied = false;
+    }
+    else if(reconnectState.whitelistPeerCnt >= ADV_RECONNECT_PEER_QUANTITY)
+    {
+        return false;
+    }
+    else
+    {
+        reconnectState.whitelistPeers[reconnectState.whitelistPeerCnt++] = peerId;
+    }
+    advWhitelistCommit();
+    return true;
+}
+
+
+// bond data is changed behind module (bonds are deleted), next commit applies white list anyway
+void advReconnectWhitelistInvalidate(void)
+{
+    reconnectState.isApplied = false;
+}
+
+
+void advReconnectWhitelistGetStat(advWhitelistStatT *stat)
+{
+    *stat = reconnectState.whitelistStat;
+}
+
+
+void advReconnectSetStart(advTypeT advType, uint16_t peerId)
+{
+    switch(advType)
+    {
+    case ADV_ADD_NEW: // advertising without white list, but REJECT connection all current peers
+        NRF_LOG_INFO("ADV add new");
+        reconnectState.currentAdvType   = ADV_ADD_NEW;
+        reconnectState.whitelistPeerCnt = 0;
+        break;
+    case ADV_RECONNECT_SCAN:
+        memset(reconnectState.whitelistPeers, 0xFF, sizeof(reconnectState.whitelistPeers));
+        reconnectState.whitelistPeerCnt = advReconnectPeerListGet(reconnectState.whitelistPeers,
+                                                                  ADV_RECONNECT_PEER_QUANTITY);
+
+        NRF_LOG_INFO("Adv recon: %d", reconnectState.whitelistPeerCnt);
+
+        if(reconnectState.whitelistPeerCnt == 0) // if no peer devices -
+        {
+            reconnectState.currentAdvType = ADV_ADD_NEW;
+        }
+        else
+        {
+            reconnectState.currentAdvType = ADV_RECONNECT_SCAN;
+            timerRun(reconnectState.stopScanAdvTimerCallback, ADV_RECONNECT_SCAN_TIMEOUT);
+            reconnectState.scaningTimeout = getTime();
+            reconnectState.isScanDetected = false;
+            reconnectTraceAdd(TRACE_SCAN_START, TRACE_PEER_NONE);
+        }
+        break;
+    case ADV_RECONNECT_CONNECT:
+        reconnectState.currentAdvType = ADV_RECONNECT_CONNECT;
+        // set white list parameters
+        NRF_LOG_INFO("Adv recon conn");
+        reconnectState.whitelistPeers[0] = peerId;
+        reconnectState.whitelistPeerCnt  = 1;
+        reconnectTraceAdd(TRACE_WHITELIST_SWITCH, peerId);
+        timerRun(reconnectState.stopScanAdvTimerCallback, ADV_RECONNECT_CONNECT_TIMEOUT);
+        break;
+    default:
+        break;
+    }
+    advReconnectAdvStop();  // use this stop adv for activate white list with new devices
+    advWhitelistCommit();
+    advReconnectAdvStart();
+}
+
+
+// parallel strategy: white list all detected devices (list is compacted and ordered by rank)
+static void advConnectAllStart(void)
+{
+    reconnectState.currentAdvType   = ADV_RECONNECT_CONNECT;
+    reconnectState.whitelistPeerCnt = advDirOrdConnState.quantityDetectedDev;
+    memcpy(reconnectState.whitelistPeers, advDirOrdConnState.listDetectedDev, sizeof(reconnectState.whitelistPeers));
+    reconnectState.connectStartTime = getTime();
+    NRF_LOG_INFO("Adv recon conn all %d", reconnectState.whitelistPeerCnt);
+    reconnectTraceAdd(TRACE_WHITELIST_SWITCH, TRACE_PEER_NONE);
+    timerRun(reconnectState.stopScanAdvTimerCallback, ADV_RECONNECT_CONNECT_TIMEOUT);
+
+    advReconnectAdvStop();
+    advWhitelistCommit();
+    advReconnectAdvStart();
+}
+
+
+// direct connection loops are over: white list all bonded devices and accept first one, no timeout,
+// advertising interval policy backs off radio use meanwhile
+static void advConnectAnyStart(void)
+{
+    advDirOrdConnState.isConnectAny = true;
+    advDirOrdConnState.loopCnt      = 0;
+    reconnectState.currentAdvType   = ADV_RECONNECT_CONNECT;
+    reconnectState.whitelistPeerCnt = advReconnectPeerListGet(reconnectState.whitelistPeers,
+                                                              ADV_RECONNECT_PEER_QUANTITY);
+    NRF_LOG_INFO("Adv recon conn any %d", reconnectState.whitelistPeerCnt);
+    reconnectTraceAdd(TRACE_WHITELIST_SWITCH, TRACE_PEER_NONE);
+
+    advReconnectAdvStop();
+    advWhitelistCommit();
+    advReconnectAdvStart();
+}
+
+
+// parallel strategy: device is rejected while any higher ranked detected device may still connect
+static bool advConnectIsRejected(uint16_t peerId)
+{
+    if(reconnectState.strategy != ADV_CONNECT_PARALLEL || advDirOrdConnState.isConnectAny ||
+       getTime() - reconnectState.connectStartTime >= ADV_RECONNECT_GRACE_TIME)
+    {
+        return false;
+    }
+    return advDirOrdConnState.listDetectedDev[0] != peerId;
+}
+
+
+void advReconnectSetScanRule(advScanStopRuleT rule)
+{
+    reconnectState.scanRule = rule;
+}
+
+
+// bits of rank positions 0..quantity-1, detectedRankMask keeps 32 of them
+static uint32_t advRankMask(uint32_t quantity)
+{
+    return (quantity >= 32) ? UINT32_MAX : (1UL << quantity) - 1;
+}
+
+
+bool advReconnectScanIsEnough(const advScanStopRuleT *rule, const advScanProgressT *progress)
+{
+    uint32_t mask;
+
+    if(progress->detectedRankMask == 0)
+    {
+        return false;
+    }
+    mask = advRankMask(progress->candidateQuantity);
+    if((progress->detectedRankMask & mask) == mask)
+    {
+        return true;
+    }
+    if(rule->isTopStop && (progress->detectedRankMask & 1))
+    {
+        return true;
+    }
+    if(rule->topK != 0)
+    {
+        mask = advRankMask((rule->topK < progress->candidateQuantity) ? rule->topK : progress->candidateQuantity);
+        if((progress->detectedRankMask & mask) == mask)
+        {
+            return true;
+        }
+    }
+    return rule->quietTime != 0 && progress->quietTime >= rule->quietTime;
+}
+
+
+static bool advScanIsEnough(void)
+{
+    advScanProgressT progress =
+    {
+        .detectedRankMask  = 0,
+        .candidateQuantity = orderGetQuantity(reconnectState.deviceOrder),
+        .quietTime         = getTime() - reconnectState.lastDetectTime,
+    };
+
+    if(progress.candidateQuantity > ADV_RECONNECT_PEER_QUANTITY)
+    {
+        progress.candidateQuantity = ADV_RECONNECT_PEER_QUANTITY;
+    }
+    for(uint8_t cnt = 0; cnt < ADV_RECONNECT_PEER_QUANTITY; cnt++)
+    {
+        if(advDirOrdConnState.listDetectedDev[cnt] != DETECTED_DEV_FREE)
+        {
+            progress.detectedRankMask |= 1UL << cnt;
+        }
+    }
+    return advReconnectScanIsEnough(&reconnectState.scanRule, &progress);
+}
+
+
+// finish scanning through scan timer, so phase is switched from timer processing as on timeout
+static void advScanFinish(void)
+{
+    NRF_LOG_INFO("---------SCANED TIME = %d", getTime() - reconnectState.scaningTimeout);
+    timerStop(reconnectState.scanQuietTimerCallback);
+    advReconnectAdvStop();
+    timerRun(reconnectState.stopScanAdvTimerCallback, 0);
+}
+
+
+static void advScanQuietCB(void *context)
+{
+    (void)context;
+    if(reconnectState.currentAdvType == ADV_RECONNECT_SCAN && advDirOrdConnState.phase == DEV_SCANNING &&
+       advScanIsEnough())
+    {
+        NRF_LOG_INFO("Scan quiet");
+        advScanFinish();
+    }
+}
+
+
+static void advAddNewProc(nrfBLEAdvEvT inEv, uint16_t peerId)
+{
+    (void)peerId;
+    switch(inEv)
+    {
+    case ADV_PROC_START_CONNECT:
+        break;
+    case ADV_PROC_STOP_ADV:
+        break;
+    case ADV_PROC_CONNECT_PREV:
+        NRF_LOG_INFO("Disconnect old dev");
+        advReconnectDisconnect();
+        break;
+    case ADV_PROC_CONNECT:
+        NRF_LOG_INFO("No device on the list");
+        advReconnectAdvStop();
+        break;
+    }
+}
+
+
+static void advDirectProc(nrfBLEAdvEvT inEv, uint16_t peerId)
+{
+    switch(inEv)
+    {
+    case ADV_PROC_START_CONNECT: // 1
+        NRF_LOG_INFO("CONNECT");
+        switch(advDirOrdConnState.phase)
+        {
+        case DEV_SCANNING:  // add device to the list of device that was detected
+        {
+            uint8_t pos;
+            // disconnect input connection
+            NRF_LOG_INFO("_SCANNING_");
+            if(!reconnectState.isScanDetected)
+            {
+                reconnectState.isScanDetected = true;
+                reconnectTraceAdd(TRACE_FIRST_BONDED_CONNECTED, peerId);
+            }
+
+            uint8_t cnt = 0;
+            for(; cnt < reconnectState.whitelistPeerCnt; cnt++)
+            {
+                if(reconnectState.whitelistPeers[cnt] == peerId)
+                {
+                    break;
+                }
+
+            }
+            if(cnt < reconnectState.whitelistPeerCnt)
+            {
+                NRF_LOG_INFO("remove dev %d", reconnectState.whitelistPeers[cnt] );
+                for(; cnt < (reconnectState.whitelistPeerCnt - 1); cnt++)
+                {
+                    reconnectState.whitelistPeers[cnt] = reconnectState.whitelistPeers[cnt+1];
+                }
+                reconnectState.whitelistPeerCnt--;
+                reconnectState.whitelistPeers[cnt] = ADV_RECONNECT_PEER_INVALID;
+                NRF_LOG_INFO("PDL quan %d", reconnectState.whitelistPeerCnt);
+            }
+            //disconnect current device
+            advReconnectDisconnect();
+
+            NRF_LOG_INFO("--------Dev in list ? %d", peerId);
+            // order may hold more peers than white list, only first ADV_RECONNECT_PEER_QUANTITY by rank take part
+            if(orderGetRankPos(reconnectState.deviceOrder, peerId, &pos) && pos < ADV_RECONNECT_PEER_QUANTITY)
+            {
+                NRF_LOG_INFO("Dev find %d  %d ", peerId, pos);
+                if(advDirOrdConnState.listDetectedDev[pos] == DETECTED_DEV_FREE)
+                {
+                    NRF_LOG_INFO("Dev save");
+                    advDirOrdConnState.listDetectedDev[pos] = peerId;
+                    advDirOrdConnState.quantityDetectedDev++;
+                    reconnectState.lastDetectTime = getTime();
+                    if(reconnectState.scanRule.quietTime != 0)
+                    {
+                        timerRun(reconnectState.scanQuietTimerCallback, reconnectState.scanRule.quietTime);
+                    }
+                }
+            }
+            if(advScanIsEnough())
+            {
+                // removal is not applied: connection phase sets its own white list right after scan stop
+                advScanFinish();
+            }
+            else
+            {
+                advWhitelistCommit();   // advertising is restarted after disconnect, without detected device
+            }
+        }
+        break;
+        case DEV_CONNECTION:// DO NOTHING (continue connection processing)
+            /*DISCONNECT CURRENT DEVICE IF IT PEER ID DON'T EQUAL CURRENT DEVICE FROM WHITE LIST !!!! */
+            NRF_LOG_INFO("_CONNECTION_");
+            if(advConnectIsRejected(peerId))
+            {
+                NRF_LOG_INFO("Wait higher rank, reject %d", peerId);
+                advReconnectDisconnect();   // advertising goes on with the same white list
+                break;
+            }
+            timerStop(reconnectState.stopScanAdvTimerCallback);
+            advDirOrdConnState.loopCnt      = 0;
+            advDirOrdConnState.isConnectAny = false;
+            advReconnectAdvStop();
+            break;
+        }
+        break;
+    case ADV_PROC_STOP_ADV:
+        NRF_LOG_INFO("STOP_ADV");
+        switch(advDirOrdConnState.phase)
+        {
+        case DEV_SCANNING: // stop adv for previous phase and start connection to detected devices
+        {
+            uint8_t cnt_1 = 0;
+            uint8_t cnt_2 = 0;
+            NRF_LOG_INFO("_SCANNING_");
+            NRF_LOG_INFO("Find %d", advDirOrdConnState.quantityDetectedDev);
+            reconnectTraceAdd(TRACE_SCAN_STOP, TRACE_PEER_NONE);
+            timerStop(reconnectState.scanQuietTimerCallback);
+            // if device wasn't detected  start adv again
+            if(advDirOrdConnState.quantityDetectedDev == 0)
+            {
+                advReconnectSetStart(ADV_RECONNECT_SCAN , 0);
+                break;
+            }
+            // shift all devices on list UP
+            for(cnt_1 = 0; cnt_1 < ADV_RECONNECT_PEER_QUANTITY - 1; cnt_1++)
+            {
+                for(cnt_2 = ADV_RECONNECT_PEER_QUANTITY-1; cnt_2 > 0; cnt_2--)
+                {
+                    if(advDirOrdConnState.listDetectedDev[cnt_2 - 1] == DETECTED_DEV_FREE &&
+                            advDirOrdConnState.listDetectedDev[cnt_2 ]    != DETECTED_DEV_FREE)
+                    {
+                        advDirOrdConnState.listDetectedDev[cnt_2 - 1] = advDirOrdConnState.listDetectedDev[cnt_2 ];
+                        advDirOrdConnState.listDetectedDev[cnt_2 ]    = DETECTED_DEV_FREE;
+                    }
+                }
+            }
+
+            advDirOrdConnState.connectCnt = 0;
+            advDirOrdConnState.phase      = DEV_CONNECTION;
+            if(reconnectState.strategy == ADV_CONNECT_PARALLEL)
+            {
+                advConnectAllStart();
+                break;
+            }
+            advReconnectSetStart(ADV_RECONNECT_CONNECT , advDirOrdConnState.listDetectedDev[advDirOrdConnState.connectCnt]);
+        }
+        break;
+        case DEV_CONNECTION:   /*
+            on this point I can go in two cases:
+            - current device from WL was not able connect
+            - LAST DEVICE THAT WAS IN CONNECT-> DISACONNECT STATE BEFOR STOP SCANNIN WAS DISCONNECTED
+
+            */
+            NRF_LOG_INFO("_CONNECTION_");
+            if(advDirOrdConnState.isConnectAny)
+            {
+                break;
+            }
+            advDirOrdConnState.connectCnt++;
+            if(reconnectState.strategy == ADV_CONNECT_PARALLEL) // all detected devices were already tried at once
+            {
+                advDirOrdConnState.connectCnt = advDirOrdConnState.quantityDetectedDev;
+            }
+            if(advDirOrdConnState.connectCnt >= advDirOrdConnState.quantityDetectedDev)
+            {
+
+                advDirOrdConnState.loopCnt++;
+
+                if(advDirOrdConnState.loopCnt >= DIRECT_CONN_QUANTITY)
+                {
+                    // start general advertising
+                    advConnectAnyStart();
+                    break;
+                }
+                // start scanning again
+                advDetectedClear();
+                advDirOrdConnState.connectCnt = 0;
+                advDirOrdConnState.phase      = DEV_SCANNING;
+                advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+                break;
+            }
+            // shift to next detected device
+            advReconnectSetStart(ADV_RECONNECT_CONNECT, advDirOrdConnState.listDetectedDev[advDirOrdConnState.connectCnt]);
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+
+void advReconnectProcessing(nrfBLEAdvEvT inEv, uint16_t peerId)
+{
+    switch(reconnectState.currentAdvType)
+    {
+    case ADV_ADD_NEW:
+        NRF_LOG_INFO("ADV_ADD_NEW");
+        advAddNewProc(inEv, peerId);
+        break;
+    case ADV_RECONNECT_SCAN:
+        NRF_LOG_INFO("ADV_SCAN");
+        advDirectProc(inEv, peerId);
+        break;
+    case ADV_RECONNECT_CONNECT:
+        NRF_LOG_INFO("ADV_CONNECT");
+        advDirectProc(inEv, peerId);
+        break;
+    default:
+        break;
+    }
+}
+
+
+void advReconnectScanStopCB(void *context)
+{
+    (void)context;
+    NRF_LOG_INFO("Stop Scan");
+    advReconnectAdvStop();
+    advReconnectProcessing(ADV_PROC_STOP_ADV, 0);
+}
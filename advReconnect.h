@@ -0,0 +1,103 @@
+/*file: advReconnect.h
+ *
+ * Reconnect state machine: direct connect to bonded devices according order.
+ * This process include two phase: scanning, one item white list advertising
+ *   - scanning:   high density advertising with rejection ALL input connection for detect device from white list around
+ *   - connection: advertising with ONE WHITE LIST device and serially switch device on white list (serial strategy)
+ *                 OR advertising with all detected devices on white list, connection of lower ranked device is
+ *                 rejected while higher ranked one is expected during ADV_RECONNECT_GRACE_TIME (parallel strategy)
+ * Each white list of connection phase is advertised during ADV_RECONNECT_CONNECT_TIMEOUT, then next one is taken,
+ * after the last one scanning starts again. After DIRECT_CONN_QUANTITY such loops without connection all bonded
+ * devices are white listed and first connected one is accepted.
+ * Scanning is over on ADV_RECONNECT_SCAN_TIMEOUT or earlier when scan stop rule is satisfied
+ * (decision is pure function advReconnectScanIsEnough(), it can be checked on recorded detection timelines).
+ * White list is applied differentially: it is given to peer manager only when it differs from the applied one,
+ * changes made between two advertising restarts are applied once (advReconnectWhitelistGetStat() counts it).
+ * Module don't call SoftDevice/peer manager directly, all radio actions go through USER IMPLEMENTED FUNCTION,
+ * time and timeouts go through systemTime, so module can be built on host against stand-in implementation.
+*/
+
+#ifndef ADVRECONNECT_H_
+#define ADVRECONNECT_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "orderProcessing.h"
+
+#define ADV_RECONNECT_PEER_QUANTITY   5         // equal BLE_GAP_WHITELIST_ADDR_MAX_COUNT
+#define ADV_RECONNECT_PEER_INVALID    0xFFFF    // equal PM_PEER_ID_INVALID
+#define ADV_RECONNECT_SCAN_TIMEOUT    10000
+#define DIRECT_CONN_QUANTITY          0x3
+#define ADV_RECONNECT_CONNECT_TIMEOUT 3000      // ms, white list switch of connection phase
+#define ADV_RECONNECT_GRACE_TIME      1500      // ms, parallel strategy waits higher ranked device
+#define ADV_SCAN_STOP_TOP             true      // default scan stop rule
+#define ADV_SCAN_STOP_TOP_K           0
+#define ADV_SCAN_STOP_QUIET_TIME      0
+
+typedef enum
+{
+    ADV_PROC_START_CONNECT,
+    ADV_PROC_STOP_ADV,
+    ADV_PROC_CONNECT_PREV,
+    ADV_PROC_CONNECT
+}nrfBLEAdvEvT;
+
+typedef enum
+{
+    ADV_IDLE,              // Mo advertising
+    ADV_ADD_NEW,           // after press connect pushbutton
+    ADV_RECONNECT_SCAN,    // after power on with bonds    OR after disconnect
+    ADV_RECONNECT_CONNECT,
+}advTypeT;
+
+typedef enum
+{
+    ADV_CONNECT_SERIAL,    // one device on white list, switch to next one after advertising timeout
+    ADV_CONNECT_PARALLEL,  // all detected devices on white list, prune by rank during grace time
+}advConnectStrategyT;
+
+typedef struct
+{
+    bool     isTopStop;            // stop when rank first device is detected
+    uint8_t  topK;                 // stop when all of rank first K devices are detected, 0 - off
+    uint32_t quietTime;            // ms, stop when no new device is detected during this time, 0 - off
+}advScanStopRuleT;                 // scan stops anyway when all devices are detected
+
+typedef struct
+{
+    uint32_t applyPerformed;       // white list is given to peer manager/SoftDevice
+    uint32_t applySkipped;         // white list is the same as applied one, SoftDevice calls are skipped
+}advWhitelistStatT;
+
+typedef struct
+{
+    uint32_t detectedRankMask;     // bit N - device with rank position N is detected
+    uint8_t  candidateQuantity;    // devices that can be detected
+    uint32_t quietTime;            // ms from last new detection
+}advScanProgressT;
+
+
+void     advReconnectInit         (orderT deviceOrderIn);
+void     advReconnectSetStart     (advTypeT advType, uint16_t peerId);
+void     advReconnectProcessing   (nrfBLEAdvEvT inEv, uint16_t peerId);
+void     advReconnectScanStopCB   (void *context);
+advTypeT advReconnectGetType      (void);
+void     advReconnectSetStrategy  (advConnectStrategyT strategy);
+advConnectStrategyT advReconnectGetStrategy(void);
+void     advReconnectSetScanRule  (advScanStopRuleT rule);
+bool     advReconnectScanIsEnough (const advScanStopRuleT *rule, const advScanProgressT *progress);
+bool     advReconnectWhitelistAdd (uint16_t peerId);
+uint32_t advReconnectWhitelistGetQuantity(void);
+void     advReconnectWhitelistInvalidate(void);
+void     advReconnectWhitelistGetStat(advWhitelistStatT *stat);
+
+
+/*********USER IMPLEMENTED FUNCTION****************/
+void     advReconnectAdvStart     (void);
+void     advReconnectAdvStop      (void);
+void     advReconnectDisconnect   (void);
+void     advReconnectWhitelistSet (const uint16_t peers[], uint32_t peersQuantity);
+uint32_t advReconnectPeerListGet  (uint16_t peers[], uint32_t peersMaxQuantity);
+
+#endif
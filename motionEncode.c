@@ -0,0 +1,124 @@
+/*file: motionEncode.c
+ *
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "motionEncode.h"
+
+#if defined(__ARM_FEATURE_SIMD32) || defined(__ARM_FEATURE_DSP)
+#include "nrf.h"                    // CMSIS SIMD intrinsics
+#define MOTION_ENCODE_SIMD   1
+#else
+#define MOTION_ENCODE_SIMD   0
+#endif
+
+
+#if MOTION_ENCODE_SIMD
+
+// x in low halfword, y in high one, each saturated to int16 first
+static uint32_t motionPairPack(const int32_t xy[2])
+{
+    return __PKHBT((uint32_t)__SSAT(xy[0], 16), (uint32_t)__SSAT(xy[1], 16), 16);
+}
+
+
+// SSAT16 range is -2^(n-1)..2^(n-1)-1, field is symmetric: halfword below -max is replaced by -max
+static uint32_t motionPairSymmetric(uint32_t pair, uint32_t minPair)
+{
+    (void)__SSUB16(pair, minPair);  // GE flags of halfword are set when it is >= -max
+    return __SEL(pair, minPair);
+}
+
+
+static void motionPairSaturate(motionEncodeT encode, const int32_t xy[2], int32_t sat[2])
+{
+    uint32_t pair = motionPairPack(xy);
+
+    switch(encode)
+    {
+    case MOTION_ENCODE_BOOT:
+        pair = motionPairSymmetric((uint32_t)__SSAT16(pair, 8), 0xFF81FF81);     // -127, -127
+        break;
+    case MOTION_ENCODE_12:
+        pair = motionPairSymmetric((uint32_t)__SSAT16(pair, 12), 0xF801F801);    // -2047, -2047
+        break;
+    case MOTION_ENCODE_16:
+    default:
+        pair = motionPairSymmetric(pair, 0x80018001);                            // -32767, -32767
+        break;
+    }
+    sat[0] = (int16_t)(pair & 0xFFFF);
+    sat[1] = (int16_t)(pair >> 16);
+}
+
+#else
+
+static int32_t motionSaturate(int32_t value, int32_t max)
+{
+    if(value > max)
+    {
+        return max;
+    }
+    if(value < -max)
+    {
+        return -max;
+    }
+    return value;
+}
+
+
+static void motionPairSaturate(motionEncodeT encode, const int32_t xy[2], int32_t sat[2])
+{
+    int32_t max;
+
+    switch(encode)
+    {
+    case MOTION_ENCODE_BOOT:
+        max = MOTION_ENCODE_BOOT_MAX;
+        break;
+    case MOTION_ENCODE_12:
+        max = MOTION_ENCODE_12_MAX;
+        break;
+    case MOTION_ENCODE_16:
+    default:
+        max = MOTION_ENCODE_16_MAX;
+        break;
+    }
+    sat[0] = motionSaturate(xy[0], max);
+    sat[1] = motionSaturate(xy[1], max);
+}
+
+#endif
+
+
+// encode saturated x/y, xy keeps the rest for next report; returns length of encoded data
+uint8_t motionEncodeXY(motionEncodeT encode, int32_t xy[2], uint8_t data[])
+{
+    int32_t sat[2];
+
+    motionPairSaturate(encode, xy, sat);
+    xy[0] -= sat[0];
+    xy[1] -= sat[1];
+
+    switch(encode)
+    {
+    case MOTION_ENCODE_BOOT:
+        data[0] = (uint8_t)sat[0];
+        data[1] = (uint8_t)sat[1];
+        return 2;
+    case MOTION_ENCODE_12:
+        data[0] = sat[0] & 0xFF;
+        data[1] = ((sat[1] & 0x0F) << 4) | ((sat[0] >> 8) & 0x0F);
+        data[2] = (sat[1] >> 4) & 0xFF;
+        return 3;
+    case MOTION_ENCODE_16:
+    default:
+        data[0] = sat[0] & 0xFF;
+        data[1] = (sat[0] >> 8) & 0xFF;
+        data[2] = sat[1] & 0xFF;
+        data[3] = (sat[1] >> 8) & 0xFF;
+        return 4;
+    }
+}
@@ -0,0 +1,32 @@
+/*file: motionEncode.h
+ *
+ * Mouse HID report x/y encoder: signed saturation to field of protocol mode, part of motion beyond the field
+ * stays in caller's x/y (carry) and goes in next report, so delta of any size and sign keeps its direction.
+ * Field range is symmetric (-max..max) as logical range of report descriptor:
+ *   - MOTION_ENCODE_BOOT: x, y int8 (-127..127), boot mouse report
+ *   - MOTION_ENCODE_12:   x, y 12 bit (-2047..2047) in 3 bytes: x low byte, x high nibble | y low nibble << 4,
+ *                         y high byte
+ *   - MOTION_ENCODE_16:   x, y 16 bit (-32767..32767) little endian in 4 bytes
+ * On Cortex-M4 x/y pair is saturated at once by SIMD instructions (SSAT16), other targets (host) use C.
+*/
+
+#ifndef MOTIONENCODE_H_
+#define MOTIONENCODE_H_
+
+#include "stdint.h"
+
+#define MOTION_ENCODE_BOOT_MAX   127
+#define MOTION_ENCODE_12_MAX     2047
+#define MOTION_ENCODE_16_MAX     32767
+
+typedef enum
+{
+    MOTION_ENCODE_BOOT,
+    MOTION_ENCODE_12,
+    MOTION_ENCODE_16,
+}motionEncodeT;
+
+
+uint8_t motionEncodeXY(motionEncodeT encode, int32_t xy[2], uint8_t data[]);
+
+#endif
@@ -0,0 +1,463 @@
+/*file: mouseMotion.c
+ *
+*/
+
+#include "stdint.h"
+#include "string.h"
+#include "stdbool.h"
+
+#include "mouseMotion.h"
+#include "motionEncode.h"
+
+#if MOTION_XY_BITS == 12
+#define MOTION_XY_ENCODE    MOTION_ENCODE_12
+#elif MOTION_XY_BITS == 16
+#define MOTION_XY_ENCODE    MOTION_ENCODE_16
+#else
+#error "MOTION_XY_BITS should be 12 or 16"
+#endif
+
+
+typedef enum
+{
+    AXIS_X,
+    AXIS_Y,
+    AXIS_WHEEL,
+    AXIS_PAN,
+    AXIS_QUANTITY,
+}motionAxisT;
+
+static struct
+{
+    int32_t     integrator[AXIS_QUANTITY];   // Q.MOTION_FRACTION_BITS counts not yet reported
+    uint16_t    scale;                       // x/y scale, MOTION_SCALE_ONE - 1.0
+    uint8_t     buttons;
+    bool        isButtonsPending;
+    bool        isConnected;
+    bool        isBootMode;
+    bool        isSync;                      // report is sent only before connection event
+    uint8_t     txBuffers;                   // TX buffers of connection
+    uint8_t     txFree;                      // TX buffers that can be used now
+    motionStatT stat;
+}motionState =
+{
+    .scale = MOTION_SCALE_ONE,
+};
+
+
+static void motionClear(void)
+{
+    memset(motionState.integrator, 0, sizeof(motionState.integrator));
+    motionState.isButtonsPending = false;
+}
+
+
+void motionInit(void)
+{
+    motionClear();
+    motionState.isConnected = false;
+    memset(&motionState.stat, 0, sizeof(motionState.stat));
+}
+
+
+// report buffers are counted per connection, value of connection config (hvn_tx_queue_size)
+void motionConnect(uint8_t txBuffers)
+{
+    motionClear();
+    motionState.buttons     = 0;
+    motionState.txBuffers   = txBuffers;
+    motionState.txFree      = txBuffers;
+    motionState.isConnected = true;
+}
+
+
+void motionDisconnect(void)
+{
+    motionClear();
+    motionState.isConnected = false;
+}
+
+
+void motionSetBootMode(bool isBootMode)
+{
+    motionState.isBootMode             = isBootMode;
+    motionState.integrator[AXIS_WHEEL] = 0;
+    motionState.integrator[AXIS_PAN]   = 0;
+}
+
+
+// sensor counts to report counts for x/y, MOTION_SCALE_ONE - 1.0
+void motionSetScale(uint16_t scale)
+{
+    motionState.scale = scale;
+}
+
+
+static uint32_t motionAbs(int32_t value)
+{
+    return (value < 0) ? -value : value;
+}
+
+
+static void motionIntegrate(motionAxisT axis, int32_t value)
+{
+    const int64_t limit = (int64_t)MOTION_INTEGRATOR_MAX * MOTION_SCALE_ONE;
+    int64_t       sum   = (int64_t)motionState.integrator[axis] + value;
+
+    if(sum > limit || sum < -limit)
+    {
+        // link stalls too long, such backlog is not worth to replay
+        motionState.stat.droppedCounts += (uint32_t)(((sum > 0) ? sum - limit : -sum - limit) / MOTION_SCALE_ONE);
+        sum = (sum > 0) ? limit : -limit;
+    }
+    motionState.integrator[axis] = (int32_t)sum;
+}
+
+
+void motionAdd(int16_t x, int16_t y, int8_t wheel, int8_t pan)
+{
+    if(!motionState.isConnected)
+    {
+        return;
+    }
+    motionIntegrate(AXIS_X,     (int32_t)x * motionState.scale);
+    motionIntegrate(AXIS_Y,     (int32_t)y * motionState.scale);
+    if(!motionState.isBootMode)     // boot report has no wheel/pan
+    {
+        motionIntegrate(AXIS_WHEEL, (int32_t)wheel * MOTION_SCALE_ONE);
+        motionIntegrate(AXIS_PAN,   (int32_t)pan * MOTION_SCALE_ONE);
+    }
+}
+
+
+void motionSetButtons(uint8_t buttons)
+{
+    if(!motionState.isConnected || buttons == motionState.buttons)
+    {
+        return;
+    }
+    motionState.buttons          = buttons;
+    motionState.isButtonsPending = true;
+}
+
+
+// synchronized mode needs motionConnEventPrepare() before each connection event (radio notification)
+void motionSetSync(bool isSync)
+{
+    motionState.isSync = isSync;
+}
+
+
+// count from BLE_GATTS_EVT_HVN_TX_COMPLETE, buffers used by other notifications come back here too
+void motionTxComplete(uint8_t count)
+{
+    uint32_t txFree = motionState.txFree + count;
+
+    motionState.txFree = (txFree > motionState.txBuffers) ? motionState.txBuffers : txFree;
+    motionProcess();
+}
+
+
+static bool motionIsAxisPending(motionAxisT axis)
+{
+    return motionAbs(motionState.integrator[axis]) >= MOTION_SCALE_ONE;
+}
+
+
+// whole counts of axis that fit report field, fraction and remainder stay in integrator
+static int32_t motionTake(int32_t integrator[], motionAxisT axis, int32_t max)
+{
+    int32_t counts = integrator[axis] / MOTION_SCALE_ONE;   // toward zero, fraction keeps its sign
+
+    if(counts > max)
+    {
+        counts = max;
+    }
+    else if(counts < -max)
+    {
+        counts = -max;
+    }
+    integrator[axis] -= counts * MOTION_SCALE_ONE;
+    return counts;
+}
+
+
+// whole x/y counts encoded by saturation to report field, fraction and residue stay in integrator; returns length
+static uint8_t motionTakeXY(int32_t integrator[], motionEncodeT encode, uint8_t data[])
+{
+    int32_t xy[2];
+    uint8_t len;
+
+    xy[0] = integrator[AXIS_X] / MOTION_SCALE_ONE;
+    xy[1] = integrator[AXIS_Y] / MOTION_SCALE_ONE;
+    integrator[AXIS_X] -= xy[0] * MOTION_SCALE_ONE;
+    integrator[AXIS_Y] -= xy[1] * MOTION_SCALE_ONE;
+    len = motionEncodeXY(encode, xy, data);
+    integrator[AXIS_X] += xy[0] * MOTION_SCALE_ONE;
+    integrator[AXIS_Y] += xy[1] * MOTION_SCALE_ONE;
+    return len;
+}
+
+
+// build next report from copy of integrator, so integrator is changed only when report is queued
+static bool motionReportBuild(int32_t integrator[], motionReportT *report, uint8_t data[], uint8_t *len)
+{
+    bool isXYPending    = motionIsAxisPending(AXIS_X) || motionIsAxisPending(AXIS_Y);
+    bool isWheelPending = motionIsAxisPending(AXIS_WHEEL) || motionIsAxisPending(AXIS_PAN);
+
+    if(motionState.isBootMode)
+    {
+        if(!motionState.isButtonsPending && !isXYPending)
+        {
+            return false;
+        }
+        *report = MOTION_REPORT_BOOT;
+        data[0] = motionState.buttons;
+        *len    = 1 + motionTakeXY(integrator, MOTION_ENCODE_BOOT, &data[1]);
+        return true;
+    }
+    if(MOTION_COMBINED_REPORT)
+    {
+        if(!motionState.isButtonsPending && !isXYPending && !isWheelPending)
+        {
+            return false;
+        }
+        *report = MOTION_REPORT_COMBINED;
+        data[0] = motionState.buttons;
+        *len    = 1 + motionTakeXY(integrator, MOTION_XY_ENCODE, &data[1]);
+        data[(*len)++] = (uint8_t)motionTake(integrator, AXIS_WHEEL, MOTION_WHEEL_MAX);
+        data[(*len)++] = (uint8_t)motionTake(integrator, AXIS_PAN,   MOTION_WHEEL_MAX);
+        return true;
+    }
+    if(motionState.isButtonsPending || isWheelPending)
+    {
+        *report = MOTION_REPORT_BUTTONS;
+        *len    = 3;
+        data[0] = motionState.buttons;
+        data[1] = (uint8_t)motionTake(integrator, AXIS_WHEEL, MOTION_WHEEL_MAX);
+        data[2] = (uint8_t)motionTake(integrator, AXIS_PAN,   MOTION_WHEEL_MAX);
+        return true;
+    }
+    if(isXYPending)
+    {
+        *report = MOTION_REPORT_MOVEMENT;
+        *len    = motionTakeXY(integrator, MOTION_XY_ENCODE, data);
+        return true;
+    }
+    return false;
+}
+
+
+// one report per free TX buffer while there is something to report
+static void motionSend(void)
+{
+    int32_t           integrator[AXIS_QUANTITY];
+    uint8_t           data[MOTION_REPORT_MAX_LEN];
+    uint8_t           len;
+    motionReportT     report;
+    motionSendResultT result;
+    motionAxisT       first;
+
+    while(motionState.isConnected && motionState.txFree != 0)
+    {
+        memcpy(integrator, motionState.integrator, sizeof(integrator));
+        if(!motionReportBuild(integrator, &report, data, &len))
+        {
+            return;
+        }
+        result = motionReportSend(report, data, len);
+        switch(result)
+        {
+        case MOTION_SEND_OK:
+            motionState.stat.reports++;
+            motionState.txFree--;
+            memcpy(motionState.integrator, integrator, sizeof(integrator));
+            if(report != MOTION_REPORT_MOVEMENT)
+            {
+                motionState.isButtonsPending = false;
+            }
+            first = (report == MOTION_REPORT_BUTTONS) ? AXIS_WHEEL : AXIS_X;
+            if(motionIsAxisPending(first) || motionIsAxisPending(first + 1) ||
+               (report == MOTION_REPORT_COMBINED && (motionIsAxisPending(AXIS_WHEEL) || motionIsAxisPending(AXIS_PAN))))
+            {
+                motionState.stat.carried++;     // report field was not enough for motion of its axes
+            }
+            break;
+        case MOTION_SEND_BUSY:
+            // buffer is used by other notification, wait motionTxComplete()
+            motionState.stat.busy++;
+            motionState.txFree = 0;
+            return;
+        case MOTION_SEND_DROP:
+        default:
+            motionState.stat.droppedCounts += (motionAbs(motionState.integrator[AXIS_X]) +
+                                               motionAbs(motionState.integrator[AXIS_Y])) / MOTION_SCALE_ONE;
+            motionClear();
+            return;
+        }
+    }
+}
+
+
+// new motion or free TX buffer, in synchronized mode report waits connection event lead time
+void motionProcess(void)
+{
+    if(!motionState.isSync)
+    {
+        motionSend();
+    }
+}
+
+
+// lead time before connection event: sample sensor and queue report, it goes on air in this event
+void motionConnEventPrepare(void)
+{
+    if(!motionState.isConnected)
+    {
+        return;
+    }
+    motionSensorSample();
+    motionSend();
+}
+
+
+bool motionIsPending(void)
+{
+    return motionState.isButtonsPending ||
+           motionIsAxisPending(AXIS_X) || motionIsAxisPending(AXIS_Y) ||
+           motionIsAxisPending(AXIS_WHEEL) || motionIsAxisPending(AXIS_PAN);
+}
+
+
+void motionGetStat(motionStatT *stat)
+{
+    *stat = motionState.stat;
+}
+
+
+/*********HID report map****************/
+// report map of HID service, reports of this module (MOTION_COMBINED_REPORT, MOTION_XY_BITS) and media player
+static const uint8_t motionReportMap[] =
+{
+    0x05, 0x01, // Usage Page (Generic Desktop)
+    0x09, 0x02, // Usage (Mouse)
+
+    0xA1, 0x01, // Collection (Application)
+
+#if MOTION_COMBINED_REPORT
+    // Report ID 1: Mouse buttons + motion + scroll/pan
+    0x85, 0x01,       // Report Id 1
+    0x09, 0x01,       // Usage (Pointer)
+    0xA1, 0x00,       // Collection (Physical)
+    0x95, 0x05,       // Report Count (5)
+    0x75, 0x01,       // Report Size (1)
+    0x05, 0x09,       // Usage Page (Buttons)
+    0x19, 0x01,       // Usage Minimum (01)
+    0x29, 0x05,       // Usage Maximum (05)
+    0x15, 0x00,       // Logical Minimum (0)
+    0x25, 0x01,       // Logical Maximum (1)
+    0x81, 0x02,       // Input (Data, Variable, Absolute)
+    0x95, 0x01,       // Report Count (1)
+    0x75, 0x03,       // Report Size (3)
+    0x81, 0x01,       // Input (Constant) for padding
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x30,       // Usage (X)
+    0x09, 0x31,       // Usage (Y)
+    0x16, (uint8_t)(-MOTION_XY_MAX), (uint8_t)(-MOTION_XY_MAX >> 8), // Logical Minimum
+    0x26, (uint8_t)MOTION_XY_MAX, (uint8_t)(MOTION_XY_MAX >> 8),     // Logical Maximum
+    0x75, MOTION_XY_BITS, // Report Size (12 or 16)
+    0x95, 0x02,       // Report Count (2)
+    0x81, 0x06,       // Input (Data, Variable, Relative)
+    0x09, 0x38,       // Usage (Wheel)
+    0x15, 0x81,       // Logical Minimum (-127)
+    0x25, 0x7F,       // Logical Maximum (127)
+    0x75, 0x08,       // Report Size (8)
+    0x95, 0x01,       // Report Count (1)
+    0x81, 0x06,       // Input (Data, Variable, Relative)
+    0x05, 0x0C,       // Usage Page (Consumer)
+    0x0A, 0x38, 0x02, // Usage (AC Pan)
+    0x95, 0x01,       // Report Count (1)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0xC0,             // End Collection (Physical)
+    0xC0,             // End Collection (Application)
+#else
+    // Report ID 1: Mouse buttons + scroll/pan
+    0x85, 0x01,       // Report Id 1
+    0x09, 0x01,       // Usage (Pointer)
+    0xA1, 0x00,       // Collection (Physical)
+    0x95, 0x05,       // Report Count (3)
+    0x75, 0x01,       // Report Size (1)
+    0x05, 0x09,       // Usage Page (Buttons)
+    0x19, 0x01,       // Usage Minimum (01)
+    0x29, 0x05,       // Usage Maximum (05)
+    0x15, 0x00,       // Logical Minimum (0)
+    0x25, 0x01,       // Logical Maximum (1)
+    0x81, 0x02,       // Input (Data, Variable, Absolute)
+    0x95, 0x01,       // Report Count (1)
+    0x75, 0x03,       // Report Size (3)
+    0x81, 0x01,       // Input (Constant) for padding
+    0x75, 0x08,       // Report Size (8)
+    0x95, 0x01,       // Report Count (1)
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x38,       // Usage (Wheel)
+    0x15, 0x81,       // Logical Minimum (-127)
+    0x25, 0x7F,       // Logical Maximum (127)
+    0x81, 0x06,       // Input (Data, Variable, Relative)
+    0x05, 0x0C,       // Usage Page (Consumer)
+    0x0A, 0x38, 0x02, // Usage (AC Pan)
+    0x95, 0x01,       // Report Count (1)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0xC0,             // End Collection (Physical)
+
+    // Report ID 2: Mouse motion
+    0x85, 0x02,       // Report Id 2
+    0x09, 0x01,       // Usage (Pointer)
+    0xA1, 0x00,       // Collection (Physical)
+    0x75, MOTION_XY_BITS, // Report Size (12 or 16)
+    0x95, 0x02,       // Report Count (2)
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x30,       // Usage (X)
+    0x09, 0x31,       // Usage (Y)
+    0x16, (uint8_t)(-MOTION_XY_MAX), (uint8_t)(-MOTION_XY_MAX >> 8), // Logical Minimum
+    0x26, (uint8_t)MOTION_XY_MAX, (uint8_t)(MOTION_XY_MAX >> 8),     // Logical Maximum
+    0x81, 0x06,       // Input (Data, Variable, Relative)
+    0xC0,             // End Collection (Physical)
+    0xC0,             // End Collection (Application)
+#endif
+
+    // Report ID 3: Advanced buttons
+    0x05, 0x0C,       // Usage Page (Consumer)
+    0x09, 0x01,       // Usage (Consumer Control)
+    0xA1, 0x01,       // Collection (Application)
+    0x85, 0x03,       // Report Id (3)
+    0x15, 0x00,       // Logical minimum (0)
+    0x25, 0x01,       // Logical maximum (1)
+    0x75, 0x01,       // Report Size (1)
+    0x95, 0x01,       // Report Count (1)
+
+    0x09, 0xCD,       // Usage (Play/Pause)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0x0A, 0x83, 0x01, // Usage (AL Consumer Control Configuration)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0x09, 0xB5,       // Usage (Scan Next Track)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0x09, 0xB6,       // Usage (Scan Previous Track)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+
+    0x09, 0xEA,       // Usage (Volume Down)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0x09, 0xE9,       // Usage (Volume Up)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0x0A, 0x25, 0x02, // Usage (AC Forward)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0x0A, 0x24, 0x02, // Usage (AC Back)
+    0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
+    0xC0              // End Collection
+};
+
+
+const uint8_t *motionReportMapGet(uint16_t *len)
+{
+    *len = sizeof(motionReportMap);
+    return motionReportMap;
+}
@@ -0,0 +1,86 @@
+/*file: mouseMotion.h
+ *
+ * Lossless motion pipeline: x/y/wheel/pan deltas are accumulated in fixed point integrator, HID report is
+ * built from integrator only when SoftDevice has free notification TX buffer, so motion is never dropped
+ * when link is busy, it is sent in next report instead.
+ *   - one report per free TX buffer, buffers come back on BLE_GATTS_EVT_HVN_TX_COMPLETE (motionTxComplete())
+ *   - motion beyond report range is carried to the next report, not clamped (x/y encoded by motionEncode)
+ *   - pending buttons change is sent first, it carries wheel/pan (report ID 1), x/y go in report ID 2
+ *   - OR with MOTION_COMBINED_REPORT buttons, x/y, wheel, pan go in one report (report ID 1 of combined map),
+ *     so click while drag costs one notification and can't be reordered relative to motion
+ *   - synchronized mode: sensor is sampled and report is queued a fixed lead time before each connection
+ *     event (motionConnEventPrepare() from radio notification), so report leaves with the freshest motion,
+ *     motion added between events waits for this point instead of being sent at random time of interval
+ * Module don't call SoftDevice/HID service directly, report goes through USER IMPLEMENTED FUNCTION,
+ * so module can be built on host against stand-in implementation. HID service takes report map of the same
+ * build options from motionReportMapGet(), so reports and their description can't go apart.
+ * All functions should be called from main context (SoftDevice events dispatched through app_scheduler).
+*/
+
+#ifndef MOUSEMOTION_H_
+#define MOUSEMOTION_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#ifndef MOTION_COMBINED_REPORT
+#define MOTION_COMBINED_REPORT   0                              // 1 - one report for buttons, x/y, wheel, pan
+#endif
+#ifndef MOTION_XY_BITS
+#define MOTION_XY_BITS           12                             // x/y field size of report ID 2/combined: 12 or 16
+#endif
+
+#define MOTION_FRACTION_BITS     8                              // integrator fixed point Q.8
+#define MOTION_SCALE_ONE         (1 << MOTION_FRACTION_BITS)    // x/y scale 1.0
+#define MOTION_XY_MAX            ((1 << (MOTION_XY_BITS - 1)) - 1)  // x/y logical range -max..max
+#define MOTION_XY_LEN            (MOTION_XY_BITS / 4)           // x/y field pair bytes
+#define MOTION_WHEEL_MAX         127                            // 8 bit wheel/pan in report ID 1
+#define MOTION_INTEGRATOR_MAX    (1L << 22)                     // counts, backlog limit while link stalls
+#define MOTION_COMBINED_LEN      (1 + MOTION_XY_LEN + 2)        // buttons, x/y, wheel, pan
+#define MOTION_REPORT_MAX_LEN    (MOTION_COMBINED_REPORT ? MOTION_COMBINED_LEN : MOTION_XY_LEN)
+
+typedef enum
+{
+    MOTION_REPORT_BUTTONS,         // buttons, wheel, pan       (report ID 1)
+    MOTION_REPORT_MOVEMENT,        // x, y 12/16 bit            (report ID 2)
+    MOTION_REPORT_BOOT,            // buttons, x, y 8 bit       (boot mouse input report)
+    MOTION_REPORT_COMBINED,        // buttons, x, y 12/16 bit, wheel, pan   (report ID 1 of combined map)
+}motionReportT;
+
+typedef enum
+{
+    MOTION_SEND_OK,                // report is queued, one TX buffer is used
+    MOTION_SEND_BUSY,              // no TX buffer, report is kept in integrator till motionTxComplete()
+    MOTION_SEND_DROP,              // report can't be delivered (notification is off), motion is discarded
+}motionSendResultT;
+
+typedef struct
+{
+    uint32_t reports;              // reports queued
+    uint32_t busy;                 // report attempts rejected for TX buffer
+    uint32_t carried;              // reports which left motion beyond report range to the next one
+    uint32_t droppedCounts;        // x/y counts discarded (notification is off or backlog limit)
+}motionStatT;
+
+
+void     motionInit        (void);
+void     motionConnect     (uint8_t txBuffers);
+void     motionDisconnect  (void);
+void     motionSetBootMode (bool isBootMode);
+void     motionSetScale    (uint16_t scale);
+void     motionAdd         (int16_t x, int16_t y, int8_t wheel, int8_t pan);
+void     motionSetButtons  (uint8_t buttons);
+void     motionSetSync     (bool isSync);
+void     motionTxComplete  (uint8_t count);
+void     motionProcess     (void);
+void     motionConnEventPrepare(void);
+bool     motionIsPending   (void);
+void     motionGetStat     (motionStatT *stat);
+const uint8_t *motionReportMapGet(uint16_t *len);
+
+
+/*********USER IMPLEMENTED FUNCTION****************/
+motionSendResultT motionReportSend(motionReportT report, const uint8_t data[], uint8_t len);
+void              motionSensorSample(void);       // read sensor and motionAdd() its motion
+
+#endif
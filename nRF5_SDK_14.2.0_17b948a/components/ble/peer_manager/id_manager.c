@@ -57,6 +57,11 @@
 #define IM_ADDR_CLEARTEXT_LENGTH        (3)
 #define IM_ADDR_CIPHERTEXT_LENGTH       (3)
 
+// The number of peers whose identity keys are kept in RAM. 0 disables the cache.
+#ifndef PM_ID_CACHE_SIZE
+    #define PM_ID_CACHE_SIZE            (0)
+#endif
+
 // The number of registered event handlers.
 #define IM_EVENT_HANDLERS_CNT           (sizeof(m_evt_handlers) / sizeof(m_evt_handlers[0]))
 
@@ -92,6 +97,16 @@ static pm_peer_id_t                     m_wlisted_peers[BLE_GAP_WHITELIST_ADDR_M
     static ble_gap_addr_t               m_current_id_addr;
 #endif
 
+#if (PM_ID_CACHE_SIZE > 0)
+typedef struct
+{
+    pm_peer_id_t     peer_id;   /**< The peer the keys belong to, or PM_PEER_ID_INVALID if the entry is free. */
+    ble_gap_id_key_t id_key;    /**< The identity address and IRK from the peer's bonding data. */
+} im_id_cache_entry_t;
+
+static im_id_cache_entry_t              m_id_cache[PM_ID_CACHE_SIZE];
+#endif
+
 
 static void internal_state_reset()
 {
@@ -101,6 +116,13 @@ static void internal_state_reset()
     {
         m_connections[i].conn_handle = BLE_CONN_HANDLE_INVALID;
     }
+
+    #if (PM_ID_CACHE_SIZE > 0)
+        for (uint32_t i = 0; i < PM_ID_CACHE_SIZE; i++)
+        {
+            m_id_cache[i].peer_id = PM_PEER_ID_INVALID;
+        }
+    #endif
 }
 
 
@@ -393,6 +415,187 @@ pm_peer_id_t im_find_duplicate_bonding_data(pm_peer_data_bonding_t const * p_bon
 }
 
 
+#if (PM_ID_CACHE_SIZE > 0)
+
+/**@brief Function for finding the identity key cache entry of a peer.
+ *
+ * @param[in] peer_id The peer to look for, or PM_PEER_ID_INVALID to look for a free entry.
+ *
+ * @return The entry, or NULL if there is none.
+ */
+static im_id_cache_entry_t * id_cache_find(pm_peer_id_t peer_id)
+{
+    for (uint32_t i = 0; i < PM_ID_CACHE_SIZE; i++)
+    {
+        if (m_id_cache[i].peer_id == peer_id)
+        {
+            return &m_id_cache[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for storing the identity keys of a peer in the cache.
+ *
+ * @details If the cache is full, the keys are not stored and will be read from flash instead.
+ */
+static void id_cache_store(pm_peer_id_t peer_id, ble_gap_id_key_t const * p_id_key)
+{
+    im_id_cache_entry_t * p_entry = id_cache_find(peer_id);
+
+    if (p_entry == NULL)
+    {
+        p_entry = id_cache_find(PM_PEER_ID_INVALID);
+    }
+
+    if (p_entry != NULL)
+    {
+        p_entry->peer_id = peer_id;
+        memcpy(&p_entry->id_key, p_id_key, sizeof(ble_gap_id_key_t));
+    }
+}
+
+
+/**@brief Function for dropping the cached identity keys of a peer, if any.
+ */
+static void id_cache_invalidate(pm_peer_id_t peer_id)
+{
+    im_id_cache_entry_t * p_entry = id_cache_find(peer_id);
+
+    if (p_entry != NULL)
+    {
+        p_entry->peer_id = PM_PEER_ID_INVALID;
+    }
+}
+
+
+/**@brief Function for filling the cache with the identity keys of all bonded peers in flash.
+ */
+static void id_cache_populate(void)
+{
+    pm_peer_id_t         peer_id;
+    pm_peer_data_flash_t peer_data;
+
+    pds_peer_data_iterate_prepare();
+
+    while (pds_peer_data_iterate(PM_PEER_DATA_ID_BONDING, &peer_id, &peer_data))
+    {
+        id_cache_store(peer_id, &peer_data.p_bonding_data->peer_ble_id);
+    }
+}
+
+#else
+
+static void id_cache_invalidate(pm_peer_id_t peer_id)
+{
+    UNUSED_PARAMETER(peer_id);
+}
+
+
+static void id_cache_populate(void)
+{
+}
+
+#endif // PM_ID_CACHE_SIZE > 0
+
+
+/**@brief Function for loading the identity address and IRK of a peer.
+ *
+ * @details The keys are taken from the cache when possible, otherwise they are read from the
+ *          peer's bonding data in flash and added to the cache.
+ *
+ * @param[in]  peer_id   The peer to load the keys of.
+ * @param[out] p_id_key  The identity address and IRK of the peer.
+ *
+ * @retval NRF_SUCCESS          If the keys were loaded.
+ * @retval NRF_ERROR_NOT_FOUND  If the peer ID is not valid or the peer has no bonding data.
+ */
+static ret_code_t id_key_load(pm_peer_id_t peer_id, ble_gap_id_key_t * p_id_key)
+{
+    ret_code_t             ret;
+    pm_peer_data_bonding_t bond_data;
+    pm_peer_data_t         peer_data;
+
+    uint32_t const buf_size = sizeof(bond_data);
+
+    #if (PM_ID_CACHE_SIZE > 0)
+        if (peer_id != PM_PEER_ID_INVALID)
+        {
+            im_id_cache_entry_t const * p_entry = id_cache_find(peer_id);
+
+            if (p_entry != NULL)
+            {
+                memcpy(p_id_key, &p_entry->id_key, sizeof(ble_gap_id_key_t));
+                return NRF_SUCCESS;
+            }
+        }
+    #endif
+
+    memset(&peer_data, 0x00, sizeof(peer_data));
+    memset(&bond_data, 0x00, sizeof(bond_data));
+    peer_data.p_bonding_data = &bond_data;
+
+    // Read peer data from flash.
+    ret = pds_peer_data_read(peer_id, PM_PEER_DATA_ID_BONDING, &peer_data, &buf_size);
+
+    if ((ret == NRF_ERROR_NOT_FOUND) || (ret == NRF_ERROR_INVALID_PARAM))
+    {
+        // Peer data coulnd't be found in flash or peer ID is not valid.
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    #if (PM_ID_CACHE_SIZE > 0)
+        // On other read errors the zeroed keys are passed on as before, but not kept: the next call
+        // reads flash again.
+        if (ret == NRF_SUCCESS)
+        {
+            id_cache_store(peer_id, &bond_data.peer_ble_id);
+        }
+    #endif
+
+    memcpy(p_id_key, &bond_data.peer_ble_id, sizeof(ble_gap_id_key_t));
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for handling events from the Peer Database module.
+ *        This function is extern in Peer Database.
+ *
+ * @details Keeps the identity key cache in step with the bonding data in flash.
+ *
+ * @param[in]  p_event  The event to handle.
+ */
+void im_pdb_evt_handler(pm_evt_t * p_event)
+{
+    switch (p_event->evt_id)
+    {
+        case PM_EVT_PEER_DATA_UPDATE_SUCCEEDED:
+            if (p_event->params.peer_data_update_succeeded.data_id == PM_PEER_DATA_ID_BONDING)
+            {
+                ble_gap_id_key_t id_key;
+
+                id_cache_invalidate(p_event->peer_id);
+
+                if (p_event->params.peer_data_update_succeeded.action == PM_PEER_DATA_OP_UPDATE)
+                {
+                    // Reload the new keys so the next whitelist update does not touch flash.
+                    (void)id_key_load(p_event->peer_id, &id_key);
+                }
+            }
+            break;
+
+        case PM_EVT_PEER_DELETE_SUCCEEDED:
+            id_cache_invalidate(p_event->peer_id);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
 ret_code_t im_init(void)
 {
     NRF_PM_DEBUG_CHECK(!m_module_initialized);
@@ -413,6 +616,8 @@ ret_code_t im_init(void)
         }
     #endif
 
+    id_cache_populate();
+
     m_module_initialized = true;
 
     return NRF_SUCCESS;
@@ -570,6 +775,9 @@ ret_code_t im_peer_free(pm_peer_id_t peer_id)
     conn_handle = im_conn_handle_get(peer_id);
     ret         = pdb_peer_free(peer_id);
 
+    // The peer is gone from the application's point of view even before flash is cleaned up.
+    id_cache_invalidate(peer_id);
+
     if ((conn_handle != BLE_CONN_HANDLE_INVALID) && (ret == NRF_SUCCESS))
     {
         peer_id_set(conn_handle, PM_PEER_ID_INVALID);
@@ -587,12 +795,8 @@ static ret_code_t peers_id_keys_get(pm_peer_id_t   const * p_peers,
                                     ble_gap_irk_t        * p_gap_irks,
                                     uint32_t             * p_irk_cnt)
 {
-    ret_code_t ret;
-
-    pm_peer_data_bonding_t bond_data;
-    pm_peer_data_t         peer_data;
-
-    uint32_t const buf_size = sizeof(bond_data);
+    ret_code_t       ret;
+    ble_gap_id_key_t id_key;
 
     bool copy_addrs = false;
     bool copy_irks  = false;
@@ -618,26 +822,18 @@ static ret_code_t peers_id_keys_get(pm_peer_id_t   const * p_peers,
         *p_irk_cnt = 0;
     }
 
-    memset(&peer_data, 0x00, sizeof(peer_data));
-    peer_data.p_bonding_data = &bond_data;
-
-    // Read through flash memory and look for peers ID keys.
+    // Look up the peers' ID keys, in the cache or in flash.
 
     for (uint32_t i = 0; i < peer_cnt; i++)
     {
-        memset(&bond_data, 0x00, sizeof(bond_data));
-
-        // Read peer data from flash.
-        ret = pds_peer_data_read(p_peers[i], PM_PEER_DATA_ID_BONDING,
-                                 &peer_data, &buf_size);
+        ret = id_key_load(p_peers[i], &id_key);
 
-        if ((ret == NRF_ERROR_NOT_FOUND) || (ret == NRF_ERROR_INVALID_PARAM))
+        if (ret != NRF_SUCCESS)
         {
-            // Peer data coulnd't be found in flash or peer ID is not valid.
-            return NRF_ERROR_NOT_FOUND;
+            return ret;
         }
 
-        uint8_t const addr_type = bond_data.peer_ble_id.id_addr_info.addr_type;
+        uint8_t const addr_type = id_key.id_addr_info.addr_type;
 
         if ((addr_type != BLE_GAP_ADDR_TYPE_PUBLIC) &&
             (addr_type != BLE_GAP_ADDR_TYPE_RANDOM_STATIC))
@@ -649,14 +845,14 @@ static ret_code_t peers_id_keys_get(pm_peer_id_t   const * p_peers,
         // Copy the GAP address.
         if (copy_addrs)
         {
-            memcpy(&p_gap_addrs[i], &bond_data.peer_ble_id.id_addr_info, sizeof(ble_gap_addr_t));
+            memcpy(&p_gap_addrs[i], &id_key.id_addr_info, sizeof(ble_gap_addr_t));
             (*p_addr_cnt)++;
         }
 
         // Copy the IRK.
         if (copy_irks)
         {
-            memcpy(&p_gap_irks[i], bond_data.peer_ble_id.id_info.irk, BLE_GAP_SEC_KEY_LEN);
+            memcpy(&p_gap_irks[i], id_key.id_info.irk, BLE_GAP_SEC_KEY_LEN);
             (*p_irk_cnt)++;
         }
     }
@@ -670,9 +866,7 @@ ret_code_t im_device_identities_list_set(pm_peer_id_t const * p_peers,
 {
     #if (NRF_SD_BLE_API_VERSION >= 3)
 
-        ret_code_t             ret;
-        pm_peer_data_t         peer_data;
-        pm_peer_data_bonding_t bond_data;
+        ret_code_t ret;
 
         ble_gap_id_key_t         keys[BLE_GAP_DEVICE_IDENTITIES_MAX_COUNT];
         ble_gap_id_key_t const * key_ptrs[BLE_GAP_DEVICE_IDENTITIES_MAX_COUNT];
@@ -683,9 +877,6 @@ ret_code_t im_device_identities_list_set(pm_peer_id_t const * p_peers,
             return sd_ble_gap_device_identities_set(NULL, NULL, 0);
         }
 
-        peer_data.p_bonding_data = &bond_data;
-        uint32_t const buf_size  = sizeof(bond_data);
-
         memset(keys, 0x00, sizeof(keys));
         for (uint32_t i = 0; i < BLE_GAP_DEVICE_IDENTITIES_MAX_COUNT; i++)
         {
@@ -694,19 +885,15 @@ ret_code_t im_device_identities_list_set(pm_peer_id_t const * p_peers,
 
         for (uint32_t i = 0; i < peer_cnt; i++)
         {
-            memset(&bond_data, 0x00, sizeof(bond_data));
+            // Load the peer's ID keys directly into the buffer.
+            ret = id_key_load(p_peers[i], &keys[i]);
 
-            // Read peer data from flash.
-            ret = pds_peer_data_read(p_peers[i], PM_PEER_DATA_ID_BONDING,
-                                     &peer_data, &buf_size);
-
-            if ((ret == NRF_ERROR_NOT_FOUND) || (ret == NRF_ERROR_INVALID_PARAM))
+            if (ret != NRF_SUCCESS)
             {
-                // Peer data coulnd't be found in flash or peer ID is not valid.
-                return NRF_ERROR_NOT_FOUND;
+                return ret;
             }
 
-            uint8_t const addr_type = bond_data.peer_ble_id.id_addr_info.addr_type;
+            uint8_t const addr_type = keys[i].id_addr_info.addr_type;
 
             if ((addr_type != BLE_GAP_ADDR_TYPE_PUBLIC) &&
                 (addr_type != BLE_GAP_ADDR_TYPE_RANDOM_STATIC))
@@ -714,9 +901,6 @@ ret_code_t im_device_identities_list_set(pm_peer_id_t const * p_peers,
                 // The address shared by the peer during bonding can't be whitelisted.
                 return BLE_ERROR_GAP_INVALID_BLE_ADDR;
             }
-
-            // Copy data to the buffer.
-            memcpy(&keys[i], &bond_data.peer_ble_id, sizeof(ble_gap_id_key_t));
         }
 
         return sd_ble_gap_device_identities_set(key_ptrs, NULL, peer_cnt);
@@ -72,11 +72,13 @@ extern void pm_pdb_evt_handler(pm_evt_t * p_event);
 extern void sm_pdb_evt_handler(pm_evt_t * p_event);
 extern void gscm_pdb_evt_handler(pm_evt_t * p_event);
 extern void gcm_pdb_evt_handler(pm_evt_t * p_event);
+extern void im_pdb_evt_handler(pm_evt_t * p_event);
 
 // Peer Database events' handlers.
 // The number of elements in this array is PDB_EVENT_HANDLERS_CNT.
 static pm_evt_handler_internal_t const m_evt_handlers[] =
 {
+    im_pdb_evt_handler,     // First, so the other handlers see the updated ID key cache.
     pm_pdb_evt_handler,
     sm_pdb_evt_handler,
     gscm_pdb_evt_handler,
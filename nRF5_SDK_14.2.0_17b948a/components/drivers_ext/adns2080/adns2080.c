@@ -86,26 +86,23 @@
 #define REG_MOUSE_CTRL_RES_EN        (0x40U) /*!< Mouse control register resolution enable bit */
 #define REG_MOUSE_CTRL_BIT_REPORTING (0x80U) /*!< Mouse control register "number of motion bits" bit*/
 
-void adns2080_movement_read(int16_t * deltaX, int16_t * deltaY)
+#define BURST_LEN_8_BITS  (REG_DELTA_Y - REG_DELTA_X + 1)       /*!< Burst read length in 8 bit mode: DELTA_X, DELTA_Y */
+#define BURST_LEN_12_BITS (REG_DELTA_XY_HIGH - REG_DELTA_X + 1) /*!< Burst read length in 12 bit mode: DELTA_X ... DELTA_XY_HIGH */
+
+static adns2080_motion_bits_t m_motion_bits = ADNS2080_MOTION_BITS_8; /*!< Cached motion bits of REG_MOUSE_CTRL, spares a register read on each movement read */
+
+static void movement_decode(uint8_t delta_x, uint8_t delta_y, uint8_t delta_xy_high, int16_t * deltaX, int16_t * deltaY)
 {
-    uint8_t delta_x;       /*!< Stores REG_DELTA_X contents */
-    uint8_t delta_y;       /*!< Stores REG_DELTA_Y contents */
-    uint8_t delta_xy_high; /*!< Stores REG_DELTA_XY contents which contains upper 4 bits for both delta_x and delta_y when 12 bit mode is used */
     uint8_t delta_x_high;  /*!< Stores delta_x 4 MSB bits */
     uint8_t delta_y_high;  /*!< Stores delta_y 4 MSB bits */
 
     uint16_t u16_deltaX; /*!< This is used to buffer the result and will be cast later to int16_t */
     uint16_t u16_deltaY; /*!< This is used to buffer the result and will be cast later to int16_t */
 
-    delta_x = sdio_read_byte(REG_DELTA_X);
-    delta_y = sdio_read_byte(REG_DELTA_Y);
-
-    if (adns2080_motion_bits_read() == ADNS2080_MOTION_BITS_12)
+    if (m_motion_bits == ADNS2080_MOTION_BITS_12)
     {
         // In 12 bit mode the upper 4 bits are stored in a separate register
         // where first 4 upper bits are for delta_x and lower 4 bits for delta_y.
-        delta_xy_high = sdio_read_byte(REG_DELTA_XY_HIGH);
-
         delta_x_high = ((delta_xy_high & 0xF0) >> 4);
         delta_y_high = (delta_xy_high & 0x0F);
 
@@ -131,8 +128,8 @@ void adns2080_movement_read(int16_t * deltaX, int16_t * deltaY)
             u16_deltaY = 0x0000;
         }
 
-        u16_deltaX |= (delta_x_high << 4) | delta_x;
-        u16_deltaY |= (delta_y_high << 4) | delta_y;
+        u16_deltaX |= (delta_x_high << 8) | delta_x;
+        u16_deltaY |= (delta_y_high << 8) | delta_y;
     }
     else // Only 8 bits is used for motion data
     {
@@ -166,10 +163,39 @@ void adns2080_movement_read(int16_t * deltaX, int16_t * deltaY)
     *deltaY = (int16_t)u16_deltaY;
 }
 
+void adns2080_movement_read(int16_t * deltaX, int16_t * deltaY)
+{
+    uint8_t delta_x;           /*!< Stores REG_DELTA_X contents */
+    uint8_t delta_y;           /*!< Stores REG_DELTA_Y contents */
+    uint8_t delta_xy_high = 0; /*!< Stores REG_DELTA_XY contents which contains upper 4 bits for both delta_x and delta_y when 12 bit mode is used */
+
+    delta_x = sdio_read_byte(REG_DELTA_X);
+    delta_y = sdio_read_byte(REG_DELTA_Y);
+
+    if (m_motion_bits == ADNS2080_MOTION_BITS_12)
+    {
+        delta_xy_high = sdio_read_byte(REG_DELTA_XY_HIGH);
+    }
+
+    movement_decode(delta_x, delta_y, delta_xy_high, deltaX, deltaY);
+}
+
+void adns2080_movement_burst_read(int16_t * deltaX, int16_t * deltaY)
+{
+    uint8_t burst[BURST_LEN_12_BITS]; /*!< Registers from REG_DELTA_X to REG_BURST_READ_LAST */
+    uint8_t burst_len = (m_motion_bits == ADNS2080_MOTION_BITS_12) ? BURST_LEN_12_BITS : BURST_LEN_8_BITS;
+
+    sdio_read_burst(burst, burst_len);
+
+    movement_decode(burst[0], burst[1], burst[burst_len - 1], deltaX, deltaY);
+}
+
 adns2080_motion_bits_t adns2080_motion_bits_read(void)
 {
     /* Read the most significant bit */
-    return (adns2080_motion_bits_t)((sdio_read_byte(REG_MOUSE_CTRL) >> 7) & 0x01);
+    m_motion_bits = (adns2080_motion_bits_t)((sdio_read_byte(REG_MOUSE_CTRL) >> 7) & 0x01);
+
+    return m_motion_bits;
 }
 
 bool adns2080_is_motion_detected(void)
@@ -206,6 +232,7 @@ adns2080_status_t adns2080_init(void)
 void adns2080_reset(void)
 {
     sdio_write_byte(REG_RESET, ADNS2080_RESET_NUMBER);
+    m_motion_bits = ADNS2080_MOTION_BITS_8; // REG_MOUSE_CTRL default
 }
 
 void adns2080_powerdown(void)
@@ -320,6 +347,9 @@ adns2080_status_t adns2080_motion_bits_set(adns2080_motion_bits_t motion_bits)
     if (status == ADNS2080_OK)
     {
         sdio_write_byte(REG_MOUSE_CTRL, databyte);
+        // Burst read ends at the last movement register of the mode
+        sdio_write_byte(REG_BURST_READ_LAST, (motion_bits == ADNS2080_MOTION_BITS_12) ? REG_DELTA_XY_HIGH : REG_DELTA_Y);
+        m_motion_bits = motion_bits;
     }
 
     return status;
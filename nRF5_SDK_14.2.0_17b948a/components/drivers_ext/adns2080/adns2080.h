@@ -216,6 +216,8 @@ adns2080_status_t adns2080_resolution_set(adns2080_resolution_t resolution);
 /**
  * @brief Function for setting number of bits used for mouse sensor motion reporting.
  *
+ * The setting is cached by the driver for movement reads and the burst read range
+ * is set to cover the movement registers of the mode.
  * Chip is expected to be initialized before calling this function.
  *
  * @param motion_bits Desired number of bits.
@@ -228,6 +230,7 @@ adns2080_status_t adns2080_motion_bits_set(adns2080_motion_bits_t motion_bits);
 /**
  * @brief Function for reading number of bits used for mouse sensor motion reporting.
  *
+ * The value read also refreshes the setting cached by the driver.
  * Chip is expected to be initialized before calling this function.
  *
  * @return motion_bits Number of bits.
@@ -245,6 +248,19 @@ adns2080_motion_bits_t adns2080_motion_bits_read(void);
  */
 void adns2080_movement_read(int16_t *p_delta_x, int16_t *p_delta_y);
 
+/**
+ * @brief Function for reading X- and Y-axis movement (in counts) since last report in one burst transaction.
+ *
+ * DELTA_X, DELTA_Y and in 12 bit mode DELTA_XY_HIGH are read by one burst read,
+ * the burst read range is set by @ref adns2080_init and @ref adns2080_motion_bits_set.
+ * Absolute value is determined by resolution.
+ * Chip is expected to be initialized before calling this function.
+ *
+ * @param p_delta_x Location to store X-axis movement
+ * @param p_delta_y Location to store Y-axis movement
+ */
+void adns2080_movement_burst_read(int16_t *p_delta_x, int16_t *p_delta_y);
+
 /**
  * @brief Function for checking if motion has been detected since last call.
  *
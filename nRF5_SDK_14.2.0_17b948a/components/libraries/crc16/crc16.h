@@ -56,6 +56,11 @@
 extern "C" {
 #endif
 
+/**@brief Kernels selectable with CRC16_KERNEL in sdk_config.h. All give the same result. */
+#define CRC16_KERNEL_BITWISE    0   //!< Shifts and XORs per byte, no table.
+#define CRC16_KERNEL_TABLE      1   //!< One table lookup per byte, 512 byte table.
+#define CRC16_KERNEL_SLICE4     2   //!< Four bytes per step (slicing-by-4), 2 kB of tables.
+
 /**@brief Function for calculating CRC-16 in blocks.
  *
  * Feed each consecutive data block into this function, along with the current value of p_crc as
@@ -54,6 +54,8 @@
 #include "nrf_fstorage_sd.h"
 #elif (FDS_BACKEND == NRF_FSTORAGE_NVMC)
 #include "nrf_fstorage_nvmc.h"
+#elif (FDS_BACKEND == NRF_FSTORAGE_FILE)
+#include "nrf_fstorage_file.h"
 #else
 #error Invalid FDS backend.
 #endif
@@ -99,6 +101,19 @@ static fds_swap_page_t      m_swap_page;
 // Garbage collection data.
 static fds_gc_data_t        m_gc;
 
+// Garbage collection statistics, and the stall being measured.
+static fds_gc_stat_t        m_gc_stat;
+static fds_time_get_t       m_gc_time_get;
+static uint32_t             m_gc_stall_start;
+static bool                 m_gc_stall;
+
+#if (FDS_TELEMETRY_ENABLED)
+// Operation counters, and the copy being saved to flash by fds_telemetry_save().
+static fds_telemetry_t      m_telemetry;
+static fds_telemetry_t      m_telemetry_saved;
+static bool                 m_telemetry_saving;
+#endif
+
 
 static void event_send(fds_evt_t const * const p_evt)
 {
@@ -154,6 +169,10 @@ static void event_prepare(fds_op_t const * const p_op, fds_evt_t * const p_evt)
             p_evt->id = FDS_EVT_GC;
             break;
 
+        case FDS_OP_TX:
+            p_evt->id = FDS_EVT_TX;
+            break;
+
         default:
             // Should not happen.
             break;
@@ -204,6 +223,37 @@ static bool address_is_valid(uint32_t const * const p_addr)
 }
 
 
+// File IDs the application can't write or delete: the invalid one, commit markers and the telemetry record.
+static bool file_id_is_reserved(uint16_t file_id)
+{
+#if (FDS_TX_ENABLED)
+    if (file_id == FDS_TX_FILE_ID)
+    {
+        return true;
+    }
+#endif
+#if (FDS_TELEMETRY_ENABLED)
+    if (file_id == FDS_TELEMETRY_FILE_ID)
+    {
+        return true;
+    }
+#endif
+    return (file_id == FDS_FILE_ID_INVALID);
+}
+
+
+// The record of fds_telemetry_save(), the only write to a reserved file that goes through the queue.
+static bool record_is_telemetry(fds_record_t const * const p_record)
+{
+#if (FDS_TELEMETRY_ENABLED)
+    return ((p_record->file_id == FDS_TELEMETRY_FILE_ID) && (p_record->data.p_data == &m_telemetry_saved));
+#else
+    UNUSED_PARAMETER(p_record);
+    return false;
+#endif
+}
+
+
 // Reads a page tag, and determines if the page is used to store data or as swap.
 static fds_page_type_t page_identify(uint32_t const * const p_page_addr)
 {
@@ -483,6 +533,314 @@ static bool record_find_by_desc(fds_record_desc_t * const p_desc, uint16_t * con
 }
 
 
+#if (FDS_TX_ENABLED)
+
+// The transaction being staged or committed.
+static fds_tx_data_t m_tx;
+
+
+// Whether a record must not be seen by the application while a transaction is committed.
+// Until the IC parts of all records are written, the old view is kept: records already finalized
+// are hidden. Then the new view is shown at once: old copies of updated records are hidden.
+static bool tx_record_is_hidden(uint32_t const * const p_record)
+{
+    fds_header_t const * const p_header = (fds_header_t*)p_record;
+
+    if (m_tx.phase < FDS_TX_STAGE)
+    {
+        return false;
+    }
+
+    if (p_record == m_tx.p_marker)
+    {
+        return true;
+    }
+
+    for (uint16_t i = 0; i < m_tx.count; i++)
+    {
+        if (m_tx.phase <= FDS_TX_FINALIZE)
+        {
+            if (p_record == m_tx.p_record[i])
+            {
+                return true;
+            }
+        }
+        else if (p_header->record_id == m_tx.record_to_delete[i])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+// Whether a page holds records of a transaction which could not complete. Garbage collection
+// must not drop them: they are dirty until their IC part is written at the next initialization.
+static bool tx_page_is_locked(uint16_t page)
+{
+    uint32_t const * const p_page     = m_pages[page].p_addr;
+    uint32_t const * const p_page_end = p_page + FDS_PAGE_SIZE;
+
+    if (m_tx.phase < FDS_TX_STAGE)
+    {
+        return false;
+    }
+
+    if ((m_tx.p_marker >= p_page) && (m_tx.p_marker < p_page_end))
+    {
+        return true;
+    }
+
+    for (uint16_t i = 0; i < m_tx.count; i++)
+    {
+        if ((m_tx.p_record[i] >= p_page) && (m_tx.p_record[i] < p_page_end))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#else
+
+static bool tx_record_is_hidden(uint32_t const * const p_record)
+{
+    UNUSED_PARAMETER(p_record);
+    return false;
+}
+
+
+static bool tx_page_is_locked(uint16_t page)
+{
+    UNUSED_PARAMETER(page);
+    return false;
+}
+
+#endif // FDS_TX_ENABLED
+
+
+#if (FDS_RAM_INDEX_ENABLED)
+
+#define FDS_RAM_INDEX_NONE  (0xFFFF)
+#define FDS_RAM_INDEX_MASK  (FDS_RAM_INDEX_SIZE - 1)
+
+#if ((FDS_RAM_INDEX_SIZE & FDS_RAM_INDEX_MASK) != 0) || (FDS_RAM_INDEX_SIZE >= FDS_RAM_INDEX_NONE)
+    #error "FDS_RAM_INDEX_SIZE must be a power of two."
+#endif
+
+// RAM index of valid records, hashed by file ID and record key.
+// Only the record address is kept, the file ID and record key are read from the record header.
+// Buckets are as many as entries. Entries not in use are linked in the free list.
+static struct
+{
+    uint32_t const * p_record[FDS_RAM_INDEX_SIZE];
+    uint16_t         next[FDS_RAM_INDEX_SIZE];
+    uint16_t         bucket[FDS_RAM_INDEX_SIZE];
+    uint16_t         free;
+    bool             valid;     // Not built yet or ran out of entries: record_find() scans flash.
+} m_index;
+
+
+static uint16_t index_hash(uint16_t file_id, uint16_t record_key)
+{
+    return (uint16_t)((file_id * 31u) ^ record_key) & FDS_RAM_INDEX_MASK;
+}
+
+
+static void index_add(uint32_t const * const p_record)
+{
+    fds_header_t const * const p_header = (fds_header_t*)p_record;
+    uint16_t                   entry;
+    uint16_t                   bucket;
+
+    CRITICAL_SECTION_ENTER();
+    if (m_index.valid)
+    {
+        entry = m_index.free;
+        if (entry == FDS_RAM_INDEX_NONE)
+        {
+            // More records than entries. Lookups fall back to flash scan until the index is rebuilt.
+            m_index.valid = false;
+        }
+        else
+        {
+            bucket                  = index_hash(p_header->file_id, p_header->record_key);
+            m_index.free            = m_index.next[entry];
+            m_index.p_record[entry] = p_record;
+            m_index.next[entry]     = m_index.bucket[bucket];
+            m_index.bucket[bucket]  = entry;
+        }
+    }
+    CRITICAL_SECTION_EXIT();
+}
+
+
+// Must be called while the record header is still intact.
+static void index_remove(uint32_t const * const p_record)
+{
+    fds_header_t const * const p_header = (fds_header_t*)p_record;
+    uint16_t           *       p_link;
+
+    CRITICAL_SECTION_ENTER();
+    if (m_index.valid)
+    {
+        p_link = &m_index.bucket[index_hash(p_header->file_id, p_header->record_key)];
+        for (; *p_link != FDS_RAM_INDEX_NONE; p_link = &m_index.next[*p_link])
+        {
+            uint16_t const entry = *p_link;
+            if (m_index.p_record[entry] == p_record)
+            {
+                *p_link             = m_index.next[entry];
+                m_index.next[entry] = m_index.free;
+                m_index.free        = entry;
+                break;
+            }
+        }
+    }
+    CRITICAL_SECTION_EXIT();
+}
+
+
+static void index_page_add(uint16_t page)
+{
+    uint32_t const * p_record = NULL;
+
+    while (record_find_next(page, &p_record))
+    {
+        index_add(p_record);
+    }
+}
+
+
+// Index all valid records. Called when initialization completes, and after garbage collection
+// if the index ran out of entries.
+static void index_build(void)
+{
+    CRITICAL_SECTION_ENTER();
+    memset(m_index.bucket, 0xFF, sizeof(m_index.bucket));
+    for (uint16_t i = 0; i < FDS_RAM_INDEX_SIZE; i++)
+    {
+        m_index.next[i] = i + 1;
+    }
+    m_index.next[FDS_RAM_INDEX_SIZE - 1] = FDS_RAM_INDEX_NONE;
+    m_index.free                         = 0;
+    m_index.valid                        = true;
+    CRITICAL_SECTION_EXIT();
+
+    for (uint16_t page = 0; page < FDS_DATA_PAGES; page++)
+    {
+        if (m_pages[page].page_type == FDS_PAGE_DATA)
+        {
+            index_page_add(page);
+        }
+    }
+}
+
+
+// A page was garbage collected: its records have been copied to the swap, which replaced it.
+// Drop entries pointing into the old (now erased) page and index the records of the new one.
+static void index_page_replace(uint16_t page, uint32_t const * const p_old_addr)
+{
+    CRITICAL_SECTION_ENTER();
+    if (m_index.valid)
+    {
+        for (uint16_t bucket = 0; bucket < FDS_RAM_INDEX_SIZE; bucket++)
+        {
+            uint16_t * p_link = &m_index.bucket[bucket];
+            while (*p_link != FDS_RAM_INDEX_NONE)
+            {
+                uint16_t const entry = *p_link;
+                if ((m_index.p_record[entry] >= p_old_addr) &&
+                    (m_index.p_record[entry] <  p_old_addr + FDS_PAGE_SIZE))
+                {
+                    *p_link             = m_index.next[entry];
+                    m_index.next[entry] = m_index.free;
+                    m_index.free        = entry;
+                }
+                else
+                {
+                    p_link = &m_index.next[entry];
+                }
+            }
+        }
+    }
+    CRITICAL_SECTION_EXIT();
+
+    index_page_add(page);
+}
+
+
+// Check whether record A comes before record B in flash scan order: page, then address.
+// The index returns records in this order, so the index and the flash scan can resume each other's token.
+static bool index_record_is_before(uint16_t page_a, uint32_t const * p_a,
+                                   uint16_t page_b, uint32_t const * p_b)
+{
+    return (page_a < page_b) || ((page_a == page_b) && (p_a < p_b));
+}
+
+
+// Find a record by file ID and record key through the index.
+// Each call looks through the whole bucket chain for the first matching record after the token,
+// so the token only keeps a position in flash: the record returned last can be deleted
+// (find and delete loop) and other records can be added between calls.
+// Returns FDS_ERR_INTERNAL if the index is not valid and flash has to be scanned instead.
+static ret_code_t index_find(uint16_t                 file_id,
+                             uint16_t                 record_key,
+                             fds_record_desc_t      * p_desc,
+                             fds_find_token_t       * p_token)
+{
+    ret_code_t       ret       = FDS_ERR_INTERNAL;
+    uint32_t const * p_next    = NULL;
+    uint16_t         next_page = 0;
+    uint16_t         entry     = FDS_RAM_INDEX_NONE;
+
+    CRITICAL_SECTION_ENTER();
+    if (m_index.valid)
+    {
+        ret   = FDS_ERR_NOT_FOUND;
+        entry = m_index.bucket[index_hash(file_id, record_key)];
+    }
+
+    for (; entry != FDS_RAM_INDEX_NONE; entry = m_index.next[entry])
+    {
+        uint32_t     const * const p_record = m_index.p_record[entry];
+        fds_header_t const * const p_header = (fds_header_t*)p_record;
+        uint16_t                   page;
+
+        if ((p_header->file_id != file_id) || (p_header->record_key != record_key) ||
+            tx_record_is_hidden(p_record) || (page_from_record(&page, p_record) != FDS_SUCCESS))
+        {
+            continue;
+        }
+
+        if (index_record_is_before(p_token->page, p_token->p_addr, page, p_record) &&
+            ((p_next == NULL) || index_record_is_before(page, p_record, next_page, p_next)))
+        {
+            p_next    = p_record;
+            next_page = page;
+            ret       = FDS_SUCCESS;
+        }
+    }
+    CRITICAL_SECTION_EXIT();
+
+    if (ret == FDS_SUCCESS)
+    {
+        p_token->p_addr = p_next;
+        p_token->page   = next_page;
+
+        p_desc->record_id    = ((fds_header_t*)p_next)->record_id;
+        p_desc->p_record     = p_next;
+        p_desc->gc_run_count = m_gc.run_count;
+    }
+
+    return ret;
+}
+
+#endif // FDS_RAM_INDEX_ENABLED
+
+
 // Search for a record and return its descriptor.
 // If p_file_id is NULL, only the record key will be used for matching.
 // If p_record_key is NULL, only the file ID will be used for matching.
@@ -502,6 +860,17 @@ static ret_code_t record_find(uint16_t          const * p_file_id,
         return FDS_ERR_NULL_ARG;
     }
 
+#if (FDS_RAM_INDEX_ENABLED)
+    if ((p_file_id != NULL) && (p_record_key != NULL))
+    {
+        ret_code_t const ret = index_find(*p_file_id, *p_record_key, p_desc, p_token);
+        if (ret != FDS_ERR_INTERNAL)
+        {
+            return ret;
+        }
+    }
+#endif
+
     // Begin (or resume) searching for a record.
     for (; p_token->page < FDS_DATA_PAGES; p_token->page++)
     {
@@ -529,6 +898,11 @@ static ret_code_t record_find(uint16_t          const * p_file_id,
                 continue;
             }
 
+            if (tx_record_is_hidden(p_token->p_addr))
+            {
+                continue;
+            }
+
             // Record found; update the descriptor.
             p_desc->record_id    = p_header->record_id;
             p_desc->p_record     = p_token->p_addr;
@@ -587,66 +961,187 @@ static void records_stat(uint16_t   page,
 }
 
 
-// Get a buffer on the queue of operations.
-static fds_op_t * queue_buf_get(nrf_atfifo_item_put_t * p_iput_ctx)
+#if (FDS_TELEMETRY_ENABLED)
+
+static void telemetry_init(void)
 {
-    fds_op_t * const p_op = (fds_op_t*) nrf_atfifo_item_alloc(m_queue, p_iput_ctx);
+    if (m_telemetry.version != 0)
+    {
+        // Counters are kept if initialization is retried.
+        return;
+    }
 
-    memset(p_op, 0x00, sizeof(fds_op_t));
-    return p_op;
+    m_telemetry.version = FDS_TELEMETRY_VERSION;
+    m_telemetry.pages   = FDS_VIRTUAL_PAGES;
+    m_telemetry.files   = FDS_TELEMETRY_FILES + 1;
+
+    for (uint16_t i = 0; i <= FDS_TELEMETRY_FILES; i++)
+    {
+        m_telemetry.file[i].file_id = FDS_FILE_ID_INVALID;
+    }
 }
 
 
-// Commit a buffer to the queue of operations.
-static void queue_buf_store(nrf_atfifo_item_put_t * p_iput_ctx)
+// Find the counters of a file, or take a free entry. Files which don't fit share the last entry.
+static uint16_t telemetry_file_entry(uint16_t file_id)
 {
-    (void) nrf_atfifo_item_put(m_queue, p_iput_ctx);
+    uint16_t i;
+
+    for (i = 0; i < FDS_TELEMETRY_FILES; i++)
+    {
+        if (m_telemetry.file[i].file_id == FDS_FILE_ID_INVALID)
+        {
+            m_telemetry.file[i].file_id = file_id;
+            break;
+        }
+
+        if (m_telemetry.file[i].file_id == file_id)
+        {
+            break;
+        }
+    }
+
+    return i;
 }
 
 
-// Load the next operation from the queue.
-static fds_op_t * queue_load(nrf_atfifo_item_get_t * p_iget_ctx)
+static void telemetry_write_count(uint16_t file_id)
 {
-    return (fds_op_t*) nrf_atfifo_item_get(m_queue, p_iget_ctx);
+    m_telemetry.file[telemetry_file_entry(file_id)].writes++;
 }
 
 
-// Free the currently loaded operation.
-static void queue_free(nrf_atfifo_item_get_t * p_iget_ctx)
+static void telemetry_delete_count(uint16_t file_id)
 {
-    // Free the current queue element.
-    (void) nrf_atfifo_item_free(m_queue, p_iget_ctx);
+    m_telemetry.file[telemetry_file_entry(file_id)].deletes++;
 }
 
 
-static bool queue_has_next(void)
+static void telemetry_erase_count(uint32_t const * const p_page_addr)
 {
-    // Decrement the number of queued operations.
-    ASSERT(m_queued_op_cnt != 0);
-    return nrf_atomic_u32_sub(&m_queued_op_cnt, 1);
+    uint32_t const page = (p_page_addr - (uint32_t*)m_fs.start_addr) / FDS_PAGE_SIZE;
+
+    if (page < FDS_VIRTUAL_PAGES)
+    {
+        m_telemetry.erase_count[page]++;
+    }
 }
 
 
-// This function is called during initialization to setup the page structure (m_pages) and
-// provide additional information regarding eventual further initialization steps.
-static fds_init_opts_t pages_init(void)
+static void telemetry_queue_full_count(void)
 {
-    uint32_t ret                    = NO_PAGES;
-    uint16_t page                   = 0;
-    uint16_t total_pages_available  = FDS_VIRTUAL_PAGES;
-    bool     swap_set_but_not_found = false;
+    m_telemetry.queue_full++;
+}
 
-    for (uint16_t i = 0; i < FDS_VIRTUAL_PAGES; i++)
+
+static void telemetry_queue_depth_update(uint32_t depth)
+{
+    if (depth > m_telemetry.queue_depth_max)
     {
-        uint32_t        const * const p_page_addr = (uint32_t*)m_fs.start_addr + (i * FDS_PAGE_SIZE);
-        fds_page_type_t const         page_type   = page_identify(p_page_addr);
+        m_telemetry.queue_depth_max = depth;
+    }
+}
 
-        switch (page_type)
-        {
-            case FDS_PAGE_UNDEFINED:
-            {
-                if (page_is_erased(p_page_addr))
-                {
+
+#else
+
+static void telemetry_write_count(uint16_t file_id)
+{
+    UNUSED_PARAMETER(file_id);
+}
+
+
+static void telemetry_delete_count(uint16_t file_id)
+{
+    UNUSED_PARAMETER(file_id);
+}
+
+
+static void telemetry_erase_count(uint32_t const * const p_page_addr)
+{
+    UNUSED_PARAMETER(p_page_addr);
+}
+
+
+static void telemetry_queue_full_count(void)
+{
+}
+
+
+static void telemetry_queue_depth_update(uint32_t depth)
+{
+    UNUSED_PARAMETER(depth);
+}
+
+#endif // FDS_TELEMETRY_ENABLED
+
+
+// Get a buffer on the queue of operations.
+static fds_op_t * queue_buf_get(nrf_atfifo_item_put_t * p_iput_ctx)
+{
+    fds_op_t * const p_op = (fds_op_t*) nrf_atfifo_item_alloc(m_queue, p_iput_ctx);
+
+    if (p_op == NULL)
+    {
+        telemetry_queue_full_count();
+        return NULL;
+    }
+
+    memset(p_op, 0x00, sizeof(fds_op_t));
+    return p_op;
+}
+
+
+// Commit a buffer to the queue of operations.
+static void queue_buf_store(nrf_atfifo_item_put_t * p_iput_ctx)
+{
+    (void) nrf_atfifo_item_put(m_queue, p_iput_ctx);
+}
+
+
+// Load the next operation from the queue.
+static fds_op_t * queue_load(nrf_atfifo_item_get_t * p_iget_ctx)
+{
+    return (fds_op_t*) nrf_atfifo_item_get(m_queue, p_iget_ctx);
+}
+
+
+// Free the currently loaded operation.
+static void queue_free(nrf_atfifo_item_get_t * p_iget_ctx)
+{
+    // Free the current queue element.
+    (void) nrf_atfifo_item_free(m_queue, p_iget_ctx);
+}
+
+
+static bool queue_has_next(void)
+{
+    // Decrement the number of queued operations.
+    ASSERT(m_queued_op_cnt != 0);
+    return nrf_atomic_u32_sub(&m_queued_op_cnt, 1);
+}
+
+
+// This function is called during initialization to setup the page structure (m_pages) and
+// provide additional information regarding eventual further initialization steps.
+static fds_init_opts_t pages_init(void)
+{
+    uint32_t ret                    = NO_PAGES;
+    uint16_t page                   = 0;
+    uint16_t total_pages_available  = FDS_VIRTUAL_PAGES;
+    bool     swap_set_but_not_found = false;
+
+    for (uint16_t i = 0; i < FDS_VIRTUAL_PAGES; i++)
+    {
+        uint32_t        const * const p_page_addr = (uint32_t*)m_fs.start_addr + (i * FDS_PAGE_SIZE);
+        fds_page_type_t const         page_type   = page_identify(p_page_addr);
+
+        switch (page_type)
+        {
+            case FDS_PAGE_UNDEFINED:
+            {
+                if (page_is_erased(p_page_addr))
+                {
                     if (m_swap_page.p_addr != NULL)
                     {
                         // If a swap page is already set, flag the page as erased (in m_pages)
@@ -772,7 +1267,14 @@ static ret_code_t record_header_write_finalize(fds_op_t * const p_op, uint32_t *
     ret = nrf_fstorage_write(&m_fs, (uint32_t)(p_addr + FDS_OFFSET_IC),
         &p_op->write.header.file_id, FDS_HEADER_SIZE_IC * sizeof(uint32_t), NULL);
 
-    return (ret == NRF_SUCCESS) ? FDS_SUCCESS : FDS_ERR_BUSY;
+    if (ret != NRF_SUCCESS)
+    {
+        return FDS_ERR_BUSY;
+    }
+
+    telemetry_write_count(p_op->write.header.file_id);
+
+    return FDS_SUCCESS;
 }
 
 
@@ -785,16 +1287,27 @@ static ret_code_t record_header_flag_dirty(uint32_t * const p_record, uint16_t p
     // Flag the record as dirty.
     ret_code_t ret;
 
+#if (FDS_RAM_INDEX_ENABLED)
+    // The header is hashed, remove the record before the write changes its key.
+    index_remove(p_record);
+#endif
+
     ret = nrf_fstorage_write(&m_fs, (uint32_t)p_record,
         &dirty_header, FDS_HEADER_SIZE_TL * sizeof(uint32_t), NULL);
 
     if (ret != NRF_SUCCESS)
     {
+#if (FDS_RAM_INDEX_ENABLED)
+        index_add(p_record);
+#endif
         return FDS_ERR_BUSY;
     }
 
     m_pages[page_to_gc].can_gc = true;
 
+    // The file ID is in the IC part of the header, which is left unchanged.
+    telemetry_delete_count(((fds_header_t*)p_record)->file_id);
+
     return FDS_SUCCESS;
 }
 
@@ -807,7 +1320,7 @@ static ret_code_t record_find_and_delete(fds_op_t * const p_op)
 
     desc.record_id = p_op->del.record_to_delete;
 
-    if (record_find_by_desc(&desc, &page))
+    if (record_find_by_desc(&desc, &page) && !tx_record_is_hidden(desc.p_record))
     {
         fds_header_t const * const p_header = (fds_header_t const *)desc.p_record;
 
@@ -921,7 +1434,7 @@ static bool gc_page_next(uint16_t * const p_next_page)
             m_gc.do_gc_page[i] = false;
 
             // Only GC pages with no open records and with some records which have been deleted.
-            if ((m_pages[i].records_open == 0) && (m_pages[i].can_gc == true))
+            if ((m_pages[i].records_open == 0) && (m_pages[i].can_gc == true) && !tx_page_is_locked(i))
             {
                 *p_next_page = i;
                 ret = true;
@@ -939,6 +1452,8 @@ static ret_code_t gc_swap_erase(void)
     m_gc.state               = GC_DISCARD_SWAP;
     m_swap_page.write_offset = FDS_PAGE_TAG_SIZE;
 
+    telemetry_erase_count(m_swap_page.p_addr);
+
     return nrf_fstorage_erase(&m_fs, (uint32_t)m_swap_page.p_addr, FDS_PHY_PAGES_IN_VPAGE, NULL);
 }
 
@@ -954,6 +1469,8 @@ static ret_code_t gc_page_erase(void)
     {
         m_gc.state = GC_ERASE_PAGE;
 
+        telemetry_erase_count(m_pages[gc].p_addr);
+
         ret = nrf_fstorage_erase(&m_fs, (uint32_t)m_pages[gc].p_addr, FDS_PHY_PAGES_IN_VPAGE, NULL);
     }
     else
@@ -976,6 +1493,10 @@ static ret_code_t gc_record_copy(void)
 
     m_gc.state = GC_COPY_RECORD;
 
+#if (FDS_TELEMETRY_ENABLED)
+    m_telemetry.gc_bytes_copied += record_len * sizeof(uint32_t);
+#endif
+
     // Copy the record to swap; it is guaranteed to fit in the destination page,
     // so there is no need to check its size. This will either succeed or timeout.
     return nrf_fstorage_write(&m_fs, (uint32_t)p_dest, m_gc.p_record_src,
@@ -1029,6 +1550,19 @@ static ret_code_t gc_next_page(void)
         m_gc.cur_page     = 0;
         m_gc.p_record_src = NULL;
 
+        m_gc_stat.runs++;
+#if (FDS_TELEMETRY_ENABLED)
+        m_telemetry.gc_runs++;
+#endif
+
+#if (FDS_RAM_INDEX_ENABLED)
+        if (!m_index.valid)
+        {
+            // The index ran out of entries, records might fit again.
+            index_build();
+        }
+#endif
+
         return FDS_OP_COMPLETED;
     }
 
@@ -1052,6 +1586,10 @@ static void gc_swap_pages(void)
     // and the current swap will be used as a data page (promoted).
     uint32_t const * const p_addr = m_swap_page.p_addr;
 
+    // Records on this page moved. GC can stop between pages and other operations run meanwhile,
+    // so descriptors obtained since GC started must be invalidated too.
+    m_gc.run_count++;
+
     m_swap_page.p_addr            = m_pages[m_gc.cur_page].p_addr;
     m_pages[m_gc.cur_page].p_addr = p_addr;
 
@@ -1078,9 +1616,16 @@ static void gc_state_advance(void)
 
         // A page was successfully erased. Prepare to promote the swap.
         case GC_ERASE_PAGE:
+        {
+#if (FDS_RAM_INDEX_ENABLED)
+            uint32_t const * const p_old_addr = m_pages[m_gc.cur_page].p_addr;
+            gc_swap_pages();
+            index_page_replace(m_gc.cur_page, p_old_addr);
+#else
             gc_swap_pages();
+#endif
             m_gc.state = GC_PROMOTE_SWAP;
-            break;
+        } break;
 
         // Swap was discarded because the page being GC'ed had open records.
         case GC_DISCARD_SWAP:
@@ -1101,123 +1646,562 @@ static void gc_state_advance(void)
 }
 
 
-// Initialize the filesystem.
-static ret_code_t init_execute(uint32_t prev_ret, fds_op_t * const p_op)
+#if (FDS_TX_ENABLED)
+
+static uint16_t tx_crc(fds_header_t const * const p_header, void const * const p_data)
 {
-    ret_code_t ret = FDS_ERR_INTERNAL;
+    uint16_t crc = 0;
 
-    if (prev_ret != NRF_SUCCESS)
+#if (FDS_CRC_CHECK_ON_READ)
+    // Same as write_enqueue().
+    crc = crc16_compute((uint8_t*)p_header,             6, NULL);
+    crc = crc16_compute((uint8_t*)&p_header->record_id, 4, &crc);
+    crc = crc16_compute((uint8_t*)p_data, p_header->length_words * sizeof(uint32_t), &crc);
+#else
+    UNUSED_PARAMETER(p_header);
+    UNUSED_PARAMETER(p_data);
+#endif
+
+    return crc;
+}
+
+
+// Assign record IDs and flash addresses, and fill in the commit marker.
+static void tx_stage_prepare(void)
+{
+    m_tx.marker[0] = m_tx.count;
+
+    for (uint16_t i = 0; i < m_tx.count; i++)
     {
-        // A previous operation has timed out.
-        m_flags.initializing = false;
-        return FDS_ERR_OPERATION_TIMEOUT;
+        fds_page_t * const p_page = &m_pages[m_tx.page[i]];
+
+        m_tx.header[i].record_id = record_id_new();
+        m_tx.header[i].crc16     = tx_crc(&m_tx.header[i], m_tx.p_data[i]);
+        m_tx.p_record[i]         = p_page->p_addr + p_page->write_offset;
+        page_offsets_update(p_page, m_tx.header[i].length_words);
+
+        m_tx.marker[1 + (3 * i)] = (uint32_t)m_tx.p_record[i];
+        memcpy(&m_tx.marker[2 + (3 * i)], &m_tx.header[i].file_id, sizeof(uint32_t));
+        m_tx.marker[3 + (3 * i)] = m_tx.record_to_delete[i];
     }
 
-    switch (p_op->init.step)
+    fds_page_t * const p_page = &m_pages[m_tx.page[FDS_TX_MAX_RECORDS]];
+
+    m_tx.marker_header.record_key   = FDS_TX_RECORD_KEY;
+    m_tx.marker_header.length_words = 1 + (3 * m_tx.count);
+    m_tx.marker_header.file_id      = FDS_TX_FILE_ID;
+    m_tx.marker_header.record_id    = record_id_new();
+    m_tx.marker_header.crc16        = tx_crc(&m_tx.marker_header, m_tx.marker);
+    m_tx.p_marker                   = p_page->p_addr + p_page->write_offset;
+    page_offsets_update(p_page, m_tx.marker_header.length_words);
+}
+
+
+static ret_code_t tx_write(uint32_t const * const p_dest, void const * const p_src, uint16_t words)
+{
+    ret_code_t const ret = nrf_fstorage_write(&m_fs, (uint32_t)p_dest, p_src, words * sizeof(uint32_t), NULL);
+
+    return (ret == NRF_SUCCESS) ? FDS_SUCCESS : FDS_ERR_BUSY;
+}
+
+
+// Start a flash operation of the current phase. Returns FDS_OP_COMPLETED if there is nothing to do
+// for this action, for example because it was already done before a reset.
+static ret_code_t tx_action_start(uint16_t action)
+{
+    uint16_t const i = action / 3;
+
+    switch (m_tx.phase)
     {
-        case FDS_OP_INIT_TAG_SWAP:
+        case FDS_TX_STAGE:
         {
-            // The page write offset was determined previously by pages_init().
-            p_op->init.step = FDS_OP_INIT_TAG_DATA;
-            ret             = page_tag_write_swap();
-        } break;
+            // The key and length, the record ID and the data of each record, then of the marker.
+            fds_header_t     const * const p_header = (i < m_tx.count) ? &m_tx.header[i]   : &m_tx.marker_header;
+            uint32_t         const * const p_dest   = (i < m_tx.count) ? m_tx.p_record[i]  : m_tx.p_marker;
+            void             const * const p_data   = (i < m_tx.count) ? m_tx.p_data[i]    : m_tx.marker;
 
-        case FDS_OP_INIT_TAG_DATA:
-        {
-            // Tag remaining erased pages as data.
-            bool write_reqd = false;
-            for (uint16_t i = 0; i < FDS_DATA_PAGES; i++)
+            switch (action % 3)
             {
-                if (m_pages[i].page_type == FDS_PAGE_ERASED)
-                {
-                    m_pages[i].page_type = FDS_PAGE_DATA;
-                    write_reqd           = true;
-                    ret = page_tag_write_data(m_pages[i].p_addr);
-                    break;
-                }
+                case 0:
+                    return tx_write(p_dest + FDS_OFFSET_TL, &p_header->record_key, FDS_HEADER_SIZE_TL);
+                case 1:
+                    return tx_write(p_dest + FDS_OFFSET_ID, &p_header->record_id, FDS_HEADER_SIZE_ID);
+                default:
+                    return (p_header->length_words == 0) ? FDS_OP_COMPLETED :
+                           tx_write(p_dest + FDS_OFFSET_DATA, p_data, p_header->length_words);
             }
-            if (!write_reqd)
+        }
+
+        case FDS_TX_COMMIT:
+            return tx_write(m_tx.p_marker + FDS_OFFSET_IC, &m_tx.marker_header.file_id, FDS_HEADER_SIZE_IC);
+
+        case FDS_TX_FINALIZE:
+        {
+            ret_code_t ret;
+
+            if (m_tx.p_record[action][FDS_OFFSET_IC] != FDS_ERASED_WORD)
             {
-                m_flags.initialized  = true;
-                m_flags.initializing = false;
                 return FDS_OP_COMPLETED;
             }
-        } break;
 
-        case FDS_OP_INIT_ERASE_SWAP:
+            ret = tx_write(m_tx.p_record[action] + FDS_OFFSET_IC, &m_tx.header[action].file_id, FDS_HEADER_SIZE_IC);
+            if (ret == FDS_SUCCESS)
+            {
+                telemetry_write_count(m_tx.header[action].file_id);
+            }
+            return ret;
+        }
+
+        case FDS_TX_CLEANUP:
         {
-            // If the swap is going to be discarded then reset its write_offset.
-            p_op->init.step          = FDS_OP_INIT_TAG_SWAP;
-            m_swap_page.write_offset = FDS_PAGE_TAG_SIZE;
+            fds_record_desc_t desc = {0};
+            uint16_t          page;
 
-            ret = nrf_fstorage_erase(&m_fs, (uint32_t)m_swap_page.p_addr, FDS_PHY_PAGES_IN_VPAGE, NULL);
-        } break;
+            desc.record_id = m_tx.record_to_delete[action];
+            if ((desc.record_id == 0) || !record_find_by_desc(&desc, &page))
+            {
+                return FDS_OP_COMPLETED;
+            }
+            return record_header_flag_dirty((uint32_t*)desc.p_record, page);
+        }
 
-        case FDS_OP_INIT_PROMOTE_SWAP:
+        case FDS_TX_MARKER_DELETE:
         {
-            p_op->init.step       = FDS_OP_INIT_TAG_SWAP;
+            uint16_t page;
 
-            // When promoting the swap, keep the write_offset set by pages_init().
-            ret = page_tag_write_data(m_swap_page.p_addr);
+            if (page_from_record(&page, m_tx.p_marker) != FDS_SUCCESS)
+            {
+                return FDS_ERR_INTERNAL;
+            }
+            return record_header_flag_dirty((uint32_t*)m_tx.p_marker, page);
+        }
 
-            uint16_t const         gc         = m_gc.cur_page;
-            uint32_t const * const p_old_swap = m_swap_page.p_addr;
+        default:
+            return FDS_ERR_INTERNAL;
+    }
+}
 
-            // Execute the swap.
-            m_swap_page.p_addr = m_pages[gc].p_addr;
-            m_pages[gc].p_addr = p_old_swap;
 
-            // Copy the offset from the swap to the new page.
-            m_pages[gc].write_offset = m_swap_page.write_offset;
-            m_swap_page.write_offset = FDS_PAGE_TAG_SIZE;
+static uint16_t tx_action_count(void)
+{
+    switch (m_tx.phase)
+    {
+        case FDS_TX_STAGE:
+            return 3 * (m_tx.count + 1);
 
-            m_pages[gc].page_type = FDS_PAGE_DATA;
-        } break;
+        case FDS_TX_FINALIZE:
+        case FDS_TX_CLEANUP:
+            return m_tx.count;
 
         default:
-            // Should not happen.
-            break;
+            return 1;
     }
+}
 
-    if (ret != FDS_SUCCESS)
+
+// Move to the next phase once all flash operations of the current one have completed.
+static void tx_phase_advance(void)
+{
+    switch (m_tx.phase)
     {
-        // fstorage queue was full.
-        m_flags.initializing = false;
-        return FDS_ERR_BUSY;
+        case FDS_TX_FINALIZE:
+#if (FDS_RAM_INDEX_ENABLED)
+            for (uint16_t i = 0; i < m_tx.count; i++)
+            {
+                index_add(m_tx.p_record[i]);
+            }
+#endif
+            // Show the new view.
+            m_tx.phase = FDS_TX_CLEANUP;
+            break;
+
+        case FDS_TX_MARKER_DELETE:
+            m_tx.phase = FDS_TX_IDLE;
+            break;
+
+        default:
+            m_tx.phase++;
+            break;
     }
 
-    return FDS_OP_EXECUTING;
+    m_tx.action = 0;
 }
 
 
-// Executes write and update operations.
-static ret_code_t write_execute(uint32_t prev_ret, fds_op_t * const p_op)
+// Executes a transaction. Flash operations of a phase are started without waiting for each other,
+// as far as the flash subsystem queue allows; the next phase starts when all of them completed.
+static ret_code_t tx_execute(uint32_t prev_ret)
 {
-    ret_code_t         ret;
-    uint32_t   *       p_write_addr;
-    fds_page_t * const p_page = &m_pages[p_op->write.page];
-
-    // This must persist across calls.
-    static fds_record_desc_t desc = {0};
-    // When a record is updated, this variable will hold the page where the old
-    // copy was stored. This will be used to set the can_gc flag when the header is
-    // invalidated (FDS_OP_WRITE_FLAG_DIRTY).
-    static uint16_t page;
-
-    if (prev_ret != NRF_SUCCESS)
+    if (m_tx.pending != 0)
     {
-        // The previous operation has timed out, update offsets.
-        page_offsets_update(p_page, p_op->write.header.length_words);
-        return FDS_ERR_OPERATION_TIMEOUT;
+        // A flash operation has completed.
+        m_tx.pending--;
+        m_tx.events++;
+        m_tx.failed |= (prev_ret != NRF_SUCCESS);
+    }
+    else if (m_tx.phase == FDS_TX_QUEUED)
+    {
+        m_tx.phase = FDS_TX_STAGE;
+        tx_stage_prepare();
     }
 
-    // Compute the address where to write data.
-    p_write_addr = (uint32_t*)(p_page->p_addr + p_page->write_offset);
-
-    // Execute the current step of the operation, and set one to be executed next.
-    switch (p_op->write.step)
+    while (!m_tx.failed)
     {
-        case FDS_OP_WRITE_FIND_RECORD:
+        ret_code_t ret;
+        uint32_t   events;
+
+        if (m_tx.action == tx_action_count())
+        {
+            if (m_tx.pending != 0)
+            {
+                return FDS_OP_EXECUTING;
+            }
+
+            tx_phase_advance();
+            if (m_tx.phase == FDS_TX_IDLE)
+            {
+                return FDS_OP_COMPLETED;
+            }
+            continue;
+        }
+
+        // The event of the operation might be sent before nrf_fstorage_write() returns, and then
+        // this function runs again from the event handler. Update the state before starting.
+        events = m_tx.events;
+        m_tx.action++;
+        m_tx.pending++;
+
+        ret = tx_action_start(m_tx.action - 1);
+
+        if (ret == FDS_SUCCESS)
+        {
+            if (m_tx.events != events)
+            {
+                // Progress was made from the event handler.
+                return FDS_OP_EXECUTING;
+            }
+            continue;
+        }
+
+        m_tx.pending--;
+
+        if (ret == FDS_OP_COMPLETED)
+        {
+            continue;
+        }
+
+        m_tx.action--;
+        if (m_tx.pending != 0)
+        {
+            // The flash subsystem queue is full, retry when an operation completes.
+            return FDS_OP_EXECUTING;
+        }
+        m_tx.failed = true;
+    }
+
+    if (m_tx.pending != 0)
+    {
+        // Wait for all events, so that they don't reach the next operation.
+        return FDS_OP_EXECUTING;
+    }
+
+    if (m_tx.phase == FDS_TX_STAGE)
+    {
+        // Nothing is committed. Records written so far are dirty and will be garbage collected.
+        m_tx.phase = FDS_TX_IDLE;
+    }
+    // Otherwise the marker might have been written: the transaction is completed or discarded by
+    // the next initialization. Until then, the old view is kept or the new view is shown.
+
+    return FDS_ERR_OPERATION_TIMEOUT;
+}
+
+
+// Find the commit marker of a transaction interrupted by a reset, and prepare to complete it.
+// Returns true if there is a transaction to complete.
+static bool tx_marker_load(void)
+{
+    uint32_t const * p_record = NULL;
+
+    memset(&m_tx, 0x00, sizeof(m_tx));
+
+    for (uint16_t page = 0; (page < FDS_DATA_PAGES) && (m_tx.p_marker == NULL); page++)
+    {
+        p_record = NULL;
+        while (record_find_next(page, &p_record))
+        {
+            fds_header_t const * const p_header = (fds_header_t*)p_record;
+
+            if ((p_header->file_id == FDS_TX_FILE_ID) && (p_header->record_key == FDS_TX_RECORD_KEY))
+            {
+                m_tx.p_marker = p_record;
+                break;
+            }
+        }
+    }
+
+    if (m_tx.p_marker == NULL)
+    {
+        return false;
+    }
+
+    uint32_t const * const p_marker = m_tx.p_marker + FDS_HEADER_SIZE;
+
+    m_tx.count = (p_marker[0] <= FDS_TX_MAX_RECORDS) ? p_marker[0] : 0;
+
+    for (uint16_t i = 0; i < m_tx.count; i++)
+    {
+        if (!address_is_valid((uint32_t const *)p_marker[1 + (3 * i)]))
+        {
+            // Should not happen, the marker is protected by its IC part. Only delete it.
+            m_tx.count = 0;
+            break;
+        }
+
+        m_tx.p_record[i]         = (uint32_t const *)p_marker[1 + (3 * i)];
+        memcpy(&m_tx.header[i].file_id, &p_marker[2 + (3 * i)], sizeof(uint32_t));
+        m_tx.record_to_delete[i] = p_marker[3 + (3 * i)];
+
+        // Records are dirty until finalized, their ID was not seen by page_scan().
+        if (m_tx.p_record[i][FDS_OFFSET_ID] > m_latest_rec_id)
+        {
+            m_latest_rec_id = m_tx.p_record[i][FDS_OFFSET_ID];
+        }
+    }
+
+    m_tx.phase = FDS_TX_FINALIZE;
+
+    return true;
+}
+
+#endif // FDS_TX_ENABLED
+
+
+#if (FDS_TELEMETRY_ENABLED)
+
+// Add the counters saved before reset to those counted since.
+static void telemetry_load(void)
+{
+    fds_record_desc_t desc       = {0};
+    fds_find_token_t  tok        = {0};
+    uint16_t const    file_id    = FDS_TELEMETRY_FILE_ID;
+    uint16_t const    record_key = FDS_TELEMETRY_RECORD_KEY;
+
+    if (record_find(&file_id, &record_key, &desc, &tok) != FDS_SUCCESS)
+    {
+        return;
+    }
+
+    fds_header_t    const * const p_header = (fds_header_t*)desc.p_record;
+    fds_telemetry_t const * const p_saved  = (fds_telemetry_t*)(desc.p_record + FDS_HEADER_SIZE);
+
+    // Saved with a different configuration.
+    if ((p_header->length_words != sizeof(fds_telemetry_t) / sizeof(uint32_t)) ||
+        (p_saved->version       != FDS_TELEMETRY_VERSION)                      ||
+        (p_saved->pages         != FDS_VIRTUAL_PAGES)                          ||
+        (p_saved->files         != FDS_TELEMETRY_FILES + 1))
+    {
+        return;
+    }
+
+#if (FDS_CRC_CHECK_ON_READ)
+    if (!crc_verify_success(p_header->crc16, p_header->length_words, desc.p_record))
+    {
+        return;
+    }
+#endif
+
+    m_telemetry.gc_runs         += p_saved->gc_runs;
+    m_telemetry.gc_bytes_copied += p_saved->gc_bytes_copied;
+    m_telemetry.queue_full      += p_saved->queue_full;
+    telemetry_queue_depth_update(p_saved->queue_depth_max);
+
+    for (uint16_t i = 0; i < FDS_VIRTUAL_PAGES; i++)
+    {
+        m_telemetry.erase_count[i] += p_saved->erase_count[i];
+    }
+
+    for (uint16_t i = 0; i <= FDS_TELEMETRY_FILES; i++)
+    {
+        uint16_t entry = FDS_TELEMETRY_FILES;
+
+        if (i < FDS_TELEMETRY_FILES)
+        {
+            if (p_saved->file[i].file_id == FDS_FILE_ID_INVALID)
+            {
+                continue;
+            }
+            entry = telemetry_file_entry(p_saved->file[i].file_id);
+        }
+
+        m_telemetry.file[entry].writes  += p_saved->file[i].writes;
+        m_telemetry.file[entry].deletes += p_saved->file[i].deletes;
+    }
+}
+
+#endif // FDS_TELEMETRY_ENABLED
+
+
+// Initialize the filesystem.
+static ret_code_t init_execute(uint32_t prev_ret, fds_op_t * const p_op)
+{
+    ret_code_t ret = FDS_ERR_INTERNAL;
+
+#if (FDS_TX_ENABLED)
+    if (p_op->init.step == FDS_OP_INIT_TX_RECOVER)
+    {
+        // Flash operations of the transaction are pipelined, tx_execute() handles their events.
+        ret = tx_execute(prev_ret);
+        if (ret == FDS_OP_EXECUTING)
+        {
+            return ret;
+        }
+
+        if (ret == FDS_OP_COMPLETED)
+        {
+#if (FDS_RAM_INDEX_ENABLED)
+            index_build();
+#endif
+            m_flags.initialized = true;
+#if (FDS_TELEMETRY_ENABLED)
+            telemetry_load();
+#endif
+        }
+
+        m_flags.initializing = false;
+        return ret;
+    }
+#endif
+
+    if (prev_ret != NRF_SUCCESS)
+    {
+        // A previous operation has timed out.
+        m_flags.initializing = false;
+        return FDS_ERR_OPERATION_TIMEOUT;
+    }
+
+    switch (p_op->init.step)
+    {
+        case FDS_OP_INIT_TAG_SWAP:
+        {
+            // The page write offset was determined previously by pages_init().
+            p_op->init.step = FDS_OP_INIT_TAG_DATA;
+            ret             = page_tag_write_swap();
+        } break;
+
+        case FDS_OP_INIT_TAG_DATA:
+        {
+            // Tag remaining erased pages as data.
+            bool write_reqd = false;
+            for (uint16_t i = 0; i < FDS_DATA_PAGES; i++)
+            {
+                if (m_pages[i].page_type == FDS_PAGE_ERASED)
+                {
+                    m_pages[i].page_type = FDS_PAGE_DATA;
+                    write_reqd           = true;
+                    ret = page_tag_write_data(m_pages[i].p_addr);
+                    break;
+                }
+            }
+            if (!write_reqd)
+            {
+#if (FDS_TX_ENABLED)
+                if (tx_marker_load())
+                {
+                    // A transaction was committed before reset, complete it first.
+                    p_op->init.step = FDS_OP_INIT_TX_RECOVER;
+                    return init_execute(NRF_SUCCESS, p_op);
+                }
+#endif
+#if (FDS_RAM_INDEX_ENABLED)
+                index_build();
+#endif
+                m_flags.initialized  = true;
+                m_flags.initializing = false;
+#if (FDS_TELEMETRY_ENABLED)
+                telemetry_load();
+#endif
+                return FDS_OP_COMPLETED;
+            }
+        } break;
+
+        case FDS_OP_INIT_ERASE_SWAP:
+        {
+            // If the swap is going to be discarded then reset its write_offset.
+            p_op->init.step          = FDS_OP_INIT_TAG_SWAP;
+            m_swap_page.write_offset = FDS_PAGE_TAG_SIZE;
+
+            telemetry_erase_count(m_swap_page.p_addr);
+
+            ret = nrf_fstorage_erase(&m_fs, (uint32_t)m_swap_page.p_addr, FDS_PHY_PAGES_IN_VPAGE, NULL);
+        } break;
+
+        case FDS_OP_INIT_PROMOTE_SWAP:
+        {
+            p_op->init.step       = FDS_OP_INIT_TAG_SWAP;
+
+            uint16_t const         gc         = m_gc.cur_page;
+            uint32_t const * const p_old_swap = m_swap_page.p_addr;
+
+            // Execute the swap. This is done before the write, because backends which complete
+            // operations synchronously run the next step from within nrf_fstorage_write().
+            m_swap_page.p_addr = m_pages[gc].p_addr;
+            m_pages[gc].p_addr = p_old_swap;
+
+            // When promoting the swap, keep the write_offset set by pages_init().
+            // Copy the offset from the swap to the new page.
+            m_pages[gc].write_offset = m_swap_page.write_offset;
+            m_swap_page.write_offset = FDS_PAGE_TAG_SIZE;
+
+            m_pages[gc].page_type = FDS_PAGE_DATA;
+
+            ret = page_tag_write_data(p_old_swap);
+        } break;
+
+        default:
+            // Should not happen.
+            break;
+    }
+
+    if (ret != FDS_SUCCESS)
+    {
+        // fstorage queue was full.
+        m_flags.initializing = false;
+        return FDS_ERR_BUSY;
+    }
+
+    return FDS_OP_EXECUTING;
+}
+
+
+// Executes write and update operations.
+static ret_code_t write_execute(uint32_t prev_ret, fds_op_t * const p_op)
+{
+    ret_code_t         ret;
+    uint32_t   *       p_write_addr;
+    fds_page_t * const p_page = &m_pages[p_op->write.page];
+
+    // This must persist across calls.
+    static fds_record_desc_t desc = {0};
+    // When a record is updated, this variable will hold the page where the old
+    // copy was stored. This will be used to set the can_gc flag when the header is
+    // invalidated (FDS_OP_WRITE_FLAG_DIRTY).
+    static uint16_t page;
+
+    if (prev_ret != NRF_SUCCESS)
+    {
+        // The previous operation has timed out, update offsets.
+        page_offsets_update(p_page, p_op->write.header.length_words);
+        return FDS_ERR_OPERATION_TIMEOUT;
+    }
+
+    // Compute the address where to write data.
+    p_write_addr = (uint32_t*)(p_page->p_addr + p_page->write_offset);
+
+    // Execute the current step of the operation, and set one to be executed next.
+    switch (p_op->write.step)
+    {
+        case FDS_OP_WRITE_FIND_RECORD:
         {
             // The first step of updating a record constists of locating the copy to be deleted.
             // If the old copy couldn't be found for any reason then the update should fail.
@@ -1225,7 +2209,7 @@ static ret_code_t write_execute(uint32_t prev_ret, fds_op_t * const p_op)
             desc.p_record  = NULL;
             desc.record_id = p_op->write.record_to_delete;
 
-            if (!record_find_by_desc(&desc, &page))
+            if (!record_find_by_desc(&desc, &page) || tx_record_is_hidden(desc.p_record))
             {
                 return FDS_ERR_NOT_FOUND;
             }
@@ -1251,12 +2235,23 @@ static ret_code_t write_execute(uint32_t prev_ret, fds_op_t * const p_op)
 
         case FDS_OP_WRITE_FLAG_DIRTY:
             p_op->write.step = FDS_OP_WRITE_DONE;
+#if (FDS_RAM_INDEX_ENABLED)
+            // The new copy is complete.
+            index_add(p_write_addr);
+#endif
             ret = record_header_flag_dirty((uint32_t*)desc.p_record, page);
             break;
 
         case FDS_OP_WRITE_DONE:
             ret = FDS_OP_COMPLETED;
 
+#if (FDS_RAM_INDEX_ENABLED)
+            if (p_op->op_code == FDS_OP_WRITE)
+            {
+                index_add(p_write_addr);
+            }
+#endif
+
 #if (FDS_CRC_CHECK_ON_WRITE)
             if (!crc_verify_success(p_op->write.header.crc16,
                                     p_op->write.header.length_words,
@@ -1319,11 +2314,85 @@ static ret_code_t delete_execute(uint32_t prev_ret, fds_op_t * const p_op)
             break;
     }
 
-    return ret;
+    return ret;
+}
+
+
+// Whether enough space can be reclaimed for fds_gc_idle() to start garbage collection.
+static bool gc_is_worth(void)
+{
+    uint16_t valid_records  = 0;
+    uint16_t dirty_records  = 0;
+    uint16_t freeable_words = 0;
+    bool     corruption     = false;
+
+    for (uint16_t page = 0; page < FDS_DATA_PAGES; page++)
+    {
+        records_stat(page, &valid_records, &dirty_records, &freeable_words, &corruption);
+    }
+
+    return corruption ||
+           ((freeable_words * 100uL) >= (FDS_GC_IDLE_DIRTY_PERCENT * (uint32_t)FDS_DATA_PAGES * FDS_PAGE_SIZE));
+}
+
+
+static uint32_t gc_time_get(void)
+{
+    return (m_gc_time_get != NULL) ? m_gc_time_get() : 0;
+}
+
+
+// Called on every GC step. Operations other than GC in the queue are waiting for it.
+static void gc_stall_check(void)
+{
+    if (m_queued_op_cnt > m_gc.queued)
+    {
+        if (!m_gc_stall)
+        {
+            m_gc_stall       = true;
+            m_gc_stall_start = gc_time_get();
+            m_gc_stat.stalls++;
+        }
+        m_gc_stat.stall_steps++;
+    }
+}
+
+
+// Called when a GC operation completes. Operations waiting on it can run now.
+static void gc_stall_end(void)
+{
+    m_gc.queued--;
+
+    if (m_gc_stall && (m_gc.queued == 0))
+    {
+        uint32_t const stall_time = gc_time_get() - m_gc_stall_start;
+
+        m_gc_stall                = false;
+        m_gc_stat.stall_time     += stall_time;
+        if (stall_time > m_gc_stat.stall_time_max)
+        {
+            m_gc_stat.stall_time_max = stall_time;
+        }
+    }
+}
+
+
+// Whether GC started by fds_gc_idle() must stop. Only between pages, when the budget is used up
+// or when other operations are waiting.
+static bool gc_idle_yield(fds_op_t * const p_op)
+{
+    if (!p_op->gc.idle)
+    {
+        return false;
+    }
+
+    p_op->gc.pages--;
+
+    return (p_op->gc.pages == 0) || (m_queued_op_cnt > m_gc.queued);
 }
 
 
-static ret_code_t gc_execute(uint32_t prev_ret)
+static ret_code_t gc_step_execute(uint32_t prev_ret, fds_op_t * const p_op)
 {
     ret_code_t ret;
 
@@ -1338,7 +2407,17 @@ static ret_code_t gc_execute(uint32_t prev_ret)
     }
     else
     {
+        fds_gc_state_t const prev_state = m_gc.state;
+
         gc_state_advance();
+
+        if ((prev_state == GC_TAG_NEW_SWAP) && gc_idle_yield(p_op))
+        {
+            // Resume with the next page.
+            m_gc.resume = true;
+            m_gc_stat.idle_yields++;
+            return FDS_OP_COMPLETED;
+        }
     }
 
     switch (m_gc.state)
@@ -1378,6 +2457,28 @@ static ret_code_t gc_execute(uint32_t prev_ret)
 }
 
 
+static ret_code_t gc_execute(uint32_t prev_ret, fds_op_t * const p_op)
+{
+    ret_code_t ret;
+
+    gc_stall_check();
+
+    ret = gc_step_execute(prev_ret, p_op);
+
+    if (ret != FDS_OP_EXECUTING)
+    {
+        if ((ret != FDS_OP_COMPLETED) && (m_gc.state != GC_BEGIN))
+        {
+            // The last step failed, the next GC operation retries it.
+            m_gc.resume = true;
+        }
+        gc_stall_end();
+    }
+
+    return ret;
+}
+
+
 static void queue_process(ret_code_t result)
 {
     static fds_op_t              * m_p_cur_op;  // Current fds operation.
@@ -1417,8 +2518,14 @@ static void queue_process(ret_code_t result)
                 break;
 
             case FDS_OP_GC:
-                result = gc_execute(result);
+                result = gc_execute(result, m_p_cur_op);
+                break;
+
+#if (FDS_TX_ENABLED)
+            case FDS_OP_TX:
+                result = tx_execute(result);
                 break;
+#endif
 
             default:
                 result = FDS_ERR_INTERNAL;
@@ -1455,6 +2562,16 @@ static void queue_process(ret_code_t result)
         }
 
         event_prepare(m_p_cur_op, &evt);
+
+#if (FDS_TELEMETRY_ENABLED)
+        if (((m_p_cur_op->op_code == FDS_OP_WRITE) || (m_p_cur_op->op_code == FDS_OP_UPDATE)) &&
+            (m_p_cur_op->write.p_data == &m_telemetry_saved))
+        {
+            // The copy of the counters can be changed again.
+            m_telemetry_saving = false;
+        }
+#endif
+
         event_send(&evt);
 
         // Zero the pointer to the current operation so that this function
@@ -1475,7 +2592,11 @@ static void queue_process(ret_code_t result)
 
 static void queue_start(void)
 {
-    if (!nrf_atomic_u32_fetch_add(&m_queued_op_cnt, 1))
+    uint32_t const queued = nrf_atomic_u32_fetch_add(&m_queued_op_cnt, 1);
+
+    telemetry_queue_depth_update(queued + 1);
+
+    if (queued == 0)
     {
         queue_process(NRF_SUCCESS);
     }
@@ -1511,8 +2632,12 @@ static ret_code_t write_enqueue(fds_record_desc_t         * const p_desc,
         return FDS_ERR_NULL_ARG;
     }
 
-    if ((p_record->file_id == FDS_FILE_ID_INVALID) ||
-        (p_record->key     == FDS_RECORD_KEY_DIRTY))
+    if (p_record->key == FDS_RECORD_KEY_DIRTY)
+    {
+        return FDS_ERR_INVALID_ARG;
+    }
+
+    if (file_id_is_reserved(p_record->file_id) && !record_is_telemetry(p_record))
     {
         return FDS_ERR_INVALID_ARG;
     }
@@ -1623,6 +2748,10 @@ ret_code_t fds_register(fds_cb_t cb)
 
 static uint32_t flash_end_addr(void)
 {
+#if (FDS_BACKEND == NRF_FSTORAGE_FILE)
+    // There are no FICR and UICR registers on the host.
+    return NRF_FSTORAGE_FILE_END_ADDR;
+#else
     uint32_t const bootloader_addr = NRF_UICR->NRFFW[0];
     uint32_t const page_sz         = NRF_FICR->CODEPAGESIZE;
 #ifndef NRF52810_XXAA
@@ -1633,6 +2762,7 @@ static uint32_t flash_end_addr(void)
 #endif
 
     return (bootloader_addr != 0xFFFFFFFF) ? bootloader_addr : (code_sz * page_sz);
+#endif
 }
 
 
@@ -1652,6 +2782,8 @@ static ret_code_t flash_subsystem_init(void)
         return nrf_fstorage_init(&m_fs, &nrf_fstorage_sd, NULL);
     #elif (FDS_BACKEND == NRF_FSTORAGE_NVMC)
         return nrf_fstorage_init(&m_fs, &nrf_fstorage_nvmc, NULL);
+    #elif (FDS_BACKEND == NRF_FSTORAGE_FILE)
+        return nrf_fstorage_init(&m_fs, &nrf_fstorage_file, NULL);
     #else
         #error Invalid FDS_BACKEND.
     #endif
@@ -1696,6 +2828,10 @@ ret_code_t fds_init(void)
 
     queue_init();
 
+#if (FDS_TELEMETRY_ENABLED)
+    telemetry_init();
+#endif
+
     // Initialize the page structure (m_pages), and determine which
     // initialization steps are required given the current state of the filesystem.
 
@@ -1709,9 +2845,22 @@ ret_code_t fds_init(void)
 
         case ALREADY_INSTALLED:
         {
+#if (FDS_TX_ENABLED)
+            if (tx_marker_load())
+            {
+                // A transaction was committed before reset. Complete it in the queue.
+                break;
+            }
+#endif
             // No initialization is necessary. Notify the application immediately.
+#if (FDS_RAM_INDEX_ENABLED)
+            index_build();
+#endif
             m_flags.initialized  = true;
             m_flags.initializing = false;
+#if (FDS_TELEMETRY_ENABLED)
+            telemetry_load();
+#endif
             event_send(&evt_success);
             return FDS_SUCCESS;
         }
@@ -1753,6 +2902,12 @@ ret_code_t fds_init(void)
             p_op->init.step = FDS_OP_INIT_TAG_DATA;
             break;
 
+#if (FDS_TX_ENABLED)
+        case ALREADY_INSTALLED:
+            p_op->init.step = FDS_OP_INIT_TX_RECOVER;
+            break;
+#endif
+
         default:
             // Should not happen.
             break;
@@ -1776,7 +2931,7 @@ ret_code_t fds_record_open(fds_record_desc_t  * const p_desc,
     }
 
     // Find the record if necessary.
-    if (record_find_by_desc(p_desc, &page))
+    if (record_find_by_desc(p_desc, &page) && !tx_record_is_hidden(p_desc->p_record))
     {
         fds_header_t const * const p_header = (fds_header_t*)p_desc->p_record;
 
@@ -1836,78 +2991,302 @@ ret_code_t fds_record_close(fds_record_desc_t * const p_desc)
     }
     else
     {
-        ret = FDS_ERR_NOT_FOUND;
+        ret = FDS_ERR_NOT_FOUND;
+    }
+
+    return ret;
+}
+
+
+ret_code_t fds_reserve(fds_reserve_token_t * const p_tok, uint16_t length_words)
+{
+    ret_code_t ret;
+    uint16_t   page;
+
+    if (!m_flags.initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    if (p_tok == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    ret = write_space_reserve(length_words, &page);
+
+    if (ret == FDS_SUCCESS)
+    {
+        p_tok->page         = page;
+        p_tok->length_words = length_words;
+    }
+
+    return ret;
+}
+
+
+ret_code_t fds_reserve_cancel(fds_reserve_token_t * const p_tok)
+{
+    ret_code_t ret;
+
+    if (!m_flags.initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    if (p_tok == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    if (p_tok->page > FDS_DATA_PAGES)
+    {
+        // The page does not exist. This shouldn't happen.
+        return FDS_ERR_INVALID_ARG;
+    }
+
+    fds_page_t const * const p_page = &m_pages[p_tok->page];
+
+    CRITICAL_SECTION_ENTER();
+    if ((FDS_HEADER_SIZE + p_tok->length_words) <= p_page->words_reserved)
+    {
+        // Free reserved space.
+        write_space_free(p_tok->length_words, p_tok->page);
+
+        // Clean the token.
+        p_tok->page         = 0;
+        p_tok->length_words = 0;
+        ret = FDS_SUCCESS;
+    }
+    else
+    {
+        // We are trying to cancel a reservation of more words than how many are
+        // currently reserved on the page. Clearly, this shouldn't happen.
+        ret = FDS_ERR_INVALID_ARG;
+    }
+    CRITICAL_SECTION_EXIT();
+
+    return ret;
+}
+
+
+ret_code_t fds_record_write(fds_record_desc_t       * const p_desc,
+                            fds_record_t      const * const p_record)
+{
+    return write_enqueue(p_desc, p_record, NULL, FDS_OP_WRITE);
+}
+
+
+ret_code_t fds_record_write_reserved(fds_record_desc_t         * const p_desc,
+                                     fds_record_t        const * const p_record,
+                                     fds_reserve_token_t const * const p_tok)
+{
+    // A NULL token is not allowed when writing to a reserved space.
+    if (p_tok == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    return write_enqueue(p_desc, p_record, p_tok, FDS_OP_WRITE);
+}
+
+
+ret_code_t fds_record_update(fds_record_desc_t       * const p_desc,
+                             fds_record_t      const * const p_record)
+{
+    // A NULL descriptor is not allowed when updating a record.
+    if (p_desc == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    return write_enqueue(p_desc, p_record, NULL, FDS_OP_UPDATE);
+}
+
+
+ret_code_t fds_record_delete(fds_record_desc_t * const p_desc)
+{
+    fds_op_t * p_op;
+    nrf_atfifo_item_put_t iput_ctx;
+
+    if (!m_flags.initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    if (p_desc == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    p_op = queue_buf_get(&iput_ctx);
+    if (p_op == NULL)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+
+    p_op->op_code              = FDS_OP_DEL_RECORD;
+    p_op->del.step             = FDS_OP_DEL_RECORD_FLAG_DIRTY;
+    p_op->del.record_to_delete = p_desc->record_id;
+
+    queue_buf_store(&iput_ctx);
+    queue_start();
+
+    return FDS_SUCCESS;
+}
+
+
+ret_code_t fds_file_delete(uint16_t file_id)
+{
+    fds_op_t * p_op;
+    nrf_atfifo_item_put_t iput_ctx;
+
+    if (!m_flags.initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    if (file_id_is_reserved(file_id))
+    {
+        return FDS_ERR_INVALID_ARG;
+    }
+
+    p_op = queue_buf_get(&iput_ctx);
+    if (p_op == NULL)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+
+    p_op->op_code      = FDS_OP_DEL_FILE;
+    p_op->del.step     = FDS_OP_DEL_FILE_FLAG_DIRTY;
+    p_op->del.file_id  = file_id;
+
+    queue_buf_store(&iput_ctx);
+    queue_start();
+
+    return FDS_SUCCESS;
+}
+
+
+static ret_code_t gc_enqueue(bool idle, uint16_t pages)
+{
+    fds_op_t * p_op;
+    nrf_atfifo_item_put_t iput_ctx;
+
+    p_op = queue_buf_get(&iput_ctx);
+    if (p_op == NULL)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+
+    p_op->op_code  = FDS_OP_GC;
+    p_op->gc.idle  = idle;
+    p_op->gc.pages = pages;
+
+    queue_buf_store(&iput_ctx);
+
+    CRITICAL_SECTION_ENTER();
+    // While another GC operation is queued, its last step is still running or has failed;
+    // gc_execute() takes care of resuming in that case.
+    if ((m_gc.queued == 0) && (m_gc.state != GC_BEGIN))
+    {
+        // Resume GC by retrying the last step.
+        m_gc.resume = true;
+    }
+    m_gc.queued++;
+    CRITICAL_SECTION_EXIT();
+
+    queue_start();
+
+    return FDS_SUCCESS;
+}
+
+
+ret_code_t fds_gc(void)
+{
+    if (!m_flags.initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
     }
 
-    return ret;
+    return gc_enqueue(false, 0);
 }
 
 
-ret_code_t fds_reserve(fds_reserve_token_t * const p_tok, uint16_t length_words)
+ret_code_t fds_gc_idle(uint16_t pages)
 {
     ret_code_t ret;
-    uint16_t   page;
 
     if (!m_flags.initialized)
     {
         return FDS_ERR_NOT_INITIALIZED;
     }
 
-    if (p_tok == NULL)
+    if (pages == 0)
     {
-        return FDS_ERR_NULL_ARG;
+        return FDS_ERR_INVALID_ARG;
     }
 
-    ret = write_space_reserve(length_words, &page);
+    if (m_gc.queued != 0)
+    {
+        return FDS_ERR_BUSY;
+    }
+
+    // A GC that stopped between pages is always resumed.
+    if ((m_gc.state == GC_BEGIN) && !gc_is_worth())
+    {
+        return FDS_ERR_NOT_FOUND;
+    }
 
+    ret = gc_enqueue(true, pages);
     if (ret == FDS_SUCCESS)
     {
-        p_tok->page         = page;
-        p_tok->length_words = length_words;
+        m_gc_stat.idle_slices++;
     }
 
     return ret;
 }
 
 
-ret_code_t fds_reserve_cancel(fds_reserve_token_t * const p_tok)
+ret_code_t fds_gc_stat(fds_gc_stat_t * const p_stat)
 {
-    ret_code_t ret;
-
-    if (!m_flags.initialized)
-    {
-        return FDS_ERR_NOT_INITIALIZED;
-    }
-
-    if (p_tok == NULL)
+    if (p_stat == NULL)
     {
         return FDS_ERR_NULL_ARG;
     }
 
-    if (p_tok->page > FDS_DATA_PAGES)
+    *p_stat = m_gc_stat;
+
+    return FDS_SUCCESS;
+}
+
+
+void fds_gc_time_source_set(fds_time_get_t time_get)
+{
+    m_gc_time_get = time_get;
+}
+
+
+#if (FDS_TX_ENABLED)
+
+ret_code_t fds_tx_begin(void)
+{
+    ret_code_t ret = FDS_SUCCESS;
+
+    if (!m_flags.initialized)
     {
-        // The page does not exist. This shouldn't happen.
-        return FDS_ERR_INVALID_ARG;
+        return FDS_ERR_NOT_INITIALIZED;
     }
 
-    fds_page_t const * const p_page = &m_pages[p_tok->page];
-
     CRITICAL_SECTION_ENTER();
-    if ((FDS_HEADER_SIZE + p_tok->length_words) <= p_page->words_reserved)
+    if (m_tx.phase == FDS_TX_IDLE)
     {
-        // Free reserved space.
-        write_space_free(p_tok->length_words, p_tok->page);
-
-        // Clean the token.
-        p_tok->page         = 0;
-        p_tok->length_words = 0;
-        ret = FDS_SUCCESS;
+        m_tx.phase = FDS_TX_OPEN;
+        m_tx.count = 0;
     }
     else
     {
-        // We are trying to cancel a reservation of more words than how many are
-        // currently reserved on the page. Clearly, this shouldn't happen.
-        ret = FDS_ERR_INVALID_ARG;
+        ret = FDS_ERR_BUSY;
     }
     CRITICAL_SECTION_EXIT();
 
@@ -1915,135 +3294,157 @@ ret_code_t fds_reserve_cancel(fds_reserve_token_t * const p_tok)
 }
 
 
-ret_code_t fds_record_write(fds_record_desc_t       * const p_desc,
-                            fds_record_t      const * const p_record)
-{
-    return write_enqueue(p_desc, p_record, NULL, FDS_OP_WRITE);
-}
-
-
-ret_code_t fds_record_write_reserved(fds_record_desc_t         * const p_desc,
-                                     fds_record_t        const * const p_record,
-                                     fds_reserve_token_t const * const p_tok)
+static ret_code_t tx_record_add(fds_record_t const * const p_record, uint32_t record_to_delete)
 {
-    // A NULL token is not allowed when writing to a reserved space.
-    if (p_tok == NULL)
+    if (m_tx.phase != FDS_TX_OPEN)
     {
-        return FDS_ERR_NULL_ARG;
+        return FDS_ERR_BUSY;
     }
 
-    return write_enqueue(p_desc, p_record, p_tok, FDS_OP_WRITE);
-}
-
-
-ret_code_t fds_record_update(fds_record_desc_t       * const p_desc,
-                             fds_record_t      const * const p_record)
-{
-    // A NULL descriptor is not allowed when updating a record.
-    if (p_desc == NULL)
+    if (p_record == NULL)
     {
         return FDS_ERR_NULL_ARG;
     }
 
-    return write_enqueue(p_desc, p_record, NULL, FDS_OP_UPDATE);
-}
-
-
-ret_code_t fds_record_delete(fds_record_desc_t * const p_desc)
-{
-    fds_op_t * p_op;
-    nrf_atfifo_item_put_t iput_ctx;
-
-    if (!m_flags.initialized)
+    if (file_id_is_reserved(p_record->file_id) ||
+        (p_record->key == FDS_RECORD_KEY_DIRTY))
     {
-        return FDS_ERR_NOT_INITIALIZED;
+        return FDS_ERR_INVALID_ARG;
     }
 
-    if (p_desc == NULL)
+    if (!is_word_aligned(p_record->data.p_data))
     {
-        return FDS_ERR_NULL_ARG;
+        return FDS_ERR_UNALIGNED_ADDR;
     }
 
-    p_op = queue_buf_get(&iput_ctx);
-    if (p_op == NULL)
+    if (m_tx.count == FDS_TX_MAX_RECORDS)
     {
         return FDS_ERR_NO_SPACE_IN_QUEUES;
     }
 
-    p_op->op_code              = FDS_OP_DEL_RECORD;
-    p_op->del.step             = FDS_OP_DEL_RECORD_FLAG_DIRTY;
-    p_op->del.record_to_delete = p_desc->record_id;
+    fds_header_t * const p_header = &m_tx.header[m_tx.count];
 
-    queue_buf_store(&iput_ctx);
-    queue_start();
+    p_header->record_key   = p_record->key;
+    p_header->length_words = p_record->data.length_words;
+    p_header->file_id      = p_record->file_id;
+
+    m_tx.p_data[m_tx.count]           = p_record->data.p_data;
+    m_tx.record_to_delete[m_tx.count] = record_to_delete;
+    m_tx.count++;
 
     return FDS_SUCCESS;
 }
 
 
-ret_code_t fds_file_delete(uint16_t file_id)
+ret_code_t fds_tx_write(fds_record_t const * const p_record)
 {
-    fds_op_t * p_op;
-    nrf_atfifo_item_put_t iput_ctx;
+    return tx_record_add(p_record, 0);
+}
 
-    if (!m_flags.initialized)
+
+ret_code_t fds_tx_update(fds_record_desc_t const * const p_desc,
+                         fds_record_t      const * const p_record)
+{
+    if (p_desc == NULL)
     {
-        return FDS_ERR_NOT_INITIALIZED;
+        return FDS_ERR_NULL_ARG;
     }
 
-    if (file_id == FDS_FILE_ID_INVALID)
+    return tx_record_add(p_record, p_desc->record_id);
+}
+
+
+ret_code_t fds_tx_commit(void)
+{
+    ret_code_t              ret = FDS_SUCCESS;
+    uint16_t                reserved;
+    fds_op_t              * p_op;
+    nrf_atfifo_item_put_t   iput_ctx;
+
+    if (m_tx.phase != FDS_TX_OPEN)
     {
-        return FDS_ERR_INVALID_ARG;
+        return FDS_ERR_BUSY;
     }
 
-    p_op = queue_buf_get(&iput_ctx);
-    if (p_op == NULL)
+    if (m_tx.count == 0)
     {
-        return FDS_ERR_NO_SPACE_IN_QUEUES;
+        m_tx.phase = FDS_TX_IDLE;
+        return FDS_ERR_INVALID_ARG;
     }
 
-    p_op->op_code      = FDS_OP_DEL_FILE;
-    p_op->del.step     = FDS_OP_DEL_FILE_FLAG_DIRTY;
-    p_op->del.file_id  = file_id;
-
-    queue_buf_store(&iput_ctx);
-    queue_start();
-
-    return FDS_SUCCESS;
-}
+    // Find a page for each record, then for the commit marker.
+    for (reserved = 0; reserved <= m_tx.count; reserved++)
+    {
+        uint16_t const length_words = (reserved < m_tx.count) ? m_tx.header[reserved].length_words :
+                                                                (1 + (3 * m_tx.count));
 
+        uint16_t * const p_page = (reserved < m_tx.count) ? &m_tx.page[reserved] :
+                                                            &m_tx.page[FDS_TX_MAX_RECORDS];
 
-ret_code_t fds_gc(void)
-{
-    fds_op_t * p_op;
-    nrf_atfifo_item_put_t iput_ctx;
+        ret = write_space_reserve(length_words, p_page);
+        if (ret != FDS_SUCCESS)
+        {
+            break;
+        }
+    }
 
-    if (!m_flags.initialized)
+    if (ret == FDS_SUCCESS)
     {
-        return FDS_ERR_NOT_INITIALIZED;
+        p_op = queue_buf_get(&iput_ctx);
+        if (p_op == NULL)
+        {
+            ret = FDS_ERR_NO_SPACE_IN_QUEUES;
+        }
     }
 
-    p_op = queue_buf_get(&iput_ctx);
-    if (p_op == NULL)
+    if (ret != FDS_SUCCESS)
     {
-        return FDS_ERR_NO_SPACE_IN_QUEUES;
+        // Undo the reservations. The transaction stays open, so that records can be removed by
+        // fds_tx_abort() or space can be reclaimed by garbage collection before retrying.
+        CRITICAL_SECTION_ENTER();
+        while (reserved-- > 0)
+        {
+            if (reserved < m_tx.count)
+            {
+                write_space_free(m_tx.header[reserved].length_words, m_tx.page[reserved]);
+            }
+            else
+            {
+                write_space_free(1 + (3 * m_tx.count), m_tx.page[FDS_TX_MAX_RECORDS]);
+            }
+        }
+        CRITICAL_SECTION_EXIT();
+        return ret;
     }
 
-    p_op->op_code = FDS_OP_GC;
+    m_tx.phase   = FDS_TX_QUEUED;
+    m_tx.failed  = false;
+    m_tx.action  = 0;
+    m_tx.pending = 0;
+
+    p_op->op_code = FDS_OP_TX;
 
     queue_buf_store(&iput_ctx);
+    queue_start();
+
+    return FDS_SUCCESS;
+}
+
 
-    if (m_gc.state != GC_BEGIN)
+ret_code_t fds_tx_abort(void)
+{
+    if (m_tx.phase != FDS_TX_OPEN)
     {
-        // Resume GC by retrying the last step.
-        m_gc.resume = true;
+        return FDS_ERR_BUSY;
     }
 
-    queue_start();
+    m_tx.phase = FDS_TX_IDLE;
 
     return FDS_SUCCESS;
 }
 
+#endif // FDS_TX_ENABLED
+
 
 ret_code_t fds_record_iterate(fds_record_desc_t * const p_desc,
                               fds_find_token_t  * const p_token)
@@ -2153,7 +3554,125 @@ ret_code_t fds_stat(fds_stat_t * const p_stat)
                      &p_stat->corruption);
     }
 
+#if (FDS_TELEMETRY_ENABLED)
+    for (uint16_t page = 0; page < FDS_VIRTUAL_PAGES; page++)
+    {
+        if (m_telemetry.erase_count[page] > p_stat->erase_count_max)
+        {
+            p_stat->erase_count_max = m_telemetry.erase_count[page];
+        }
+    }
+
+    p_stat->gc_runs         = m_telemetry.gc_runs;
+    p_stat->gc_bytes_copied = m_telemetry.gc_bytes_copied;
+    p_stat->queue_full      = m_telemetry.queue_full;
+    p_stat->queue_depth_max = m_telemetry.queue_depth_max;
+#endif
+
+    return FDS_SUCCESS;
+}
+
+
+#if (FDS_TELEMETRY_ENABLED)
+
+ret_code_t fds_stat_erase_count(uint16_t page, uint32_t * const p_count)
+{
+    if (p_count == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    if (page >= FDS_VIRTUAL_PAGES)
+    {
+        return FDS_ERR_INVALID_ARG;
+    }
+
+    *p_count = m_telemetry.erase_count[page];
+
+    return FDS_SUCCESS;
+}
+
+
+ret_code_t fds_stat_file(uint16_t file_id, fds_file_stat_t * const p_stat)
+{
+    if (p_stat == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    // FDS_FILE_ID_INVALID selects the last entry, which counts the files that have no entry.
+    uint16_t i = FDS_TELEMETRY_FILES;
+
+    if (file_id != FDS_FILE_ID_INVALID)
+    {
+        for (i = 0; i < FDS_TELEMETRY_FILES; i++)
+        {
+            if (m_telemetry.file[i].file_id == file_id)
+            {
+                break;
+            }
+        }
+
+        if (i == FDS_TELEMETRY_FILES)
+        {
+            return FDS_ERR_NOT_FOUND;
+        }
+    }
+
+    p_stat->writes  = m_telemetry.file[i].writes;
+    p_stat->deletes = m_telemetry.file[i].deletes;
+
     return FDS_SUCCESS;
 }
 
+
+ret_code_t fds_telemetry_save(void)
+{
+    ret_code_t        ret;
+    fds_record_desc_t desc       = {0};
+    fds_find_token_t  tok        = {0};
+    uint16_t const    file_id    = FDS_TELEMETRY_FILE_ID;
+    uint16_t const    record_key = FDS_TELEMETRY_RECORD_KEY;
+
+    fds_record_t const record =
+    {
+        .file_id           = FDS_TELEMETRY_FILE_ID,
+        .key               = FDS_TELEMETRY_RECORD_KEY,
+        .data.p_data       = &m_telemetry_saved,
+        .data.length_words = sizeof(fds_telemetry_t) / sizeof(uint32_t),
+    };
+
+    if (!m_flags.initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    if (m_telemetry_saving)
+    {
+        return FDS_ERR_BUSY;
+    }
+
+    // The copy is written from the queue, it must not change until then.
+    m_telemetry_saved  = m_telemetry;
+    m_telemetry_saving = true;
+
+    if (record_find(&file_id, &record_key, &desc, &tok) == FDS_SUCCESS)
+    {
+        ret = write_enqueue(&desc, &record, NULL, FDS_OP_UPDATE);
+    }
+    else
+    {
+        ret = write_enqueue(NULL, &record, NULL, FDS_OP_WRITE);
+    }
+
+    if (ret != FDS_SUCCESS)
+    {
+        m_telemetry_saving = false;
+    }
+
+    return ret;
+}
+
+#endif // FDS_TELEMETRY_ENABLED
+
 #endif //NRF_MODULE_ENABLED(FDS)
@@ -192,7 +192,8 @@ typedef enum
     FDS_EVT_UPDATE,     //!< Event for @ref fds_record_update.
     FDS_EVT_DEL_RECORD, //!< Event for @ref fds_record_delete.
     FDS_EVT_DEL_FILE,   //!< Event for @ref fds_file_delete.
-    FDS_EVT_GC          //!< Event for @ref fds_gc.
+    FDS_EVT_GC,         //!< Event for @ref fds_gc.
+    FDS_EVT_TX          //!< Event for @ref fds_tx_commit.
 } fds_evt_id_t;
 
 
@@ -258,9 +259,52 @@ typedef struct
      * @note: This flag is unrelated to CRC failures.
      */
     bool corruption;
+
+    /**@brief Operation counters, zero unless FDS_TELEMETRY_ENABLED is set.
+     *
+     * They include the counters saved by @ref fds_telemetry_save before reset, if any.
+     */
+    uint32_t erase_count_max;   //!< The highest number of times a virtual page was erased.
+    uint32_t gc_runs;           //!< The number of times garbage collection went through all pages.
+    uint32_t gc_bytes_copied;   //!< The number of bytes copied by garbage collection.
+    uint32_t queue_full;        //!< The number of operations rejected with @ref FDS_ERR_NO_SPACE_IN_QUEUES.
+    uint32_t queue_depth_max;   //!< The largest number of operations queued at once.
 } fds_stat_t;
 
 
+/**@brief   Operation counters of a file. */
+typedef struct
+{
+    uint32_t writes;            //!< The number of records written, including updates.
+    uint32_t deletes;           //!< The number of records deleted, including old copies of updated records.
+} fds_file_stat_t;
+
+
+/**@brief   Garbage collection statistics.
+ *
+ * A stall is the time an operation waits in the queue for garbage collection to finish or to stop.
+ * Times are in the units of the function set by @ref fds_gc_time_source_set, and are zero if
+ * none is set.
+ */
+typedef struct
+{
+    uint16_t runs;              //!< Number of times garbage collection went through all pages.
+    uint16_t idle_slices;       //!< Number of operations started by @ref fds_gc_idle.
+    uint16_t idle_yields;       //!< Number of those which stopped before all pages were collected.
+    uint16_t stalls;            //!< Number of times operations waited on garbage collection.
+    uint32_t stall_steps;       //!< Number of flash operations garbage collection did while operations waited.
+    uint32_t stall_time;        //!< Total time operations waited on garbage collection.
+    uint32_t stall_time_max;    //!< Longest time operations waited on garbage collection.
+} fds_gc_stat_t;
+
+
+/**@brief   Time source function prototype, used to measure garbage collection stalls.
+ *
+ * @return  The current time, in any unit. It is allowed to wrap around.
+ */
+typedef uint32_t (*fds_time_get_t)(void);
+
+
 /**@brief   FDS event handler function prototype.
  *
  * @param   p_evt   The event.
@@ -636,6 +680,129 @@ ret_code_t fds_record_close(fds_record_desc_t * p_desc);
 ret_code_t fds_gc(void);
 
 
+/**@brief   Function for running garbage collection in idle time.
+ *
+ * Call this function when the application is idle, for example when there is no connection or
+ * when the link has been quiet for a while. Garbage collection starts only if at least
+ * @ref FDS_GC_IDLE_DIRTY_PERCENT of the data page words can be reclaimed, or if corruption was
+ * detected.
+ *
+ * Garbage collection stops after @p pages pages, or as soon as the current page is done if other
+ * operations have been queued meanwhile. The next call resumes it; so does @ref fds_gc.
+ * A page is never left half collected, because records on it could be updated or deleted in the
+ * meantime.
+ *
+ * This function is asynchronous. Completion is reported through an @ref FDS_EVT_GC event, also
+ * when garbage collection stopped before collecting all pages.
+ *
+ * @param[in]   pages   The maximum number of pages to garbage collect.
+ *
+ * @retval  FDS_SUCCESS                 If the operation was queued successfully.
+ * @retval  FDS_ERR_NOT_INITIALIZED     If the module is not initialized.
+ * @retval  FDS_ERR_INVALID_ARG         If @p pages is zero.
+ * @retval  FDS_ERR_BUSY                If garbage collection is already queued.
+ * @retval  FDS_ERR_NOT_FOUND           If there is not enough to reclaim yet.
+ * @retval  FDS_ERR_NO_SPACE_IN_QUEUES  If the operation queue is full.
+ */
+ret_code_t fds_gc_idle(uint16_t pages);
+
+
+/**@brief   Function for retrieving garbage collection statistics.
+ *
+ * @param[out]  p_stat  Garbage collection statistics.
+ *
+ * @retval  FDS_SUCCESS         If the statistics were returned successfully.
+ * @retval  FDS_ERR_NULL_ARG    If @p p_stat is NULL.
+ */
+ret_code_t fds_gc_stat(fds_gc_stat_t * const p_stat);
+
+
+/**@brief   Function for setting the time source used to measure garbage collection stalls.
+ *
+ * @param[in]   time_get    The time source, or NULL to stop measuring time.
+ */
+void fds_gc_time_source_set(fds_time_get_t time_get);
+
+
+/**@brief   Function for starting a transaction.
+ *
+ * Records written or updated in a transaction are stored atomically: after a reset, either all
+ * of them or none of them are found. Until the transaction is completed, @ref fds_record_find and
+ * related functions return the records as they were before the transaction.
+ *
+ * Only one transaction can be open at a time. Transactions are available if FDS_TX_ENABLED is set.
+ * The file ID 0xBFFF is reserved for commit markers and must not be used by the application.
+ *
+ * @retval  FDS_SUCCESS             If the transaction was started.
+ * @retval  FDS_ERR_NOT_INITIALIZED If the module is not initialized.
+ * @retval  FDS_ERR_BUSY            If another transaction is open or is being committed.
+ */
+ret_code_t fds_tx_begin(void);
+
+
+/**@brief   Function for adding a new record to the open transaction.
+ *
+ * The record data is not buffered: it must stay in memory until the @ref FDS_EVT_TX event is
+ * received.
+ *
+ * @param[in]   p_record    The record to write.
+ *
+ * @retval  FDS_SUCCESS                 If the record was added.
+ * @retval  FDS_ERR_BUSY                If no transaction is open.
+ * @retval  FDS_ERR_NULL_ARG            If @p p_record is NULL.
+ * @retval  FDS_ERR_INVALID_ARG         If the file ID or the record key is not valid.
+ * @retval  FDS_ERR_UNALIGNED_ADDR      If the record data is not aligned to a 4 byte boundary.
+ * @retval  FDS_ERR_NO_SPACE_IN_QUEUES  If the transaction already holds FDS_TX_MAX_RECORDS records.
+ */
+ret_code_t fds_tx_write(fds_record_t const * const p_record);
+
+
+/**@brief   Function for adding a record update to the open transaction.
+ *
+ * The old record is deleted when the transaction is completed. The record data is not buffered:
+ * it must stay in memory until the @ref FDS_EVT_TX event is received.
+ *
+ * @param[in]   p_desc      The descriptor of the record to update.
+ * @param[in]   p_record    The updated record.
+ *
+ * @retval  FDS_SUCCESS                 If the record was added.
+ * @retval  FDS_ERR_BUSY                If no transaction is open.
+ * @retval  FDS_ERR_NULL_ARG            If @p p_desc or @p p_record is NULL.
+ * @retval  FDS_ERR_INVALID_ARG         If the file ID or the record key is not valid.
+ * @retval  FDS_ERR_UNALIGNED_ADDR      If the record data is not aligned to a 4 byte boundary.
+ * @retval  FDS_ERR_NO_SPACE_IN_QUEUES  If the transaction already holds FDS_TX_MAX_RECORDS records.
+ */
+ret_code_t fds_tx_update(fds_record_desc_t const * const p_desc,
+                         fds_record_t      const * const p_record);
+
+
+/**@brief   Function for committing the open transaction.
+ *
+ * This function is asynchronous. Completion is reported through an @ref FDS_EVT_TX event.
+ *
+ * If the event reports an error after the commit marker might have been written, the transaction
+ * is neither completed nor discarded until the next @ref fds_init, which completes it if the
+ * marker is found. Until then, no other transaction can be started.
+ *
+ * @retval  FDS_SUCCESS                 If the transaction was queued for commit.
+ * @retval  FDS_ERR_BUSY                If no transaction is open.
+ * @retval  FDS_ERR_INVALID_ARG         If the transaction holds no records. It is closed.
+ * @retval  FDS_ERR_RECORD_TOO_LARGE    If a record exceeds the maximum length.
+ * @retval  FDS_ERR_NO_SPACE_IN_FLASH   If there is not enough space in flash. The transaction stays
+ *                                      open.
+ * @retval  FDS_ERR_NO_SPACE_IN_QUEUES  If the operation queue is full. The transaction stays open.
+ */
+ret_code_t fds_tx_commit(void);
+
+
+/**@brief   Function for discarding the open transaction.
+ *
+ * @retval  FDS_SUCCESS     If the transaction was discarded.
+ * @retval  FDS_ERR_BUSY    If no transaction is open.
+ */
+ret_code_t fds_tx_abort(void);
+
+
 /**@brief   Function for obtaining a descriptor from a record ID.
  *
  * This function can be used to reconstruct a descriptor from a record ID, like the one that is
@@ -690,6 +857,55 @@ ret_code_t fds_record_id_from_desc(fds_record_desc_t const * p_desc,
 ret_code_t fds_stat(fds_stat_t * p_stat);
 
 
+/**@brief   Function for retrieving the number of times a virtual page was erased.
+ *
+ * Pages are numbered in address order, the swap page included; their role changes at each
+ * garbage collection. Available if FDS_TELEMETRY_ENABLED is set.
+ *
+ * @param[in]   page        The page, from 0 to FDS_VIRTUAL_PAGES - 1.
+ * @param[out]  p_count     The erase count of the page.
+ *
+ * @retval  FDS_SUCCESS         If the erase count was returned successfully.
+ * @retval  FDS_ERR_NULL_ARG    If @p p_count is NULL.
+ * @retval  FDS_ERR_INVALID_ARG If @p page is out of range.
+ */
+ret_code_t fds_stat_erase_count(uint16_t page, uint32_t * const p_count);
+
+
+/**@brief   Function for retrieving the operation counters of a file.
+ *
+ * Counters are kept for the first FDS_TELEMETRY_FILES files written or deleted. The other files
+ * share one entry, which is returned for @ref FDS_FILE_ID_INVALID. Available if
+ * FDS_TELEMETRY_ENABLED is set.
+ *
+ * @param[in]   file_id     The file ID.
+ * @param[out]  p_stat      The operation counters of the file.
+ *
+ * @retval  FDS_SUCCESS         If the counters were returned successfully.
+ * @retval  FDS_ERR_NULL_ARG    If @p p_stat is NULL.
+ * @retval  FDS_ERR_NOT_FOUND   If the file has no entry.
+ */
+ret_code_t fds_stat_file(uint16_t file_id, fds_file_stat_t * const p_stat);
+
+
+/**@brief   Function for saving the operation counters to flash.
+ *
+ * The counters are written in a record of file 0xBFFE, which is reserved, and are added to those
+ * counted after the next @ref fds_init. Saving also counts as a write, so call this function
+ * sparingly, for example after garbage collection or before power off.
+ *
+ * This function is asynchronous. Completion is reported through an @ref FDS_EVT_WRITE or
+ * @ref FDS_EVT_UPDATE event. Available if FDS_TELEMETRY_ENABLED is set.
+ *
+ * @retval  FDS_SUCCESS                 If the operation was queued successfully.
+ * @retval  FDS_ERR_NOT_INITIALIZED     If the module is not initialized.
+ * @retval  FDS_ERR_BUSY                If a previous save has not completed yet.
+ * @retval  FDS_ERR_NO_SPACE_IN_FLASH   If there is not enough space in flash.
+ * @retval  FDS_ERR_NO_SPACE_IN_QUEUES  If the operation queue is full.
+ */
+ret_code_t fds_telemetry_save(void);
+
+
 /** @} */
 
 
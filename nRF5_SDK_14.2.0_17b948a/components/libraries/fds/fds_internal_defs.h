@@ -78,6 +78,7 @@ extern "C" {
 
 #define NRF_FSTORAGE_NVMC       1
 #define NRF_FSTORAGE_SD         2
+#define NRF_FSTORAGE_FILE       3   // Host builds only.
 
 // The size of a physical page, in 4-byte words.
 #if     defined(NRF51)
@@ -107,6 +108,52 @@ extern "C" {
     #error "FDS requires at least two virtual pages."
 #endif
 
+// RAM index of records is optional, sdk_config.h of older projects doesn't define it.
+#ifndef FDS_RAM_INDEX_ENABLED
+    #define FDS_RAM_INDEX_ENABLED   0
+#endif
+
+#ifndef FDS_RAM_INDEX_SIZE
+    #define FDS_RAM_INDEX_SIZE      64
+#endif
+
+// Share of data page words that can be reclaimed before fds_gc_idle() starts garbage collection.
+#ifndef FDS_GC_IDLE_DIRTY_PERCENT
+    #define FDS_GC_IDLE_DIRTY_PERCENT   25
+#endif
+
+// Transactions are optional, sdk_config.h of older projects doesn't define them.
+#ifndef FDS_TX_ENABLED
+    #define FDS_TX_ENABLED          0
+#endif
+
+#ifndef FDS_TX_MAX_RECORDS
+    #define FDS_TX_MAX_RECORDS      4
+#endif
+
+// The commit marker of a transaction. This file ID is reserved when transactions are enabled.
+#define FDS_TX_FILE_ID              (0xBFFF)
+#define FDS_TX_RECORD_KEY           (0x0001)
+
+// Length of the commit marker data, in 4-byte words: the number of records, then the address,
+// the IC part of the header and the ID of the record to delete of each record.
+#define FDS_TX_MARKER_SIZE          (1 + (3 * FDS_TX_MAX_RECORDS))
+
+// Telemetry is optional, sdk_config.h of older projects doesn't define it.
+#ifndef FDS_TELEMETRY_ENABLED
+    #define FDS_TELEMETRY_ENABLED   0
+#endif
+
+// Number of file IDs for which writes and deletes are counted. Other files share one more entry.
+#ifndef FDS_TELEMETRY_FILES
+    #define FDS_TELEMETRY_FILES     4
+#endif
+
+// The record saved by fds_telemetry_save(). This file ID is reserved when telemetry is enabled.
+#define FDS_TELEMETRY_FILE_ID       (0xBFFE)
+#define FDS_TELEMETRY_RECORD_KEY    (0x0001)
+#define FDS_TELEMETRY_VERSION       (1)
+
 
 // Page types.
 typedef enum
@@ -153,7 +200,8 @@ typedef enum
     FDS_OP_UPDATE,      // Update a record.
     FDS_OP_DEL_RECORD,  // Delete a record.
     FDS_OP_DEL_FILE,    // Delete a file.
-    FDS_OP_GC           // Run garbage collection.
+    FDS_OP_GC,          // Run garbage collection.
+    FDS_OP_TX           // Commit a transaction.
 } fds_op_code_t;
 
 
@@ -163,6 +211,7 @@ typedef enum
     FDS_OP_INIT_TAG_DATA,
     FDS_OP_INIT_ERASE_SWAP,
     FDS_OP_INIT_PROMOTE_SWAP,
+    FDS_OP_INIT_TX_RECOVER,         // Complete a transaction which was committed before reset.
 } fds_init_step_t;
 
 
@@ -219,6 +268,11 @@ typedef struct
             uint16_t          record_key;
             uint32_t          record_to_delete;
         } del;
+        struct
+        {
+            bool              idle;             // Started by fds_gc_idle(), may stop between pages.
+            uint16_t          pages;            // Pages left to garbage collect before stopping.
+        } gc;
     };
 } fds_op_t;
 
@@ -303,9 +357,69 @@ typedef struct
     uint16_t         run_count;                  // Total number of times GC was run.
     bool             do_gc_page[FDS_DATA_PAGES]; // Controls which pages to garbage collect.
     bool             resume;                     // Whether or not GC should be resumed.
+    uint8_t          queued;                     // GC operations in the queue, including the current one.
 } fds_gc_data_t;
 
 
+// Transaction phases. Records are written without the IC part of the header, which makes them
+// dirty, then the commit marker is written. After that the IC parts are written, old copies of
+// updated records and the commit marker are flagged as dirty.
+typedef enum
+{
+    FDS_TX_IDLE,
+    FDS_TX_OPEN,            // Records are being staged by the application.
+    FDS_TX_QUEUED,          // Committed by the application, waiting in the queue.
+    FDS_TX_STAGE,           // Write records without the IC part, and the commit marker.
+    FDS_TX_COMMIT,          // Write the IC part of the commit marker.
+    FDS_TX_FINALIZE,        // Write the IC part of records.
+    FDS_TX_CLEANUP,         // Flag old copies of updated records as dirty.
+    FDS_TX_MARKER_DELETE,   // Flag the commit marker as dirty.
+} fds_tx_phase_t;
+
+
+// Holds the transaction being staged or committed. Written to flash, so it must be static.
+typedef struct
+{
+    fds_tx_phase_t   phase;
+    bool             failed;                                // A flash operation has failed.
+    uint16_t         count;                                 // Number of records.
+    uint16_t         action;                                // Next flash operation of the phase.
+    uint16_t         pending;                               // Flash operations not completed yet.
+    uint32_t         events;                                // Flash events received.
+    fds_header_t     header[FDS_TX_MAX_RECORDS];
+    void     const * p_data[FDS_TX_MAX_RECORDS];
+    uint32_t const * p_record[FDS_TX_MAX_RECORDS];          // Where records are written.
+    uint32_t         record_to_delete[FDS_TX_MAX_RECORDS];  // Old copy of updated records, or 0.
+    fds_header_t     marker_header;
+    uint32_t         marker[FDS_TX_MARKER_SIZE];
+    uint32_t const * p_marker;
+    uint16_t         page[FDS_TX_MAX_RECORDS + 1];          // Reserved pages, the last one is for the marker.
+} fds_tx_data_t;
+
+
+// Operation counters, saved as the data of the telemetry record. Only 4-byte words, so that the
+// layout is the same on the host: the version, the number of pages and of file entries, the
+// counters, one erase count per virtual page in address order, then {file ID, writes, deletes}
+// per file entry. The last file entry, with file ID FDS_FILE_ID_INVALID, counts other files.
+typedef struct
+{
+    uint32_t version;
+    uint32_t pages;
+    uint32_t files;
+    uint32_t gc_runs;
+    uint32_t gc_bytes_copied;
+    uint32_t queue_full;
+    uint32_t queue_depth_max;
+    uint32_t erase_count[FDS_VIRTUAL_PAGES];
+    struct
+    {
+        uint32_t file_id;
+        uint32_t writes;
+        uint32_t deletes;
+    } file[FDS_TELEMETRY_FILES + 1];
+} fds_telemetry_t;
+
+
 // Macros to enable and disable application interrupts.
 #if defined (FDS_THREADS)
 
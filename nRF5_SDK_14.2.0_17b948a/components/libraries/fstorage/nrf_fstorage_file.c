@@ -0,0 +1,485 @@
+/**
+ * Copyright (c) 2016 - 2017, Nordic Semiconductor ASA
+ * 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ * 
+ * 3. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ * 
+ * 4. This software, with or without modification, must only be used with a
+ *    Nordic Semiconductor ASA integrated circuit.
+ * 
+ * 5. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+#include "sdk_common.h"
+
+#if NRF_MODULE_ENABLED(NRF_FSTORAGE) && defined(__linux__)
+
+#include "nrf_fstorage_file.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+static nrf_fstorage_info_t m_flash_info =
+{
+    .erase_unit   = 4096,
+    .program_unit = 4,
+    .rmap         = true,
+    .wmap         = false,
+};
+
+
+/* The file is mapped twice: read-only at the flash addresses, and writable for the backend.
+ * The writable mapping is followed by the erase counts, one word per page. */
+static struct
+{
+    int             fd;
+    uint32_t        start_addr;
+    uint32_t        len;            /* Size of the flash area, in bytes. */
+    uint8_t const * p_view;         /* Read-only mapping, at start_addr. */
+    uint8_t       * p_image;        /* Writable mapping. */
+    uint32_t      * p_erase_count;  /* Erase count of each page, after the image. */
+    bool            busy;
+} m_file = { .fd = -1 };
+
+
+static nrf_fstorage_file_stat_t m_stat;
+
+static uint32_t m_write_us;
+static uint32_t m_erase_us;
+static uint32_t m_power_loss_countdown;
+static bool     m_power_lost;
+
+
+static uint32_t file_size(uint32_t len)
+{
+    return len + (len / m_flash_info.erase_unit) * sizeof(uint32_t);
+}
+
+
+static void delay(uint32_t us)
+{
+    if (us != 0)
+    {
+        struct timespec t =
+        {
+            .tv_sec  = us / 1000000,
+            .tv_nsec = (us % 1000000) * 1000,
+        };
+
+        while (nanosleep(&t, &t) != 0)
+        {
+            /* Interrupted, sleep the remaining time. */
+        }
+    }
+}
+
+
+/* Count the operation down to the injected power loss. Returns true if power is lost during it. */
+static bool power_loss_hit(void)
+{
+    if (m_power_loss_countdown == 0)
+    {
+        return false;
+    }
+
+    m_power_loss_countdown--;
+    m_power_lost = (m_power_loss_countdown == 0);
+
+    return m_power_lost;
+}
+
+
+/* Send event to the event handler. */
+static void event_send(nrf_fstorage_t        const * p_fs,
+                       nrf_fstorage_evt_id_t         evt_id,
+                       uint32_t                      addr,
+                       uint32_t                      len,
+                       void                        * p_param)
+{
+    if (p_fs->evt_handler == NULL)
+    {
+        /* Nothing to do. */
+        return;
+    }
+
+    nrf_fstorage_evt_t evt =
+    {
+        .result  = NRF_SUCCESS,
+        .id      = evt_id,
+        .addr    = addr,
+        .len     = len,
+        .p_param = p_param,
+    };
+
+    p_fs->evt_handler(&evt);
+}
+
+
+static void file_unmap(void)
+{
+    if (m_file.p_view != NULL)
+    {
+        (void) munmap((void*)m_file.p_view, m_file.len);
+    }
+    if (m_file.p_image != NULL)
+    {
+        (void) munmap(m_file.p_image, file_size(m_file.len));
+    }
+    if (m_file.fd >= 0)
+    {
+        (void) close(m_file.fd);
+    }
+
+    m_file.fd            = -1;
+    m_file.p_view        = NULL;
+    m_file.p_image       = NULL;
+    m_file.p_erase_count = NULL;
+}
+
+
+static ret_code_t file_map(char const * p_name, uint32_t start_addr, uint32_t len)
+{
+    struct stat st;
+    void      * p_view;
+
+    m_file.fd = open(p_name, O_RDWR | O_CREAT, 0644);
+    if ((m_file.fd < 0) || (fstat(m_file.fd, &st) != 0))
+    {
+        file_unmap();
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    bool const is_new = (st.st_size != (off_t)file_size(len));
+    if (is_new && (ftruncate(m_file.fd, file_size(len)) != 0))
+    {
+        file_unmap();
+        return NRF_ERROR_NO_MEM;
+    }
+
+    m_file.start_addr = start_addr;
+    m_file.len        = len;
+    m_file.p_image    = mmap(NULL, file_size(len), PROT_READ | PROT_WRITE, MAP_SHARED, m_file.fd, 0);
+    if (m_file.p_image == MAP_FAILED)
+    {
+        m_file.p_image = NULL;
+        file_unmap();
+        return NRF_ERROR_NO_MEM;
+    }
+    m_file.p_erase_count = (uint32_t*)(m_file.p_image + len);
+
+    /* The flash addresses are used as pointers, the view must be exactly there. */
+    p_view = mmap((void*)(uintptr_t)start_addr, len, PROT_READ, MAP_SHARED, m_file.fd, 0);
+    if (p_view != MAP_FAILED)
+    {
+        m_file.p_view = p_view;
+    }
+    if (p_view != (void*)(uintptr_t)start_addr)
+    {
+        file_unmap();
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    if (is_new)
+    {
+        memset(m_file.p_image, 0xFF, len);
+        memset(m_file.p_erase_count, 0x00, file_size(len) - len);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+static ret_code_t api_init(nrf_fstorage_t * p_fs, void * p_param)
+{
+    char const * const p_name = (p_param != NULL) ? (char const *)p_param : NRF_FSTORAGE_FILE_NAME;
+    uint32_t     const len    = p_fs->end_addr - p_fs->start_addr;
+    ret_code_t         rc     = NRF_SUCCESS;
+
+    if (   ((p_fs->start_addr % m_flash_info.erase_unit) != 0)
+        || ((len % m_flash_info.erase_unit) != 0))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    if (m_file.fd < 0)
+    {
+        rc = file_map(p_name, p_fs->start_addr, len);
+    }
+    else if ((m_file.start_addr != p_fs->start_addr) || (m_file.len != len))
+    {
+        /* Only one flash area is emulated; other instances must use the same. */
+        rc = NRF_ERROR_INVALID_STATE;
+    }
+
+    if (rc == NRF_SUCCESS)
+    {
+        /* Power is back. */
+        m_power_lost           = false;
+        m_power_loss_countdown = 0;
+        memset(&m_stat, 0x00, sizeof(m_stat));
+
+        for (uint32_t page = 0; page < (m_file.len / m_flash_info.erase_unit); page++)
+        {
+            if (m_file.p_erase_count[page] > m_stat.erase_count_max)
+            {
+                m_stat.erase_count_max = m_file.p_erase_count[page];
+            }
+        }
+
+        p_fs->p_flash_info = &m_flash_info;
+    }
+
+    return rc;
+}
+
+
+static ret_code_t api_uninit(nrf_fstorage_t * p_fs, void * p_param)
+{
+    UNUSED_PARAMETER(p_fs);
+    UNUSED_PARAMETER(p_param);
+
+    file_unmap();
+    m_file.busy = false;
+
+    return NRF_SUCCESS;
+}
+
+
+static ret_code_t api_read(nrf_fstorage_t const * p_fs, uint32_t src, void * p_dest, uint32_t len)
+{
+    UNUSED_PARAMETER(p_fs);
+
+    memcpy(p_dest, m_file.p_image + (src - m_file.start_addr), len);
+
+    return NRF_SUCCESS;
+}
+
+
+static ret_code_t api_write(nrf_fstorage_t const * p_fs,
+                            uint32_t               dest,
+                            void           const * p_src,
+                            uint32_t               len,
+                            void                 * p_param)
+{
+    uint32_t       * const p_dest = (uint32_t*)(m_file.p_image + (dest - m_file.start_addr));
+    uint32_t const * const p_data = (uint32_t const *)p_src;
+    uint32_t               words  = len / m_flash_info.program_unit;
+
+    if (m_power_lost)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    if (m_file.busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    /* Programming can only clear bits, ones written over zeros are ignored like on the device.
+     * FDS relies on this to flag records as dirty. */
+    for (uint32_t i = 0; i < words; i++)
+    {
+        if ((p_dest[i] & p_data[i]) != p_data[i])
+        {
+            m_stat.violations++;
+            break;
+        }
+    }
+
+    m_file.busy = true;
+
+    if (power_loss_hit())
+    {
+        words /= 2;
+    }
+
+    delay(words * m_write_us);
+    for (uint32_t i = 0; i < words; i++)
+    {
+        p_dest[i] &= p_data[i];
+    }
+
+    m_file.busy = false;
+
+    if (m_power_lost)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    m_stat.writes++;
+    m_stat.bytes_written += len;
+
+    event_send(p_fs, NRF_FSTORAGE_EVT_WRITE_RESULT, dest, len, p_param);
+
+    return NRF_SUCCESS;
+}
+
+
+static ret_code_t api_erase(nrf_fstorage_t const * p_fs,
+                            uint32_t               page_addr,
+                            uint32_t               len,
+                            void                 * p_param)
+{
+    uint32_t progress = 0;
+
+    if (m_power_lost)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    if (m_file.busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_file.busy = true;
+
+    while ((progress != len) && !m_power_lost)
+    {
+        uint32_t const offset = (page_addr - m_file.start_addr) + (progress * m_flash_info.erase_unit);
+        uint32_t const page   = offset / m_flash_info.erase_unit;
+        uint32_t       size   = m_flash_info.erase_unit;
+
+        if (power_loss_hit())
+        {
+            size /= 2;
+        }
+
+        delay(m_erase_us);
+        memset(m_file.p_image + offset, 0xFF, size);
+
+        m_file.p_erase_count[page]++;
+        m_stat.erases++;
+        if (m_file.p_erase_count[page] > m_stat.erase_count_max)
+        {
+            m_stat.erase_count_max = m_file.p_erase_count[page];
+        }
+
+        progress++;
+    }
+
+    m_file.busy = false;
+
+    if (m_power_lost)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    event_send(p_fs, NRF_FSTORAGE_EVT_ERASE_RESULT, page_addr, len, p_param);
+
+    return NRF_SUCCESS;
+}
+
+
+static uint8_t const * api_rmap(nrf_fstorage_t const * p_fs, uint32_t addr)
+{
+    UNUSED_PARAMETER(p_fs);
+
+    return (uint8_t*)(uintptr_t)addr;
+}
+
+
+static uint8_t * api_wmap(nrf_fstorage_t const * p_fs, uint32_t addr)
+{
+    UNUSED_PARAMETER(p_fs);
+    UNUSED_PARAMETER(addr);
+
+    /* Not supported. */
+    return NULL;
+}
+
+
+static bool api_is_busy(nrf_fstorage_t const * p_fs)
+{
+    UNUSED_PARAMETER(p_fs);
+
+    return m_file.busy;
+}
+
+
+void nrf_fstorage_file_latency_set(uint32_t write_us, uint32_t erase_us)
+{
+    m_write_us = write_us;
+    m_erase_us = erase_us;
+}
+
+
+void nrf_fstorage_file_power_loss_set(uint32_t op_count)
+{
+    m_power_loss_countdown = op_count;
+}
+
+
+bool nrf_fstorage_file_is_power_lost(void)
+{
+    return m_power_lost;
+}
+
+
+uint32_t nrf_fstorage_file_erase_count_get(uint32_t page_addr)
+{
+    if (   (m_file.p_erase_count == NULL)
+        || (page_addr <  m_file.start_addr)
+        || (page_addr >= m_file.start_addr + m_file.len))
+    {
+        return 0;
+    }
+
+    return m_file.p_erase_count[(page_addr - m_file.start_addr) / m_flash_info.erase_unit];
+}
+
+
+void nrf_fstorage_file_stat_get(nrf_fstorage_file_stat_t * p_stat)
+{
+    *p_stat = m_stat;
+}
+
+
+/* The exported API. Functions are prefixed, read() and write() are taken by unistd.h. */
+nrf_fstorage_api_t nrf_fstorage_file =
+{
+    .init    = api_init,
+    .uninit  = api_uninit,
+    .read    = api_read,
+    .write   = api_write,
+    .erase   = api_erase,
+    .rmap    = api_rmap,
+    .wmap    = api_wmap,
+    .is_busy = api_is_busy
+};
+
+
+#endif // NRF_FSTORAGE_ENABLED && __linux__
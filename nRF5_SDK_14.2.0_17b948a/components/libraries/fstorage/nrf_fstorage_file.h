@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2016 - 2017, Nordic Semiconductor ASA
+ * 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ * 
+ * 3. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ * 
+ * 4. This software, with or without modification, must only be used with a
+ *    Nordic Semiconductor ASA integrated circuit.
+ * 
+ * 5. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/**
+ * @file
+ *
+ * @defgroup nrf_fstorage_file File implementation
+ * @ingroup nrf_fstorage
+ * @{
+ *
+ * @brief API implementation of fstorage that emulates NOR flash in a file, for Linux hosts.
+ *
+ * @details The file is memory mapped read-only at the flash addresses of the fstorage instance,
+ *          so that modules reading flash directly through pointers (FDS, the peer manager) run
+ *          unmodified. The flash area must lie in the low 4 GB of the host address space and must
+ *          not overlap the program: build for the host with @c -m32, or keep the default flash
+ *          area of the nRF52840 (end address @ref NRF_FSTORAGE_FILE_END_ADDR).
+ *
+ *          Flash semantics are enforced: a write can only change bits from 1 to 0, ones written over
+ *          zeros are ignored, memory is set to 1 only by page erase. Erase counts are kept per page at the
+ *          end of the file and survive restarts. Operations complete synchronously, after an
+ *          optional latency. A power loss can be injected at any write or erase: the operation is
+ *          left half done and the backend stops, until it is initialized again.
+ */
+
+#ifndef NRF_FSTORAGE_FILE_H__
+#define NRF_FSTORAGE_FILE_H__
+
+#include <stdint.h>
+#include "nrf_fstorage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief   File used when no file name is passed to @ref nrf_fstorage_init. */
+#ifndef NRF_FSTORAGE_FILE_NAME
+#define NRF_FSTORAGE_FILE_NAME      "nrf_fstorage.bin"
+#endif
+
+/**@brief   End of the flash, used by FDS instead of reading FICR and UICR registers. */
+#ifndef NRF_FSTORAGE_FILE_END_ADDR
+#define NRF_FSTORAGE_FILE_END_ADDR  0x100000
+#endif
+
+
+/**@brief   Operation statistics, since the backend was initialized. */
+typedef struct
+{
+    uint32_t writes;            //!< Number of completed write operations.
+    uint32_t bytes_written;     //!< Number of bytes written.
+    uint32_t erases;            //!< Number of erased pages.
+    uint32_t violations;        //!< Number of writes which tried to set a bit from 0 to 1.
+    uint32_t erase_count_max;   //!< Highest erase count of a page, including previous runs.
+} nrf_fstorage_file_stat_t;
+
+
+/**@brief   API implementation that uses a file.
+ *
+ * @details An fstorage instance with this API implementation can be initialized by providing
+ *          this structure as a parameter to @ref nrf_fstorage_init, together with the file
+ *          name (or NULL for @ref NRF_FSTORAGE_FILE_NAME). The file is created if it doesn't exist
+ *          or if its size doesn't match the flash area; its content is then erased.
+ *          The structure is defined in @c nrf_fstorage_file.c.
+ */
+extern nrf_fstorage_api_t nrf_fstorage_file;
+
+
+/**@brief   Function for setting the time an operation takes.
+ *
+ * @param[in]   write_us    Time to write one word, in microseconds.
+ * @param[in]   erase_us    Time to erase one page, in microseconds.
+ */
+void nrf_fstorage_file_latency_set(uint32_t write_us, uint32_t erase_us);
+
+
+/**@brief   Function for injecting a power loss.
+ *
+ * @details The power loss happens during the n-th write or erase operation from now: the first
+ *          half of the words is written, or the first half of the page is erased. Then every write
+ *          and erase fails with NRF_ERROR_INTERNAL and no event is sent, until the backend is
+ *          uninitialized and initialized again.
+ *
+ * @param[in]   op_count    Operation in which power is lost, 1 for the next one. 0 to cancel.
+ */
+void nrf_fstorage_file_power_loss_set(uint32_t op_count);
+
+
+/**@brief   Function for checking whether an injected power loss has happened. */
+bool nrf_fstorage_file_is_power_lost(void);
+
+
+/**@brief   Function for retrieving the number of times a page was erased.
+ *
+ * @param[in]   page_addr   Address of the page.
+ *
+ * @return  The erase count, or 0 if the address is outside of the flash area.
+ */
+uint32_t nrf_fstorage_file_erase_count_get(uint32_t page_addr);
+
+
+/**@brief   Function for retrieving operation statistics.
+ *
+ * @param[out]  p_stat  Statistics.
+ */
+void nrf_fstorage_file_stat_get(nrf_fstorage_file_stat_t * p_stat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_FSTORAGE_FILE_H__
+/** @} */
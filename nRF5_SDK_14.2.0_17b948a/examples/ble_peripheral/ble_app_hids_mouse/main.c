@@ -79,11 +79,15 @@
 #include "fds.h"
 #include "ble_conn_state.h"
 #include "nrf_ble_gatt.h"
+#include "ble_radio_notification.h"
+#include "nrf_pwr_mgmt.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
+#include "mouseMotion.h"                                                            /* MOTION_COMBINED_REPORT, MOTION_XY_BITS select input reports of report map */
+
 
 #define DEVICE_NAME                     "Nordic_Mouse"                              /**< Name of device. Will be included in the advertising data. */
 #define MANUFACTURER_NAME               "NordicSemiconductor"                       /**< Manufacturer. Will be passed to Device Information Service. */
@@ -121,9 +125,18 @@
 #define SEC_PARAM_MAX_KEY_SIZE          16                                          /**< Maximum encryption key size. */
 
 #define MOVEMENT_SPEED                  5                                           /**< Number of pixels by which the cursor is moved each time a button is pushed. */
+#if MOTION_COMBINED_REPORT
+#define INPUT_REPORT_COUNT              2                                           /**< Number of input reports in this application. */
+#define INPUT_REP_COMBINED_LEN          MOTION_COMBINED_LEN                         /**< Length of Mouse Input Report containing buttons, movement, wheel and pan. */
+#define INPUT_REP_MEDIA_PLAYER_LEN      1                                           /**< Length of Mouse Input Report containing media player data. */
+#define INPUT_REP_COMBINED_INDEX        0                                           /**< Index of Mouse Input Report containing buttons, movement, wheel and pan. */
+#define INPUT_REP_MPLAYER_INDEX         1                                           /**< Index of Mouse Input Report containing media player data. */
+#define INPUT_REP_REF_COMBINED_ID       1                                           /**< Id of reference to Mouse Input Report containing buttons, movement, wheel and pan. */
+#define INPUT_REP_REF_MPLAYER_ID        3                                           /**< Id of reference to Mouse Input Report containing media player data. */
+#else
 #define INPUT_REPORT_COUNT              3                                           /**< Number of input reports in this application. */
 #define INPUT_REP_BUTTONS_LEN           3                                           /**< Length of Mouse Input Report containing button data. */
-#define INPUT_REP_MOVEMENT_LEN          3                                           /**< Length of Mouse Input Report containing movement data. */
+#define INPUT_REP_MOVEMENT_LEN          MOTION_XY_LEN                               /**< Length of Mouse Input Report containing movement data. */
 #define INPUT_REP_MEDIA_PLAYER_LEN      1                                           /**< Length of Mouse Input Report containing media player data. */
 #define INPUT_REP_BUTTONS_INDEX         0                                           /**< Index of Mouse Input Report containing button data. */
 #define INPUT_REP_MOVEMENT_INDEX        1                                           /**< Index of Mouse Input Report containing movement data. */
@@ -131,6 +144,7 @@
 #define INPUT_REP_REF_BUTTONS_ID        1                                           /**< Id of reference to Mouse Input Report containing button data. */
 #define INPUT_REP_REF_MOVEMENT_ID       2                                           /**< Id of reference to Mouse Input Report containing movement data. */
 #define INPUT_REP_REF_MPLAYER_ID        3                                           /**< Id of reference to Mouse Input Report containing media player data. */
+#endif
 
 #define BASE_USB_HID_SPEC_VERSION       0x0101                                      /**< Version number of base USB HID Specification implemented by this application. */
 
@@ -162,8 +176,6 @@ static uint16_t          m_conn_handle  = BLE_CONN_HANDLE_INVALID;
 static pm_peer_id_t      m_peer_id;                                                 /**< Device reference handle to the current bonded central. */
 static sensorsim_cfg_t   m_battery_sim_cfg;                                         /**< Battery Level sensor simulator configuration. */
 static sensorsim_state_t m_battery_sim_state;                                       /**< Battery Level sensor simulator state. */
-static pm_peer_id_t      m_whitelist_peers[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];       /**< List of peers currently in the whitelist. */
-static uint32_t          m_whitelist_peer_cnt;                                      /**< Number of peers currently in the whitelist. */
 static ble_uuid_t        m_adv_uuids[] =                                            /**< Universally unique service identifiers. */
 {
     {BLE_UUID_HUMAN_INTERFACE_DEVICE_SERVICE, BLE_UUID_TYPE_BLE}
@@ -178,40 +190,18 @@ static void ble_advertising_error_handler(uint32_t nrf_error);
 static void peer_list_get(pm_peer_id_t * p_peers, uint32_t * p_size);
 
 
-/**@brief Function for starting advertising for direct connect to device according order.
- *        This process include two phase: scanning, one item white list advertising
-          - scanning:   high density advertising with rejection ALL input connection for detect device from white list around
-          - connection: advertising with ONE WHITE LIST device and serially switch device on white list
-          I should add state machine for global control advertising process: power on adv, normal adv and so on
-          On processing of power On adv I should switch phase of adv.
-
- */
-
-
-
-
-
-
-
-
-
-
-
 #include "fds.h"
 
 #include "orderProcessing.h"
 #include "systemTime.h"
-
-#define DETECTED_DEV_FREE    0xFF
-#define DIRECT_CONN_QUANTITY 0x3
+#include "advReconnect.h"
+#include "reconnectTrace.h"
+#include "advInterval.h"
+#include "opticalSensor.h"
 
 #define FILE_ORDER                               0xBAAB  /* The ID of the file to write the records into. */
 #define RECORD_KEY_ORDER                         0xABBA  /* A key for the second record. */
 
-#define APP_ADV_GLOBAL_INTERVAL           0x0023      /**< Fast advertising interval (in units of 0.625 ms. This value corresponds to 21 ms.). */
-#define APP_ADV_GLOBAL_TIMEOUT              60     /**< The duration of the fast advertising period (in seconds). */
-
-
 #define APP_ADV_FAST_SCANING_INTERVAL           0x0023      /**< Fast advertising interval (in units of 0.625 ms. This value corresponds to 21 ms.). */
 #define APP_ADV_FAST_SCANING_TIMEOUT                10     /**< The duration of the fast advertising period (in seconds). */
 
@@ -221,34 +211,24 @@ static void peer_list_get(pm_peer_id_t * p_peers, uint32_t * p_size);
 #define APP_ADV_FAST_SEARCH_INTERVAL           0x0140      /**< Fast advertising interval (in units of 0.625 ms. This value corresponds to 200 ms.). */
 #define APP_ADV_FAST_SEARCH_TIMEOUT                60     /**< The duration of the fast advertising period (in seconds). */
 
-#define ORDER_FLASHE_PAGE                         254
+#define APP_ADV_CONNECT_STRATEGY     ADV_CONNECT_SERIAL  /**< Reconnect connection phase strategy at start, can be changed by advReconnectSetStrategy(). */
 
-#define ADV_RECONNECT_SCAN_TIMEOUT               10000
+#define ORDER_FLASHE_PAGE                         254
 
-#define GET_PAGE_ADDRESS(X)  (uint32_t)(X*4096)
+#define APP_GC_IDLE_PERIOD           2000                /**< Period of checking if flash garbage collection is worth (ms). */
+#define APP_GC_IDLE_QUIET_TIME       5000                /**< Link is idle when no report was sent during this time (ms). */
+#define APP_GC_IDLE_PAGES            1                   /**< Pages garbage collected in one idle slice. */
 
+#define APP_MOTION_TX_BUFFERS        BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT  /**< Notification TX buffers of connection (hvn_tx_queue_size is not configured). */
+#define APP_MOTION_SYNC              true                                    /**< Sample sensor and queue report right before each connection event. */
+#define APP_MOTION_SYNC_DISTANCE     NRF_RADIO_NOTIFICATION_DISTANCE_1740US  /**< Lead time of radio notification, covers scheduler latency and sensor read. */
 
-typedef enum
-{
-    ADV_PROC_START_CONNECT,
-    ADV_PROC_STOP_ADV,
-    ADV_PROC_CONNECT_PREV,
-    ADV_PROC_CONNECT
-}nrfBLEAdvEvT;
+#define APP_SENSOR_ENABLED           false                        /**< ADNS2080 sensor, its SDIO pins (sdio_config.h) are buttons 3/4 of PCA10056. */
+#define APP_SENSOR_MOTION_PIN        26                           /**< MOTION output of ADNS2080. */
+#define APP_SENSOR_RESOLUTION        ADNS2080_RESOLUTION_1000DPI  /**< Sensor counts per inch. */
 
-typedef enum
-{
-    DEV_SCANNING,
-    DEV_CONNECTION,
-}connPhase;
+#define GET_PAGE_ADDRESS(X)  (uint32_t)(X*4096)
 
-typedef enum
-{
-    ADV_IDLE,              // Mo advertising
-    ADV_ADD_NEW,           // after press connect pushbutton
-    ADV_RECONNECT_SCAN,    // after power on with bonds    OR after disconnect
-    ADV_RECONNECT_CONNECT,
-}advTypeT;
 
 typedef enum
 {
@@ -258,29 +238,20 @@ typedef enum
 }connectionStateT;
 
 
-struct
-{
-    connPhase phase;
-    uint16_t  listDetectedDev[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
-    uint8_t   quantityDetectedDev;
-    uint8_t   connectCnt;
-    uint8_t   loopCnt;
-}advDirOrdConnState =
-{
-    .listDetectedDev = {[0 ... BLE_GAP_WHITELIST_ADDR_MAX_COUNT-1] = DETECTED_DEV_FREE}
-};
-
 orderT        deviceOrder;
-timerCallbacT stopScanAdvTimerCallback;
-timerCallbacT switchToConnAdvTimerCallback;
 struct{
     bool             isDeleteBonds;
     bool             isRealAdv;
     bool             isAppAdv;
     bool             isPrevConn;
     uint16_t         connectionHandler;
-    advTypeT         currentAdvType;
     connectionStateT connectState;
+    pm_peer_id_t     usagePeer;
+    uint32_t         usageStartTime;
+    bool             isShutdown;
+    uint32_t         reportTime;
+    uint32_t         gcCheckTime;
+    uint16_t         gcRunsSaved;
 } appState =
 {
     .isDeleteBonds    = false,                  // do we need clear bonds
@@ -288,11 +259,9 @@ struct{
     .isAppAdv         = false,                  // is advertising: true, false
     .isPrevConn       = false,                  // is current device was previous connected
     .connectionHandler = BLE_CONN_HANDLE_INVALID,
-    .currentAdvType   = ADV_IDLE,               // current advertising state
     .connectState     = CONNECTION_DISCONNECT,  // current connection state
+    .usagePeer        = PM_PEER_ID_INVALID,     // secured peer whose connected time is counted in order rank
 };
-uint32_t scaningTimeout;
-
 bool appAdvGetPrevConn(void)
 {
     return appState.isPrevConn;
@@ -307,7 +276,7 @@ void appAdvSetPrevConn(bool prevConnSet)
 
 advTypeT appAdvGetCurrentType(void)
 {
-    return appState.currentAdvType;
+    return advReconnectGetType();
 }
 
 
@@ -383,13 +352,27 @@ void appAdvStop(void)
 }
 
 
+/**@brief Apply interval and period of advertising policy, it is used by next advertising start.
+ */
+static void advertising_interval_update(void)
+{
+    advIntervalT           advInterval = advIntervalGet();
+    ble_adv_modes_config_t config      = m_advertising.adv_modes_config;
+
+    config.ble_adv_fast_interval = advInterval.interval;
+    config.ble_adv_fast_timeout  = advInterval.period;
+    ble_advertising_modes_config_set(&m_advertising, &config);
+    NRF_LOG_INFO("ADV interval %d period %d", advInterval.interval, advInterval.period);
+}
+
+
 void appAdvStart(void)
 {
     ret_code_t ret;
     switch(appState.connectState)
     {
         case CONNECTION_CONNECT:
-            // after disconnect nrf automatically start advertising
+            // advertising is started again by BLE_GAP_EVT_DISCONNECTED handler
             appState.isAppAdv = true;
             NRF_LOG_INFO("ADV START: disconnect connection");
             //ret = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
@@ -408,6 +391,7 @@ void appAdvStart(void)
             appState.isAppAdv  = true;
             appState.isRealAdv = true;
             NRF_LOG_INFO("ADV START: start");
+            advertising_interval_update();
             ret = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
             NRF_LOG_INFO("ADV START: ret = %d", ret);
             APP_ERROR_CHECK(ret);
@@ -418,11 +402,12 @@ void appAdvStart(void)
 }
 
 
-static void advertising_init(uint16_t intervalMSeconds, uint16_t periodSeconds, bool whitelistEnabled)
+static void advertising_init(bool whitelistEnabled)
 {
     ret_code_t err_code;
     uint8_t    adv_flags;
     ble_advertising_init_t init;
+    advIntervalT           advInterval = advIntervalGet();
 
     memset(&init, 0, sizeof(init));
 
@@ -433,15 +418,15 @@ static void advertising_init(uint16_t intervalMSeconds, uint16_t periodSeconds,
     init.advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
     init.advdata.uuids_complete.p_uuids  = m_adv_uuids;
 
-    init.config.ble_adv_on_disconnect_disabled = false;
+    init.config.ble_adv_on_disconnect_disabled = true;     // restarted by BLE_GAP_EVT_DISCONNECTED handler
     init.config.ble_adv_whitelist_enabled      = whitelistEnabled;
     init.config.ble_adv_directed_enabled       = false;
     init.config.ble_adv_directed_slow_enabled  = false;
     init.config.ble_adv_directed_slow_interval = APP_ADV_FAST_INTERVAL;
     init.config.ble_adv_directed_slow_timeout  = APP_ADV_FAST_TIMEOUT;
     init.config.ble_adv_fast_enabled           = true;
-    init.config.ble_adv_fast_interval          = intervalMSeconds;
-    init.config.ble_adv_fast_timeout           = periodSeconds;
+    init.config.ble_adv_fast_interval          = advInterval.interval;
+    init.config.ble_adv_fast_timeout           = advInterval.period;
     init.config.ble_adv_slow_enabled           = false;
     init.config.ble_adv_slow_interval          = APP_ADV_SLOW_INTERVAL;
     init.config.ble_adv_slow_timeout           = APP_ADV_SLOW_TIMEOUT;
@@ -474,290 +459,51 @@ bool appPeerGetIdInList(pm_peer_id_t peerIdIn)
 }
 
 
-static void appAdvSetStart(advTypeT advType, uint16_t peerId)
-{
-    ret_code_t ret;
-
-    switch(advType)
-    {
-    case ADV_ADD_NEW: // advertising without white list, but REJECT connection all current peers
-        NRF_LOG_INFO("ADV add new");
-        appState.currentAdvType = ADV_ADD_NEW;
-
- /*      appAdvStop();  // use this stop adv for activate white list with new devices
-
-        m_whitelist_peer_cnt = 0;
-       ret = pm_whitelist_set(NULL, 0);
-        APP_ERROR_CHECK(ret);
-        ret = pm_device_identities_list_set(NULL, 0);
-        if (ret != NRF_ERROR_NOT_SUPPORTED)
-        {
-            APP_ERROR_CHECK(ret);
-        }
-
-
-        if(m_conn_handle != BLE_CONN_HANDLE_INVALID)
-        {
-            NRF_LOG_INFO("----start adv DISCONNECT-----");
-            appAdvStart();
-        }
-        else
-        {
-            NRF_LOG_INFO("----start adv ADV-----");
-            appAdvStop();  // use this stop adv for activate white list with new devices
-            appAdvStart();
-            APP_ERROR_CHECK(ret);
-        }
-        return;
-        break;
-*/
-        m_whitelist_peer_cnt = 0;
-
-        break;
-    case ADV_RECONNECT_SCAN:
-        memset(m_whitelist_peers, PM_PEER_ID_INVALID, sizeof(m_whitelist_peers));
-        m_whitelist_peer_cnt = (sizeof(m_whitelist_peers) / sizeof(pm_peer_id_t));
-        peer_list_get(m_whitelist_peers, &m_whitelist_peer_cnt);
-
-        NRF_LOG_INFO("Adv recon: %d", m_whitelist_peer_cnt);
+/*********advReconnect USER IMPLEMENTED FUNCTION****************/
+STATIC_ASSERT(ADV_RECONNECT_PEER_QUANTITY == BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+STATIC_ASSERT(ADV_RECONNECT_PEER_INVALID  == PM_PEER_ID_INVALID);
 
-
-        if(m_whitelist_peer_cnt == 0) // if no peer devices -
-        {
-            appState.currentAdvType = ADV_ADD_NEW;
-        }
-        else
-        {
-            appState.currentAdvType = ADV_RECONNECT_SCAN;
-            timerRun(stopScanAdvTimerCallback, ADV_RECONNECT_SCAN_TIMEOUT);
-            scaningTimeout = getTime();
-        }
-        break;
-    case ADV_RECONNECT_CONNECT:
-        appState.currentAdvType = ADV_RECONNECT_CONNECT;
-        // set white list parameters
-        NRF_LOG_INFO("Adv recon conn");
-        m_whitelist_peers[0] = peerId;
-        m_whitelist_peer_cnt = 1;
-        break;
-    default:
-        break;
-    }
-    appAdvStop();  // use this stop adv for activate white list with new devices
-
-    ret = pm_whitelist_set((m_whitelist_peer_cnt == 0 ) ? (NULL) : (m_whitelist_peers),
-                           (m_whitelist_peer_cnt == 0 ) ? (0)    : (m_whitelist_peer_cnt));
-    ret = pm_device_identities_list_set((m_whitelist_peer_cnt == 0 ) ? (NULL) : (m_whitelist_peers),
-                                        (m_whitelist_peer_cnt == 0 ) ? (0)    : (m_whitelist_peer_cnt));
-    NRF_LOG_INFO("ret = %d", ret);
-
-    if (ret != NRF_ERROR_NOT_SUPPORTED)
-    {
-        APP_ERROR_CHECK(ret);
-    }
+void advReconnectAdvStart(void)
+{
     appAdvStart();
 }
 
 
-void appAdvAddNew(nrfBLEAdvEvT inEv, pm_peer_id_t peerId)
+void advReconnectAdvStop(void)
 {
-    switch(inEv)
-    {
-    case ADV_PROC_START_CONNECT:
-        break;
-    case ADV_PROC_STOP_ADV:
-        break;
-    case ADV_PROC_CONNECT_PREV:
-        NRF_LOG_INFO("Disconnect old dev");
-        appDisconnect();
-        break;
-    case ADV_PROC_CONNECT:
-
-       // if(!appPeerGetIdInList(peerId))
-       // {
-            NRF_LOG_INFO("No device on the list");
-            appAdvStop();
-            break;
-       // }
-
-
-    }
-
+    appAdvStop();
 }
 
 
-void appAdvDirectProc(nrfBLEAdvEvT inEv, pm_peer_id_t peerId)
+void advReconnectDisconnect(void)
 {
-    ret_code_t err_code;
-    switch(inEv)
-    {
-    case ADV_PROC_START_CONNECT: // 1
-        NRF_LOG_INFO("CONNECT");
-        switch(advDirOrdConnState.phase)
-        {
-        case DEV_SCANNING:  // add device to the list of device that was detected
-        {
-            uint8_t pos;
-            // disconnect input connection
-            NRF_LOG_INFO("_SCANNING_");
-
-            uint8_t cnt = 0;
-            for(; cnt < m_whitelist_peer_cnt; cnt++)
-            {
-                if(m_whitelist_peers[cnt] == peerId)
-                {
-                    break;
-                }
-
-            }
-            if(cnt < m_whitelist_peer_cnt)
-            {
-                NRF_LOG_INFO("remove dev %d", m_whitelist_peers[cnt] );
-                for(; cnt < (m_whitelist_peer_cnt - 1); cnt++)
-                {
-                    m_whitelist_peers[cnt] = m_whitelist_peers[cnt+1];//
-                }
-                m_whitelist_peer_cnt--;
-                m_whitelist_peers[cnt] = PM_PEER_ID_INVALID;
-                NRF_LOG_INFO("PDL quan %d", m_whitelist_peer_cnt);
-
-
-                err_code = pm_whitelist_set((m_whitelist_peer_cnt == 0 ) ? (NULL) : (m_whitelist_peers),
-                                       (m_whitelist_peer_cnt == 0 ) ? (0)    : (m_whitelist_peer_cnt));
-                APP_ERROR_CHECK(err_code);
-                // Setup the device identies list.
-                // Some SoftDevices do not support this feature.
-                err_code = pm_device_identities_list_set((m_whitelist_peer_cnt == 0 ) ? (NULL) : (m_whitelist_peers),
-                                                    (m_whitelist_peer_cnt == 0 ) ? (0)    : (m_whitelist_peer_cnt));
-                APP_ERROR_CHECK(err_code);
-            }
-            //disconnect current device
-            appDisconnect();
-
-            NRF_LOG_INFO("--------Dev in list ? %d", peerId);
-            if(orderGetPos(deviceOrder, peerId, &pos))
-            {
-                NRF_LOG_INFO("Dev find %d  %d ", peerId, pos);
-                if(advDirOrdConnState.listDetectedDev[pos] == DETECTED_DEV_FREE)
-                {
-                    NRF_LOG_INFO("Dev save");
-                    advDirOrdConnState.listDetectedDev[pos] = peerId;
-                    advDirOrdConnState.quantityDetectedDev++;
-                }
-            }
-            if(advDirOrdConnState.quantityDetectedDev >= orderGetQuantity(deviceOrder))
-            {
-                NRF_LOG_INFO("---------SCANED TIME = %d", getTime() - scaningTimeout);
-                appAdvStop();
-            }
-        }
-        break;
-        case DEV_CONNECTION:// DO NOTHING (continue connection processing)
-            /*DISCONNECT CURRENT DEVICE IF IT PEER ID DON'T EQUAL CURRENT DEVICE FROM WHITE LIST !!!! */
-            NRF_LOG_INFO("_CONNECTION_");
-            appAdvStop();
-            break;
-        }
-        break;
-    case ADV_PROC_STOP_ADV:
-        NRF_LOG_INFO("STOP_ADV");
-        switch(advDirOrdConnState.phase)
-        {
-        case DEV_SCANNING: // stop adv for previous phase and start connection to detected devices
-        {
-            uint8_t cnt_1 = 0;
-            uint8_t cnt_2 = 0;
-            NRF_LOG_INFO("_SCANNING_");
-            NRF_LOG_INFO("Find %d", advDirOrdConnState.quantityDetectedDev);
-            // if device wasn't detected  start adv again
-            if(advDirOrdConnState.quantityDetectedDev == 0)
-            {
-                appAdvSetStart(ADV_RECONNECT_SCAN , 0);
-                break;
-            }
-            // shift all devices on list UP
-            for(cnt_1 = 0; cnt_1 < BLE_GAP_WHITELIST_ADDR_MAX_COUNT - 1; cnt_1++)
-            {
-                for(cnt_2 = BLE_GAP_WHITELIST_ADDR_MAX_COUNT-1; cnt_2 > 0; cnt_2--)
-                {
-                    if(advDirOrdConnState.listDetectedDev[cnt_2 - 1] == DETECTED_DEV_FREE &&
-                            advDirOrdConnState.listDetectedDev[cnt_2 ]    != DETECTED_DEV_FREE)
-                    {
-                        advDirOrdConnState.listDetectedDev[cnt_2 - 1] = advDirOrdConnState.listDetectedDev[cnt_2 ];
-                        advDirOrdConnState.listDetectedDev[cnt_2 ]    = DETECTED_DEV_FREE;
-                    }
-                }
-            }
-
-            advDirOrdConnState.connectCnt = 0;
-            NRF_LOG_INFO("+++++++++");
-            appAdvSetStart(ADV_RECONNECT_CONNECT , advDirOrdConnState.listDetectedDev[advDirOrdConnState.connectCnt]);
-            NRF_LOG_INFO("---------");
-            advDirOrdConnState.phase = DEV_CONNECTION;
-        }
-        break;
-        case DEV_CONNECTION:   /*
-            on this point I can go in two cases:
-            - current device from WL was not able connect
-            - LAST DEVICE THAT WAS IN CONNECT-> DISACONNECT STATE BEFOR STOP SCANNIN WAS DISCONNECTED
-
-            */
-            NRF_LOG_INFO("_CONNECTION_");
-            if(advDirOrdConnState.connectCnt >= advDirOrdConnState.quantityDetectedDev)
-            {
-
-                advDirOrdConnState.loopCnt++;
-
-                if(advDirOrdConnState.loopCnt >= DIRECT_CONN_QUANTITY)
-                {
-                    // start general advertising
-                    break;
-                }
-                // start scanning again
-                memset(advDirOrdConnState.listDetectedDev, DETECTED_DEV_FREE, sizeof(advDirOrdConnState.listDetectedDev));
-                advDirOrdConnState.connectCnt = 0;
-                advDirOrdConnState.phase      = DEV_SCANNING;
-                appAdvSetStart(ADV_RECONNECT_SCAN, 0);
-            }
-            // shift to next detected device
-            advDirOrdConnState.connectCnt++;
-            appAdvSetStart(ADV_RECONNECT_CONNECT, advDirOrdConnState.listDetectedDev[advDirOrdConnState.connectCnt]);
-            break;
-        }
-        break;
-    default:
-        break;
-    }
+    appDisconnect();
 }
 
 
-void appAdvProcessing(nrfBLEAdvEvT inEv, pm_peer_id_t peerId)
+void advReconnectWhitelistSet(const uint16_t peers[], uint32_t peersQuantity)
 {
-    switch(appState.currentAdvType)
+    ret_code_t ret;
+
+    ret = pm_whitelist_set((peersQuantity == 0 ) ? (NULL) : (peers), peersQuantity);
+    APP_ERROR_CHECK(ret);
+    // Setup the device identies list.
+    // Some SoftDevices do not support this feature.
+    ret = pm_device_identities_list_set((peersQuantity == 0 ) ? (NULL) : (peers), peersQuantity);
+    NRF_LOG_INFO("ret = %d", ret);
+    if (ret != NRF_ERROR_NOT_SUPPORTED)
     {
-    case ADV_ADD_NEW:
-        NRF_LOG_INFO("ADV_ADD_NEW");
-        appAdvAddNew(inEv, peerId);
-        break;
-    case ADV_RECONNECT_SCAN:
-        NRF_LOG_INFO("ADV_SCAN");
-        appAdvDirectProc(inEv, peerId);
-        break;
-    case ADV_RECONNECT_CONNECT:
-        NRF_LOG_INFO("ADV_CONNECT");
-        appAdvDirectProc(inEv, peerId);
-        break;
-    default:
-        break;
+        APP_ERROR_CHECK(ret);
     }
 }
 
 
-void appAdvScanStopCB(void)
+uint32_t advReconnectPeerListGet(uint16_t peers[], uint32_t peersMaxQuantity)
 {
-    NRF_LOG_INFO("Stop Scan");
-    appAdvStop();
-    appAdvProcessing(ADV_PROC_STOP_ADV, 0);
+    uint32_t peersQuantity = peersMaxQuantity;
+
+    peer_list_get(peers, &peersQuantity);
+    return peersQuantity;
 }
 
 
@@ -796,72 +542,109 @@ void appProcessing(void)
         appState.isDeleteBonds = false;
         NRF_LOG_INFO("Clear b_start");
         delete_bonds();
+        advReconnectWhitelistInvalidate();  // peer IDs get reused by new bonds
         orderClean(deviceOrder);
         orderWriteFlash(deviceOrder, GET_PAGE_ADDRESS(ORDER_FLASHE_PAGE));
     }
+
+    // flash garbage collection in idle time, so it doesn't land in bonding procedure (PM_EVT_STORAGE_FULL)
+    if((getTime() - appState.gcCheckTime) >= APP_GC_IDLE_PERIOD)
+    {
+        appState.gcCheckTime = getTime();
+        if(appState.connectState == CONNECTION_DISCONNECT ||
+           (getTime() - appState.reportTime) >= APP_GC_IDLE_QUIET_TIME)
+        {
+            (void)fds_gc_idle(APP_GC_IDLE_PAGES);
+        }
+    }
 }
 
 
-void flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+/* Descriptor of order record is found once and kept: FDS opens record by its ID,
+ * and refinds it by ID only after garbage collection.
+*/
+static struct
+{
+    fds_record_desc_t desc;
+    bool              isValid;
+} orderRecord;
+
+
+static bool orderRecordFind(void)
+{
+    fds_find_token_t ftok;
+
+    /* It is required to zero the token before first use. */
+    memset(&ftok, 0x00, sizeof(fds_find_token_t));
+    orderRecord.isValid = (fds_record_find(FILE_ORDER, RECORD_KEY_ORDER, &orderRecord.desc, &ftok) == FDS_SUCCESS);
+    return orderRecord.isValid;
+}
+
+
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
 {
     fds_record_t        record;
-    fds_record_desc_t   record_desc;
+    ret_code_t          ret;
     // Set up record.
     record.file_id           = FILE_ORDER;
     record.key               = RECORD_KEY_ORDER;
     record.data.p_data       = buffer;
     record.data.length_words = (bufferSize+ 3) / 4;
-    ret_code_t ret;
-    fds_find_token_t    ftok;
-
-    /* It is required to zero the token before first use. */
-    memset(&ftok, 0x00, sizeof(fds_find_token_t));
 
-    // delete all previous records with the same KEY and ID
-    while (fds_record_find(FILE_ORDER, RECORD_KEY_ORDER, &record_desc, &ftok) == FDS_SUCCESS)
+    // buffer is kept by orderProcessing until write event (orderFlushDone()/orderFlushFailed()), FDS writes it
+    // asynchronously and checks its CRC on read back
+    if (orderRecord.isValid || orderRecordFind())
     {
-        ret = fds_record_delete(&record_desc);
-        if (ret != FDS_SUCCESS)
-        {
-        /* Error. */
-        }
+        // new copy and deletion of old one in one FDS operation, descriptor gets ID of new record
+        ret = fds_record_update(&orderRecord.desc, &record);
     }
-    ret = fds_record_write(&record_desc, &record);
-    if (ret != FDS_SUCCESS)
+    else
     {
-        /* Handle error. */
+        ret = fds_record_write(&orderRecord.desc, &record);
     }
+    orderRecord.isValid = (ret == FDS_SUCCESS);
+    if (ret == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        // order write is retried by orderProcessing after garbage collection frees space
+        NRF_LOG_INFO("Order write: no space, GC");
+        (void)fds_gc();
+    }
+    else if (ret != FDS_SUCCESS)
+    {
+        NRF_LOG_INFO("Order write: error %d", ret);
+    }
+    return ret;
 }
 
 
-void flashMemReadBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
 {
     fds_flash_record_t  flash_record;
-    fds_record_desc_t   record_desc;
-    fds_find_token_t    ftok;
 
-    /* It is required to zero the token before first use. */
-    memset(&ftok, 0x00, sizeof(fds_find_token_t));
-    /* Loop until all records with the given key and file ID have been found. */
-    // while (fds_record_find(FILE_ORDER, RECORD_KEY_ORDER, &record_desc, &ftok) == FDS_SUCCESS)
-    while (fds_record_find(FILE_ORDER, RECORD_KEY_ORDER, &record_desc, &ftok) == FDS_SUCCESS)
+    if (!orderRecord.isValid && !orderRecordFind())
+    {
+        return NULL;
+    }
+    if (fds_record_open(&orderRecord.desc, &flash_record) != FDS_SUCCESS)
     {
-        NRF_LOG_INFO("Read start");
-        if (fds_record_open(&record_desc, &flash_record) != FDS_SUCCESS)
+        // record was deleted out of this module, look for other one
+        if (!orderRecordFind() || fds_record_open(&orderRecord.desc, &flash_record) != FDS_SUCCESS)
         {
-            /* Handle error. */
+            orderRecord.isValid = false;
+            return NULL;
         }
+    }
+    *size = flash_record.p_header->length_words * sizeof(uint32_t);
+    return (const uint8_t *)flash_record.p_data;
+}
 
-        memcpy(buffer, (uint8_t*)flash_record.p_data, bufferSize);
 
-        /* Access the record through the flash_record structure. */
-        /* Close the record when done. */
-        if (fds_record_close(&record_desc) != FDS_SUCCESS)
-        {
-            /* Handle error. */
-        }
+void flashMemClose(uint32_t flashAddress)
+{
+    if (fds_record_close(&orderRecord.desc) != FDS_SUCCESS)
+    {
+        /* Handle error. */
     }
-    NRF_LOG_INFO("Read End");
 }
 
 
@@ -1132,89 +915,21 @@ static void hids_init(void)
     ble_hids_inp_rep_init_t   inp_rep_array[INPUT_REPORT_COUNT];
     ble_hids_inp_rep_init_t * p_input_report;
     uint8_t                   hid_info_flags;
-
-    static uint8_t rep_map_data[] =
-    {
-        0x05, 0x01, // Usage Page (Generic Desktop)
-        0x09, 0x02, // Usage (Mouse)
-
-        0xA1, 0x01, // Collection (Application)
-
-        // Report ID 1: Mouse buttons + scroll/pan
-        0x85, 0x01,       // Report Id 1
-        0x09, 0x01,       // Usage (Pointer)
-        0xA1, 0x00,       // Collection (Physical)
-        0x95, 0x05,       // Report Count (3)
-        0x75, 0x01,       // Report Size (1)
-        0x05, 0x09,       // Usage Page (Buttons)
-        0x19, 0x01,       // Usage Minimum (01)
-        0x29, 0x05,       // Usage Maximum (05)
-        0x15, 0x00,       // Logical Minimum (0)
-        0x25, 0x01,       // Logical Maximum (1)
-        0x81, 0x02,       // Input (Data, Variable, Absolute)
-        0x95, 0x01,       // Report Count (1)
-        0x75, 0x03,       // Report Size (3)
-        0x81, 0x01,       // Input (Constant) for padding
-        0x75, 0x08,       // Report Size (8)
-        0x95, 0x01,       // Report Count (1)
-        0x05, 0x01,       // Usage Page (Generic Desktop)
-        0x09, 0x38,       // Usage (Wheel)
-        0x15, 0x81,       // Logical Minimum (-127)
-        0x25, 0x7F,       // Logical Maximum (127)
-        0x81, 0x06,       // Input (Data, Variable, Relative)
-        0x05, 0x0C,       // Usage Page (Consumer)
-        0x0A, 0x38, 0x02, // Usage (AC Pan)
-        0x95, 0x01,       // Report Count (1)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0xC0,             // End Collection (Physical)
-
-        // Report ID 2: Mouse motion
-        0x85, 0x02,       // Report Id 2
-        0x09, 0x01,       // Usage (Pointer)
-        0xA1, 0x00,       // Collection (Physical)
-        0x75, 0x0C,       // Report Size (12)
-        0x95, 0x02,       // Report Count (2)
-        0x05, 0x01,       // Usage Page (Generic Desktop)
-        0x09, 0x30,       // Usage (X)
-        0x09, 0x31,       // Usage (Y)
-        0x16, 0x01, 0xF8, // Logical maximum (2047)
-        0x26, 0xFF, 0x07, // Logical minimum (-2047)
-        0x81, 0x06,       // Input (Data, Variable, Relative)
-        0xC0,             // End Collection (Physical)
-        0xC0,             // End Collection (Application)
-
-        // Report ID 3: Advanced buttons
-        0x05, 0x0C,       // Usage Page (Consumer)
-        0x09, 0x01,       // Usage (Consumer Control)
-        0xA1, 0x01,       // Collection (Application)
-        0x85, 0x03,       // Report Id (3)
-        0x15, 0x00,       // Logical minimum (0)
-        0x25, 0x01,       // Logical maximum (1)
-        0x75, 0x01,       // Report Size (1)
-        0x95, 0x01,       // Report Count (1)
-
-        0x09, 0xCD,       // Usage (Play/Pause)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0x0A, 0x83, 0x01, // Usage (AL Consumer Control Configuration)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0x09, 0xB5,       // Usage (Scan Next Track)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0x09, 0xB6,       // Usage (Scan Previous Track)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-
-        0x09, 0xEA,       // Usage (Volume Down)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0x09, 0xE9,       // Usage (Volume Up)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0x0A, 0x25, 0x02, // Usage (AC Forward)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0x0A, 0x24, 0x02, // Usage (AC Back)
-        0x81, 0x06,       // Input (Data,Value,Relative,Bit Field)
-        0xC0              // End Collection
-    };
+    const uint8_t           * p_rep_map;
+    uint16_t                  rep_map_len;
 
     memset(inp_rep_array, 0, sizeof(inp_rep_array));
     // Initialize HID Service.
+#if MOTION_COMBINED_REPORT
+    p_input_report                      = &inp_rep_array[INPUT_REP_COMBINED_INDEX];
+    p_input_report->max_len             = INPUT_REP_COMBINED_LEN;
+    p_input_report->rep_ref.report_id   = INPUT_REP_REF_COMBINED_ID;
+    p_input_report->rep_ref.report_type = BLE_HIDS_REP_TYPE_INPUT;
+
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&p_input_report->security_mode.cccd_write_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&p_input_report->security_mode.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&p_input_report->security_mode.write_perm);
+#else
     p_input_report                      = &inp_rep_array[INPUT_REP_BUTTONS_INDEX];
     p_input_report->max_len             = INPUT_REP_BUTTONS_LEN;
     p_input_report->rep_ref.report_id   = INPUT_REP_REF_BUTTONS_ID;
@@ -1232,6 +947,7 @@ static void hids_init(void)
     BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&p_input_report->security_mode.cccd_write_perm);
     BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&p_input_report->security_mode.read_perm);
     BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&p_input_report->security_mode.write_perm);
+#endif
 
     p_input_report                      = &inp_rep_array[INPUT_REP_MPLAYER_INDEX];
     p_input_report->max_len             = INPUT_REP_MEDIA_PLAYER_LEN;
@@ -1243,6 +959,7 @@ static void hids_init(void)
     BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&p_input_report->security_mode.write_perm);
 
     hid_info_flags = HID_INFO_FLAG_REMOTE_WAKE_MSK | HID_INFO_FLAG_NORMALLY_CONNECTABLE_MSK;
+    p_rep_map      = motionReportMapGet(&rep_map_len);   // SoftDevice copies it to the attribute
 
     memset(&hids_init_obj, 0, sizeof(hids_init_obj));
 
@@ -1256,8 +973,8 @@ static void hids_init(void)
     hids_init_obj.p_outp_rep_array               = NULL;
     hids_init_obj.feature_rep_count              = 0;
     hids_init_obj.p_feature_rep_array            = NULL;
-    hids_init_obj.rep_map.data_len               = sizeof(rep_map_data);
-    hids_init_obj.rep_map.p_data                 = rep_map_data;
+    hids_init_obj.rep_map.data_len               = rep_map_len;
+    hids_init_obj.rep_map.p_data                 = (uint8_t *)p_rep_map;
     hids_init_obj.hid_information.bcd_hid        = BASE_USB_HID_SPEC_VERSION;
     hids_init_obj.hid_information.b_country_code = 0;
     hids_init_obj.hid_information.flags          = hid_info_flags;
@@ -1368,11 +1085,48 @@ static void sleep_mode_enter(void)
     err_code = bsp_btn_ble_sleep_mode_prepare();
     APP_ERROR_CHECK(err_code);
 
-    // Go to system-off mode (this function will not return; wakeup will cause a reset).
-    err_code = sd_power_system_off();
-    APP_ERROR_CHECK(err_code);
+    // Go to system-off mode after shutdown handlers are ready (wakeup will cause a reset).
+    nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF);
+}
+
+
+/**@brief Shutdown handler: write pending device order before System OFF.
+ *
+ * @retval false flash write is started or still queued, shutdown is continued from FDS event.
+ * @details Handler is called again on continue: order changed while previous write was queued is written then,
+ *          write result doesn't matter. Write that isn't started (FDS error) has no event to wait for, order
+ *          change is lost but shutdown goes on.
+ */
+static bool order_shutdown_handler(nrf_pwr_mgmt_evt_t event)
+{
+    appState.isShutdown = true;
+    return !orderFlushAll();
 }
 
+NRF_PWR_MGMT_HANDLER_REGISTER(order_shutdown_handler, 0);
+
+
+/**@brief Shutdown handler: dump reconnect trace to log before System OFF.
+ *
+ * @details One line per item "TRACE <seq> <phase> <peer> <time>", captured log is decoded on host by
+ *          test/reconnectTraceDecode. Log is flushed per item, trace is longer than deferred log buffer.
+ */
+static bool trace_shutdown_handler(nrf_pwr_mgmt_evt_t event)
+{
+    traceItemT item;
+
+    NRF_LOG_INFO("TRACE lost %d", reconnectTraceGetLost());
+    NRF_LOG_FLUSH();
+    while (reconnectTraceRead(&item, 1) != 0)
+    {
+        NRF_LOG_INFO("TRACE %d %d %d %d", item.seq, item.phase, item.peerId, item.time);
+        NRF_LOG_FLUSH();
+    }
+    return true;
+}
+
+NRF_PWR_MGMT_HANDLER_REGISTER(trace_shutdown_handler, 1);
+
 
 /**@brief Function for handling HID events.
  *
@@ -1387,10 +1141,12 @@ static void on_hids_evt(ble_hids_t * p_hids, ble_hids_evt_t * p_evt)
     {
         case BLE_HIDS_EVT_BOOT_MODE_ENTERED:
             m_in_boot_mode = true;
+            motionSetBootMode(true);
             break;
 
         case BLE_HIDS_EVT_REPORT_MODE_ENTERED:
             m_in_boot_mode = false;
+            motionSetBootMode(false);
             break;
 
         case BLE_HIDS_EVT_NOTIF_ENABLED:
@@ -1475,59 +1231,164 @@ static void scheduler_init(void)
 }
 
 
-/**@brief Function for sending a Mouse Movement.
- *
- * @param[in]   x_delta   Horizontal movement.
- * @param[in]   y_delta   Vertical movement.
- */
-static void mouse_movement_send(int16_t x_delta, int16_t y_delta)
+/*********mouseMotion USER IMPLEMENTED FUNCTION****************/
+motionSendResultT motionReportSend(motionReportT report, const uint8_t data[], uint8_t len)
 {
     ret_code_t err_code;
 
-    if (m_in_boot_mode)
+    switch(report)
+    {
+    case MOTION_REPORT_BOOT:
+        err_code = ble_hids_boot_mouse_inp_rep_send(&m_hids, data[0], (int8_t)data[1], (int8_t)data[2], 0, NULL);
+        break;
+#if MOTION_COMBINED_REPORT
+    case MOTION_REPORT_COMBINED:
+    default:
+        err_code = ble_hids_inp_rep_send(&m_hids, INPUT_REP_COMBINED_INDEX, len, (uint8_t *)data);
+        break;
+#else
+    case MOTION_REPORT_BUTTONS:
+        err_code = ble_hids_inp_rep_send(&m_hids, INPUT_REP_BUTTONS_INDEX, len, (uint8_t *)data);
+        break;
+    case MOTION_REPORT_MOVEMENT:
+    default:
+        err_code = ble_hids_inp_rep_send(&m_hids, INPUT_REP_MOVEMENT_INDEX, len, (uint8_t *)data);
+        break;
+#endif
+    }
+
+    switch(err_code)
     {
-        x_delta = MIN(x_delta, 0x00ff);
-        y_delta = MIN(y_delta, 0x00ff);
-
-        err_code = ble_hids_boot_mouse_inp_rep_send(&m_hids,
-                                                    0x00,
-                                                    (int8_t)x_delta,
-                                                    (int8_t)y_delta,
-                                                    0,
-                                                    NULL);
+    case NRF_SUCCESS:
+        appState.reportTime = getTime();
+        return MOTION_SEND_OK;
+    case NRF_ERROR_RESOURCES:
+        return MOTION_SEND_BUSY;
+    case NRF_ERROR_INVALID_STATE:            // notification is not enabled by host
+    case BLE_ERROR_GATTS_SYS_ATTR_MISSING:
+        return MOTION_SEND_DROP;
+    default:
+        NRF_LOG_INFO("HID ERROR %d", err_code);
+        APP_ERROR_HANDLER(err_code);
+        return MOTION_SEND_DROP;
     }
-    else
+}
+
+
+void motionSensorSample(void)
+{
+    // motion of keys is added by bsp_event_handler()
+    int16_t x;
+    int16_t y;
+
+    while (APP_SENSOR_ENABLED && sensorRead(&x, &y))
     {
-        uint8_t buffer[INPUT_REP_MOVEMENT_LEN];
+        motionAdd(x, y, 0, 0);
+    }
+}
 
-        APP_ERROR_CHECK_BOOL(INPUT_REP_MOVEMENT_LEN == 3);
 
-        x_delta = MIN(x_delta, 0x0fff);
-        y_delta = MIN(y_delta, 0x0fff);
+static volatile bool m_sensor_evt_pending;  /**< Sensor event is in scheduler queue, samples of later interrupts go with it. */
 
-        buffer[0] = x_delta & 0x00ff;
-        buffer[1] = ((y_delta & 0x000f) << 4) | ((x_delta & 0x0f00) >> 8);
-        buffer[2] = (y_delta & 0x0ff0) >> 4;
+/**@brief Function for handling new sensor samples in main context (not synchronized mode).
+ */
+static void sensor_evt_process(void * p_event_data, uint16_t event_size)
+{
+    m_sensor_evt_pending = false;
+    motionSensorSample();
+    motionProcess();
+}
 
-        err_code = ble_hids_inp_rep_send(&m_hids,
-                                         INPUT_REP_MOVEMENT_INDEX,
-                                         INPUT_REP_MOVEMENT_LEN,
-                                         buffer);
+
+/*********opticalSensor USER IMPLEMENTED FUNCTION****************/
+void sensorSampleReady(void)
+{
+    // synchronized mode takes samples at connection event lead time
+    if (!APP_MOTION_SYNC && !m_sensor_evt_pending)
+    {
+        m_sensor_evt_pending = true;
+        ret_code_t err_code  = app_sched_event_put(NULL, 0, sensor_evt_process);
+        APP_ERROR_CHECK(err_code);
     }
+}
 
-    NRF_LOG_INFO("HID ERROR %d", err_code);
 
-    if ((err_code != NRF_SUCCESS) &&
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != NRF_ERROR_RESOURCES) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-       )
+/**@brief Function for initializing the optical sensor, mouse works with keys only if it is not found.
+ */
+static void sensor_init(void)
+{
+    sensorResultT result = sensorInit(APP_SENSOR_MOTION_PIN, APP_SENSOR_RESOLUTION);
+
+    if (result != SENSOR_OK)
     {
-        APP_ERROR_HANDLER(err_code);
+        NRF_LOG_INFO("Optical sensor is not available (%d)", result);
+    }
+}
+
+
+static volatile bool m_conn_evt_pending;  /**< Connection event lead time is in scheduler queue, the next ones go with it. */
+
+/**@brief Function for handling connection event lead time in main context.
+ */
+static void motion_conn_event_prepare(void * p_event_data, uint16_t event_size)
+{
+    m_conn_evt_pending = false;
+    motionConnEventPrepare();
+}
+
+
+/**@brief Function for handling Radio Notification events (SWI1 interrupt context).
+ *
+ * @param[in]   radio_active   true - APP_MOTION_SYNC_DISTANCE before radio event, false - radio event is over.
+ */
+static void radio_notification_evt_handler(bool radio_active)
+{
+    // radio events of advertising have no report to prepare
+    if (radio_active && !m_conn_evt_pending && m_conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        // scheduler wakes main loop, report is queued before connection event starts
+        m_conn_evt_pending  = true;
+        ret_code_t err_code = app_sched_event_put(NULL, 0, motion_conn_event_prepare);
+        if (err_code == NRF_ERROR_NO_MEM)
+        {
+            // queue is full of other events, report goes with the next connection event
+            m_conn_evt_pending = false;
+            return;
+        }
+        APP_ERROR_CHECK(err_code);
     }
 }
 
 
+/**@brief Function for synchronizing motion reports with connection events.
+ */
+static void motion_sync_init(void)
+{
+    ret_code_t err_code;
+
+    err_code = ble_radio_notification_init(APP_IRQ_PRIORITY_LOW,
+                                           APP_MOTION_SYNC_DISTANCE,
+                                           radio_notification_evt_handler);
+    APP_ERROR_CHECK(err_code);
+    motionSetSync(true);
+}
+
+
+/**@brief Function for sending a Mouse Movement.
+ *
+ * @details Movement is accumulated and reported as soon as notification TX buffer is free,
+ *          it is never dropped because the link is busy.
+ *
+ * @param[in]   x_delta   Horizontal movement.
+ * @param[in]   y_delta   Vertical movement.
+ */
+static void mouse_movement_send(int16_t x_delta, int16_t y_delta)
+{
+    motionAdd(x_delta, y_delta, 0, 0);
+    motionProcess();
+}
+
+
 
 bool genisAppAdv = false;
 
@@ -1591,7 +1452,8 @@ static void bsp_event_handler(bsp_event_t event)
 
         case BSP_EVENT_KEY_3:
            NRF_LOG_INFO("ADD_NEW adv start");
-           appAdvSetStart(ADV_ADD_NEW, 0);
+           advIntervalRestart(getTime());
+           advReconnectSetStart(ADV_ADD_NEW, 0);
            break;
 
         default:
@@ -1651,6 +1513,7 @@ static void fds_evt_handler(fds_evt_t const * p_fds_evt)
         case  FDS_EVT_DEL_RECORD: NRF_LOG_INFO("FDS_EVT_DEL_RECORD");  break;
         case  FDS_EVT_DEL_FILE:   NRF_LOG_INFO("FDS_EVT_DEL_FILE");    break;
         case  FDS_EVT_GC:         NRF_LOG_INFO("FDS_EVT_GC");          break;
+        case  FDS_EVT_TX:         NRF_LOG_INFO("FDS_EVT_TX");          break;
     }
 
     switch (p_fds_evt->id)
@@ -1661,6 +1524,51 @@ static void fds_evt_handler(fds_evt_t const * p_fds_evt)
                 // Initialization failed.
             }
             break;
+        case FDS_EVT_GC:
+        {
+            fds_gc_stat_t gcStat;
+            (void)fds_gc_stat(&gcStat);
+            NRF_LOG_INFO("GC runs = %d stalls = %d stall time = %d max = %d", gcStat.runs, gcStat.stalls,
+                         gcStat.stall_time, gcStat.stall_time_max);
+#if FDS_TELEMETRY_ENABLED
+            if (gcStat.runs != appState.gcRunsSaved)
+            {
+                // Save flash wear counters once per complete garbage collection.
+                fds_stat_t stat;
+                (void)fds_stat(&stat);
+                NRF_LOG_INFO("erase max = %d GC bytes = %d queue full = %d depth max = %d", stat.erase_count_max,
+                             stat.gc_bytes_copied, stat.queue_full, stat.queue_depth_max);
+                if (fds_telemetry_save() == FDS_SUCCESS)
+                {
+                    appState.gcRunsSaved = gcStat.runs;
+                }
+            }
+#endif
+        } break;
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            if (p_fds_evt->write.file_id != FILE_ORDER)
+            {
+                break;
+            }
+            if (p_fds_evt->result != FDS_SUCCESS)
+            {
+                orderRecord.isValid = false;
+            }
+            // image buffer of order is free now, failed write isn't retried on shutdown
+            if (p_fds_evt->result == FDS_SUCCESS || appState.isShutdown)
+            {
+                orderFlushDone(deviceOrder);
+            }
+            else
+            {
+                orderFlushFailed(deviceOrder);
+            }
+            if (appState.isShutdown)
+            {
+                nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_CONTINUE);
+            }
+            break;
         default:
             break;
     }
@@ -1678,10 +1586,16 @@ int main(void)
     NRF_LOG_INFO("Gerasimchuk started.");
 
     initUserTimer();
-    stopScanAdvTimerCallback = timerGetCallback(appAdvScanStopCB);
+    ret_code_t ret           = nrf_pwr_mgmt_init();
+    APP_ERROR_CHECK(ret);
+    reconnectTraceInit();
+    reconnectTraceAdd(TRACE_POWER_ON, TRACE_PEER_NONE);
     deviceOrder              = orderMalloc();
+    advReconnectInit(deviceOrder);
+    advReconnectSetStrategy(APP_ADV_CONNECT_STRATEGY);
+    motionInit();
 
-    ret_code_t ret           = fds_register(fds_evt_handler);
+    ret                      = fds_register(fds_evt_handler);
     if (ret != FDS_SUCCESS)
     {
     // Registering of the FDS event handler has failed.
@@ -1691,16 +1605,22 @@ int main(void)
     {
     // Handle error.
     }
+    fds_gc_time_source_set(getTime);
     //orderWriteFlash(deviceOrder, GET_PAGE_ADDRESS(ORDER_FLASHE_PAGE));
     orderReadFlash(deviceOrder, GET_PAGE_ADDRESS(ORDER_FLASHE_PAGE));
     NRF_LOG_INFO("Order items = %d",  orderGetQuantity(deviceOrder));
-    for(uint8_t cnt = 0; cnt < ORDER_ITEM_QUANTITY; cnt++ )
+    for(uint16_t cnt = 0; cnt < orderGetQuantity(deviceOrder); cnt++ )
     {
-        NRF_LOG_INFO("item = %d \n", orderGetItem(deviceOrder, cnt));
+        NRF_LOG_INFO("item = %d rank item = %d score = %d\n", orderGetItem(deviceOrder, cnt),
+                     orderGetRankItem(deviceOrder, cnt), orderGetScore(deviceOrder, orderGetRankItem(deviceOrder, cnt)));
     }
 
     timers_init();
     buttons_leds_init(&erase_bonds);
+    if (APP_SENSOR_ENABLED)
+    {
+        sensor_init();
+    }
     ble_stack_init();
     scheduler_init();
     gap_params_init();
@@ -1709,11 +1629,16 @@ int main(void)
     sensor_simulator_init();
     conn_params_init();
     peer_manager_init();
+    if (APP_MOTION_SYNC)
+    {
+        motion_sync_init();
+    }
     // Start execution.
 
     timers_start();
-    advertising_init(APP_ADV_GLOBAL_INTERVAL, APP_ADV_GLOBAL_TIMEOUT, true);
-    appAdvSetStart(ADV_RECONNECT_SCAN, 0);
+    advIntervalInit(getTime());
+    advertising_init(true);
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
 
     // Enter main loop.
     for (;;)
@@ -1778,6 +1703,11 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             err_code = bsp_indication_set(BSP_INDICATE_CONNECTED);
             APP_ERROR_CHECK(err_code);
             m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            motionConnect(APP_MOTION_TX_BUFFERS);
+            if (APP_SENSOR_ENABLED)
+            {
+                sensorStart();
+            }
             if(appAdvGetPrevConn())
             {
                 break;
@@ -1785,7 +1715,7 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             /******app processing*****************/
             appAdvSetRealState(false);
             appConnectSetState(CONNECTION_CONNECT, m_conn_handle);
-            appAdvProcessing(ADV_PROC_CONNECT,0);
+            advReconnectProcessing(ADV_PROC_CONNECT,0);
             /*************************************/
             break;
 
@@ -1795,11 +1725,34 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             /******app processing*****************/
             appAdvSetPrevConn(false);
             appConnectSetState(CONNECTION_DISCONNECT, BLE_CONN_HANDLE_INVALID);
+            appAdvSetRealState(false);          // ble_advertising doesn't restart on disconnect
+            if(appState.usagePeer != PM_PEER_ID_INVALID)
+            {
+                orderUsageDisconnect(deviceOrder, appState.usagePeer, getTime() - appState.usageStartTime);
+                orderWriteFlash(deviceOrder, GET_PAGE_ADDRESS(ORDER_FLASHE_PAGE));
+                appState.usagePeer = PM_PEER_ID_INVALID;
+                advIntervalRestart(getTime());  // host lost, start dense advertising again
+                appAdvStart();
+            }
+            else if(appAdvGetState())
+            {
+                appAdvStart();                  // connection rejected by reconnect, advertising goes on
+            }
             /*************************************/
 
+            motionDisconnect();
+            if (APP_SENSOR_ENABLED)
+            {
+                sensorStop();
+            }
             m_conn_handle = BLE_CONN_HANDLE_INVALID;
             break;
 
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            // TX buffers are free again, send motion accumulated meanwhile
+            motionTxComplete(p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count);
+            break;
+
 #ifndef S140
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
         {
@@ -1915,7 +1868,7 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
             appAdvSetPrevConn(true);
             appAdvSetRealState(false);
             appConnectSetState(CONNECTION_CONNECT, p_evt->conn_handle);
-            appAdvProcessing(ADV_PROC_START_CONNECT, p_evt->peer_id);
+            advReconnectProcessing(ADV_PROC_START_CONNECT, p_evt->peer_id);
             /****** *******************************/
 
         } break;
@@ -1927,9 +1880,19 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
                          p_evt->conn_handle,
                          p_evt->params.conn_sec_succeeded.procedure);
 
-            /* -AddOrder- Added new device to the order*/
-            orderSetFirst(deviceOrder, p_evt->peer_id);
+            reconnectTraceAdd(TRACE_CONN_SEC_SUCCEEDED, p_evt->peer_id);
+            advIntervalConnected(getTime());    // host found, rejected connections of scan phase don't count
+            {
+                advWhitelistStatT wlStat;
+                advReconnectWhitelistGetStat(&wlStat);
+                NRF_LOG_INFO("WL applied %d skipped %d", wlStat.applyPerformed, wlStat.applySkipped);
+            }
+
+            /* -AddOrder- Added new device to the order, count connection in its rank*/
+            orderUsageConnect(deviceOrder, p_evt->peer_id);
             orderWriteFlash(deviceOrder, GET_PAGE_ADDRESS(ORDER_FLASHE_PAGE));
+            appState.usagePeer      = p_evt->peer_id;
+            appState.usageStartTime = getTime();
 
             m_peer_id = p_evt->peer_id;
 
@@ -1991,25 +1954,12 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
 
                 NRF_LOG_INFO("New Bond, add the peer to the whitelist if possible");
                 NRF_LOG_INFO("\tm_whitelist_peer_cnt %d, MAX_PEERS_WLIST %d",
-                               m_whitelist_peer_cnt + 1,
+                               advReconnectWhitelistGetQuantity() + 1,
                                BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
                 // Note: You should check on what kind of white list policy your application should use.
 
-                if (m_whitelist_peer_cnt < BLE_GAP_WHITELIST_ADDR_MAX_COUNT)
-                {
-                    // Bonded to a new peer, add it to the whitelist.
-                    m_whitelist_peers[m_whitelist_peer_cnt++] = m_peer_id;
-
-                    // The whitelist has been modified, update it in the Peer Manager.
-                    err_code = pm_whitelist_set(m_whitelist_peers, m_whitelist_peer_cnt);
-                    APP_ERROR_CHECK(err_code);
-
-                    err_code = pm_device_identities_list_set(m_whitelist_peers, m_whitelist_peer_cnt);
-                    if (err_code != NRF_ERROR_NOT_SUPPORTED)
-                    {
-                        APP_ERROR_CHECK(err_code);
-                    }
-                }
+                // Bonded to a new peer, add it to the whitelist.
+                advReconnectWhitelistAdd(m_peer_id);
             }
         } break;
 
@@ -2108,6 +2058,7 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 
             /******processing adv event************/
             appAdvSetRealState(false);
+            advIntervalNext();   // no connection on this period, back off
             /****** *******************************/
             //sleep_mode_enter();
             break;
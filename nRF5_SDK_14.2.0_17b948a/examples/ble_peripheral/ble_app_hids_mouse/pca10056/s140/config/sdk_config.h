@@ -144,6 +144,14 @@
 #define PM_CENTRAL_ENABLED 0
 #endif
 
+// <o> PM_ID_CACHE_SIZE - Number of bonded peers whose identity address and IRK are kept in RAM. 
+// <i> Whitelist and device identity updates for cached peers do not read flash.
+// <i> Each entry takes 26 bytes of RAM. 0 disables the cache.
+
+#ifndef PM_ID_CACHE_SIZE
+#define PM_ID_CACHE_SIZE 8
+#endif
+
 // </e>
 
 // </h> 
@@ -2166,12 +2174,22 @@
 #define BUTTON_ENABLED 1
 #endif
 
-// <q> CRC16_ENABLED  - crc16 - CRC16 calculation routines
- 
-
+// <e> CRC16_ENABLED - crc16 - CRC16 calculation routines
+//==========================================================
 #ifndef CRC16_ENABLED
 #define CRC16_ENABLED 1
 #endif
+// <o> CRC16_KERNEL  - Implementation, trading flash size for speed. All give the same result.
+ 
+// <0=> Bitwise (no table) 
+// <1=> Table (512 bytes) 
+// <2=> Slicing-by-4 (2 kB) 
+
+#ifndef CRC16_KERNEL
+#define CRC16_KERNEL 1
+#endif
+
+// </e>
 
 // <q> CRC32_ENABLED  - crc32 - CRC32 calculation routines
  
@@ -2230,8 +2248,10 @@
 
 // <i> NRF_FSTORAGE_SD uses the nrf_fstorage_sd backend implementation using the SoftDevice API. Use this if you have a SoftDevice present.
 // <i> NRF_FSTORAGE_NVMC uses the nrf_fstorage_nvmc implementation. Use this setting if you don't use the SoftDevice.
+// <i> NRF_FSTORAGE_FILE uses the nrf_fstorage_file implementation, emulating flash in a file. Use this setting for Linux host builds.
 // <1=> NRF_FSTORAGE_NVMC 
 // <2=> NRF_FSTORAGE_SD 
+// <3=> NRF_FSTORAGE_FILE 
 
 #ifndef FDS_BACKEND
 #define FDS_BACKEND 2
@@ -2293,6 +2313,51 @@
 // </h> 
 //==========================================================
 
+// <e> FDS_RAM_INDEX_ENABLED - Keep a RAM index of records.
+// <i> Finding a record by file ID and record key doesn't scan flash.
+// <i> When there are more records than index entries, lookups scan flash until garbage collection.
+//==========================================================
+#ifndef FDS_RAM_INDEX_ENABLED
+#define FDS_RAM_INDEX_ENABLED 1
+#endif
+// <o> FDS_RAM_INDEX_SIZE - Maximum number of indexed records. Must be a power of two.
+#ifndef FDS_RAM_INDEX_SIZE
+#define FDS_RAM_INDEX_SIZE 64
+#endif
+
+// </e>
+
+// <o> FDS_GC_IDLE_DIRTY_PERCENT - Reclaimable share of data pages (%) for fds_gc_idle() to start garbage collection. <1-100>
+#ifndef FDS_GC_IDLE_DIRTY_PERCENT
+#define FDS_GC_IDLE_DIRTY_PERCENT 25
+#endif
+
+// <e> FDS_TELEMETRY_ENABLED - Count flash erases and operations.
+// <i> Counters are read with fds_stat() and saved with fds_telemetry_save(). File ID 0xBFFE is reserved.
+//==========================================================
+#ifndef FDS_TELEMETRY_ENABLED
+#define FDS_TELEMETRY_ENABLED 1
+#endif
+// <o> FDS_TELEMETRY_FILES - Number of file IDs with their own write and delete counters.
+#ifndef FDS_TELEMETRY_FILES
+#define FDS_TELEMETRY_FILES 4
+#endif
+
+// </e>
+
+// <e> FDS_TX_ENABLED - Enable atomic multi-record transactions.
+// <i> File ID 0xBFFF is reserved for commit markers.
+//==========================================================
+#ifndef FDS_TX_ENABLED
+#define FDS_TX_ENABLED 0
+#endif
+// <o> FDS_TX_MAX_RECORDS - Maximum number of records in a transaction. <1-16>
+#ifndef FDS_TX_MAX_RECORDS
+#define FDS_TX_MAX_RECORDS 4
+#endif
+
+// </e>
+
 // </e>
 
 // <e> HARDFAULT_HANDLER_ENABLED - hardfault_default - HardFault default handler for debugging and release
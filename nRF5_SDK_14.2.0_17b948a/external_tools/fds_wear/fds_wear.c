@@ -0,0 +1,363 @@
+/**
+ * Copyright (c) 2016 - 2017, Nordic Semiconductor ASA
+ * 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ * 
+ * 3. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ * 
+ * 4. This software, with or without modification, must only be used with a
+ *    Nordic Semiconductor ASA integrated circuit.
+ * 
+ * 5. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/* Host tool projecting flash lifetime from the FDS operation counters.
+ *
+ * The counters are read from the telemetry record saved by fds_telemetry_save(), in an image of
+ * the FDS flash area: the file of the nrf_fstorage_file backend, or a binary dump of the device
+ * flash from the first FDS page (for example nrfjprog --readcode, converted with objcopy).
+ *
+ * Usage: fds_wear [-e endurance] [-p page_words] image [old_image] days
+ *
+ * days is the time the counters were collected over: since they were first saved, or between
+ * old_image and image. Erase rates are projected against the flash endurance (10000 write/erase
+ * cycles for the nRF52 series by default).
+ *
+ * Build: cc -std=c99 -o fds_wear fds_wear.c
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* From fds_internal_defs.h. */
+#define FDS_PAGE_TAG_MAGIC          (0xDEADC0DE)
+#define FDS_PAGE_TAG_SWAP           (0xF11E01FF)
+#define FDS_PAGE_TAG_DATA           (0xF11E01FE)
+#define FDS_PAGE_TAG_SIZE           (2)
+#define FDS_HEADER_SIZE             (3)
+#define FDS_TELEMETRY_FILE_ID       (0xBFFE)
+#define FDS_TELEMETRY_RECORD_KEY    (0x0001)
+#define FDS_TELEMETRY_VERSION       (1)
+
+/* Layout of the record data, see fds_telemetry_t. */
+#define TM_VERSION                  (0)
+#define TM_PAGES                    (1)
+#define TM_FILES                    (2)
+#define TM_GC_RUNS                  (3)
+#define TM_GC_BYTES_COPIED          (4)
+#define TM_QUEUE_FULL               (5)
+#define TM_QUEUE_DEPTH_MAX          (6)
+#define TM_ERASE_COUNT              (7)
+
+#define DEFAULT_ENDURANCE           (10000)
+#define DEFAULT_PAGE_WORDS          (1024)
+
+
+typedef struct
+{
+    uint32_t * p_words;
+    size_t     words;
+    uint32_t   record_id;   /* ID of the telemetry record, to pick the latest copy. */
+    uint32_t * p_data;      /* Telemetry record data, NULL if not found. */
+    uint32_t   length;      /* Length of the data, in words. */
+} image_t;
+
+
+static int image_load(image_t * p_image, char const * p_name)
+{
+    FILE * p_file = fopen(p_name, "rb");
+    long   size;
+
+    if (p_file == NULL)
+    {
+        perror(p_name);
+        return -1;
+    }
+
+    (void)fseek(p_file, 0, SEEK_END);
+    size = ftell(p_file);
+    (void)fseek(p_file, 0, SEEK_SET);
+
+    memset(p_image, 0, sizeof(*p_image));
+    p_image->words   = (size_t)size / sizeof(uint32_t);
+    p_image->p_words = malloc(p_image->words * sizeof(uint32_t));
+
+    if ((p_image->p_words == NULL) ||
+        (fread(p_image->p_words, sizeof(uint32_t), p_image->words, p_file) != p_image->words))
+    {
+        fprintf(stderr, "%s: read error\n", p_name);
+        fclose(p_file);
+        return -1;
+    }
+
+    fclose(p_file);
+    return 0;
+}
+
+
+/* Find the latest valid telemetry record, walking records like page_scan() does. */
+static void image_scan(image_t * p_image, size_t page_words)
+{
+    for (size_t page = 0; (page + 1) * page_words <= p_image->words; page++)
+    {
+        uint32_t * const p_page = p_image->p_words + page * page_words;
+        size_t           offset = FDS_PAGE_TAG_SIZE;
+
+        if ((p_page[0] != FDS_PAGE_TAG_MAGIC) ||
+            ((p_page[1] != FDS_PAGE_TAG_DATA) && (p_page[1] != FDS_PAGE_TAG_SWAP)))
+        {
+            continue;
+        }
+
+        while (offset + FDS_HEADER_SIZE <= page_words)
+        {
+            uint32_t const tl         = p_page[offset];
+            uint32_t const ic         = p_page[offset + 1];
+            uint32_t const record_id  = p_page[offset + 2];
+            uint16_t const record_key = tl & 0xFFFF;
+            uint16_t const length     = tl >> 16;
+            uint16_t const file_id    = ic & 0xFFFF;
+
+            if ((tl == 0xFFFFFFFF) || (offset + FDS_HEADER_SIZE + length > page_words))
+            {
+                break;
+            }
+
+            if ((record_key == FDS_TELEMETRY_RECORD_KEY) &&
+                (file_id    == FDS_TELEMETRY_FILE_ID)    &&
+                (length     >  TM_ERASE_COUNT)           &&
+                ((p_image->p_data == NULL) || (record_id > p_image->record_id)))
+            {
+                p_image->p_data    = p_page + offset + FDS_HEADER_SIZE;
+                p_image->length    = length;
+                p_image->record_id = record_id;
+            }
+
+            offset += FDS_HEADER_SIZE + length;
+        }
+    }
+}
+
+
+static int image_check(image_t const * p_image, char const * p_name)
+{
+    uint32_t const * const p_data = p_image->p_data;
+
+    if (p_data == NULL)
+    {
+        fprintf(stderr, "%s: no telemetry record found\n", p_name);
+        return -1;
+    }
+
+    if ((p_data[TM_VERSION] != FDS_TELEMETRY_VERSION) ||
+        (p_image->length != TM_ERASE_COUNT + p_data[TM_PAGES] + 3 * p_data[TM_FILES]))
+    {
+        fprintf(stderr, "%s: unknown telemetry record layout\n", p_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static uint32_t counter(image_t const * p_new, image_t const * p_old, uint32_t index)
+{
+    uint32_t const old = (p_old != NULL) ? p_old->p_data[index] : 0;
+
+    return p_new->p_data[index] - old;
+}
+
+
+/* Counters of a file in the old image, found by file ID since entries are taken in any order. */
+static uint32_t file_counter_old(image_t const * p_old, uint32_t file_id, uint32_t field)
+{
+    uint32_t const * const p_data = (p_old != NULL) ? p_old->p_data : NULL;
+
+    if (p_data == NULL)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < p_data[TM_FILES]; i++)
+    {
+        uint32_t const * const p_file = p_data + TM_ERASE_COUNT + p_data[TM_PAGES] + 3 * i;
+
+        if (p_file[0] == file_id)
+        {
+            return p_file[field];
+        }
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char ** argv)
+{
+    image_t  images[2];
+    image_t  const * p_new;
+    image_t  const * p_old     = NULL;
+    uint32_t endurance         = DEFAULT_ENDURANCE;
+    size_t   page_words        = DEFAULT_PAGE_WORDS;
+    double   days;
+    int      arg               = 1;
+    int      image_count;
+
+    while ((arg + 1 < argc) && (argv[arg][0] == '-'))
+    {
+        if (strcmp(argv[arg], "-e") == 0)
+        {
+            endurance = (uint32_t)strtoul(argv[arg + 1], NULL, 0);
+        }
+        else if (strcmp(argv[arg], "-p") == 0)
+        {
+            page_words = (size_t)strtoul(argv[arg + 1], NULL, 0);
+        }
+        else
+        {
+            break;
+        }
+        arg += 2;
+    }
+
+    image_count = argc - arg - 1;
+    if ((image_count < 1) || (image_count > 2) || (endurance == 0) || (page_words == 0))
+    {
+        fprintf(stderr, "usage: %s [-e endurance] [-p page_words] image [old_image] days\n", argv[0]);
+        return 2;
+    }
+
+    days = strtod(argv[argc - 1], NULL);
+    if (days <= 0)
+    {
+        fprintf(stderr, "days must be positive\n");
+        return 2;
+    }
+
+    for (int i = 0; i < image_count; i++)
+    {
+        if (image_load(&images[i], argv[arg + i]) != 0)
+        {
+            return 1;
+        }
+        image_scan(&images[i], page_words);
+        if (image_check(&images[i], argv[arg + i]) != 0)
+        {
+            return 1;
+        }
+    }
+
+    p_new = &images[0];
+    if (image_count == 2)
+    {
+        p_old = &images[1];
+        if (memcmp(p_new->p_data, p_old->p_data, (TM_FILES + 1) * sizeof(uint32_t)) != 0)
+        {
+            fprintf(stderr, "images have different telemetry configurations\n");
+            return 1;
+        }
+    }
+
+    uint32_t const * const p_data = p_new->p_data;
+    uint32_t const         pages  = p_data[TM_PAGES];
+    uint32_t const         files  = p_data[TM_FILES];
+
+    printf("Over %.1f days:\n", days);
+    printf("  GC runs           %10u  %10.1f/day\n", counter(p_new, p_old, TM_GC_RUNS),
+           counter(p_new, p_old, TM_GC_RUNS) / days);
+    printf("  GC bytes copied   %10u  %10.1f/day\n", counter(p_new, p_old, TM_GC_BYTES_COPIED),
+           counter(p_new, p_old, TM_GC_BYTES_COPIED) / days);
+    printf("  Queue full        %10u\n", counter(p_new, p_old, TM_QUEUE_FULL));
+    printf("  Queue depth max   %10u\n", p_data[TM_QUEUE_DEPTH_MAX]);
+
+    printf("\nFile      writes/day  deletes/day\n");
+    for (uint32_t i = 0; i < files; i++)
+    {
+        uint32_t const * const p_file  = p_data + TM_ERASE_COUNT + pages + 3 * i;
+        uint32_t const         writes  = p_file[1] - file_counter_old(p_old, p_file[0], 1);
+        uint32_t const         deletes = p_file[2] - file_counter_old(p_old, p_file[0], 2);
+
+        if ((p_file[0] == 0xFFFF) && (i + 1 < files))
+        {
+            continue;   /* Free entry. */
+        }
+
+        if (p_file[0] == 0xFFFF)
+        {
+            printf("other   ");
+        }
+        else
+        {
+            printf("0x%04X  ", p_file[0]);
+        }
+        printf("%12.1f %12.1f\n", writes / days, deletes / days);
+    }
+
+    /* The most erased page wears out first; garbage collection spreads erases over all pages. */
+    double   rate_max  = 0;
+    uint32_t count_max = 0;
+
+    printf("\nPage  erases  erases/day\n");
+    for (uint32_t page = 0; page < pages; page++)
+    {
+        uint32_t const count = p_data[TM_ERASE_COUNT + page];
+        double   const rate  = counter(p_new, p_old, TM_ERASE_COUNT + page) / days;
+
+        printf("%4u  %6u  %10.2f\n", page, count, rate);
+
+        if (count > count_max)
+        {
+            count_max = count;
+        }
+        if (rate > rate_max)
+        {
+            rate_max = rate;
+        }
+    }
+
+    if (count_max >= endurance)
+    {
+        printf("\nEndurance of %u cycles reached.\n", endurance);
+    }
+    else if (rate_max == 0)
+    {
+        printf("\nNo erases, lifetime not limited by FDS.\n");
+    }
+    else
+    {
+        double const days_left = (endurance - count_max) / rate_max;
+        printf("\nProjected lifetime: %.0f days (%.1f years) until %u cycles.\n",
+               days_left, days_left / 365.0, endurance);
+    }
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*file: opticalSensor.c
+ *
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "opticalSensor.h"
+
+#include "nrf_gpio.h"
+#include "nrf_drv_gpiote.h"
+#include "nrf_atfifo.h"
+
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+}sensorSampleT;
+
+NRF_ATFIFO_DEF(sensorFifo, sensorSampleT, SENSOR_FIFO_SIZE);
+
+static volatile struct
+{
+    uint32_t    motionPin;
+    int32_t     carryX;                // interrupt side motion not yet put in FIFO
+    int32_t     carryY;
+    bool        isReady;               // sensor found and MOTION pin event configured
+    bool        isStarted;
+    sensorStatT stat;
+}sensorState;
+
+
+// MOTION pin is configured active low
+static bool sensorIsMotion(void)
+{
+    return nrf_gpio_pin_read(sensorState.motionPin) == 0;
+}
+
+
+static int32_t sensorClamp(int32_t value, int32_t max)
+{
+    if(value > max)
+    {
+        return max;
+    }
+    if(value < -max)
+    {
+        return -max;
+    }
+    return value;
+}
+
+
+// owner of SDIO bus: interrupt, or main context with pin event disabled
+static void sensorSample(void)
+{
+    sensorSampleT sample;
+    int16_t       x;
+    int16_t       y;
+    int32_t       sumX;
+    int32_t       sumY;
+
+    adns2080_movement_burst_read(&x, &y);
+    sensorState.stat.samples++;
+
+    sumX     = sensorState.carryX + x;
+    sumY     = sensorState.carryY + y;
+    sample.x = (int16_t)sensorClamp(sumX, INT16_MAX);
+    sample.y = (int16_t)sensorClamp(sumY, INT16_MAX);
+    if(nrf_atfifo_alloc_put(sensorFifo, &sample, sizeof(sample), NULL) == NRF_SUCCESS)
+    {
+        sumX -= sample.x;
+        sumY -= sample.y;
+    }
+    else
+    {
+        sensorState.stat.carried++;
+    }
+    sensorState.carryX = sensorClamp(sumX, SENSOR_CARRY_MAX);
+    sensorState.carryY = sensorClamp(sumY, SENSOR_CARRY_MAX);
+}
+
+
+// GPIOTE interrupt: MOTION pin became active
+static void sensorMotionHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    uint8_t reads = 0;
+
+    (void)pin;
+    (void)action;
+    sensorState.stat.interrupts++;
+    do
+    {
+        sensorSample();
+        reads++;
+    } while(reads < SENSOR_READ_MAX && sensorIsMotion());
+    sensorSampleReady();
+}
+
+
+// MOTION pin event is edge triggered and enable clears latched event: pin that is already active gives no
+// interrupt, its motion is read here (main context, pin event disabled) as interrupt would do
+static void sensorEventEnable(void)
+{
+    uint8_t reads = 0;
+
+    nrf_drv_gpiote_in_event_enable(sensorState.motionPin, true);
+    while(reads < SENSOR_READ_MAX && sensorIsMotion())
+    {
+        nrf_drv_gpiote_in_event_disable(sensorState.motionPin);
+        sensorSample();
+        reads++;
+        nrf_drv_gpiote_in_event_enable(sensorState.motionPin, true);
+    }
+    if(reads != 0)
+    {
+        sensorState.stat.recovered++;
+        sensorSampleReady();
+    }
+}
+
+
+sensorResultT sensorInit(uint32_t motionPin, adns2080_resolution_t resolution)
+{
+    nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_HITOLO(true);
+
+    NRF_ATFIFO_INIT(sensorFifo);
+    sensorState.motionPin = motionPin;
+    sensorState.isReady   = false;
+    sensorState.isStarted = false;
+
+    if(adns2080_init() != ADNS2080_OK)
+    {
+        return SENSOR_NOT_DETECTED;
+    }
+    if(adns2080_motion_bits_set(SENSOR_MOTION_BITS) != ADNS2080_OK ||
+       adns2080_resolution_set(resolution) != ADNS2080_OK ||
+       adns2080_motion_interrupt_set(ADNS2080_MOTION_OUTPUT_POLARITY_LOW, ADNS2080_MOTION_OUTPUT_SENSITIVITY_LEVEL) != ADNS2080_OK)
+    {
+        return SENSOR_NOT_DETECTED;
+    }
+
+    if(!nrf_drv_gpiote_is_init() && nrf_drv_gpiote_init() != NRF_SUCCESS)
+    {
+        return SENSOR_ERROR;
+    }
+    config.pull = NRF_GPIO_PIN_PULLUP;
+    if(nrf_drv_gpiote_in_init(motionPin, &config, sensorMotionHandler) != NRF_SUCCESS)
+    {
+        return SENSOR_ERROR;
+    }
+    sensorState.isReady = true;
+    return SENSOR_OK;
+}
+
+
+// motion collected while stopped is discarded, reading clears DELTA registers and releases MOTION pin
+void sensorStart(void)
+{
+    int16_t x;
+    int16_t y;
+
+    if(!sensorState.isReady || sensorState.isStarted)
+    {
+        return;
+    }
+    adns2080_movement_burst_read(&x, &y);
+    (void)nrf_atfifo_clear(sensorFifo);
+    sensorState.carryX    = 0;
+    sensorState.carryY    = 0;
+    sensorState.isStarted = true;
+    sensorEventEnable();
+}
+
+
+void sensorStop(void)
+{
+    if(!sensorState.isStarted)
+    {
+        return;
+    }
+    nrf_drv_gpiote_in_event_disable(sensorState.motionPin);
+    sensorState.isStarted = false;
+}
+
+
+// main context; pin still active with empty FIFO - interrupt gave up after SENSOR_READ_MAX reads, no edge will come,
+// read it here, sample is taken by next sensorRead() so drain loop of caller ends
+static void sensorRecover(void)
+{
+    if(!sensorState.isStarted || !sensorIsMotion())
+    {
+        return;
+    }
+    nrf_drv_gpiote_in_event_disable(sensorState.motionPin);
+    sensorSample();
+    sensorState.stat.recovered++;
+    sensorEventEnable();
+}
+
+
+bool sensorRead(int16_t *x, int16_t *y)
+{
+    sensorSampleT sample;
+
+    if(nrf_atfifo_get_free(sensorFifo, &sample, sizeof(sample), NULL) != NRF_SUCCESS)
+    {
+        sensorRecover();
+        return false;
+    }
+    *x = sample.x;
+    *y = sample.y;
+    return true;
+}
+
+
+void sensorGetStat(sensorStatT *stat)
+{
+    *stat = sensorState.stat;
+}
@@ -0,0 +1,60 @@
+/*file: opticalSensor.h
+ *
+ * ADNS2080 optical sensor pipeline: MOTION pin of sensor raises GPIOTE IN event, its interrupt reads
+ * DELTA_X/DELTA_Y/DELTA_XY_HIGH in one burst transaction and puts sample in lock-free FIFO (nrf_atfifo),
+ * main context takes samples by sensorRead() (from motionSensorSample() of mouseMotion).
+ *   - MOTION pin is level sensitive (active while DELTA registers hold motion), motion arrived during read
+ *     keeps pin active, so interrupt reads again till pin is released (SENSOR_READ_MAX reads per interrupt)
+ *   - pin event is edge triggered: pin already active when event is enabled (sensorStart(), after
+ *     SENSOR_READ_MAX reads) is read by main context, sensorSampleReady() is called from there too
+ *   - FIFO full: sample stays in interrupt side carry and goes with next sample, motion is not lost
+ *   - motion bits mode is set once by sensorInit(), driver keeps it cached, no mode read per sample
+ *   - SENSOR_MOTION_BITS: 8 bit burst is DELTA_X, DELTA_Y (2 bytes); 12 bit burst runs from DELTA_X to
+ *     DELTA_XY_HIGH (10 bytes, registers between are read too), it is worth only when 8 bit delta can
+ *     overflow between reads (high resolution, long interrupt latency)
+ * SDIO bus belongs to interrupt while sensor is started, main context touches sensor only when it is stopped
+ * (sensorInit(), sensorStart(), sensorStop()) or with pin event disabled.
+*/
+
+#ifndef OPTICALSENSOR_H_
+#define OPTICALSENSOR_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "adns2080.h"
+
+#ifndef SENSOR_MOTION_BITS
+#define SENSOR_MOTION_BITS   ADNS2080_MOTION_BITS_8     // ADNS2080_MOTION_BITS_8 or ADNS2080_MOTION_BITS_12
+#endif
+
+#define SENSOR_FIFO_SIZE     32                 // samples between interrupt and main context, ~14 ms of sensor frames
+#define SENSOR_READ_MAX      4                  // burst reads in one interrupt while MOTION pin stays active
+#define SENSOR_CARRY_MAX     (1L << 22)         // counts, motion kept by interrupt while FIFO is full
+
+typedef enum
+{
+    SENSOR_OK,
+    SENSOR_NOT_DETECTED,           // no answer or wrong product ID
+    SENSOR_ERROR,                  // GPIOTE channel for MOTION pin is not available
+}sensorResultT;
+
+typedef struct
+{
+    uint32_t interrupts;           // MOTION pin events
+    uint32_t samples;              // burst reads
+    uint32_t carried;              // samples kept in carry because FIFO was full
+    uint32_t recovered;            // reads by main context: pin active with empty FIFO or at pin event enable
+}sensorStatT;
+
+
+sensorResultT sensorInit    (uint32_t motionPin, adns2080_resolution_t resolution);
+void          sensorStart   (void);
+void          sensorStop    (void);
+bool          sensorRead    (int16_t *x, int16_t *y);
+void          sensorGetStat (sensorStatT *stat);
+
+
+/*********USER IMPLEMENTED FUNCTION****************/
+void          sensorSampleReady(void);      // interrupt context (main context at pin event enable), new sample in FIFO
+
+#endif
@@ -7,41 +7,221 @@
 #include "stdbool.h"
 
 #include "orderProcessing.h"
+#include "systemTime.h"
 
 #define ORDER_CLEAR_BYTE  0xFF
-#define ORDER_ITEM_FREE   0xFFFF
 #define ORDER_HEAP_ITEM_FREE       0xFF
 #define ORDER_HEAP_ITEM_BUSY       0x00
 #define ORDER_FLASH_DATA_VALIDATOR 0xAABBCCDD
+#define ORDER_FLASH_VERSION        1
+
+#if ORDER_ITEM_QUANTITY < 0xFF
+typedef uint8_t  orderSlotT;
+#define ORDER_SLOT_NONE   0xFF
+#else
+typedef uint16_t orderSlotT;
+#define ORDER_SLOT_NONE   0xFFFF
+#endif
 
 
 typedef struct order
 {
-    uint16_t order[ORDER_ITEM_QUANTITY];
+    orderSlotT slotByPeer[ORDER_PEER_ID_QUANTITY];   // slot of peer ID or ORDER_SLOT_NONE
+    uint16_t   item[ORDER_ITEM_QUANTITY];            // peer ID stored in slot
+    orderSlotT prev[ORDER_ITEM_QUANTITY];            // toward first (most recently used)
+    orderSlotT next[ORDER_ITEM_QUANTITY];            // toward last
+    uint16_t   score[ORDER_ITEM_QUANTITY];           // decayed usage score of slot
+    orderSlotT rankSlot[ORDER_ITEM_QUANTITY];        // slots from highest score to lowest
+    orderSlotT rankPos[ORDER_ITEM_QUANTITY];         // rank position of slot
+    orderSlotT first;
+    orderSlotT last;
+    uint16_t   quantity;
 } deviceOrderS;
 
+typedef struct
+{
+    uint32_t validator;
+    uint16_t version;
+    uint16_t itemQuantity;                           // quantity of item and score fields, capacity of writer
+} orderFlashHeaderS;
+
+typedef struct
+{
+    orderFlashHeaderS header;
+    uint16_t item[ORDER_ITEM_QUANTITY];
+    uint16_t score[ORDER_ITEM_QUANTITY];
+} orderFlashImageS;
+
+typedef struct
+{
+    orderFlashImageS image;          // last image written to (or read from) flash
+    uint32_t         flashAddress;
+    bool             isDirty;
+    bool             isWriting;      // image is buffer of queued write until orderFlushDone()/orderFlushFailed()
+    timerCallbacT    flushTimer;
+} orderFlashCacheS;
+
 struct
 {
-    deviceOrderS heap[HEAP_ORDER_QUANTITY];
-    uint8_t      heapItemState[HEAP_ORDER_QUANTITY];
+    deviceOrderS     heap[HEAP_ORDER_QUANTITY];
+    orderFlashCacheS flashCache[HEAP_ORDER_QUANTITY];
+    uint8_t          heapItemState[HEAP_ORDER_QUANTITY];
 }heapDescriptor =
 {
     .heapItemState = {[0 ... HEAP_ORDER_QUANTITY - 1] = ORDER_HEAP_ITEM_FREE}
 };
 
 
-static inline bool getIDPos(orderT orderIn, uint16_t *rezPos, uint8_t inItem)
+static inline void slotUnlink(orderT orderIn, orderSlotT slot)
+{
+    orderSlotT prev = orderIn->prev[slot];
+    orderSlotT next = orderIn->next[slot];
+
+    if(prev != ORDER_SLOT_NONE)
+    {
+        orderIn->next[prev] = next;
+    }
+    else
+    {
+        orderIn->first = next;
+    }
+    if(next != ORDER_SLOT_NONE)
+    {
+        orderIn->prev[next] = prev;
+    }
+    else
+    {
+        orderIn->last = prev;
+    }
+}
+
+
+static inline void slotLinkFirst(orderT orderIn, orderSlotT slot)
+{
+    orderIn->prev[slot] = ORDER_SLOT_NONE;
+    orderIn->next[slot] = orderIn->first;
+    if(orderIn->first != ORDER_SLOT_NONE)
+    {
+        orderIn->prev[orderIn->first] = slot;
+    }
+    else
+    {
+        orderIn->last = slot;
+    }
+    orderIn->first = slot;
+}
+
+
+static inline void slotLinkLast(orderT orderIn, orderSlotT slot)
 {
-    for(uint16_t cnt = 0; cnt < ORDER_ITEM_QUANTITY; cnt++ )
+    orderIn->next[slot] = ORDER_SLOT_NONE;
+    orderIn->prev[slot] = orderIn->last;
+    if(orderIn->last != ORDER_SLOT_NONE)
     {
-        if( inItem != orderIn->order[cnt])
+        orderIn->next[orderIn->last] = slot;
+    }
+    else
+    {
+        orderIn->first = slot;
+    }
+    orderIn->last = slot;
+}
+
+
+// slot for new item: next unused one while list isn't full, else slot of rank last item; slot stays rank last
+static inline orderSlotT slotTake(orderT orderIn)
+{
+    orderSlotT slot;
+
+    if(orderIn->quantity < ORDER_ITEM_QUANTITY)
+    {
+        slot = orderIn->quantity++;
+        orderIn->rankSlot[slot] = slot;
+        orderIn->rankPos[slot]  = slot;
+    }
+    else
+    {
+        slot = orderIn->rankSlot[ORDER_ITEM_QUANTITY - 1];
+        slotUnlink(orderIn, slot);
+        orderIn->slotByPeer[orderIn->item[slot]] = ORDER_SLOT_NONE;
+    }
+    orderIn->score[slot] = 0;
+    return slot;
+}
+
+
+/* move slot toward rank first after its score was increased, other slots keep relative order.
+ * isRecent - slot was just moved to front, it goes ahead of equal scores too.
+*/
+static void rankRaise(orderT orderIn, orderSlotT slot, bool isRecent)
+{
+    uint16_t pos   = orderIn->rankPos[slot];
+    uint16_t score = orderIn->score[slot];
+
+    for(; pos > 0; pos--)
+    {
+        orderSlotT prev = orderIn->rankSlot[pos - 1];
+        if(orderIn->score[prev] > score || (orderIn->score[prev] == score && !isRecent))
         {
-            continue;
+            break;
         }
-        *rezPos = cnt;
-        return true;
+        orderIn->rankSlot[pos] = prev;
+        orderIn->rankPos[prev] = pos;
     }
-    return false;
+    orderIn->rankSlot[pos] = slot;
+    orderIn->rankPos[slot] = pos;
+}
+
+
+/* insertion sort of slots by score walking from most recently used, so equal scores keep recency order.
+ * Called only when order is loaded, changes move one slot by rankRaise().
+*/
+static void rankUpdate(orderT orderIn)
+{
+    uint16_t   cnt = 0;
+    orderSlotT slot;
+
+    for(slot = orderIn->first; slot != ORDER_SLOT_NONE; slot = orderIn->next[slot], cnt++)
+    {
+        uint16_t pos = cnt;
+        for(; pos > 0 && orderIn->score[orderIn->rankSlot[pos - 1]] < orderIn->score[slot]; pos--)
+        {
+            orderIn->rankSlot[pos] = orderIn->rankSlot[pos - 1];
+        }
+        orderIn->rankSlot[pos] = slot;
+    }
+    for(cnt = 0; cnt < orderIn->quantity; cnt++)
+    {
+        orderIn->rankPos[orderIn->rankSlot[cnt]] = cnt;
+    }
+}
+
+
+static inline orderFlashCacheS *getFlashCache(const orderT orderIn)
+{
+    return &heapDescriptor.flashCache[orderIn - heapDescriptor.heap];
+}
+
+
+static void imageMake(const orderT orderIn, orderFlashImageS *image)
+{
+    orderSlotT slot = orderIn->first;
+
+    memset(image, ORDER_CLEAR_BYTE, sizeof(*image));
+    image->header.validator    = ORDER_FLASH_DATA_VALIDATOR;
+    image->header.version      = ORDER_FLASH_VERSION;
+    image->header.itemQuantity = ORDER_ITEM_QUANTITY;
+    for(uint16_t cnt = 0; slot != ORDER_SLOT_NONE; cnt++, slot = orderIn->next[slot])
+    {
+        image->item[cnt]  = orderIn->item[slot];
+        image->score[cnt] = orderIn->score[slot];
+    }
+}
+
+
+static void orderFlushCB(void *context)
+{
+    orderFlush((orderT)context);
 }
 
 
@@ -54,7 +234,15 @@ orderT orderMalloc(void)
             continue;
         }
         heapDescriptor.heapItemState[cnt] = ORDER_HEAP_ITEM_BUSY;
-        memset(heapDescriptor.heap[cnt].order, ORDER_CLEAR_BYTE, sizeof(heapDescriptor.heap[cnt].order));
+        orderClean(&heapDescriptor.heap[cnt]);
+        // timer is kept by heap item, systemTime has no free of callbacks
+        if(heapDescriptor.flashCache[cnt].flushTimer == NULL)
+        {
+            heapDescriptor.flashCache[cnt].flushTimer = timerGetCallback(orderFlushCB, &heapDescriptor.heap[cnt]);
+        }
+        heapDescriptor.flashCache[cnt].isDirty   = false;
+        heapDescriptor.flashCache[cnt].isWriting = false;
+        memset(&heapDescriptor.flashCache[cnt].image, ORDER_CLEAR_BYTE, sizeof(heapDescriptor.flashCache[cnt].image));
         return &heapDescriptor.heap[cnt];
     }
     return NULL;
@@ -68,6 +256,7 @@ bool orderFree(orderT orderIn)
         {
             continue;
         }
+        orderFlush(orderIn);
         heapDescriptor.heapItemState[cnt] = ORDER_HEAP_ITEM_FREE;
         return true;
     }
@@ -75,77 +264,341 @@ bool orderFree(orderT orderIn)
 }
 
 
+// recency only, new item is rank last with zero score
+static orderSlotT itemToFront(orderT orderIn, uint8_t inItem)
+{
+    orderSlotT slot = orderIn->slotByPeer[inItem];
+
+    if(slot == orderIn->first && slot != ORDER_SLOT_NONE)
+    {
+        return slot;
+    }
+    if(slot != ORDER_SLOT_NONE)
+    {
+        slotUnlink(orderIn, slot);
+    }
+    else
+    {
+        slot = slotTake(orderIn);
+        orderIn->item[slot]        = inItem;
+        orderIn->slotByPeer[inItem] = slot;
+    }
+    slotLinkFirst(orderIn, slot);
+    return slot;
+}
+
+
 bool orderSetFirst (orderT orderIn, uint8_t inItem)
 {
-    uint16_t currentPos;
     if( orderIn == NULL)
     {
         return false;
     }
-    if( !getIDPos(orderIn, &currentPos, inItem))
+    rankRaise(orderIn, itemToFront(orderIn, inItem), true);
+    return true;
+}
+
+
+// decay keeps order of scores (equal ones stay in rank order), only connected slot moves in rank
+void orderUsageConnect(orderT orderIn, uint8_t inItem)
+{
+    orderSlotT slot = itemToFront(orderIn, inItem);
+
+    for(orderSlotT cnt = 0; cnt < orderIn->quantity; cnt++)
     {
-        currentPos = ORDER_ITEM_QUANTITY - 1;
+        orderIn->score[cnt] -= orderIn->score[cnt] >> ORDER_RANK_DECAY_SHIFT;
     }
-    if(currentPos == 0)
+    if(orderIn->score[slot] > ORDER_RANK_SCORE_MAX - ORDER_RANK_CONNECT_WEIGHT)
     {
-        return true;
+        orderIn->score[slot] = ORDER_RANK_SCORE_MAX;
     }
-    for(; currentPos > 0; currentPos--)
+    else
     {
-        orderIn->order[currentPos] = orderIn->order[currentPos - 1];
+        orderIn->score[slot] += ORDER_RANK_CONNECT_WEIGHT;
     }
-    orderIn->order[0] = inItem;
+    rankRaise(orderIn, slot, true);
+}
+
+
+void orderUsageDisconnect(orderT orderIn, uint8_t inItem, uint32_t connectedTimeMs)
+{
+    orderSlotT slot = orderIn->slotByPeer[inItem];
+    uint32_t   minutes = connectedTimeMs / 60000;
+    uint32_t   score;
+
+    if(slot == ORDER_SLOT_NONE)
+    {
+        return;
+    }
+    if(minutes > ORDER_RANK_MINUTE_MAX)
+    {
+        minutes = ORDER_RANK_MINUTE_MAX;
+    }
+    score = orderIn->score[slot] + minutes * ORDER_RANK_MINUTE_WEIGHT;
+    orderIn->score[slot] = (score > ORDER_RANK_SCORE_MAX) ? ORDER_RANK_SCORE_MAX : score;
+    rankRaise(orderIn, slot, false);
+}
+
+
+bool orderGetRankPos(const orderT orderIn, uint8_t deviceID, uint8_t *pos)
+{
+    orderSlotT slot = orderIn->slotByPeer[deviceID];
+
+    if(slot == ORDER_SLOT_NONE)
+    {
+        return false;
+    }
+    *pos = orderIn->rankPos[slot];
     return true;
 }
 
 
+uint16_t orderGetRankItem(const orderT orderIn, uint8_t pos)
+{
+    if(pos >= orderIn->quantity)
+    {
+        return ORDER_ITEM_FREE;
+    }
+    return orderIn->item[orderIn->rankSlot[pos]];
+}
+
+
+uint16_t orderGetScore(const orderT orderIn, uint8_t deviceID)
+{
+    orderSlotT slot = orderIn->slotByPeer[deviceID];
+    return (slot == ORDER_SLOT_NONE) ? 0 : orderIn->score[slot];
+}
+
+
+bool orderIsContain(const orderT orderIn, uint8_t deviceID)
+{
+    return orderIn->slotByPeer[deviceID] != ORDER_SLOT_NONE;
+}
+
+
+// position is distance from first item, so it costs walk over the list
 bool orderGetPos(const orderT orderIn, uint8_t deviceID, uint8_t *pos)
 {
-    for(uint16_t cnt = 0; cnt < ORDER_ITEM_QUANTITY; cnt++)
+    orderSlotT slot = orderIn->slotByPeer[deviceID];
+    uint8_t    cnt  = 0;
+
+    if(slot == ORDER_SLOT_NONE)
     {
-        if(orderIn->order[cnt] != deviceID)
-        {
-            continue;
-        }
-        *pos = cnt;
-        return true;
+        return false;
     }
-    return false;
+    for(; slot != orderIn->first; slot = orderIn->prev[slot])
+    {
+        cnt++;
+    }
+    *pos = cnt;
+    return true;
 }
 
 uint16_t orderGetItem(const orderT orderIn, uint8_t pos)
 {
-    return orderIn->order[pos];
+    orderSlotT slot = orderIn->first;
+
+    if(pos >= orderIn->quantity)
+    {
+        return ORDER_ITEM_FREE;
+    }
+    for(; pos > 0; pos--)
+    {
+        slot = orderIn->next[slot];
+    }
+    return orderIn->item[slot];
+}
+
+
+uint16_t orderGetQuantity(const orderT orderIn)
+{
+    return orderIn->quantity;
 }
 
 
-uint8_t orderGetQuantity(const orderT orderIn)
+void orderClean(orderT orderIn)
 {
-    for(uint16_t cnt = 0; cnt < ORDER_ITEM_QUANTITY; cnt++)
+    memset(orderIn->slotByPeer, ORDER_CLEAR_BYTE, sizeof(orderIn->slotByPeer));
+    memset(orderIn->item, ORDER_CLEAR_BYTE, sizeof(orderIn->item));
+    memset(orderIn->score, 0, sizeof(orderIn->score));
+    orderIn->first    = ORDER_SLOT_NONE;
+    orderIn->last     = ORDER_SLOT_NONE;
+    orderIn->quantity = 0;
+}
+
+
+static void itemAddLast(orderT orderIn, uint16_t item, uint16_t score)
+{
+    orderSlotT slot;
+
+    if(item >= ORDER_PEER_ID_QUANTITY || orderIn->slotByPeer[item] != ORDER_SLOT_NONE) // duplicate in damaged image
     {
-        if(orderIn->order[cnt] == ORDER_ITEM_FREE)
-        {
-            return cnt;
-        }
+        return;
     }
-    return ORDER_ITEM_QUANTITY;
+    slot = orderIn->quantity++;
+    orderIn->item[slot]       = item;
+    orderIn->score[slot]      = (score > ORDER_RANK_SCORE_MAX) ? 0 : score;
+    orderIn->slotByPeer[item] = slot;
+    slotLinkLast(orderIn, slot);
 }
 
 
-void orderClean(orderT orderIn)
+/* image is parsed directly in flash. Other capacity of writer is allowed: extra items are dropped.
+ * Image without validator is plain array of peer IDs written by former firmware, it has no scores.
+*/
+static void imageParse(orderT orderIn, const uint8_t *data, uint32_t size)
 {
-    memset(orderIn->order, ORDER_CLEAR_BYTE, sizeof(orderIn->order));
+    const orderFlashHeaderS *header = (const orderFlashHeaderS *)data;
+    const uint16_t          *item;
+    const uint16_t          *score = NULL;
+    uint32_t                 quantity;
+
+    if(size >= sizeof(*header) && header->validator == ORDER_FLASH_DATA_VALIDATOR)
+    {
+        if(header->version != ORDER_FLASH_VERSION ||
+           size < sizeof(*header) + 2 * header->itemQuantity * sizeof(uint16_t))
+        {
+            return;
+        }
+        item     = (const uint16_t *)(header + 1);
+        score    = item + header->itemQuantity;
+        quantity = header->itemQuantity;
+    }
+    else
+    {
+        item     = (const uint16_t *)data;
+        quantity = size / sizeof(uint16_t);
+    }
+    for(uint32_t cnt = 0; cnt < quantity && orderIn->quantity < ORDER_ITEM_QUANTITY; cnt++)
+    {
+        if(item[cnt] == ORDER_ITEM_FREE)
+        {
+            break;
+        }
+        itemAddLast(orderIn, item[cnt], (score != NULL) ? score[cnt] : 0);
+    }
 }
 
 
 bool orderReadFlash(orderT orderIn, uint32_t  flashAddress)
 {
-    flashMemReadBytes(flashAddress, (uint8_t*)orderIn->order, sizeof(orderIn->order));
-   return true;
+    orderFlashCacheS *cache = getFlashCache(orderIn);
+    const uint8_t    *data;
+    uint32_t          size;
+
+    cache->flashAddress = flashAddress;
+    cache->isDirty      = false;
+    if(cache->flushTimer != NULL)
+    {
+        timerStop(cache->flushTimer);
+    }
+    orderClean(orderIn);
+    data = flashMemOpen(flashAddress, &size);
+    if(data != NULL)
+    {
+        imageParse(orderIn, data, size);
+        flashMemClose(flashAddress);
+    }
+    rankUpdate(orderIn);
+    // flash content as it is seen by this firmware, unchanged order isn't written back
+    imageMake(orderIn, &cache->image);
+    return data != NULL;
 }
 
 
+// write-behind: every call restarts quiet time, burst of changes gives one flash write
 void orderWriteFlash(orderT orderIn, uint32_t flashAddress)
 {
-    flashMemWriteBytes(flashAddress, (uint8_t*)orderIn->order, sizeof(orderIn->order));
+    orderFlashCacheS *cache = getFlashCache(orderIn);
+    orderFlashImageS  image;
+
+    imageMake(orderIn, &image);
+    cache->flashAddress = flashAddress;
+    if(memcmp(&image, &cache->image, sizeof(image)) == 0)
+    {
+        // back to flash content
+        cache->isDirty = false;
+        timerStop(cache->flushTimer);
+        return;
+    }
+    cache->isDirty = true;
+    timerRun(cache->flushTimer, ORDER_FLUSH_QUIET_TIME);
+}
+
+
+// returns true if write was started (queued), on error order stays dirty and write is retried
+bool orderFlush(orderT orderIn)
+{
+    orderFlashCacheS *cache = getFlashCache(orderIn);
+    orderFlashImageS  written;
+
+    if(!cache->isDirty)
+    {
+        return false;
+    }
+    if(cache->isWriting)
+    {
+        // FDS still reads image of queued write, it is changed only after write event
+        timerRun(cache->flushTimer, ORDER_FLUSH_RETRY_TIME);
+        return false;
+    }
+    // image is buffer of asynchronous write, it becomes flash content only when write is queued
+    written = cache->image;
+    imageMake(orderIn, &cache->image);
+    if(flashMemWriteBytes(cache->flashAddress, (uint8_t*)&cache->image, sizeof(cache->image)) != NRF_SUCCESS)
+    {
+        cache->image = written;
+        timerRun(cache->flushTimer, ORDER_FLUSH_RETRY_TIME);
+        return false;
+    }
+    timerStop(cache->flushTimer);
+    cache->isDirty   = false;
+    cache->isWriting = true;
+    return true;
+}
+
+
+// queued write is over, image buffer is free
+void orderFlushDone(orderT orderIn)
+{
+    getFlashCache(orderIn)->isWriting = false;
+}
+
+
+// queued write is failed: flash content is unknown, order is written again
+void orderFlushFailed(orderT orderIn)
+{
+    orderFlashCacheS *cache = getFlashCache(orderIn);
+
+    memset(&cache->image, ORDER_CLEAR_BYTE, sizeof(cache->image));
+    cache->isDirty   = true;
+    cache->isWriting = false;
+    timerRun(cache->flushTimer, ORDER_FLUSH_RETRY_TIME);
+}
+
+
+// returns true if some write is started or still queued, its write event is to wait for
+bool orderFlushAll(void)
+{
+    bool isWrite = false;
+
+    for(uint8_t cnt = 0; cnt < HEAP_ORDER_QUANTITY; cnt++)
+    {
+        if(heapDescriptor.heapItemState[cnt] != ORDER_HEAP_ITEM_BUSY)
+        {
+            continue;
+        }
+        (void)orderFlush(&heapDescriptor.heap[cnt]);
+        if(heapDescriptor.flashCache[cnt].isWriting)
+        {
+            isWrite = true;
+        }
+    }
+    return isWrite;
+}
+
+
+bool orderIsDirty(const orderT orderIn)
+{
+    return getFlashCache(orderIn)->isDirty;
 }
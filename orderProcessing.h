@@ -1,5 +1,24 @@
 /*file: orderProcessing.h
  *
+ * Most recently used order of peer IDs.
+ * List is doubly linked over fixed slots, slot of each peer ID is kept in table indexed by peer ID,
+ * so move to front (orderSetFirst) and membership lookup are O(1) for any capacity.
+ * Besides recency each item has usage score: every connection decays all scores and adds
+ * ORDER_RANK_CONNECT_WEIGHT to connected peer, every disconnection adds weight of connected time.
+ * Rank is order by score, changed item moves only past lower scores (and equal ones when it is moved to
+ * front), so equal scores are in recency order except ties made by decay. Rank last item is replaced
+ * when list is full.
+ * Capacity and heap size are compile time parameters, may be redefined from project options.
+ * Flash write is write-behind: orderWriteFlash() only marks order dirty, image is written by
+ * flashMemWriteBytes() after ORDER_FLUSH_QUIET_TIME without new changes or by orderFlush()/orderFlushAll()
+ * (shutdown), write is skipped when image is equal to the last written/read one.
+ * Write that isn't queued (flashMemWriteBytes() error) or fails later (orderFlushFailed()) leaves order dirty,
+ * it is written again after ORDER_FLUSH_RETRY_TIME. Image given to flashMemWriteBytes() is kept unchanged until
+ * write event of flash (orderFlushDone() or orderFlushFailed()), flush of order changed meanwhile is retried
+ * after ORDER_FLUSH_RETRY_TIME.
+ * Flash image: header (ORDER_FLASH_DATA_VALIDATOR, ORDER_FLASH_VERSION, item quantity), peer IDs from first
+ * to last, scores. It is parsed in place through const view given by flashMemOpen(), without copy to RAM.
+ * Image without validator is former plain array of peer IDs.
 */
 
 #ifndef ORDERPROCESSING
@@ -8,24 +27,63 @@
 #include "stdint.h"
 #include "stdbool.h"
 
-#define ORDER_ITEM_QUANTITY  5
-#define HEAP_ORDER_QUANTITY  2
+#include "sdk_errors.h"
+
+#ifndef ORDER_ITEM_QUANTITY
+#define ORDER_ITEM_QUANTITY    5       // <= ORDER_PEER_ID_QUANTITY
+#endif
+#ifndef HEAP_ORDER_QUANTITY
+#define HEAP_ORDER_QUANTITY    2
+#endif
+#define ORDER_PEER_ID_QUANTITY 256     // equal PM_PEER_ID_N_AVAILABLE_IDS
+#define ORDER_ITEM_FREE        0xFFFF
+
+#ifndef ORDER_RANK_DECAY_SHIFT
+#define ORDER_RANK_DECAY_SHIFT      3      // score -= score/8 on each connection
+#endif
+#define ORDER_RANK_CONNECT_WEIGHT   1024
+#define ORDER_RANK_MINUTE_WEIGHT    4      // per minute of connected time
+#define ORDER_RANK_MINUTE_MAX       240    // longer connections count as 4 hours
+#define ORDER_RANK_SCORE_MAX        0xFFFE
+
+#ifndef ORDER_FLUSH_QUIET_TIME
+#define ORDER_FLUSH_QUIET_TIME      3000   // ms
+#endif
+#ifndef ORDER_FLUSH_RETRY_TIME
+#define ORDER_FLUSH_RETRY_TIME      1000   // ms, after write error
+#endif
+
+#if (ORDER_ITEM_QUANTITY == 0) || (ORDER_ITEM_QUANTITY > ORDER_PEER_ID_QUANTITY)
+#error "ORDER_ITEM_QUANTITY out of range"
+#endif
 
 typedef struct order *orderT;
 
 orderT   orderMalloc     (void);
 bool     orderFree       (orderT orderIn);
 bool     orderSetFirst   (orderT orderIn, uint8_t inItem);
+bool     orderIsContain  (const orderT orderIn, uint8_t deviceID);
 bool     orderGetPos     (const orderT orderIn, uint8_t deviceID,  uint8_t *pos);
 uint16_t orderGetItem    (const orderT orderIn, uint8_t pos);
-uint8_t  orderGetQuantity(const orderT orderIn);
+uint16_t orderGetQuantity(const orderT orderIn);
+void     orderUsageConnect   (orderT orderIn, uint8_t inItem);
+void     orderUsageDisconnect(orderT orderIn, uint8_t inItem, uint32_t connectedTimeMs);
+bool     orderGetRankPos (const orderT orderIn, uint8_t deviceID,  uint8_t *pos);
+uint16_t orderGetRankItem(const orderT orderIn, uint8_t pos);
+uint16_t orderGetScore   (const orderT orderIn, uint8_t deviceID);
 void     orderClean      (orderT orderIn);
 bool     orderReadFlash  (orderT orderIn, uint32_t  flashAddress);
 void     orderWriteFlash (orderT orderIn, uint32_t flashAddress);
+bool     orderFlush      (orderT orderIn);
+bool     orderFlushAll   (void);
+void     orderFlushDone  (orderT orderIn);
+void     orderFlushFailed(orderT orderIn);
+bool     orderIsDirty    (const orderT orderIn);
 
 
 /*********USER IMPLEMENTED FUNCTION****************/
-void flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize);
-void flashMemReadBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize);
+ret_code_t     flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize); // NRF_SUCCESS - queued
+const uint8_t *flashMemOpen (uint32_t flashAddress, uint32_t *size);  // word aligned data or NULL
+void           flashMemClose(uint32_t flashAddress);
 
 #endif
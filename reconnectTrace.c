@@ -0,0 +1,68 @@
+/*file: reconnectTrace.c
+ *
+*/
+
+#include "stdint.h"
+#include "string.h"
+#include "stdbool.h"
+
+#include "reconnectTrace.h"
+#include "systemTime.h"
+
+#define TRACE_INDEX_MASK   (TRACE_ITEM_QUANTITY - 1)
+
+_Static_assert((TRACE_ITEM_QUANTITY & TRACE_INDEX_MASK) == 0, "TRACE_ITEM_QUANTITY must be power of 2");
+
+
+static struct
+{
+    traceItemT item[TRACE_ITEM_QUANTITY];
+    uint32_t   wrPos;
+    uint32_t   rdPos;
+    uint32_t   lost;
+    uint8_t    seq;
+}traceBuffer;
+
+
+void reconnectTraceInit(void)
+{
+    memset(&traceBuffer, 0, sizeof(traceBuffer));
+}
+
+
+void reconnectTraceAdd(tracePhaseT phase, uint16_t peerId)
+{
+    traceItemT *item;
+
+    if((traceBuffer.wrPos - traceBuffer.rdPos) >= TRACE_ITEM_QUANTITY)
+    {
+        // overwrite oldest item, latest transitions more important
+        traceBuffer.rdPos++;
+        traceBuffer.lost++;
+    }
+    item         = &traceBuffer.item[traceBuffer.wrPos & TRACE_INDEX_MASK];
+    item->time   = getTime();
+    item->peerId = peerId;
+    item->phase  = (uint8_t)phase;
+    item->seq    = traceBuffer.seq++;
+    traceBuffer.wrPos++;
+}
+
+
+uint32_t reconnectTraceRead(traceItemT items[], uint32_t itemsMaxQuantity)
+{
+    uint32_t cnt = 0;
+
+    for(; (cnt < itemsMaxQuantity) && (traceBuffer.rdPos != traceBuffer.wrPos); cnt++)
+    {
+        items[cnt] = traceBuffer.item[traceBuffer.rdPos & TRACE_INDEX_MASK];
+        traceBuffer.rdPos++;
+    }
+    return cnt;
+}
+
+
+uint32_t reconnectTraceGetLost(void)
+{
+    return traceBuffer.lost;
+}
@@ -0,0 +1,44 @@
+/*file: reconnectTrace.h
+ *
+ * Reconnect latency trace: timestamp of each phase transition of reconnect process stored in RAM ring buffer.
+ * Log backend drop messages under load, so trace read out in bulk by reconnectTraceRead()
+ * (or directly from traceBuffer by debugger). main.c dumps it to log on shutdown, test/reconnectTraceDecode
+ * turns captured log into per-phase latency histograms.
+ * All functions should be called from main context (SoftDevice events dispatched through app_scheduler).
+*/
+
+#ifndef RECONNECTTRACE_H_
+#define RECONNECTTRACE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#define TRACE_ITEM_QUANTITY   64      // must be power of 2
+#define TRACE_PEER_NONE       0xFFFF
+
+typedef enum
+{
+    TRACE_POWER_ON,
+    TRACE_SCAN_START,
+    TRACE_FIRST_BONDED_CONNECTED,     // first PM_EVT_BONDED_PEER_CONNECTED on scan phase
+    TRACE_SCAN_STOP,
+    TRACE_WHITELIST_SWITCH,           // switch white list on connect phase
+    TRACE_CONN_SEC_SUCCEEDED,
+    TRACE_PHASE_QUANTITY,
+}tracePhaseT;
+
+typedef struct
+{
+    uint32_t time;                    // getTime(), ms
+    uint16_t peerId;
+    uint8_t  phase;                   // tracePhaseT
+    uint8_t  seq;                     // sequence number, detect overwritten items on dump
+}traceItemT;
+
+
+void     reconnectTraceInit   (void);
+void     reconnectTraceAdd    (tracePhaseT phase, uint16_t peerId);
+uint32_t reconnectTraceRead   (traceItemT items[], uint32_t itemsMaxQuantity);
+uint32_t reconnectTraceGetLost(void);
+
+#endif
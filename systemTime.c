@@ -1,87 +1,300 @@
 /*file: systemTime.c
  *
+ * Tickless scheduler: RTC run from LFCLK, compare channel programmed to the earliest armed deadline,
+ * so CPU wake up only when callback actually due (and on counter overflow each 512 s).
+ * getTime() derived from the counter on demand.
+ * Armed callbacks kept in binary min-heap keyed on deadline, ISR check only the head.
+ * Expired callbacks passed from ISR to main loop through lock-free FIFO (nrf_atfifo), each item is
+ * slot index + arm generation, so callback re-armed or stopped after expiry is not called with stale event.
 */
 #include "stdint.h"
+#include "stdbool.h"
 #include "systemTime.h"
 
 #include "nrf.h"
-#include "nrf_timer.h"
+#include "nrf_rtc.h"
+#include "nrf_atfifo.h"
 
-#define TIMER_INT_MS   1
+#define RTC_FREQUENCY       32768
+#define RTC_COUNTER_MASK    0x00FFFFFF
+#define RTC_MIN_DELTA       2             // CC closer than 2 ticks to COUNTER may not trigger COMPARE event
+#define RTC_MAX_DELTA       0x007FFFFF    // half of the counter range, longer deadlines reprogrammed on the next compare
+#define RTC_MAX_DELTA_MS    100000        // less than RTC_MAX_DELTA, ms * RTC_FREQUENCY fit in 32 bit
+#define RTC_CC_CHANNEL      0
 
+#define TICKS_TO_MS(X)      (((X) * 1000) >> 15)
 
-static volatile uint32_t cntMs;
-static bool              isNewTick = false;
+#define HEAP_POS_NONE       0xFF
+#define HEAP_PARENT(X)      (((X) - 1) / 2)
+#define HEAP_LEFT(X)        (2 * (X) + 1)
+
+// wraparound-safe compare of deadlines (valid while deadlines are closer than 2^31 ms)
+#define TIME_BEFORE(A, B)   ((int32_t)((A) - (B)) < 0)
+
+#define EXPIRED_QUANTITY    (2 * CALLBACK_QUANTITY)   // periodic callback can expire again before main loop drain queue
+#define EXPIRED_GEN_MASK          0x00FFFFFF                // arm/stop changes before queued event is taken for stale one
+#define EXPIRED_ITEM(SLOT, GEN)   ((((GEN) & EXPIRED_GEN_MASK) << 8) | (SLOT))
+#define EXPIRED_ITEM_SLOT(X)      ((uint8_t)((X) & 0xFF))
+#define EXPIRED_ITEM_GEN(X)       ((X) >> 8)
+
+
+static volatile uint32_t overflowCnt;
+static volatile uint32_t expiredLostCnt;
+
+NRF_ATFIFO_DEF(expiredFifo, uint32_t, EXPIRED_QUANTITY);
 
 static volatile struct timerCallback
 {
      timerCallbackFunT fun;
+     void              *context;
      uint32_t          timeCallback;
-     bool              runCallback;
+     uint32_t          period;               // 0 - one-shot
+     uint32_t          generation;           // changed on each arm/stop, invalidate queued expired events
+     uint8_t           heapPos;
      bool              waiteCallback;
 } timerCallbackHeap[CALLBACK_QUANTITY];
 
 bool isCallbackFree[CALLBACK_QUANTITY] = {[0 ... CALLBACK_QUANTITY - 1] = true};
 
+// min-heap of armed callbacks (index in timerCallbackHeap), deadlineHeap[0] - earliest deadline
+static volatile uint8_t deadlineHeap[CALLBACK_QUANTITY];
+static volatile uint8_t deadlineHeapSize;
+
+_Static_assert(CALLBACK_QUANTITY < HEAP_POS_NONE, "CALLBACK_QUANTITY too big for heap position");
 
-const uint32_t timFrqList[]=
+
+static uint64_t getTicks(void)
 {
-    [NRF_TIMER_FREQ_16MHz]    = 16000000, ///< Timer frequency 16 MHz.
-    [NRF_TIMER_FREQ_8MHz]     = 8000000,  ///< Timer frequency 8 MHz.
-    [NRF_TIMER_FREQ_4MHz]     = 4000000,  ///< Timer frequency 4 MHz.
-    [NRF_TIMER_FREQ_2MHz]     = 2000000,  ///< Timer frequency 2 MHz.
-    [NRF_TIMER_FREQ_1MHz]     = 1000000,  ///< Timer frequency 1 MHz.
-    [NRF_TIMER_FREQ_500kHz]   = 500000,   ///< Timer frequency 500 kHz.
-    [NRF_TIMER_FREQ_250kHz]   = 250000,   ///< Timer frequency 250 kHz.
-    [NRF_TIMER_FREQ_125kHz]   = 125000,   ///< Timer frequency 125 kHz.
-    [NRF_TIMER_FREQ_62500Hz]  = 62500,    ///< Timer frequency 62500 Hz.
-    [NRF_TIMER_FREQ_31250Hz]  = 31250     ///< Timer frequency 31250 Hz.
-};
+    uint32_t ovfRead;
+    uint32_t ovf;
+    uint32_t cnt;
 
+    do
+    {
+        ovfRead = overflowCnt;
+        ovf     = ovfRead;
+        cnt     = nrf_rtc_counter_get(USER_SCHEDULER_RTC);
+        // overflow was happened but interrupt not processed yet (called with masked interrupt)
+        if(nrf_rtc_event_pending(USER_SCHEDULER_RTC, NRF_RTC_EVENT_OVERFLOW))
+        {
+            ovf++;
+            cnt = nrf_rtc_counter_get(USER_SCHEDULER_RTC);
+        }
+    } while(ovfRead != overflowCnt);
 
-void initUserTimer(void)
+    return ((uint64_t)ovf << 24) | cnt;
+}
+
+
+static inline void heapSet(uint8_t pos, uint8_t item)
 {
-    /*-------------Config timer for interrupt in CC---------*/
-    uint32_t valCC = (timFrqList[NRF_TIMER_FREQ_500kHz] / 1000) * TIMER_INT_MS;
-    nrf_timer_mode_set(USER_SCHEDULER_TIMER, NRF_TIMER_MODE_TIMER);
-    nrf_timer_bit_width_set(USER_SCHEDULER_TIMER, NRF_TIMER_BIT_WIDTH_16);
-    nrf_timer_frequency_set(USER_SCHEDULER_TIMER, NRF_TIMER_FREQ_500kHz);
-    nrf_timer_cc_write(USER_SCHEDULER_TIMER, NRF_TIMER_CC_CHANNEL0, valCC);
-    nrf_timer_int_enable(USER_SCHEDULER_TIMER, (0b1 << 16));
+    deadlineHeap[pos]                = item;
+    timerCallbackHeap[item].heapPos  = pos;
+}
 
-    NVIC_SetPriority(TIMER1_IRQn, 3);
-    NVIC_EnableIRQ(TIMER1_IRQn);
 
-    nrf_timer_task_trigger(USER_SCHEDULER_TIMER, NRF_TIMER_TASK_START);
+static void heapSiftUp(uint8_t pos)
+{
+    uint8_t item = deadlineHeap[pos];
+
+    while(pos > 0)
+    {
+        uint8_t parent = HEAP_PARENT(pos);
+        if(!TIME_BEFORE(timerCallbackHeap[item].timeCallback,
+                        timerCallbackHeap[deadlineHeap[parent]].timeCallback))
+        {
+            break;
+        }
+        heapSet(pos, deadlineHeap[parent]);
+        pos = parent;
+    }
+    heapSet(pos, item);
 }
 
 
-void TIMER1_IRQHandler(void)
+static void heapSiftDown(uint8_t pos)
 {
-    cntMs++;
-    nrf_timer_task_trigger(USER_SCHEDULER_TIMER, NRF_TIMER_TASK_CLEAR);
-    nrf_timer_event_clear(USER_SCHEDULER_TIMER, NRF_TIMER_EVENT_COMPARE0);
-    for(uint16_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    uint8_t item = deadlineHeap[pos];
+
+    for(;;)
     {
-        if(timerCallbackHeap[cnt].waiteCallback && (timerCallbackHeap[cnt].timeCallback <= cntMs))
+        uint8_t child = HEAP_LEFT(pos);
+        if(child >= deadlineHeapSize)
         {
-            if(timerCallbackHeap[cnt].timeCallback >= cntMs)
-            timerCallbackHeap[cnt].waiteCallback = false;
-            timerCallbackHeap[cnt].runCallback   = true;
+            break;
         }
+        if(((child + 1) < deadlineHeapSize) &&
+           TIME_BEFORE(timerCallbackHeap[deadlineHeap[child + 1]].timeCallback,
+                       timerCallbackHeap[deadlineHeap[child]].timeCallback))
+        {
+            child++;
+        }
+        if(!TIME_BEFORE(timerCallbackHeap[deadlineHeap[child]].timeCallback,
+                        timerCallbackHeap[item].timeCallback))
+        {
+            break;
+        }
+        heapSet(pos, deadlineHeap[child]);
+        pos = child;
+    }
+    heapSet(pos, item);
+}
+
 
+static void heapInsert(uint8_t item)
+{
+    heapSet(deadlineHeapSize, item);
+    deadlineHeapSize++;
+    heapSiftUp(deadlineHeapSize - 1);
+}
+
+
+static void heapRemove(uint8_t item)
+{
+    uint8_t pos = timerCallbackHeap[item].heapPos;
+
+    if(pos == HEAP_POS_NONE)
+    {
+        return;
+    }
+    timerCallbackHeap[item].heapPos = HEAP_POS_NONE;
+    deadlineHeapSize--;
+    if(pos == deadlineHeapSize)
+    {
+        return;
+    }
+    heapSet(pos, deadlineHeap[deadlineHeapSize]);
+    if((pos > 0) && TIME_BEFORE(timerCallbackHeap[deadlineHeap[pos]].timeCallback,
+                                timerCallbackHeap[deadlineHeap[HEAP_PARENT(pos)]].timeCallback))
+    {
+        heapSiftUp(pos);
+    }
+    else
+    {
+        heapSiftDown(pos);
     }
-    isNewTick = true;
+}
+
+
+/*Program compare to the earliest armed deadline. Should be called with masked scheduler interrupt*/
+static void setNextCompare(void)
+{
+    uint32_t nowMs = getTime();
+    uint32_t deltaMs = 0;
+    uint32_t deltaTicks;
+
+    if(deadlineHeapSize == 0)
+    {
+        nrf_rtc_int_disable(USER_SCHEDULER_RTC, NRF_RTC_INT_COMPARE0_MASK);
+        return;
+    }
+    if(TIME_BEFORE(nowMs, timerCallbackHeap[deadlineHeap[0]].timeCallback))
+    {
+        deltaMs = timerCallbackHeap[deadlineHeap[0]].timeCallback - nowMs;
+    }
+    // round up, callback must not be called before deadline
+    deltaTicks = (deltaMs >= RTC_MAX_DELTA_MS) ?
+                 (RTC_MAX_DELTA) :
+                 ((deltaMs * RTC_FREQUENCY + 999) / 1000);
+    if(deltaTicks < RTC_MIN_DELTA)
+    {
+        deltaTicks = RTC_MIN_DELTA;
+    }
+    nrf_rtc_event_clear(USER_SCHEDULER_RTC, NRF_RTC_EVENT_COMPARE_0);
+    // higher priority interrupt (SoftDevice) between counter read and CC write can leave CC behind the counter and
+    // COMPARE would come only after counter wrap: counter is read again after write, deadline that is closer than
+    // RTC_MIN_DELTA by then (or passed) is set RTC_MIN_DELTA from the counter
+    for(;;)
+    {
+        uint32_t cc = (nrf_rtc_counter_get(USER_SCHEDULER_RTC) + deltaTicks) & RTC_COUNTER_MASK;
+        uint32_t ahead;
+
+        nrf_rtc_cc_set(USER_SCHEDULER_RTC, RTC_CC_CHANNEL, cc);
+        ahead = (cc - nrf_rtc_counter_get(USER_SCHEDULER_RTC)) & RTC_COUNTER_MASK;
+        if((ahead >= RTC_MIN_DELTA) && (ahead <= deltaTicks))
+        {
+            break;
+        }
+        deltaTicks = RTC_MIN_DELTA;
+    }
+    nrf_rtc_int_enable(USER_SCHEDULER_RTC, NRF_RTC_INT_COMPARE0_MASK);
+}
+
+
+void initUserTimer(void)
+{
+    /*-------------Config RTC: 32768 Hz, interrupt on overflow and compare---------*/
+    nrf_rtc_task_trigger(USER_SCHEDULER_RTC, NRF_RTC_TASK_STOP);
+    nrf_rtc_task_trigger(USER_SCHEDULER_RTC, NRF_RTC_TASK_CLEAR);
+    nrf_rtc_prescaler_set(USER_SCHEDULER_RTC, 0);
+    nrf_rtc_event_clear(USER_SCHEDULER_RTC, NRF_RTC_EVENT_OVERFLOW);
+    nrf_rtc_event_clear(USER_SCHEDULER_RTC, NRF_RTC_EVENT_COMPARE_0);
+    nrf_rtc_int_enable(USER_SCHEDULER_RTC, NRF_RTC_INT_OVERFLOW_MASK);
+
+    NRF_ATFIFO_INIT(expiredFifo);
+
+    NVIC_SetPriority(USER_SCHEDULER_IRQn, 3);
+    NVIC_ClearPendingIRQ(USER_SCHEDULER_IRQn);
+    NVIC_EnableIRQ(USER_SCHEDULER_IRQn);
+
+    // LFCLK started by SoftDevice, RTC start counting as soon as clock available
+    nrf_rtc_task_trigger(USER_SCHEDULER_RTC, NRF_RTC_TASK_START);
+}
+
+
+void RTC2_IRQHandler(void)
+{
+    uint32_t nowMs;
+    uint32_t expiredItem;
+
+    if(nrf_rtc_event_pending(USER_SCHEDULER_RTC, NRF_RTC_EVENT_OVERFLOW))
+    {
+        nrf_rtc_event_clear(USER_SCHEDULER_RTC, NRF_RTC_EVENT_OVERFLOW);
+        overflowCnt++;
+    }
+    if(!nrf_rtc_event_pending(USER_SCHEDULER_RTC, NRF_RTC_EVENT_COMPARE_0))
+    {
+        return;
+    }
+    nrf_rtc_event_clear(USER_SCHEDULER_RTC, NRF_RTC_EVENT_COMPARE_0);
+    nowMs = getTime();
+    while(deadlineHeapSize > 0)
+    {
+        uint8_t item = deadlineHeap[0];
+        if(TIME_BEFORE(nowMs, timerCallbackHeap[item].timeCallback))
+        {
+            break;
+        }
+        heapRemove(item);
+        expiredItem = EXPIRED_ITEM(item, timerCallbackHeap[item].generation);
+        if(nrf_atfifo_alloc_put(expiredFifo, &expiredItem, sizeof(expiredItem), NULL) != NRF_SUCCESS)
+        {
+            expiredLostCnt++;
+        }
+        if(timerCallbackHeap[item].period == 0)
+        {
+            timerCallbackHeap[item].waiteCallback = false;
+            continue;
+        }
+        // periodic: next deadline from previous one, no drift
+        timerCallbackHeap[item].timeCallback += timerCallbackHeap[item].period;
+        if(TIME_BEFORE(timerCallbackHeap[item].timeCallback, nowMs))
+        {
+            timerCallbackHeap[item].timeCallback = nowMs + timerCallbackHeap[item].period;
+        }
+        heapInsert(item);
+    }
+    setNextCompare();
 }
 
 
 uint32_t getTime(void)
 {
-    return cntMs;
+    return (uint32_t)TICKS_TO_MS(getTicks());
 }
 
 
-timerCallbacT timerGetCallback(timerCallbackFunT timerCallbackFun)
+timerCallbacT timerGetCallback(timerCallbackFunT timerCallbackFun, void *context)
 {
     for(uint16_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt ++)
     {
@@ -91,37 +304,74 @@ timerCallbacT timerGetCallback(timerCallbackFunT timerCallbackFun)
         }
         isCallbackFree[cnt]                  = false;
         timerCallbackHeap[cnt].fun           = timerCallbackFun;
-        timerCallbackHeap[cnt].runCallback   = false;
+        timerCallbackHeap[cnt].context       = context;
+        timerCallbackHeap[cnt].generation++;
         timerCallbackHeap[cnt].waiteCallback = false;
+        timerCallbackHeap[cnt].period        = 0;
+        timerCallbackHeap[cnt].heapPos       = HEAP_POS_NONE;
         return &timerCallbackHeap[cnt];
     }
     return NULL;
 }
 
 
-void timerRun(timerCallbacT inTimerCallbac, int32_t waitTime)
+static void timerArm(timerCallbacT inTimerCallbac, int32_t waitTime, uint32_t period)
 {
-    inTimerCallbac->timeCallback  = cntMs + waitTime;
-    inTimerCallbac->runCallback   = false;
+    uint8_t item = inTimerCallbac - timerCallbackHeap;
+
+    NVIC_DisableIRQ(USER_SCHEDULER_IRQn);
+    heapRemove(item);
+    inTimerCallbac->timeCallback  = getTime() + waitTime;
+    inTimerCallbac->period        = period;
+    inTimerCallbac->generation++;
     inTimerCallbac->waiteCallback = true;
+    heapInsert(item);
+    setNextCompare();
+    NVIC_EnableIRQ(USER_SCHEDULER_IRQn);
+}
+
+
+void timerRun(timerCallbacT inTimerCallbac, int32_t waitTime)
+{
+    timerArm(inTimerCallbac, waitTime, 0);
+}
+
+
+void timerRunPeriodic(timerCallbacT inTimerCallbac, int32_t period)
+{
+    timerArm(inTimerCallbac, period, period);
+}
+
+
+void timerStop(timerCallbacT inTimerCallbac)
+{
+    NVIC_DisableIRQ(USER_SCHEDULER_IRQn);
+    heapRemove(inTimerCallbac - timerCallbackHeap);
+    inTimerCallbac->generation++;
+    inTimerCallbac->waiteCallback = false;
+    setNextCompare();
+    NVIC_EnableIRQ(USER_SCHEDULER_IRQn);
+}
+
+
+uint32_t timerGetLost(void)
+{
+    return expiredLostCnt;
 }
 
 
 void userProcessingTimerCallbackFun(void)
 {
-    if(!isNewTick)
-    {
-        return;
-    }
-    isNewTick = false;
-    for(uint16_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    uint32_t item;
+
+    while(nrf_atfifo_get_free(expiredFifo, &item, sizeof(item), NULL) == NRF_SUCCESS)
     {
-        if(!timerCallbackHeap[cnt].runCallback)
+        volatile struct timerCallback *callback = &timerCallbackHeap[EXPIRED_ITEM_SLOT(item)];
+
+        if((callback->generation & EXPIRED_GEN_MASK) != EXPIRED_ITEM_GEN(item))
         {
             continue;
         }
-        timerCallbackHeap[cnt].runCallback   = false;
-        timerCallbackHeap[cnt].fun();
+        callback->fun(callback->context);
     }
 }
-
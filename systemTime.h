@@ -5,17 +5,21 @@
 #ifndef SYSTEMTIME_H_
 #define SYSTEMTIME_H_
 
-#define USER_SCHEDULER_TIMER NRF_TIMER1
-#define CALLBACK_QUANTITY        5
+#define USER_SCHEDULER_RTC       NRF_RTC2
+#define USER_SCHEDULER_IRQn      RTC2_IRQn
+#define CALLBACK_QUANTITY        32
 
 typedef volatile struct timerCallback *timerCallbacT;
-typedef void (*timerCallbackFunT)(void);
+typedef void (*timerCallbackFunT)(void *context);
 
 
 void initUserTimer(void);
 uint32_t getTime(void);
-timerCallbacT timerGetCallback(timerCallbackFunT timerCallbackFun);
+timerCallbacT timerGetCallback(timerCallbackFunT timerCallbackFun, void *context);
 void timerRun(timerCallbacT inTimerCallbac, int32_t waitTime);
+void timerRunPeriodic(timerCallbacT inTimerCallbac, int32_t period);
+void timerStop(timerCallbacT inTimerCallbac);
+uint32_t timerGetLost(void);
 void userProcessingTimerCallbackFun(void);
 
 #endif
@@ -0,0 +1,326 @@
+/*file: advReconnectTest.c
+ *
+ * Unit test of advReconnect scan phase.
+ * Scan stop rule: advReconnectScanIsEnough() is replayed millisecond by millisecond over detection timelines
+ * (time and rank position of each first detection, as reconnect trace gives them), scan stop time is
+ * compared with the expected one for each rule. Candidate quantity and top K over 31 take all 32 rank bits of
+ * detectedRankMask.
+ * State machine: rank first peer with ID 0xFF stops scanning, detected list is cleared for scanning again
+ * after connection phase went through all detected devices. Serial connection phase white lists each detected
+ * device in rank order for ADV_RECONNECT_CONNECT_TIMEOUT, after DIRECT_CONN_QUANTITY loops all bonded devices
+ * are white listed without timeout.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+
+#include "advReconnect.h"
+#include "orderProcessing.h"
+#include "reconnectTrace.h"
+#include "systemTimeStub.h"
+#include "testCheck.h"
+
+#define TEST_DETECT_MAX        ADV_RECONNECT_PEER_QUANTITY
+#define TEST_NO_STOP           0xFFFFFFFF      // scan goes on up to ADV_RECONNECT_SCAN_TIMEOUT
+
+typedef struct
+{
+    uint32_t time;                             // ms from scan start
+    uint8_t  rankPos;
+}testDetectT;
+
+typedef struct
+{
+    const char      *name;
+    advScanStopRuleT rule;
+    uint8_t          candidateQuantity;
+    uint8_t          detectQuantity;
+    testDetectT      detect[TEST_DETECT_MAX];
+    uint32_t         stopTime;
+}testTimelineT;
+
+static const testTimelineT testTimeline[] =
+{
+    {"top first",          {true,  0, 0},    3, 2, {{120, 0}, {400, 1}},                       120},
+    {"top last",           {true,  0, 0},    3, 3, {{80, 1}, {300, 2}, {2500, 0}},             2500},
+    {"top never",          {true,  0, 0},    3, 2, {{80, 1}, {300, 2}},                        TEST_NO_STOP},
+    {"top 2",              {false, 2, 0},    4, 3, {{80, 1}, {300, 3}, {2500, 0}},             2500},
+    {"top 2 > candidates", {false, 3, 0},    2, 2, {{40, 1}, {90, 0}},                         90},
+    {"all detected",       {false, 0, 0},    2, 2, {{50, 1}, {700, 0}},                        700},
+    {"quiet",              {false, 0, 1000}, 3, 2, {{80, 1}, {300, 2}},                        1300},
+    {"quiet restarted",    {false, 0, 1000}, 5, 4, {{800, 4}, {1600, 3}, {2400, 2}, {3200, 1}}, 4200},
+    {"quiet no detection", {false, 0, 1000}, 3, 0, {{0, 0}},                                   TEST_NO_STOP},
+    {"rule off",           {false, 0, 0},    3, 3, {{10, 0}, {20, 1}, {5000, 2}},              5000},
+    {"quiet before top",   {true,  0, 500},  3, 2, {{100, 2}, {900, 0}},                       600},
+    {"32 candidates",      {false, 0, 0},    32, 2, {{10, 0}, {20, 31}},                       TEST_NO_STOP},
+    {"top 40 of 255",      {false, 40, 0},   255, 3, {{10, 0}, {20, 1}, {30, 31}},             TEST_NO_STOP},
+};
+
+
+/*********advReconnect USER IMPLEMENTED FUNCTION****************/
+static struct
+{
+    bool     isAdv;
+    uint16_t whitelist[ADV_RECONNECT_PEER_QUANTITY];
+    uint32_t whitelistCnt;
+    uint16_t peers[ADV_RECONNECT_PEER_QUANTITY];
+    uint32_t peerCnt;
+    uint16_t switchPeer[4 * ADV_RECONNECT_PEER_QUANTITY];  // one device white lists in apply order
+    uint32_t switchCnt;
+}testRadio;
+
+
+void advReconnectAdvStart(void)
+{
+    testRadio.isAdv = true;
+}
+
+
+void advReconnectAdvStop(void)
+{
+    testRadio.isAdv = false;
+}
+
+
+void advReconnectDisconnect(void)
+{
+}
+
+
+void advReconnectWhitelistSet(const uint16_t peers[], uint32_t peersQuantity)
+{
+    for(uint32_t cnt = 0; cnt < peersQuantity; cnt++)
+    {
+        testRadio.whitelist[cnt] = peers[cnt];
+    }
+    testRadio.whitelistCnt = peersQuantity;
+    if(peersQuantity == 1 && testRadio.switchCnt < sizeof(testRadio.switchPeer) / sizeof(testRadio.switchPeer[0]))
+    {
+        testRadio.switchPeer[testRadio.switchCnt++] = peers[0];
+    }
+}
+
+
+uint32_t advReconnectPeerListGet(uint16_t peers[], uint32_t peersMaxQuantity)
+{
+    uint32_t cnt = 0;
+
+    for(; cnt < testRadio.peerCnt && cnt < peersMaxQuantity; cnt++)
+    {
+        peers[cnt] = testRadio.peers[cnt];
+    }
+    return cnt;
+}
+
+
+/*********orderProcessing USER IMPLEMENTED FUNCTION****************/
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+{
+    (void)flashAddress;
+    (void)buffer;
+    (void)bufferSize;
+    return NRF_SUCCESS;
+}
+
+
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
+{
+    (void)flashAddress;
+    (void)size;
+    return NULL;
+}
+
+
+void flashMemClose(uint32_t flashAddress)
+{
+    (void)flashAddress;
+}
+
+
+/*********test****************/
+static uint32_t testReplay(const testTimelineT *timeline)
+{
+    advScanProgressT progress = {.candidateQuantity = timeline->candidateQuantity};
+    uint32_t         lastDetectTime = 0;
+
+    for(uint32_t time = 0; time < ADV_RECONNECT_SCAN_TIMEOUT; time++)
+    {
+        for(uint8_t cnt = 0; cnt < timeline->detectQuantity; cnt++)
+        {
+            if(timeline->detect[cnt].time == time)
+            {
+                progress.detectedRankMask |= 1UL << timeline->detect[cnt].rankPos;
+                lastDetectTime = time;
+            }
+        }
+        progress.quietTime = time - lastDetectTime;
+        if(advReconnectScanIsEnough(&timeline->rule, &progress))
+        {
+            return time;
+        }
+    }
+    return TEST_NO_STOP;
+}
+
+
+static void testScanRule(void)
+{
+    for(uint32_t cnt = 0; cnt < sizeof(testTimeline) / sizeof(testTimeline[0]); cnt++)
+    {
+        uint32_t stopTime = testReplay(&testTimeline[cnt]);
+
+        if(stopTime != testTimeline[cnt].stopTime)
+        {
+            printf("timeline \"%s\": stop %d, expected %d\n", testTimeline[cnt].name, (int)stopTime,
+                   (int)testTimeline[cnt].stopTime);
+        }
+        TEST_CHECK_EQ(stopTime, testTimeline[cnt].stopTime);
+    }
+}
+
+
+// candidate quantity and top K over rank bits of detectedRankMask: all 32 bits must be detected
+static void testScanRuleRange(void)
+{
+    static const uint8_t quantity[] = {31, 32, 33, 64, 255};
+    advScanStopRuleT     rule       = {.isTopStop = false};
+
+    for(uint32_t cnt = 0; cnt < sizeof(quantity) / sizeof(quantity[0]); cnt++)
+    {
+        advScanProgressT progress = {.candidateQuantity = quantity[cnt]};
+        uint32_t         all      = (quantity[cnt] >= 32) ? UINT32_MAX : (1UL << quantity[cnt]) - 1;
+        uint32_t         last     = (quantity[cnt] >= 32) ? 31 : quantity[cnt] - 1;
+
+        // all detected rule, then top K rule with K equal candidate quantity
+        for(uint32_t isTopK = 0; isTopK < 2; isTopK++)
+        {
+            rule.topK                 = isTopK ? quantity[cnt] : 0;
+            progress.detectedRankMask = all & ~(1UL << last);
+            TEST_CHECK(!advReconnectScanIsEnough(&rule, &progress));
+            progress.detectedRankMask = all;
+            TEST_CHECK(advReconnectScanIsEnough(&rule, &progress));
+        }
+    }
+}
+
+
+// peer is detected on scan phase, timers due by now are processed
+static void testDetect(uint16_t peerId)
+{
+    advReconnectProcessing(ADV_PROC_START_CONNECT, peerId);
+    hostTimeRun(getTime());
+}
+
+
+static void testStateMachine(void)
+{
+    static const uint16_t peers[] = {3, 7, 0xFF};  // connected last is rank first
+    orderT  order = orderMalloc();
+    uint8_t pos;
+
+    hostTimeReset();
+    reconnectTraceInit();
+    testRadio.peerCnt = sizeof(peers) / sizeof(peers[0]);
+    for(uint32_t cnt = 0; cnt < testRadio.peerCnt; cnt++)
+    {
+        testRadio.peers[cnt] = peers[cnt];
+        orderUsageConnect(order, peers[cnt]);
+    }
+    TEST_CHECK(orderGetRankPos(order, 0xFF, &pos) && pos == 0);
+    advReconnectSetScanRule((advScanStopRuleT){.isTopStop = true});
+    advReconnectInit(order);
+
+    // rank first peer 0xFF stops scanning at once, connection phase white lists it
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 3);
+    hostTimeSet(200);
+    testDetect(0xFF);
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_CONNECT);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 1);
+    TEST_CHECK_EQ(testRadio.whitelist[0], 0xFF);
+
+    // advertising timeouts go through detected devices, then scanning starts again
+    for(uint32_t cnt = 0; cnt < 4 && advReconnectGetType() != ADV_RECONNECT_SCAN; cnt++)
+    {
+        hostTimeSet(getTime() + 1000);
+        advReconnectProcessing(ADV_PROC_STOP_ADV, 0);
+    }
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_SCAN);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 3);
+
+    // detection of rank last peer doesn't stop new scanning (nothing left detected from previous one)
+    hostTimeSet(getTime() + 100);
+    testDetect(3);
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_SCAN);
+    TEST_CHECK(testRadio.isAdv);
+    testDetect(0xFF);
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_CONNECT);
+    TEST_CHECK_EQ(testRadio.whitelist[0], 0xFF);
+
+    orderFree(order);
+}
+
+
+static void testConnectPhase(void)
+{
+    orderT   order = orderMalloc();
+    uint32_t deadline;
+
+    hostTimeReset();
+    reconnectTraceInit();
+    testRadio.peerCnt = ADV_RECONNECT_PEER_QUANTITY;
+    for(uint32_t cnt = 0; cnt < testRadio.peerCnt; cnt++)
+    {
+        testRadio.peers[cnt] = 10 + cnt;
+        orderUsageConnect(order, testRadio.peers[cnt]);
+    }
+    advReconnectSetScanRule((advScanStopRuleT){.isTopStop = true});
+    advReconnectSetStrategy(ADV_CONNECT_SERIAL);
+    advReconnectInit(order);
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+
+    for(uint32_t loop = 0; loop < DIRECT_CONN_QUANTITY; loop++)
+    {
+        TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_SCAN);
+        testRadio.switchCnt = 0;
+        // all detected, rank first one last: it stops scanning
+        for(uint8_t pos = ADV_RECONNECT_PEER_QUANTITY; pos > 0; pos--)
+        {
+            hostTimeSet(getTime() + 50);
+            testDetect(orderGetRankItem(order, pos - 1));
+        }
+        // no host accepts connection: each white list is advertised until connection timeout
+        for(uint8_t pos = 0; pos < ADV_RECONNECT_PEER_QUANTITY; pos++)
+        {
+            TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_CONNECT);
+            TEST_CHECK(hostTimeNext(&deadline) && deadline == getTime() + ADV_RECONNECT_CONNECT_TIMEOUT);
+            hostTimeRun(getTime() + ADV_RECONNECT_CONNECT_TIMEOUT);
+        }
+        TEST_CHECK_EQ(testRadio.switchCnt, ADV_RECONNECT_PEER_QUANTITY);
+        for(uint8_t pos = 0; pos < testRadio.switchCnt; pos++)
+        {
+            TEST_CHECK_EQ(testRadio.switchPeer[pos], orderGetRankItem(order, pos));
+        }
+    }
+
+    // general advertising: all bonded devices, first one is accepted, no timeout
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_CONNECT);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, ADV_RECONNECT_PEER_QUANTITY);
+    TEST_CHECK(!hostTimeNext(&deadline));
+    TEST_CHECK(testRadio.isAdv);
+    advReconnectProcessing(ADV_PROC_START_CONNECT, orderGetRankItem(order, 3));
+    TEST_CHECK(!testRadio.isAdv);
+
+    orderFree(order);
+}
+
+
+int main(void)
+{
+    testScanRule();
+    testScanRuleRange();
+    testStateMachine();
+    testConnectPhase();
+    return testResult("advReconnectTest");
+}
@@ -0,0 +1,276 @@
+/*file: advWhitelistTest.c
+ *
+ * Unit test of differential white list of advReconnect: white list is given to peer manager
+ * (advReconnectWhitelistSet()) only when it differs as set from the applied one, scan phase removal of detected
+ * device is applied at once while scanning goes on and folded into connection phase white list when it ends
+ * the scan, bond update (advReconnectWhitelistAdd() of listed peer) and advReconnectWhitelistInvalidate() force
+ * the next apply. Every commit is counted as performed or skipped (advReconnectWhitelistGetStat()).
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+
+#include "advReconnect.h"
+#include "orderProcessing.h"
+#include "reconnectTrace.h"
+#include "systemTimeStub.h"
+#include "testCheck.h"
+
+#define TEST_PEER_TOP          0xFF            // connected last, rank first
+
+
+/*********advReconnect USER IMPLEMENTED FUNCTION****************/
+static struct
+{
+    uint16_t whitelist[ADV_RECONNECT_PEER_QUANTITY];
+    uint32_t whitelistCnt;
+    uint32_t whitelistSets;
+    uint16_t peers[ADV_RECONNECT_PEER_QUANTITY];
+    uint32_t peerCnt;
+}testRadio;
+
+
+void advReconnectAdvStart(void)
+{
+}
+
+
+void advReconnectAdvStop(void)
+{
+}
+
+
+void advReconnectDisconnect(void)
+{
+}
+
+
+void advReconnectWhitelistSet(const uint16_t peers[], uint32_t peersQuantity)
+{
+    for(uint32_t cnt = 0; cnt < peersQuantity; cnt++)
+    {
+        testRadio.whitelist[cnt] = peers[cnt];
+    }
+    testRadio.whitelistCnt = peersQuantity;
+    testRadio.whitelistSets++;
+}
+
+
+uint32_t advReconnectPeerListGet(uint16_t peers[], uint32_t peersMaxQuantity)
+{
+    uint32_t cnt = 0;
+
+    for(; cnt < testRadio.peerCnt && cnt < peersMaxQuantity; cnt++)
+    {
+        peers[cnt] = testRadio.peers[cnt];
+    }
+    return cnt;
+}
+
+
+/*********orderProcessing USER IMPLEMENTED FUNCTION****************/
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+{
+    (void)flashAddress;
+    (void)buffer;
+    (void)bufferSize;
+    return NRF_SUCCESS;
+}
+
+
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
+{
+    (void)flashAddress;
+    (void)size;
+    return NULL;
+}
+
+
+void flashMemClose(uint32_t flashAddress)
+{
+    (void)flashAddress;
+}
+
+
+/*********test****************/
+static orderT testOrder;
+
+
+// bonded peers {3, 7, TEST_PEER_TOP}, module idle, statistics cleared
+static void testStart(void)
+{
+    static const uint16_t peers[] = {3, 7, TEST_PEER_TOP};
+
+    if(testOrder != NULL)
+    {
+        orderFree(testOrder);
+    }
+    testOrder = orderMalloc();
+    hostTimeReset();
+    reconnectTraceInit();
+    testRadio.peerCnt       = sizeof(peers) / sizeof(peers[0]);
+    testRadio.whitelistSets = 0;
+    for(uint32_t cnt = 0; cnt < testRadio.peerCnt; cnt++)
+    {
+        testRadio.peers[cnt] = peers[cnt];
+        orderUsageConnect(testOrder, peers[cnt]);
+    }
+    advReconnectSetScanRule((advScanStopRuleT){.isTopStop = true});
+    advReconnectSetStrategy(ADV_CONNECT_SERIAL);
+    advReconnectInit(testOrder);
+}
+
+
+static bool testIsWhitelisted(uint16_t peerId)
+{
+    for(uint32_t cnt = 0; cnt < testRadio.whitelistCnt; cnt++)
+    {
+        if(testRadio.whitelist[cnt] == peerId)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void testCheckStat(uint32_t performed, uint32_t skipped)
+{
+    advWhitelistStatT stat;
+
+    advReconnectWhitelistGetStat(&stat);
+    TEST_CHECK_EQ(stat.applyPerformed, performed);
+    TEST_CHECK_EQ(stat.applySkipped, skipped);
+    TEST_CHECK_EQ(testRadio.whitelistSets, performed);
+}
+
+
+// peer is detected on scan phase, timers due by now are processed
+static void testDetect(uint16_t peerId)
+{
+    hostTimeSet(getTime() + 50);
+    advReconnectProcessing(ADV_PROC_START_CONNECT, peerId);
+    hostTimeRun(getTime());
+}
+
+
+static void testScanRemoval(void)
+{
+    testStart();
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 3);
+    testCheckStat(1, 0);
+
+    // scanning goes on: each removal is applied at once
+    testDetect(3);
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_SCAN);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 2);
+    TEST_CHECK(!testIsWhitelisted(3));
+    testDetect(7);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 1);
+    TEST_CHECK(testIsWhitelisted(TEST_PEER_TOP));
+    testCheckStat(3, 0);
+
+    // rank first ends the scan: its removal isn't applied, connection phase white lists it, as applied already
+    testDetect(TEST_PEER_TOP);
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_CONNECT);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 1);
+    TEST_CHECK(testIsWhitelisted(TEST_PEER_TOP));
+    testCheckStat(3, 1);
+}
+
+
+static void testScanEndFolded(void)
+{
+    testStart();
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+
+    // removal and connection phase white list cost one apply
+    testDetect(TEST_PEER_TOP);
+    TEST_CHECK_EQ(advReconnectGetType(), ADV_RECONNECT_CONNECT);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 1);
+    TEST_CHECK(testIsWhitelisted(TEST_PEER_TOP));
+    testCheckStat(2, 0);
+
+    // the same single peer again
+    advReconnectSetStart(ADV_RECONNECT_CONNECT, TEST_PEER_TOP);
+    testCheckStat(2, 1);
+    advReconnectSetStart(ADV_RECONNECT_CONNECT, 7);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 1);
+    TEST_CHECK(testIsWhitelisted(7));
+    testCheckStat(3, 1);
+}
+
+
+static void testSetCompare(void)
+{
+    testStart();
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    testCheckStat(1, 0);
+
+    // the same peers in other order
+    testRadio.peers[0] = TEST_PEER_TOP;
+    testRadio.peers[1] = 3;
+    testRadio.peers[2] = 7;
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    testCheckStat(1, 1);
+
+    // one peer less, then one replaced
+    testRadio.peerCnt = 2;
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    TEST_CHECK_EQ(testRadio.whitelistCnt, 2);
+    TEST_CHECK(!testIsWhitelisted(7));
+    testRadio.peers[1] = 9;
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    TEST_CHECK(testIsWhitelisted(9));
+    TEST_CHECK(!testIsWhitelisted(3));
+    testCheckStat(3, 1);
+}
+
+
+static void testForcedApply(void)
+{
+    testStart();
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    testCheckStat(1, 0);
+
+    // bond update of listed peer: same set, its keys may differ
+    TEST_CHECK(advReconnectWhitelistAdd(7));
+    TEST_CHECK_EQ(advReconnectWhitelistGetQuantity(), 3);
+    testCheckStat(2, 0);
+
+    // bonds deleted behind module
+    advReconnectWhitelistInvalidate();
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    testCheckStat(3, 0);
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    testCheckStat(3, 1);
+
+    // new bonds until the list is full
+    TEST_CHECK(advReconnectWhitelistAdd(20));
+    TEST_CHECK(advReconnectWhitelistAdd(21));
+    TEST_CHECK_EQ(testRadio.whitelistCnt, ADV_RECONNECT_PEER_QUANTITY);
+    TEST_CHECK(testIsWhitelisted(21));
+    TEST_CHECK(!advReconnectWhitelistAdd(22));
+    TEST_CHECK(!testIsWhitelisted(22));
+    testCheckStat(5, 1);
+
+    // statistics start again
+    advReconnectInit(testOrder);
+    testRadio.whitelistSets = 0;
+    testCheckStat(0, 0);
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+    testCheckStat(1, 0);
+}
+
+
+int main(void)
+{
+    testScanRemoval();
+    testScanEndFolded();
+    testSetCompare();
+    testForcedApply();
+    orderFree(testOrder);
+    return testResult("advWhitelistTest");
+}
@@ -0,0 +1,94 @@
+/*file: crc16Bench.c
+ *
+ * Host benchmark of crc16_compute() kernel (CRC16_KERNEL from make) against original SDK bitwise loop
+ * (copied below) over random buffers of FDS record sizes, from one record header to a full virtual page.
+ * Both results are compared before timing, so benchmark also checks the kernel against the reference.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+
+#include "crc16.h"
+
+#define BENCH_BYTES            (64u * 1024 * 1024)  // per buffer size and implementation
+#define BENCH_BUFFER_SIZE      4096
+
+static const uint32_t benchSize[] = {12, 64, 256, 4096};
+
+
+/*********original SDK crc16_compute()****************/
+static uint16_t refCrc16(uint8_t const *p_data, uint32_t size, uint16_t const *p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+
+    for(uint32_t i = 0; i < size; i++)
+    {
+        crc  = (uint8_t)(crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t)(crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
+
+
+/*********benchmark****************/
+static volatile uint32_t benchSink;             // keeps result of timed loops
+static uint8_t           benchBuffer[BENCH_BUFFER_SIZE + 1];
+
+
+static uint64_t benchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+// ns per byte, CRC chained through calls so they can't overlap; data starts unaligned
+static double benchRun(uint16_t (*crcFunc)(uint8_t const *, uint32_t, uint16_t const *), uint32_t size)
+{
+    uint32_t const calls = BENCH_BYTES / size;
+    uint16_t       crc   = 0xFFFF;
+    uint64_t       start;
+
+    start = benchNow();
+    for(uint32_t cnt = 0; cnt < calls; cnt++)
+    {
+        crc = crcFunc(&benchBuffer[1], size, &crc);
+    }
+    start = benchNow() - start;
+    benchSink = crc;
+    return (double)start / ((double)calls * size);
+}
+
+
+int main(void)
+{
+    srand(16);
+    for(uint32_t pos = 0; pos < sizeof(benchBuffer); pos++)
+    {
+        benchBuffer[pos] = rand();
+    }
+    for(uint32_t cnt = 0; cnt < sizeof(benchSize) / sizeof(benchSize[0]); cnt++)
+    {
+        double refNs;
+        double kernelNs;
+
+        if(crc16_compute(&benchBuffer[1], benchSize[cnt], NULL) != refCrc16(&benchBuffer[1], benchSize[cnt], NULL))
+        {
+            printf("CRC16_KERNEL %u: %u bytes differ from original\n", CRC16_KERNEL, benchSize[cnt]);
+            return 1;
+        }
+        refNs    = benchRun(refCrc16, benchSize[cnt]);
+        kernelNs = benchRun(crc16_compute, benchSize[cnt]);
+        printf("CRC16_KERNEL %u, %4u bytes: original %5.2f ns/byte, kernel %5.2f ns/byte (x%.2f)\n",
+               CRC16_KERNEL, benchSize[cnt], refNs, kernelNs, refNs / kernelNs);
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*file: crc16Test.c
+ *
+ * Regression test of crc16_compute() kernel (CRC16_KERNEL from make) against original SDK bitwise loop
+ * (copied below): CRC-16-CCITT check value, every single byte from every CRC, random buffers with random
+ * length, start offset (unaligned data) and seed CRC, and the same buffers fed in random blocks.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "crc16.h"
+#include "testCheck.h"
+
+#define TEST_BUFFERS           20000
+#define TEST_BUFFER_SIZE       1100
+
+
+/*********original SDK crc16_compute()****************/
+static uint16_t refCrc16(uint8_t const *p_data, uint32_t size, uint16_t const *p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+
+    for(uint32_t i = 0; i < size; i++)
+    {
+        crc  = (uint8_t)(crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t)(crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
+
+
+/*********tests****************/
+static void testCheckValue(void)
+{
+    static const uint8_t digits[] = "123456789";
+
+    TEST_CHECK_EQ(crc16_compute(digits, 9, NULL), 0x29B1);
+    TEST_CHECK_EQ(crc16_compute(digits, 0, NULL), 0xFFFF);
+}
+
+
+// errors over all 65536 seed CRCs and 256 byte values
+static void testSingleByte(void)
+{
+    uint32_t errors = 0;
+
+    for(uint32_t crc = 0; crc <= 0xFFFF; crc++)
+    {
+        for(uint32_t value = 0; value <= 0xFF; value++)
+        {
+            uint16_t const seed = crc;
+            uint8_t  const data = value;
+
+            errors += (crc16_compute(&data, 1, &seed) != refCrc16(&data, 1, &seed));
+        }
+    }
+    TEST_CHECK_EQ(errors, 0);
+}
+
+
+static void testRandom(void)
+{
+    static uint8_t buffer[TEST_BUFFER_SIZE];
+    uint32_t       errors      = 0;
+    uint32_t       blockErrors = 0;
+
+    srand(16);
+    for(uint32_t cnt = 0; cnt < TEST_BUFFERS; cnt++)
+    {
+        uint32_t const offset = rand() % 8;
+        uint32_t const size   = rand() % (TEST_BUFFER_SIZE - offset + 1);
+        uint16_t const seed   = rand();
+        uint16_t const *pSeed = (cnt % 2 == 0) ? NULL : &seed;
+        uint16_t       crc;
+        uint16_t       blockCrc;
+        uint32_t       done;
+
+        for(uint32_t pos = 0; pos < TEST_BUFFER_SIZE; pos++)
+        {
+            buffer[pos] = rand();
+        }
+        crc     = refCrc16(&buffer[offset], size, pSeed);
+        errors += (crc16_compute(&buffer[offset], size, pSeed) != crc);
+
+        // same data in blocks, each block goes on from CRC of previous one
+        done = rand() % (size + 1);
+        blockCrc = crc16_compute(&buffer[offset], done, pSeed);
+        while(done < size)
+        {
+            uint32_t const block = 1 + rand() % (size - done);
+
+            blockCrc = crc16_compute(&buffer[offset + done], block, &blockCrc);
+            done    += block;
+        }
+        blockErrors += (blockCrc != crc);
+    }
+    TEST_CHECK_EQ(errors, 0);
+    TEST_CHECK_EQ(blockErrors, 0);
+}
+
+
+int main(void)
+{
+    testCheckValue();
+    testSingleByte();
+    testRandom();
+    printf("CRC16_KERNEL %u: ", CRC16_KERNEL);
+    return testResult("crc16Test");
+}
@@ -0,0 +1,132 @@
+/*file: fdsFindBench.c
+ *
+ * Host benchmark of FDS lookup by file ID and record key over file backed fstorage: cost of fds_record_find()
+ * of one record against number of records in flash, built with RAM index and with flash scan
+ * (FDS_RAM_INDEX_ENABLED from make). Records have distinct keys, 8 files, lookup keys are random.
+ * Flash and index are enlarged from make so that all record counts fit.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+
+#define BENCH_LOOKUPS          200000
+#define BENCH_FILES            8
+
+static const uint32_t benchRecords[] = {8, 32, 128, 240};
+
+
+/*********benchmark****************/
+static volatile uint32_t benchSink;             // keeps result of timed loops
+static bool              benchIsInit;
+
+
+static void benchFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        benchIsInit = (p_evt->result == FDS_SUCCESS);
+    }
+}
+
+
+static uint64_t benchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static bool benchFill(uint32_t records)
+{
+    static uint32_t   data;
+    fds_record_desc_t desc;
+    fds_record_t      record = {.data = {.p_data = &data, .length_words = 1}};
+
+    for(uint32_t cnt = 0; cnt < records; cnt++)
+    {
+        data           = cnt;
+        record.file_id = 1 + cnt % BENCH_FILES;
+        record.key     = 1 + cnt;
+        if(fds_record_write(&desc, &record) != FDS_SUCCESS)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// ns per lookup of random record, every lookup is checked to find its record
+static double benchFind(uint32_t records)
+{
+    static uint16_t   key[BENCH_LOOKUPS];
+    fds_find_token_t  token;
+    fds_record_desc_t desc;
+    uint64_t          start;
+    uint32_t          found = 0;
+
+    for(uint32_t cnt = 0; cnt < BENCH_LOOKUPS; cnt++)
+    {
+        key[cnt] = rand() % records;
+    }
+    start = benchNow();
+    for(uint32_t cnt = 0; cnt < BENCH_LOOKUPS; cnt++)
+    {
+        memset(&token, 0, sizeof(token));
+        found += (fds_record_find(1 + key[cnt] % BENCH_FILES, 1 + key[cnt], &desc, &token) == FDS_SUCCESS);
+    }
+    start = benchNow() - start;
+    benchSink = found;
+    return (found == BENCH_LOOKUPS) ? (double)start / BENCH_LOOKUPS : -1;
+}
+
+
+int main(void)
+{
+    for(uint32_t cnt = 0; cnt < sizeof(benchRecords) / sizeof(benchRecords[0]); cnt++)
+    {
+        double findNs;
+
+        // each flash content in its own process: FDS is initialized once
+        if(fork() != 0)
+        {
+            int status;
+
+            wait(&status);
+            if(status != 0)
+            {
+                return 1;
+            }
+            continue;
+        }
+        srand(benchRecords[cnt]);
+        unlink(NRF_FSTORAGE_FILE_NAME);
+        if(fds_register(benchFdsHandler) != FDS_SUCCESS || fds_init() != FDS_SUCCESS || !benchIsInit ||
+           !benchFill(benchRecords[cnt]))
+        {
+            printf("flash setup with %u records failed\n", benchRecords[cnt]);
+            return 1;
+        }
+        findNs = benchFind(benchRecords[cnt]);
+        if(findNs < 0)
+        {
+            printf("%u records: lookup didn't find its record\n", benchRecords[cnt]);
+            return 1;
+        }
+        printf("%-10s %3u records: %8.1f ns per fds_record_find()\n",
+               FDS_RAM_INDEX_ENABLED ? "RAM index" : "flash scan", benchRecords[cnt], findNs);
+        return 0;
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*file: fdsGcIdleBench.c
+ *
+ * Host benchmark of FDS garbage collection policy over file backed fstorage: device order record updates
+ * (connection workload), garbage collection only when write reports full flash (former PM_EVT_STORAGE_FULL
+ * path) against idle slices (fds_gc_idle(1) between connections, as main.c does while disconnected).
+ * Flash time is counted from backend statistics in nRF52840 figures (word write, page erase) and split into
+ * foreground (update, with garbage collection it had to wait for) and idle time.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+
+#define BENCH_FILE             0xBAAB
+#define BENCH_KEY              0xABBA
+#define BENCH_UPDATES          5000
+#define BENCH_IDLE_PERIOD      10              // updates (connections) between idle slices
+#define BENCH_DATA_WORDS       7               // device order image
+#define BENCH_STATIC_RECORDS   12              // bonds, 24 words each
+#define BENCH_WRITE_WORD_US    41              // nRF52840 t_WRITE
+#define BENCH_ERASE_PAGE_US    85000           // nRF52840 t_ERASEPAGE
+
+typedef struct
+{
+    uint64_t foregroundUs;
+    uint32_t foregroundMaxUs;
+    uint32_t foregroundGc;
+    uint64_t idleUs;
+    uint32_t idleSlices;
+}benchResultT;
+
+static bool benchIsInit;
+
+
+static void benchFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        benchIsInit = (p_evt->result == FDS_SUCCESS);
+    }
+}
+
+
+// device flash time since last call
+static uint32_t benchFlashUs(void)
+{
+    static nrf_fstorage_file_stat_t last;
+    nrf_fstorage_file_stat_t        stat;
+    uint32_t                        us;
+
+    nrf_fstorage_file_stat_get(&stat);
+    us = (stat.bytes_written - last.bytes_written) / sizeof(uint32_t) * BENCH_WRITE_WORD_US +
+         (stat.erases - last.erases) * BENCH_ERASE_PAGE_US;
+    last = stat;
+    return us;
+}
+
+
+static bool benchFill(fds_record_desc_t *orderDesc)
+{
+    static uint32_t data[24];
+    fds_record_desc_t desc;
+    fds_record_t      record = {.file_id = 0xC000, .data = {.p_data = data, .length_words = 24}};
+
+    for(uint16_t cnt = 0; cnt < BENCH_STATIC_RECORDS; cnt++)
+    {
+        record.key = 1 + cnt;
+        if(fds_record_write(&desc, &record) != FDS_SUCCESS)
+        {
+            return false;
+        }
+    }
+    record = (fds_record_t){.file_id = BENCH_FILE, .key = BENCH_KEY, .data = {.p_data = data,
+                                                                             .length_words = BENCH_DATA_WORDS}};
+    return fds_record_write(orderDesc, &record) == FDS_SUCCESS;
+}
+
+
+static bool benchRun(bool isIdle, benchResultT *result)
+{
+    static uint32_t   data[BENCH_DATA_WORDS];
+    fds_record_desc_t desc;
+    fds_record_t      record = {.file_id = BENCH_FILE, .key = BENCH_KEY, .data = {.p_data = data,
+                                                                                 .length_words = BENCH_DATA_WORDS}};
+
+    memset(result, 0, sizeof(*result));
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    if(fds_register(benchFdsHandler) != FDS_SUCCESS || fds_init() != FDS_SUCCESS || !benchIsInit ||
+       !benchFill(&desc))
+    {
+        return false;
+    }
+    (void)benchFlashUs();
+    for(uint32_t cnt = 0; cnt < BENCH_UPDATES; cnt++)
+    {
+        ret_code_t ret;
+        uint32_t   us;
+
+        data[0] = cnt;
+        ret = fds_record_update(&desc, &record);
+        if(ret == FDS_ERR_NO_SPACE_IN_FLASH)
+        {
+            result->foregroundGc++;
+            if(fds_gc() != FDS_SUCCESS)
+            {
+                return false;
+            }
+            ret = fds_record_update(&desc, &record);
+        }
+        if(ret != FDS_SUCCESS)
+        {
+            return false;
+        }
+        us = benchFlashUs();
+        result->foregroundUs += us;
+        if(us > result->foregroundMaxUs)
+        {
+            result->foregroundMaxUs = us;
+        }
+
+        if(isIdle && cnt % BENCH_IDLE_PERIOD == BENCH_IDLE_PERIOD - 1 && fds_gc_idle(1) == FDS_SUCCESS)
+        {
+            result->idleSlices++;
+            result->idleUs += benchFlashUs();
+        }
+    }
+    return true;
+}
+
+
+int main(void)
+{
+    static const char *const policyName[] = {"on full flash", "idle slices  "};
+
+    for(uint32_t policy = 0; policy < 2; policy++)
+    {
+        benchResultT result;
+        int          status;
+
+        // each policy in its own process on new flash: FDS is initialized once
+        if(fork() != 0)
+        {
+            wait(&status);
+            if(status != 0)
+            {
+                return 1;
+            }
+            continue;
+        }
+        if(!benchRun(policy != 0, &result))
+        {
+            printf("%s: FDS operation failed\n", policyName[policy]);
+            return 1;
+        }
+        printf("GC %s: %u updates, foreground GC %3u, update max %6.1f ms mean %5.2f ms, "
+               "idle slices %3u, idle %7.1f ms\n", policyName[policy], BENCH_UPDATES, result.foregroundGc,
+               result.foregroundMaxUs / 1000.0, result.foregroundUs / 1000.0 / BENCH_UPDATES, result.idleSlices,
+               result.idleUs / 1000.0);
+        return 0;
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*file: fdsGcIdleTest.c
+ *
+ * Unit test of FDS idle garbage collection (fds_gc_idle()) over file backed fstorage: nothing starts below
+ * FDS_GC_IDLE_DIRTY_PERCENT of reclaimable words, one page slice erases one page and yields, the stopped run is
+ * resumed by fds_gc() and records keep their data. Operation queued while idle slice runs (from FDS event
+ * handler, so it waits in queue) stops the slice after the current page and is counted as stall.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+#include "unistd.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+#include "testCheck.h"
+
+#define TEST_FILE              0x1234
+#define TEST_KEY_STATIC        1               // written once
+#define TEST_KEY_UPDATED       2               // updated until enough is dirty
+#define TEST_KEY_QUEUED        3               // written from event handler during idle slice
+#define TEST_DATA_WORDS        16
+
+static uint32_t testData[TEST_DATA_WORDS];
+
+static struct
+{
+    bool       isInit;
+    uint32_t   gcEvents;
+    bool       isQueueOnWrite;                 // next write event queues idle slice and other write
+    ret_code_t idleRet;
+    ret_code_t writeRet;
+}testFds;
+
+static uint32_t testTime;
+
+
+static uint32_t testTimeGet(void)
+{
+    return ++testTime;
+}
+
+
+static ret_code_t testWrite(uint16_t key, uint32_t value)
+{
+    fds_record_desc_t desc;
+    fds_find_token_t  token;
+    fds_record_t      record = {.file_id = TEST_FILE, .key = key, .data = {.p_data = testData,
+                                                                           .length_words = TEST_DATA_WORDS}};
+
+    testData[0] = value;
+    memset(&token, 0, sizeof(token));
+    if(fds_record_find(TEST_FILE, key, &desc, &token) == FDS_SUCCESS)
+    {
+        return fds_record_update(&desc, &record);
+    }
+    return fds_record_write(&desc, &record);
+}
+
+
+static void testFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        testFds.isInit = (p_evt->result == FDS_SUCCESS);
+    }
+    else if(p_evt->id == FDS_EVT_GC)
+    {
+        testFds.gcEvents++;
+    }
+    else if((p_evt->id == FDS_EVT_WRITE || p_evt->id == FDS_EVT_UPDATE) && testFds.isQueueOnWrite)
+    {
+        testFds.isQueueOnWrite = false;
+        testFds.idleRet        = fds_gc_idle(FDS_VIRTUAL_PAGES);
+        testFds.writeRet       = testWrite(TEST_KEY_QUEUED, 0xCAFE);
+    }
+}
+
+
+static uint32_t testValue(uint16_t key)
+{
+    fds_record_desc_t  desc;
+    fds_find_token_t   token;
+    fds_flash_record_t flashRecord;
+    uint32_t           value = 0xFFFFFFFF;
+
+    memset(&token, 0, sizeof(token));
+    if(fds_record_find(TEST_FILE, key, &desc, &token) == FDS_SUCCESS &&
+       fds_record_open(&desc, &flashRecord) == FDS_SUCCESS)
+    {
+        value = *(const uint32_t *)flashRecord.p_data;
+        (void)fds_record_close(&desc);
+    }
+    return value;
+}
+
+
+static uint32_t testErases(void)
+{
+    nrf_fstorage_file_stat_t stat;
+
+    nrf_fstorage_file_stat_get(&stat);
+    return stat.erases;
+}
+
+
+static uint16_t testFreeable(void)
+{
+    fds_stat_t stat;
+
+    (void)fds_stat(&stat);
+    return stat.freeable_words;
+}
+
+
+// updates spill over first data page, so both data pages have dirty records; idle GC doesn't start
+// below FDS_GC_IDLE_DIRTY_PERCENT of data page words. Returns last value.
+static uint32_t testDirty(uint32_t value)
+{
+    uint32_t const dirtyMin = FDS_GC_IDLE_DIRTY_PERCENT * (FDS_VIRTUAL_PAGES - 1) * FDS_VIRTUAL_PAGE_SIZE / 100;
+
+    while(testFreeable() < FDS_VIRTUAL_PAGE_SIZE)
+    {
+        if(testFreeable() < dirtyMin)
+        {
+            TEST_CHECK_EQ(fds_gc_idle(1), FDS_ERR_NOT_FOUND);
+        }
+        TEST_CHECK_EQ(testWrite(TEST_KEY_UPDATED, ++value), FDS_SUCCESS);
+    }
+    return value;
+}
+
+
+static void testSlice(void)
+{
+    fds_gc_stat_t stat;
+    uint32_t      erases;
+    uint32_t      value;
+
+    TEST_CHECK_EQ(testWrite(TEST_KEY_STATIC, 0x5A5A), FDS_SUCCESS);
+    TEST_CHECK_EQ(fds_gc_idle(0), FDS_ERR_INVALID_ARG);
+    TEST_CHECK_EQ(fds_gc_idle(1), FDS_ERR_NOT_FOUND);
+    value = testDirty(0);
+
+    // one page, then the run is stopped
+    erases = testErases();
+    TEST_CHECK_EQ(fds_gc_idle(1), FDS_SUCCESS);
+    TEST_CHECK_EQ(testFds.gcEvents, 1);
+    TEST_CHECK_EQ(testErases(), erases + 1);
+    TEST_CHECK_EQ(fds_gc_stat(&stat), FDS_SUCCESS);
+    TEST_CHECK_EQ(stat.idle_slices, 1);
+    TEST_CHECK_EQ(stat.idle_yields, 1);
+    TEST_CHECK_EQ(stat.runs, 0);
+    TEST_CHECK_EQ(testValue(TEST_KEY_STATIC), 0x5A5A);
+    TEST_CHECK_EQ(testValue(TEST_KEY_UPDATED), value);
+
+    // fds_gc() goes on from the next page
+    TEST_CHECK_EQ(fds_gc(), FDS_SUCCESS);
+    TEST_CHECK_EQ(testFds.gcEvents, 2);
+    TEST_CHECK_EQ(testErases(), erases + FDS_VIRTUAL_PAGES - 1);
+    TEST_CHECK_EQ(fds_gc_stat(&stat), FDS_SUCCESS);
+    TEST_CHECK_EQ(stat.runs, 1);
+    TEST_CHECK_EQ(stat.stalls, 0);
+    TEST_CHECK_EQ(testFreeable(), 0);
+    TEST_CHECK_EQ(fds_gc_idle(1), FDS_ERR_NOT_FOUND);
+    TEST_CHECK_EQ(testValue(TEST_KEY_STATIC), 0x5A5A);
+    TEST_CHECK_EQ(testValue(TEST_KEY_UPDATED), value);
+}
+
+
+static void testYield(void)
+{
+    fds_gc_stat_t before;
+    fds_gc_stat_t stat;
+    uint32_t      erases;
+    uint32_t      value;
+
+    value = testDirty(1000);
+    TEST_CHECK_EQ(fds_gc_stat(&before), FDS_SUCCESS);
+    erases = testErases();
+
+    // slice of all pages is queued with a write behind it: it stops after the first page
+    testFds.isQueueOnWrite = true;
+    TEST_CHECK_EQ(testWrite(TEST_KEY_UPDATED, ++value), FDS_SUCCESS);
+    TEST_CHECK(!testFds.isQueueOnWrite);
+    TEST_CHECK_EQ(testFds.idleRet, FDS_SUCCESS);
+    TEST_CHECK_EQ(testFds.writeRet, FDS_SUCCESS);
+    TEST_CHECK_EQ(testErases(), erases + 1);
+    TEST_CHECK_EQ(fds_gc_stat(&stat), FDS_SUCCESS);
+    TEST_CHECK_EQ(stat.idle_slices, before.idle_slices + 1);
+    TEST_CHECK_EQ(stat.idle_yields, before.idle_yields + 1);
+    TEST_CHECK_EQ(stat.stalls, before.stalls + 1);
+    TEST_CHECK(stat.stall_steps > before.stall_steps);
+    TEST_CHECK(stat.stall_time_max > 0);
+    TEST_CHECK_EQ(testValue(TEST_KEY_QUEUED), 0xCAFE);
+    TEST_CHECK_EQ(testValue(TEST_KEY_UPDATED), value);
+
+    // queued behind nothing: stopped run is resumed even if not worth starting
+    TEST_CHECK_EQ(fds_gc_idle(FDS_VIRTUAL_PAGES), FDS_SUCCESS);
+    TEST_CHECK_EQ(fds_gc_stat(&stat), FDS_SUCCESS);
+    TEST_CHECK_EQ(stat.runs, before.runs + 1);
+    TEST_CHECK_EQ(stat.stalls, before.stalls + 1);
+    TEST_CHECK_EQ(testValue(TEST_KEY_STATIC), 0x5A5A);
+}
+
+
+int main(void)
+{
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    fds_gc_time_source_set(testTimeGet);
+    TEST_CHECK_EQ(fds_register(testFdsHandler), FDS_SUCCESS);
+    TEST_CHECK_EQ(fds_init(), FDS_SUCCESS);
+    TEST_CHECK(testFds.isInit);
+    testSlice();
+    testYield();
+    return testResult("fdsGcIdleTest");
+}
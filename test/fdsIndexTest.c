@@ -0,0 +1,171 @@
+/*file: fdsIndexTest.c
+ *
+ * Test of FDS record search by file ID and record key over file backed fstorage, built with and without RAM
+ * index (FDS_RAM_INDEX_ENABLED from make). Find and delete loop: each found record is deleted before the next
+ * search with the same token, every record is returned once, also after updates moved some of them.
+ * Records written during search are found by it. Search order is flash scan order (page, address),
+ * checked against search by file ID only, which always scans flash.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+#include "unistd.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+#include "testCheck.h"
+
+#define TEST_FILE              0x1111
+#define TEST_KEY               0x2222
+#define TEST_RECORDS           10
+#define TEST_UPDATE_STEP       3               // every third record is updated, it moves to flash end
+
+static uint32_t testData[2 * TEST_RECORDS];
+static bool     testIsInit;
+
+
+static void testFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        testIsInit = (p_evt->result == FDS_SUCCESS);
+    }
+}
+
+
+static ret_code_t testWrite(fds_record_desc_t *desc, uint32_t *data, bool isUpdate)
+{
+    fds_record_t record = {.file_id = TEST_FILE, .key = TEST_KEY, .data = {.p_data = data, .length_words = 1}};
+
+    return isUpdate ? fds_record_update(desc, &record) : fds_record_write(desc, &record);
+}
+
+
+static uint32_t testValue(fds_record_desc_t *desc)
+{
+    fds_flash_record_t flashRecord;
+    uint32_t           value = 0xFFFFFFFF;
+
+    if(fds_record_open(desc, &flashRecord) == FDS_SUCCESS)
+    {
+        value = *(const uint32_t *)flashRecord.p_data;
+        (void)fds_record_close(desc);
+    }
+    return value;
+}
+
+
+static void testFill(void)
+{
+    fds_record_desc_t desc[TEST_RECORDS];
+
+    for(uint32_t cnt = 0; cnt < TEST_RECORDS; cnt++)
+    {
+        testData[cnt] = cnt;
+        memset(&desc[cnt], 0, sizeof(desc[cnt]));
+        TEST_CHECK_EQ(testWrite(&desc[cnt], &testData[cnt], false), FDS_SUCCESS);
+    }
+    for(uint32_t cnt = 0; cnt < TEST_RECORDS; cnt += TEST_UPDATE_STEP)
+    {
+        testData[TEST_RECORDS + cnt] = TEST_RECORDS + cnt;
+        TEST_CHECK_EQ(testWrite(&desc[cnt], &testData[TEST_RECORDS + cnt], true), FDS_SUCCESS);
+    }
+}
+
+
+// search by file and key gives the same records in the same order as flash scan by file
+static void testOrder(void)
+{
+    fds_find_token_t  keyToken;
+    fds_find_token_t  fileToken;
+    fds_record_desc_t keyDesc;
+    fds_record_desc_t fileDesc;
+    uint32_t          found = 0;
+
+    memset(&keyToken, 0, sizeof(keyToken));
+    memset(&fileToken, 0, sizeof(fileToken));
+    while(fds_record_find(TEST_FILE, TEST_KEY, &keyDesc, &keyToken) == FDS_SUCCESS)
+    {
+        TEST_CHECK_EQ(fds_record_find_in_file(TEST_FILE, &fileDesc, &fileToken), FDS_SUCCESS);
+        TEST_CHECK_EQ(keyDesc.record_id, fileDesc.record_id);
+        found++;
+    }
+    TEST_CHECK_EQ(fds_record_find_in_file(TEST_FILE, &fileDesc, &fileToken), FDS_ERR_NOT_FOUND);
+    TEST_CHECK_EQ(found, TEST_RECORDS);
+}
+
+
+static void testFindDelete(void)
+{
+    fds_find_token_t  token;
+    fds_record_desc_t desc;
+    uint32_t          seen[2 * TEST_RECORDS] = {0};
+    uint32_t          found = 0;
+
+    memset(&token, 0, sizeof(token));
+    while(fds_record_find(TEST_FILE, TEST_KEY, &desc, &token) == FDS_SUCCESS && found <= 2 * TEST_RECORDS)
+    {
+        uint32_t value = testValue(&desc);
+
+        TEST_CHECK(value < 2 * TEST_RECORDS);
+        if(value < 2 * TEST_RECORDS)
+        {
+            seen[value]++;
+        }
+        TEST_CHECK_EQ(fds_record_delete(&desc), FDS_SUCCESS);
+        found++;
+    }
+    TEST_CHECK_EQ(found, TEST_RECORDS);
+    for(uint32_t cnt = 0; cnt < TEST_RECORDS; cnt++)
+    {
+        uint32_t value = (cnt % TEST_UPDATE_STEP == 0) ? TEST_RECORDS + cnt : cnt;
+
+        TEST_CHECK_EQ(seen[value], 1);
+    }
+
+    memset(&token, 0, sizeof(token));
+    TEST_CHECK_EQ(fds_record_find(TEST_FILE, TEST_KEY, &desc, &token), FDS_ERR_NOT_FOUND);
+}
+
+
+// each found record adds one: records written during search come after the token
+static void testFindWrite(void)
+{
+    fds_find_token_t  token;
+    fds_record_desc_t desc;
+    uint32_t          found = 0;
+
+    testData[0] = 0;
+    memset(&desc, 0, sizeof(desc));
+    TEST_CHECK_EQ(testWrite(&desc, &testData[0], false), FDS_SUCCESS);
+    memset(&token, 0, sizeof(token));
+    while(fds_record_find(TEST_FILE, TEST_KEY, &desc, &token) == FDS_SUCCESS && found < 2 * TEST_RECORDS)
+    {
+        TEST_CHECK_EQ(testValue(&desc), found);
+        found++;
+        if(found < TEST_RECORDS)
+        {
+            testData[found] = found;
+            TEST_CHECK_EQ(testWrite(&desc, &testData[found], false), FDS_SUCCESS);
+        }
+    }
+    TEST_CHECK_EQ(found, TEST_RECORDS);
+}
+
+
+int main(void)
+{
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    TEST_CHECK_EQ(fds_register(testFdsHandler), FDS_SUCCESS);
+    TEST_CHECK_EQ(fds_init(), FDS_SUCCESS);
+    TEST_CHECK(testIsInit);
+
+    testFill();
+    testOrder();
+    testFindDelete();
+    testFindWrite();
+    printf("RAM index %u: ", FDS_RAM_INDEX_ENABLED);
+    return testResult("fdsIndexTest");
+}
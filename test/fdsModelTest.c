@@ -0,0 +1,205 @@
+/*file: fdsModelTest.c
+ *
+ * Random operation test of FDS over file backed fstorage against a model of stored records: writes, updates
+ * and deletes of TEST_RECORDS records in TEST_FILES files, garbage collection (full and idle slices) between
+ * them. After each step every file is enumerated (search by file ID, flash scan) and each live record is found
+ * by file ID and record key (RAM index when built with it): each live record is found once with its data,
+ * nothing else is found. Each seed runs in its own process on new flash.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+#include "testCheck.h"
+
+#define TEST_RECORDS           40
+#define TEST_FILES             3
+#define TEST_STEPS             4000
+#define TEST_SEEDS             4
+#define TEST_DATA_WORDS        4
+#define TEST_KEY_BASE          0x100
+
+typedef struct
+{
+    bool     isLive;
+    uint32_t recordId;
+    uint16_t fileId;
+    uint32_t value;                            // first data word
+}testModelT;
+
+static testModelT testModel[TEST_RECORDS];
+static uint32_t   testData[TEST_RECORDS][TEST_DATA_WORDS];
+static bool       testIsInit;
+
+
+static void testFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        testIsInit = (p_evt->result == FDS_SUCCESS);
+    }
+}
+
+
+static uint16_t testFile(uint32_t rec)
+{
+    return 1 + rec % TEST_FILES;
+}
+
+
+static bool testValueIs(fds_record_desc_t *desc, uint32_t value)
+{
+    fds_flash_record_t flashRecord;
+    bool               isEqual;
+
+    if(fds_record_open(desc, &flashRecord) != FDS_SUCCESS)
+    {
+        return false;
+    }
+    isEqual = *(const uint32_t *)flashRecord.p_data == value;
+    (void)fds_record_close(desc);
+    return isEqual;
+}
+
+
+// errors of one file: unknown or repeated record, wrong data, live record not found
+static uint32_t testFileCheck(uint16_t fileId)
+{
+    fds_find_token_t  token;
+    fds_record_desc_t desc;
+    uint32_t          seen[TEST_RECORDS] = {0};
+    uint32_t          errors = 0;
+    uint32_t          found  = 0;
+
+    memset(&token, 0, sizeof(token));
+    while(fds_record_find_in_file(fileId, &desc, &token) == FDS_SUCCESS && found++ <= TEST_RECORDS)
+    {
+        uint32_t rec = 0;
+
+        while(rec < TEST_RECORDS && !(testModel[rec].isLive && testModel[rec].recordId == desc.record_id))
+        {
+            rec++;
+        }
+        if(rec == TEST_RECORDS || seen[rec]++ != 0 || !testValueIs(&desc, testModel[rec].value))
+        {
+            errors++;
+        }
+    }
+    for(uint32_t rec = 0; rec < TEST_RECORDS; rec++)
+    {
+        if(testModel[rec].isLive && testModel[rec].fileId == fileId)
+        {
+            errors += (seen[rec] != 1);
+            memset(&token, 0, sizeof(token));
+            errors += fds_record_find(fileId, TEST_KEY_BASE + rec, &desc, &token) != FDS_SUCCESS ||
+                      desc.record_id != testModel[rec].recordId;
+            errors += fds_record_find(fileId, TEST_KEY_BASE + rec, &desc, &token) != FDS_ERR_NOT_FOUND;
+        }
+    }
+    return errors;
+}
+
+
+static void testStep(uint32_t rec, uint32_t op)
+{
+    fds_record_desc_t desc;
+    fds_record_t      record;
+    ret_code_t        ret;
+
+    memset(&desc, 0, sizeof(desc));
+    if(!testModel[rec].isLive || op < 3)
+    {
+        testData[rec][0]          = rand();
+        record.file_id            = testFile(rec);
+        record.key                = TEST_KEY_BASE + rec;
+        record.data.p_data        = testData[rec];
+        record.data.length_words  = 1 + rand() % TEST_DATA_WORDS;
+        if(testModel[rec].isLive)
+        {
+            TEST_CHECK_EQ(fds_descriptor_from_rec_id(&desc, testModel[rec].recordId), FDS_SUCCESS);
+            ret = fds_record_update(&desc, &record);
+        }
+        else
+        {
+            ret = fds_record_write(&desc, &record);
+        }
+        if(ret == FDS_ERR_NO_SPACE_IN_FLASH)
+        {
+            TEST_CHECK_EQ(fds_gc(), FDS_SUCCESS);
+            return;
+        }
+        TEST_CHECK_EQ(ret, FDS_SUCCESS);
+        testModel[rec] = (testModelT){true, desc.record_id, testFile(rec), testData[rec][0]};
+    }
+    else if(op < 5)
+    {
+        TEST_CHECK_EQ(fds_descriptor_from_rec_id(&desc, testModel[rec].recordId), FDS_SUCCESS);
+        TEST_CHECK_EQ(fds_record_delete(&desc), FDS_SUCCESS);
+        testModel[rec].isLive = false;
+    }
+    else if(op < 6)
+    {
+        TEST_CHECK_EQ(fds_gc(), FDS_SUCCESS);
+    }
+    else if(op < 7)
+    {
+        (void)fds_gc_idle(1);
+    }
+}
+
+
+static int testSeed(uint32_t seed)
+{
+    uint32_t errorSteps = 0;
+
+    srand(seed);
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    TEST_CHECK_EQ(fds_register(testFdsHandler), FDS_SUCCESS);
+    TEST_CHECK_EQ(fds_init(), FDS_SUCCESS);
+    TEST_CHECK(testIsInit);
+    for(uint32_t step = 0; step < TEST_STEPS && testIsInit; step++)
+    {
+        uint32_t rec    = rand() % TEST_RECORDS;
+        uint32_t errors = 0;
+
+        testStep(rec, rand() % 10);
+        for(uint16_t fileId = 1; fileId <= TEST_FILES; fileId++)
+        {
+            errors += testFileCheck(fileId);
+        }
+        if(errors != 0 && errorSteps++ < 5)
+        {
+            printf("seed %u step %u: %u records differ from model\n", seed, step, errors);
+        }
+    }
+    TEST_CHECK_EQ(errorSteps, 0);
+    printf("seed %u, RAM index %u: ", seed, FDS_RAM_INDEX_ENABLED);
+    return testResult("fdsModelTest");
+}
+
+
+int main(void)
+{
+    for(uint32_t seed = 1; seed <= TEST_SEEDS; seed++)
+    {
+        int status;
+
+        if(fork() == 0)
+        {
+            return testSeed(seed);
+        }
+        wait(&status);
+        if(status != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,354 @@
+/*file: fdsTelemetryTest.c
+ *
+ * Test of FDS operation counters (FDS_TELEMETRY_ENABLED) over file backed fstorage. Each phase runs in its own
+ * process (FDS is initialized once per process) and sends counters after fds_init() and after its operations
+ * to the test process:
+ *   - phase 0: new flash, records of TEST_FILES files (the last two share the other entry), updates, record
+ *     and file deletes, writes queued from event handler until queue is full, garbage collection, save
+ *   - phase 1: counters loaded by fds_init() equal the saved ones, more writes, file delete and garbage
+ *     collection add to them, save again
+ *   - phase 2: fds_init() only, counters equal the second save
+ * File counters are checked against the operations made, fds_stat() against fds_stat_erase_count() and the
+ * previous phase. Flash image is left for fds_wear (make test runs it).
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+#include "testCheck.h"
+
+#define TEST_FILES             (FDS_TELEMETRY_FILES + 2)
+#define TEST_FILE(N)           (0x1000 + (N))
+#define TEST_FILE_UNKNOWN      0x1FFF          // never written
+#define TEST_KEY_QUEUED        0x100           // writes queued from event handler
+#define TEST_DATA_WORDS        8
+#define TEST_UPDATES           3
+#define TEST_PHASES            3
+
+typedef struct
+{
+    ret_code_t      result;                    // first failed FDS call, FDS_SUCCESS - none
+    uint32_t        queued;                    // writes queued from event handler before queue was full
+    fds_stat_t      stat;
+    uint32_t        eraseCount[FDS_VIRTUAL_PAGES];
+    ret_code_t      fileResult[TEST_FILES];
+    fds_file_stat_t file[TEST_FILES];
+    fds_file_stat_t other;
+    ret_code_t      unknownResult;             // fds_stat_file() of file never written
+    ret_code_t      pageResult;                // fds_stat_erase_count() of page out of range
+    ret_code_t      nullResult;                // fds_stat_erase_count() and fds_stat_file() without output
+}testSnapT;
+
+static uint32_t testData[TEST_DATA_WORDS];
+
+static struct
+{
+    bool       isInit;
+    bool       isQueueFill;                    // next write event queues writes until queue is full
+    uint32_t   queued;
+    ret_code_t fillResult;
+    bool       isSaved;                        // write event of telemetry record
+    uint32_t   gcEvents;
+}testFds;
+
+// expected file counters, test process
+static fds_file_stat_t testModel[TEST_FILES];
+
+
+/*********phase processes****************/
+static void testFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        testFds.isInit = (p_evt->result == FDS_SUCCESS);
+    }
+    else if(p_evt->id == FDS_EVT_GC)
+    {
+        testFds.gcEvents++;
+    }
+    else if(p_evt->id == FDS_EVT_WRITE || p_evt->id == FDS_EVT_UPDATE)
+    {
+        testFds.isSaved = testFds.isSaved || (p_evt->write.file_id == 0xBFFE && p_evt->result == FDS_SUCCESS);
+        if(testFds.isQueueFill)
+        {
+            fds_record_t record = {.file_id = TEST_FILE(0), .data = {.p_data = testData, .length_words = 1}};
+
+            testFds.isQueueFill = false;
+            do
+            {
+                record.key         = TEST_KEY_QUEUED + testFds.queued;
+                testFds.fillResult = fds_record_write(NULL, &record);
+            }while(testFds.fillResult == FDS_SUCCESS && ++testFds.queued < 2 * FDS_OP_QUEUE_SIZE);
+        }
+    }
+}
+
+
+static void testResultKeep(testSnapT *snap, ret_code_t ret)
+{
+    if(snap->result == FDS_SUCCESS)
+    {
+        snap->result = ret;
+    }
+}
+
+
+static void testSnapTake(testSnapT *snap)
+{
+    fds_file_stat_t fileStat;
+
+    memset(snap, 0, sizeof(*snap));
+    testResultKeep(snap, fds_stat(&snap->stat));
+    for(uint16_t page = 0; page < FDS_VIRTUAL_PAGES; page++)
+    {
+        testResultKeep(snap, fds_stat_erase_count(page, &snap->eraseCount[page]));
+    }
+    for(uint16_t file = 0; file < TEST_FILES; file++)
+    {
+        snap->fileResult[file] = fds_stat_file(TEST_FILE(file), &snap->file[file]);
+    }
+    testResultKeep(snap, fds_stat_file(FDS_FILE_ID_INVALID, &snap->other));
+    snap->unknownResult = fds_stat_file(TEST_FILE_UNKNOWN, &fileStat);
+    snap->pageResult    = fds_stat_erase_count(FDS_VIRTUAL_PAGES, &snap->eraseCount[0]);
+    if(fds_stat_erase_count(0, NULL) == FDS_ERR_NULL_ARG && fds_stat_file(TEST_FILE(0), NULL) == FDS_ERR_NULL_ARG)
+    {
+        snap->nullResult = FDS_ERR_NULL_ARG;
+    }
+}
+
+
+static ret_code_t testWrite(fds_record_desc_t *desc, uint16_t file, uint16_t key)
+{
+    fds_record_t record = {.file_id = TEST_FILE(file), .key = key,
+                           .data = {.p_data = testData, .length_words = TEST_DATA_WORDS}};
+
+    testData[0] = (uint32_t)file << 16 | key;
+    return fds_record_write(desc, &record);
+}
+
+
+static void testPhase0(testSnapT *snap)
+{
+    fds_record_desc_t desc[TEST_FILES];
+    fds_record_t      record = {.file_id = TEST_FILE(0), .key = 1,
+                                .data = {.p_data = testData, .length_words = TEST_DATA_WORDS}};
+
+    // file N gets N + 1 records, the last one is kept
+    for(uint16_t file = 0; file < TEST_FILES; file++)
+    {
+        for(uint16_t key = 1; key <= file + 1; key++)
+        {
+            testResultKeep(snap, testWrite(&desc[file], file, key));
+        }
+    }
+    for(uint32_t cnt = 0; cnt < TEST_UPDATES; cnt++)
+    {
+        testResultKeep(snap, fds_record_update(&desc[0], &record));
+    }
+    testResultKeep(snap, fds_record_delete(&desc[1]));
+    testResultKeep(snap, fds_file_delete(TEST_FILE(TEST_FILES - 1)));
+
+    testFds.isQueueFill = true;
+    testResultKeep(snap, testWrite(NULL, 2, 0x10));
+    testResultKeep(snap, (testFds.fillResult == FDS_ERR_NO_SPACE_IN_QUEUES) ? FDS_SUCCESS : FDS_ERR_INTERNAL);
+    snap->queued = testFds.queued;
+    testResultKeep(snap, fds_gc());
+}
+
+
+static void testPhase1(testSnapT *snap)
+{
+    testResultKeep(snap, testWrite(NULL, 0, 0x20));
+    testResultKeep(snap, testWrite(NULL, 0, 0x21));
+    testResultKeep(snap, fds_file_delete(TEST_FILE(TEST_FILES - 2)));
+    testResultKeep(snap, fds_gc());
+}
+
+
+// counters after fds_init() and after phase operations go to pipe
+static int testPhaseRun(uint32_t phase, int pipeOut)
+{
+    testSnapT snap[2];
+
+    if(phase == 0)
+    {
+        unlink(NRF_FSTORAGE_FILE_NAME);
+    }
+    if(fds_register(testFdsHandler) != FDS_SUCCESS || fds_init() != FDS_SUCCESS || !testFds.isInit)
+    {
+        return 1;
+    }
+    testSnapTake(&snap[0]);
+    if(phase == 0)
+    {
+        testPhase0(&snap[1]);
+    }
+    else if(phase == 1)
+    {
+        testPhase1(&snap[1]);
+    }
+    if(snap[1].result == FDS_SUCCESS)
+    {
+        uint32_t  queued = snap[1].queued;
+        ret_code_t result;
+
+        testSnapTake(&snap[1]);
+        snap[1].queued = queued;
+        if(phase < TEST_PHASES - 1)
+        {
+            result         = fds_telemetry_save();
+            snap[1].result = (result == FDS_SUCCESS && !testFds.isSaved) ? FDS_ERR_INTERNAL : result;
+        }
+    }
+    return (write(pipeOut, snap, sizeof(snap)) == (ssize_t)sizeof(snap)) ? 0 : 1;
+}
+
+
+static bool testPhaseFork(uint32_t phase, testSnapT snap[2])
+{
+    int   fd[2];
+    pid_t pid;
+    int   status;
+    bool  isRead;
+
+    fflush(stdout);
+    if(pipe(fd) != 0)
+    {
+        return false;
+    }
+    pid = fork();
+    if(pid == 0)
+    {
+        close(fd[0]);
+        exit(testPhaseRun(phase, fd[1]));
+    }
+    close(fd[1]);
+    isRead = (pid > 0 && read(fd[0], snap, 2 * sizeof(snap[0])) == (ssize_t)(2 * sizeof(snap[0])));
+    close(fd[0]);
+    return isRead && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+
+/*********test****************/
+static uint32_t testEraseSum(const testSnapT *snap)
+{
+    uint32_t sum = 0;
+
+    for(uint16_t page = 0; page < FDS_VIRTUAL_PAGES; page++)
+    {
+        sum += snap->eraseCount[page];
+    }
+    return sum;
+}
+
+
+static uint32_t testEraseMax(const testSnapT *snap)
+{
+    uint32_t max = 0;
+
+    for(uint16_t page = 0; page < FDS_VIRTUAL_PAGES; page++)
+    {
+        max = (snap->eraseCount[page] > max) ? snap->eraseCount[page] : max;
+    }
+    return max;
+}
+
+
+// operation counters of both snapshots are equal
+static void testSnapEqual(const testSnapT *snap, const testSnapT *saved)
+{
+    TEST_CHECK_EQ(snap->stat.erase_count_max, saved->stat.erase_count_max);
+    TEST_CHECK_EQ(snap->stat.gc_runs, saved->stat.gc_runs);
+    TEST_CHECK_EQ(snap->stat.gc_bytes_copied, saved->stat.gc_bytes_copied);
+    TEST_CHECK_EQ(snap->stat.queue_full, saved->stat.queue_full);
+    TEST_CHECK_EQ(snap->stat.queue_depth_max, saved->stat.queue_depth_max);
+    TEST_CHECK(memcmp(snap->eraseCount, saved->eraseCount, sizeof(snap->eraseCount)) == 0);
+    TEST_CHECK(memcmp(snap->fileResult, saved->fileResult, sizeof(snap->fileResult)) == 0);
+    TEST_CHECK(memcmp(snap->file, saved->file, sizeof(snap->file)) == 0);
+    TEST_CHECK(memcmp(&snap->other, &saved->other, sizeof(snap->other)) == 0);
+}
+
+
+// file counters against operations made, the first FDS_TELEMETRY_FILES files have own entries
+static void testSnapModel(const testSnapT *snap)
+{
+    fds_file_stat_t other = {0, 0};
+
+    for(uint16_t file = 0; file < TEST_FILES; file++)
+    {
+        if(file < FDS_TELEMETRY_FILES)
+        {
+            TEST_CHECK_EQ(snap->fileResult[file], FDS_SUCCESS);
+            TEST_CHECK_EQ(snap->file[file].writes, testModel[file].writes);
+            TEST_CHECK_EQ(snap->file[file].deletes, testModel[file].deletes);
+            continue;
+        }
+        TEST_CHECK_EQ(snap->fileResult[file], FDS_ERR_NOT_FOUND);
+        other.writes  += testModel[file].writes;
+        other.deletes += testModel[file].deletes;
+    }
+    TEST_CHECK_EQ(snap->other.writes, other.writes);
+    TEST_CHECK_EQ(snap->other.deletes, other.deletes);
+    TEST_CHECK_EQ(snap->unknownResult, FDS_ERR_NOT_FOUND);
+    TEST_CHECK_EQ(snap->pageResult, FDS_ERR_INVALID_ARG);
+    TEST_CHECK_EQ(snap->nullResult, FDS_ERR_NULL_ARG);
+    TEST_CHECK_EQ(snap->stat.erase_count_max, testEraseMax(snap));
+}
+
+
+static void testTelemetry(void)
+{
+    testSnapT snap[TEST_PHASES][2];
+
+    for(uint32_t phase = 0; phase < TEST_PHASES; phase++)
+    {
+        TEST_CHECK(testPhaseFork(phase, snap[phase]));
+        TEST_CHECK_EQ(snap[phase][1].result, FDS_SUCCESS);
+    }
+
+    // phase 0: records, updates (new copy and delete of old one), record delete, file delete of the last file
+    for(uint16_t file = 0; file < TEST_FILES; file++)
+    {
+        testModel[file].writes = file + 1;
+    }
+    testModel[0].writes              += TEST_UPDATES + snap[0][1].queued;
+    testModel[0].deletes             += TEST_UPDATES;
+    testModel[1].deletes             += 1;
+    testModel[2].writes              += 1;
+    testModel[TEST_FILES - 1].deletes = TEST_FILES;
+    testSnapModel(&snap[0][1]);
+    TEST_CHECK_EQ(snap[0][0].stat.gc_runs, 0);
+    TEST_CHECK_EQ(snap[0][1].stat.gc_runs, 1);
+    TEST_CHECK(snap[0][1].stat.gc_bytes_copied != 0);
+    TEST_CHECK_EQ(snap[0][1].stat.queue_full, 1);
+    TEST_CHECK(snap[0][1].queued != 0 && snap[0][1].stat.queue_depth_max >= snap[0][1].queued);
+    TEST_CHECK(testEraseSum(&snap[0][1]) > testEraseSum(&snap[0][0]));
+
+    // phase 1: loaded counters are the saved ones, the new ones add to them
+    testSnapEqual(&snap[1][0], &snap[0][1]);
+    testModel[0].writes              += 2;
+    testModel[TEST_FILES - 2].deletes = TEST_FILES - 1;
+    testSnapModel(&snap[1][1]);
+    TEST_CHECK_EQ(snap[1][1].stat.gc_runs, 2);
+    TEST_CHECK(snap[1][1].stat.gc_bytes_copied > snap[0][1].stat.gc_bytes_copied);
+    TEST_CHECK_EQ(snap[1][1].stat.queue_full, 1);
+    TEST_CHECK(testEraseSum(&snap[1][1]) > testEraseSum(&snap[0][1]));
+
+    // phase 2: the second save is loaded, not added to the first one again
+    testSnapEqual(&snap[2][0], &snap[1][1]);
+}
+
+
+int main(void)
+{
+    testTelemetry();
+    printf("%u files, %u pages: ", TEST_FILES, FDS_VIRTUAL_PAGES);
+    return testResult("fdsTelemetryTest");
+}
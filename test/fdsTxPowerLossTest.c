@@ -0,0 +1,371 @@
+/*file: fdsTxPowerLossTest.c
+ *
+ * Power loss fuzz test of FDS transactions (fds_tx_*) over file backed fstorage. Each seed makes a random
+ * transaction (1 to FDS_TX_MAX_RECORDS new or updated records of random length) behind random filler records,
+ * so that records and commit marker fall anywhere in flash. Power is lost in every flash operation of the
+ * commit in turn: one process sets up flash and runs the transaction until power loss, a new process
+ * initializes FDS (recovery) and checks that all transaction records are found with old data or all with new
+ * data, each once, fillers are intact and a next transaction can be committed. Old view has to turn into new
+ * view at one operation (commit point) and stay. Power loss during recovery is not injected.
+ * Reserved file IDs (commit markers 0xBFFF, telemetry 0xBFFE) are refused to write, update, file delete and
+ * transaction records.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+#include "testCheck.h"
+
+#define TEST_SEEDS             500
+#define TEST_LOSS_MAX          100             // power loss points of one commit, more is an error
+#define TEST_FILLERS_MAX       60
+#define TEST_FILLER_WORDS      24
+#define TEST_FILLER_FILE       0x100
+#define TEST_TX_WORDS          8
+#define TEST_TX_KEY            0x10
+#define TEST_NEXT_KEY          0x20            // record of transaction after recovery
+#define TEST_OLD_VALUE(N)      (0x01000000 | (N))
+#define TEST_NEW_VALUE(N)      (0x02000000 | (N))
+
+// exit codes of child processes
+#define TEST_VIEW_OLD          0               // check: records before transaction
+#define TEST_VIEW_NEW          1               // check: records of transaction
+#define TEST_POWER_LOST        0               // transaction: power lost during commit
+#define TEST_TX_DONE           2               // transaction: completed without power loss
+#define TEST_ERROR             3
+#define TEST_RESERVED_OK       4               // reserved: all refused
+
+typedef struct
+{
+    uint16_t fillers;
+    uint16_t fillerWords[TEST_FILLERS_MAX];
+    uint16_t count;                            // records in transaction
+    bool     isUpdate[FDS_TX_MAX_RECORDS];     // otherwise new record
+    uint16_t oldWords[FDS_TX_MAX_RECORDS];
+    uint16_t newWords[FDS_TX_MAX_RECORDS];
+}testTxT;
+
+static testTxT  testTx;
+static uint32_t testData[FDS_TX_MAX_RECORDS][TEST_TX_WORDS];
+static uint32_t testFillerData[TEST_FILLER_WORDS];
+
+static struct
+{
+    bool       isInit;
+    bool       isTxEvt;
+    ret_code_t txResult;
+}testFds;
+
+
+static void testFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        testFds.isInit = (p_evt->result == FDS_SUCCESS);
+    }
+    else if(p_evt->id == FDS_EVT_TX)
+    {
+        testFds.isTxEvt  = true;
+        testFds.txResult = p_evt->result;
+    }
+}
+
+
+static uint16_t testFile(uint16_t rec)
+{
+    return 1 + rec % 2;
+}
+
+
+static void testFill(uint32_t *data, uint32_t words, uint32_t value)
+{
+    for(uint32_t cnt = 0; cnt < words; cnt++)
+    {
+        data[cnt] = value;
+    }
+}
+
+
+// number of records found by file ID and key, last one is opened and compared: 1 for every data word equal to
+// value and length words, 0 otherwise
+static uint32_t testFind(uint16_t fileId, uint16_t key, uint32_t value, uint16_t words, bool *isEqual)
+{
+    fds_find_token_t   token;
+    fds_record_desc_t  desc;
+    fds_flash_record_t flashRecord;
+    uint32_t           found = 0;
+
+    *isEqual = false;
+    memset(&token, 0, sizeof(token));
+    while(fds_record_find(fileId, key, &desc, &token) == FDS_SUCCESS && found++ <= FDS_TX_MAX_RECORDS)
+    {
+        if(fds_record_open(&desc, &flashRecord) != FDS_SUCCESS)
+        {
+            *isEqual = false;
+            continue;
+        }
+        *isEqual = (flashRecord.p_header->length_words == words);
+        for(uint32_t cnt = 0; cnt < flashRecord.p_header->length_words && *isEqual; cnt++)
+        {
+            *isEqual = ((const uint32_t *)flashRecord.p_data)[cnt] == value;
+        }
+        (void)fds_record_close(&desc);
+    }
+    return found;
+}
+
+
+static bool testInit(void)
+{
+    return fds_register(testFdsHandler) == FDS_SUCCESS && fds_init() == FDS_SUCCESS && testFds.isInit;
+}
+
+
+/*********child processes****************/
+// new flash: fillers and old records, then transaction with power loss in operation lossOp
+static int testTxRun(uint32_t lossOp)
+{
+    fds_record_desc_t desc[FDS_TX_MAX_RECORDS];
+    fds_record_t      record;
+    ret_code_t        ret = FDS_SUCCESS;
+
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    if(!testInit())
+    {
+        return TEST_ERROR;
+    }
+    for(uint16_t cnt = 0; cnt < testTx.fillers && ret == FDS_SUCCESS; cnt++)
+    {
+        fds_record_desc_t fillerDesc;
+
+        testFill(testFillerData, testTx.fillerWords[cnt], cnt);
+        record = (fds_record_t){.file_id = TEST_FILLER_FILE, .key = 1 + cnt,
+                                .data = {.p_data = testFillerData, .length_words = testTx.fillerWords[cnt]}};
+        ret    = fds_record_write(&fillerDesc, &record);
+    }
+    for(uint16_t rec = 0; rec < testTx.count && ret == FDS_SUCCESS; rec++)
+    {
+        if(testTx.isUpdate[rec])
+        {
+            testFill(testData[rec], testTx.oldWords[rec], TEST_OLD_VALUE(rec));
+            record = (fds_record_t){.file_id = testFile(rec), .key = TEST_TX_KEY + rec,
+                                    .data = {.p_data = testData[rec], .length_words = testTx.oldWords[rec]}};
+            ret    = fds_record_write(&desc[rec], &record);
+        }
+    }
+    if(ret != FDS_SUCCESS)
+    {
+        printf("flash setup failed: %u\n", ret);
+        return TEST_ERROR;
+    }
+
+    nrf_fstorage_file_power_loss_set(lossOp);
+    ret = fds_tx_begin();
+    for(uint16_t rec = 0; rec < testTx.count && ret == FDS_SUCCESS; rec++)
+    {
+        testFill(testData[rec], testTx.newWords[rec], TEST_NEW_VALUE(rec));
+        record = (fds_record_t){.file_id = testFile(rec), .key = TEST_TX_KEY + rec,
+                                .data = {.p_data = testData[rec], .length_words = testTx.newWords[rec]}};
+        ret    = testTx.isUpdate[rec] ? fds_tx_update(&desc[rec], &record) : fds_tx_write(&record);
+    }
+    if(ret == FDS_SUCCESS)
+    {
+        ret = fds_tx_commit();
+    }
+    if(ret != FDS_SUCCESS)
+    {
+        printf("transaction not committed: %u\n", ret);
+        return TEST_ERROR;
+    }
+    if(nrf_fstorage_file_is_power_lost())
+    {
+        return TEST_POWER_LOST;
+    }
+    return (testFds.isTxEvt && testFds.txResult == FDS_SUCCESS) ? TEST_TX_DONE : TEST_ERROR;
+}
+
+
+// after power loss: view of transaction records
+static int testCheckView(uint32_t lossOp)
+{
+    fds_record_t record;
+    uint32_t     nextData = 0x5A5A5A5A;
+    bool         isOld    = true;
+    bool         isNew    = true;
+    bool         isEqual;
+
+    if(!testInit())
+    {
+        printf("power loss at %u: initialization failed\n", lossOp);
+        return TEST_ERROR;
+    }
+    for(uint16_t rec = 0; rec < testTx.count; rec++)
+    {
+        uint32_t found;
+
+        found  = testFind(testFile(rec), TEST_TX_KEY + rec, TEST_NEW_VALUE(rec), testTx.newWords[rec], &isEqual);
+        isNew &= (found == 1) && isEqual;
+        found  = testFind(testFile(rec), TEST_TX_KEY + rec, TEST_OLD_VALUE(rec), testTx.oldWords[rec], &isEqual);
+        isOld &= testTx.isUpdate[rec] ? (found == 1) && isEqual : (found == 0);
+    }
+    for(uint16_t cnt = 0; cnt < testTx.fillers; cnt++)
+    {
+        if(testFind(TEST_FILLER_FILE, 1 + cnt, cnt, testTx.fillerWords[cnt], &isEqual) != 1 || !isEqual)
+        {
+            printf("power loss at %u: filler %u lost\n", lossOp, cnt);
+            return TEST_ERROR;
+        }
+    }
+    if(isOld == isNew)
+    {
+        printf("power loss at %u: transaction records are torn\n", lossOp);
+        return TEST_ERROR;
+    }
+
+    // transaction isn't left open
+    record = (fds_record_t){.file_id = testFile(0), .key = TEST_NEXT_KEY, .data = {.p_data = &nextData,
+                                                                                    .length_words = 1}};
+    if(fds_tx_begin() != FDS_SUCCESS || fds_tx_write(&record) != FDS_SUCCESS || fds_tx_commit() != FDS_SUCCESS ||
+       !testFds.isTxEvt || testFds.txResult != FDS_SUCCESS ||
+       testFind(testFile(0), TEST_NEXT_KEY, nextData, 1, &isEqual) != 1 || !isEqual)
+    {
+        printf("power loss at %u: next transaction failed\n", lossOp);
+        return TEST_ERROR;
+    }
+    return isNew ? TEST_VIEW_NEW : TEST_VIEW_OLD;
+}
+
+
+// new flash: application record calls with reserved file IDs are refused
+static int testReservedRun(uint32_t lossOp)
+{
+    static const uint16_t fileId[] = {FDS_FILE_ID_INVALID, 0xBFFF, 0xBFFE};
+    fds_record_desc_t     desc;
+    fds_record_t          record = {.file_id = TEST_FILLER_FILE, .key = TEST_TX_KEY,
+                                    .data = {.p_data = testFillerData, .length_words = 1}};
+
+    (void)lossOp;
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    if(!testInit() || fds_record_write(&desc, &record) != FDS_SUCCESS)
+    {
+        return TEST_ERROR;
+    }
+    for(uint32_t cnt = 0; cnt < sizeof(fileId) / sizeof(fileId[0]); cnt++)
+    {
+        record.file_id = fileId[cnt];
+        if(fds_record_write(NULL, &record) != FDS_ERR_INVALID_ARG ||
+           fds_record_update(&desc, &record) != FDS_ERR_INVALID_ARG ||
+           fds_file_delete(fileId[cnt]) != FDS_ERR_INVALID_ARG ||
+           fds_tx_begin() != FDS_SUCCESS || fds_tx_write(&record) != FDS_ERR_INVALID_ARG ||
+           fds_tx_update(&desc, &record) != FDS_ERR_INVALID_ARG ||
+           fds_tx_commit() != FDS_ERR_INVALID_ARG)
+        {
+            printf("file ID 0x%04X is not refused\n", fileId[cnt]);
+            return TEST_ERROR;
+        }
+    }
+    return TEST_RESERVED_OK;
+}
+
+
+static int testFork(int (*child)(uint32_t), uint32_t lossOp)
+{
+    pid_t pid;
+    int   status;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid == 0)
+    {
+        exit(child(lossOp));
+    }
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+    {
+        return TEST_ERROR;
+    }
+    return WEXITSTATUS(status);
+}
+
+
+/*********tests****************/
+static void testScenario(uint32_t seed)
+{
+    srand(seed);
+    memset(&testTx, 0, sizeof(testTx));
+    testTx.fillers = rand() % (TEST_FILLERS_MAX + 1);
+    for(uint16_t cnt = 0; cnt < testTx.fillers; cnt++)
+    {
+        testTx.fillerWords[cnt] = 1 + rand() % TEST_FILLER_WORDS;
+    }
+    testTx.count = 1 + rand() % FDS_TX_MAX_RECORDS;
+    for(uint16_t rec = 0; rec < testTx.count; rec++)
+    {
+        testTx.isUpdate[rec] = rand() % 2;
+        testTx.oldWords[rec] = 1 + rand() % TEST_TX_WORDS;
+        testTx.newWords[rec] = 1 + rand() % TEST_TX_WORDS;
+    }
+}
+
+
+// returns number of power loss points
+static uint32_t testSeed(uint32_t seed)
+{
+    uint32_t lossOp;
+    uint32_t newFrom = 0;                      // first power loss point with new view
+    uint32_t errors  = 0;
+
+    testScenario(seed);
+    for(lossOp = 1; lossOp <= TEST_LOSS_MAX; lossOp++)
+    {
+        int status = testFork(testTxRun, lossOp);
+        int view;
+
+        if(status == TEST_TX_DONE)
+        {
+            break;
+        }
+        TEST_CHECK_EQ(status, TEST_POWER_LOST);
+        if(status != TEST_POWER_LOST)
+        {
+            return 0;
+        }
+        view = testFork(testCheckView, lossOp);
+        TEST_CHECK(view == TEST_VIEW_OLD || view == TEST_VIEW_NEW);
+        if(view == TEST_VIEW_NEW && newFrom == 0)
+        {
+            newFrom = lossOp;
+        }
+        errors += (view == TEST_VIEW_OLD && newFrom != 0);
+    }
+    if(errors != 0 || lossOp > TEST_LOSS_MAX)
+    {
+        printf("seed %u: %u records, new view from power loss %u, %u old views after it\n", seed, testTx.count,
+               newFrom, errors);
+    }
+    TEST_CHECK_EQ(errors, 0);
+    TEST_CHECK(lossOp <= TEST_LOSS_MAX);
+    // completed transaction with power loss in the last operation has written its marker
+    TEST_CHECK(newFrom != 0);
+    return lossOp - 1;
+}
+
+
+int main(void)
+{
+    uint32_t points = 0;
+
+    TEST_CHECK_EQ(testFork(testReservedRun, 0), TEST_RESERVED_OK);
+    for(uint32_t seed = 1; seed <= TEST_SEEDS; seed++)
+    {
+        points += testSeed(seed);
+    }
+    printf("%u seeds, %u power loss points, RAM index %u: ", TEST_SEEDS, points, FDS_RAM_INDEX_ENABLED);
+    return testResult("fdsTxPowerLossTest");
+}
@@ -0,0 +1,178 @@
+/*file: fstorageFileTest.c
+ *
+ * Unit test of file backed fstorage (nrf_fstorage_file) against NOR flash rules: erased flash reads 0xFF,
+ * write only clears bits (violation is counted), erase sets whole page, result is read through pointer at flash
+ * address and through nrf_fstorage_read(). Content and erase counts survive uninit/init. Injected power loss
+ * leaves write or erase half done, fails every next operation without event until init.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+#include "unistd.h"
+
+#include "nrf_fstorage.h"
+#include "nrf_fstorage_file.h"
+#include "testCheck.h"
+
+#define TEST_PAGE_SIZE         4096
+#define TEST_START_ADDR        0xF8000
+#define TEST_END_ADDR          0x100000
+#define TEST_PAGE_ADDR(N)      (TEST_START_ADDR + (N) * TEST_PAGE_SIZE)
+
+static struct
+{
+    uint32_t writes;
+    uint32_t erases;
+}testEvt;
+
+
+static void testFsHandler(nrf_fstorage_evt_t *p_evt)
+{
+    if(p_evt->result != NRF_SUCCESS)
+    {
+        return;
+    }
+    if(p_evt->id == NRF_FSTORAGE_EVT_WRITE_RESULT)
+    {
+        testEvt.writes++;
+    }
+    else if(p_evt->id == NRF_FSTORAGE_EVT_ERASE_RESULT)
+    {
+        testEvt.erases++;
+    }
+}
+
+
+NRF_FSTORAGE_DEF(nrf_fstorage_t testFs) =
+{
+    .evt_handler = testFsHandler,
+    .start_addr  = TEST_START_ADDR,
+    .end_addr    = TEST_END_ADDR,
+};
+
+
+static const uint32_t *testFlash(uint32_t addr)
+{
+    return (const uint32_t *)(uintptr_t)addr;
+}
+
+
+static bool testIsErased(uint32_t addr, uint32_t size)
+{
+    for(uint32_t cnt = 0; cnt < size / sizeof(uint32_t); cnt++)
+    {
+        if(testFlash(addr)[cnt] != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static void testWriteErase(void)
+{
+    static const uint32_t first[4]  = {0x0F0F0F0F, 0x12345678, 0x00000000, 0xFFFF0000};
+    static const uint32_t second[4] = {0xFF00FF00, 0x12345678, 0xFFFFFFFF, 0xFFFF0000};
+    nrf_fstorage_file_stat_t stat;
+    uint32_t                 readBack[4];
+
+    TEST_CHECK(testIsErased(TEST_START_ADDR, TEST_END_ADDR - TEST_START_ADDR));
+    TEST_CHECK_EQ(testFs.p_flash_info->erase_unit, TEST_PAGE_SIZE);
+
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_PAGE_ADDR(1), first, sizeof(first), NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(testEvt.writes, 1);
+    TEST_CHECK(memcmp(testFlash(TEST_PAGE_ADDR(1)), first, sizeof(first)) == 0);
+
+    // ones over zeros are ignored
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_PAGE_ADDR(1), second, sizeof(second), NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(testFlash(TEST_PAGE_ADDR(1))[0], 0x0F000F00);
+    TEST_CHECK_EQ(testFlash(TEST_PAGE_ADDR(1))[2], 0x00000000);
+    TEST_CHECK_EQ(nrf_fstorage_read(&testFs, TEST_PAGE_ADDR(1), readBack, sizeof(readBack)), NRF_SUCCESS);
+    TEST_CHECK(memcmp(readBack, testFlash(TEST_PAGE_ADDR(1)), sizeof(readBack)) == 0);
+    TEST_CHECK(testIsErased(TEST_PAGE_ADDR(1) + sizeof(first), TEST_PAGE_SIZE - sizeof(first)));
+
+    nrf_fstorage_file_stat_get(&stat);
+    TEST_CHECK_EQ(stat.writes, 2);
+    TEST_CHECK_EQ(stat.bytes_written, sizeof(first) + sizeof(second));
+    TEST_CHECK_EQ(stat.violations, 1);
+
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_END_ADDR - 4, first, sizeof(first), NULL), NRF_ERROR_INVALID_ADDR);
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_PAGE_ADDR(1), first, 3, NULL), NRF_ERROR_INVALID_LENGTH);
+
+    TEST_CHECK_EQ(nrf_fstorage_erase(&testFs, TEST_PAGE_ADDR(1), 2, NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(testEvt.erases, 1);
+    TEST_CHECK(testIsErased(TEST_PAGE_ADDR(1), TEST_PAGE_SIZE));
+    TEST_CHECK_EQ(nrf_fstorage_file_erase_count_get(TEST_PAGE_ADDR(0)), 0);
+    TEST_CHECK_EQ(nrf_fstorage_file_erase_count_get(TEST_PAGE_ADDR(1)), 1);
+    TEST_CHECK_EQ(nrf_fstorage_file_erase_count_get(TEST_PAGE_ADDR(2)), 1);
+    TEST_CHECK_EQ(nrf_fstorage_file_erase_count_get(TEST_END_ADDR), 0);
+}
+
+
+static void testRestart(void)
+{
+    static const uint32_t data[2] = {0xA5A5A5A5, 0x5A5A5A5A};
+    nrf_fstorage_file_stat_t stat;
+
+    TEST_CHECK_EQ(nrf_fstorage_erase(&testFs, TEST_PAGE_ADDR(2), 1, NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_PAGE_ADDR(3), data, sizeof(data), NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(nrf_fstorage_uninit(&testFs, NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(nrf_fstorage_init(&testFs, &nrf_fstorage_file, NULL), NRF_SUCCESS);
+
+    TEST_CHECK(memcmp(testFlash(TEST_PAGE_ADDR(3)), data, sizeof(data)) == 0);
+    TEST_CHECK_EQ(nrf_fstorage_file_erase_count_get(TEST_PAGE_ADDR(2)), 2);
+    nrf_fstorage_file_stat_get(&stat);
+    TEST_CHECK_EQ(stat.writes, 0);
+    TEST_CHECK_EQ(stat.erase_count_max, 2);
+}
+
+
+static void testPowerLoss(void)
+{
+    static const uint32_t data[4] = {0, 1, 2, 3};
+    uint32_t              writes  = testEvt.writes;
+    uint32_t              erases  = testEvt.erases;
+
+    // second write from now is cut in half
+    nrf_fstorage_file_power_loss_set(2);
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_PAGE_ADDR(4), data, sizeof(data), NULL), NRF_SUCCESS);
+    TEST_CHECK(!nrf_fstorage_file_is_power_lost());
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_PAGE_ADDR(5), data, sizeof(data), NULL), NRF_ERROR_INTERNAL);
+    TEST_CHECK(nrf_fstorage_file_is_power_lost());
+    TEST_CHECK(memcmp(testFlash(TEST_PAGE_ADDR(5)), data, sizeof(data) / 2) == 0);
+    TEST_CHECK(testIsErased(TEST_PAGE_ADDR(5) + sizeof(data) / 2, sizeof(data) / 2));
+    TEST_CHECK_EQ(testEvt.writes, writes + 1);
+
+    // nothing works until power is back
+    TEST_CHECK_EQ(nrf_fstorage_erase(&testFs, TEST_PAGE_ADDR(4), 1, NULL), NRF_ERROR_INTERNAL);
+    TEST_CHECK(memcmp(testFlash(TEST_PAGE_ADDR(4)), data, sizeof(data)) == 0);
+    TEST_CHECK_EQ(nrf_fstorage_uninit(&testFs, NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(nrf_fstorage_init(&testFs, &nrf_fstorage_file, NULL), NRF_SUCCESS);
+    TEST_CHECK(!nrf_fstorage_file_is_power_lost());
+
+    // erase cut in half: end of page keeps its data
+    TEST_CHECK_EQ(nrf_fstorage_write(&testFs, TEST_PAGE_ADDR(4) + TEST_PAGE_SIZE - sizeof(data), data, sizeof(data),
+                                     NULL), NRF_SUCCESS);
+    nrf_fstorage_file_power_loss_set(1);
+    TEST_CHECK_EQ(nrf_fstorage_erase(&testFs, TEST_PAGE_ADDR(4), 1, NULL), NRF_ERROR_INTERNAL);
+    TEST_CHECK(testIsErased(TEST_PAGE_ADDR(4), TEST_PAGE_SIZE / 2));
+    TEST_CHECK(memcmp(testFlash(TEST_PAGE_ADDR(4) + TEST_PAGE_SIZE - sizeof(data)), data, sizeof(data)) == 0);
+    TEST_CHECK_EQ(testEvt.erases, erases);
+    TEST_CHECK_EQ(nrf_fstorage_uninit(&testFs, NULL), NRF_SUCCESS);
+    TEST_CHECK_EQ(nrf_fstorage_init(&testFs, &nrf_fstorage_file, NULL), NRF_SUCCESS);
+}
+
+
+int main(void)
+{
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    TEST_CHECK_EQ(nrf_fstorage_init(&testFs, &nrf_fstorage_file, NULL), NRF_SUCCESS);
+    testWriteErase();
+    testRestart();
+    testPowerLoss();
+    TEST_CHECK_EQ(nrf_fstorage_uninit(&testFs, NULL), NRF_SUCCESS);
+    return testResult("fstorageFileTest");
+}
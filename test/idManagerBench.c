@@ -0,0 +1,150 @@
+/*file: idManagerBench.c
+ *
+ * Host benchmark of whitelist switch in Identity Manager with and without identity key cache (PM_ID_CACHE_SIZE
+ * from make), over Peer Data Storage on FDS on file backed fstorage. 8 peers are bonded (bonding data and peer
+ * rank records in flash). One switch is what appAdvSetStart() does: whitelist and device identity list of the
+ * peers to connect, alternately as many as SoftDevice takes (window over bonded peers) and one (directed).
+ * Each list given to SoftDevice is checked against the bonding data.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+
+#include "id_manager.h"
+#include "peer_data_storage.h"
+#include "peerManagerStub.h"
+
+#define BENCH_PEERS            8
+#define BENCH_SWITCHES         200000
+#define BENCH_LIST_MAX         BLE_GAP_WHITELIST_ADDR_MAX_COUNT
+
+
+/*********benchmark****************/
+static volatile uint32_t       benchSink;       // keeps result of timed loops
+static pm_peer_id_t            benchPeer[BENCH_PEERS];
+static pm_peer_data_bonding_t  benchBond[BENCH_PEERS];
+
+
+static uint64_t benchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static bool benchBondAll(void)
+{
+    static uint32_t rank;
+
+    for(uint32_t cnt = 0; cnt < BENCH_PEERS; cnt++)
+    {
+        ble_gap_id_key_t     *idKey = &benchBond[cnt].peer_ble_id;
+        pm_peer_data_const_t data;
+
+        benchPeer[cnt] = pds_peer_id_allocate();
+        idKey->id_addr_info.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+        memset(idKey->id_addr_info.addr, 0x10 + cnt, BLE_GAP_ADDR_LEN);
+        memset(idKey->id_info.irk, 0xE0 + cnt, BLE_GAP_SEC_KEY_LEN);
+
+        data.data_id        = PM_PEER_DATA_ID_BONDING;
+        data.length_words   = BYTES_TO_WORDS(sizeof(pm_peer_data_bonding_t));
+        data.p_bonding_data = &benchBond[cnt];
+        if(benchPeer[cnt] == PM_PEER_ID_INVALID ||
+           pds_peer_data_store(benchPeer[cnt], &data, PDS_PREPARE_TOKEN_INVALID, NULL) != NRF_SUCCESS)
+        {
+            return false;
+        }
+        rank               = cnt;
+        data.data_id       = PM_PEER_DATA_ID_PEER_RANK;
+        data.length_words  = BYTES_TO_WORDS(sizeof(rank));
+        data.p_peer_rank   = &rank;
+        if(pds_peer_data_store(benchPeer[cnt], &data, PDS_PREPARE_TOKEN_INVALID, NULL) != NRF_SUCCESS)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// list of SoftDevice matches bonding data of peers from first
+static bool benchListIs(uint32_t first, uint32_t len)
+{
+    if(hostSoftdevice.whitelistLen != len || hostSoftdevice.identitiesLen != len)
+    {
+        return false;
+    }
+    for(uint32_t cnt = 0; cnt < len; cnt++)
+    {
+        ble_gap_id_key_t const *idKey = &benchBond[(first + cnt) % BENCH_PEERS].peer_ble_id;
+
+        if(memcmp(&hostSoftdevice.whitelist[cnt], &idKey->id_addr_info, sizeof(ble_gap_addr_t)) != 0 ||
+           memcmp(&hostSoftdevice.identities[cnt], idKey, sizeof(ble_gap_id_key_t)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static ret_code_t benchSwitch(uint32_t step, uint32_t *first, uint32_t *len)
+{
+    pm_peer_id_t list[BENCH_LIST_MAX];
+    ret_code_t   ret;
+
+    *first = step % BENCH_PEERS;
+    *len   = (step % 2 == 0) ? BENCH_LIST_MAX : 1;
+    for(uint32_t cnt = 0; cnt < *len; cnt++)
+    {
+        list[cnt] = benchPeer[(*first + cnt) % BENCH_PEERS];
+    }
+    ret = im_whitelist_set(list, *len);
+    if(ret == NRF_SUCCESS)
+    {
+        ret = im_device_identities_list_set(list, *len);
+    }
+    return ret;
+}
+
+
+int main(void)
+{
+    uint64_t start;
+    uint32_t first;
+    uint32_t len;
+    uint32_t errors = 0;
+
+    unlink(NRF_FSTORAGE_FILE_NAME);
+    if(pds_init() != NRF_SUCCESS || !benchBondAll() || im_init() != NRF_SUCCESS)
+    {
+        printf("peer setup failed\n");
+        return 1;
+    }
+    for(uint32_t step = 0; step < 2 * BENCH_PEERS; step++)
+    {
+        errors += benchSwitch(step, &first, &len) != NRF_SUCCESS || !benchListIs(first, len);
+    }
+    if(errors != 0)
+    {
+        printf("PM_ID_CACHE_SIZE %u: %u lists differ from bonding data\n", PM_ID_CACHE_SIZE, errors);
+        return 1;
+    }
+
+    start = benchNow();
+    for(uint32_t step = 0; step < BENCH_SWITCHES; step++)
+    {
+        errors += (benchSwitch(step, &first, &len) != NRF_SUCCESS);
+    }
+    start = benchNow() - start;
+    benchSink = errors;
+    printf("PM_ID_CACHE_SIZE %u, %u bonded peers: %8.1f ns per whitelist switch (%u and 1 peers)\n",
+           PM_ID_CACHE_SIZE, BENCH_PEERS, (double)start / BENCH_SWITCHES, BENCH_LIST_MAX);
+    return (errors != 0) ? 1 : 0;
+}
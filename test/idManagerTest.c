@@ -0,0 +1,209 @@
+/*file: idManagerTest.c
+ *
+ * Unit test of identity key cache of Identity Manager (id_manager.c, PM_ID_CACHE_SIZE from sdk_config.h) over
+ * Peer Data Storage stand-in (below) that counts flash reads: cache is filled at im_init(), whitelist and
+ * device identity list are set from it without reading flash, bonding update reloads the keys of the peer,
+ * peer delete and im_peer_free() drop them. Keys of failed read are not cached.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "id_manager.h"
+#include "peer_data_storage.h"
+#include "peerManagerStub.h"
+#include "testCheck.h"
+
+#define TEST_PEERS             10
+#define TEST_BONDED            8               // peers bonded at im_init()
+
+extern void im_pdb_evt_handler(pm_evt_t *p_event);
+
+static struct
+{
+    bool                   isBonded;
+    ret_code_t             readRet;            // error of flash read, if not NRF_SUCCESS
+    pm_peer_data_bonding_t bond;
+}testPeer[TEST_PEERS];
+
+static uint32_t     testReads;
+static pm_peer_id_t testIterPeer;
+
+
+/*********Peer Data Storage stand-in****************/
+ret_code_t pds_peer_data_read(pm_peer_id_t peer_id, pm_peer_data_id_t data_id, pm_peer_data_t *const p_data,
+                              uint32_t const *const p_buf_len)
+{
+    (void)p_buf_len;
+    testReads++;
+    if(peer_id >= TEST_PEERS || data_id != PM_PEER_DATA_ID_BONDING)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if(testPeer[peer_id].readRet != NRF_SUCCESS)
+    {
+        return testPeer[peer_id].readRet;
+    }
+    if(!testPeer[peer_id].isBonded)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_data->p_bonding_data = testPeer[peer_id].bond;
+    return NRF_SUCCESS;
+}
+
+
+void pds_peer_data_iterate_prepare(void)
+{
+    testIterPeer = 0;
+}
+
+
+bool pds_peer_data_iterate(pm_peer_data_id_t data_id, pm_peer_id_t *const p_peer_id,
+                           pm_peer_data_flash_t *const p_data)
+{
+    for(; testIterPeer < TEST_PEERS && data_id == PM_PEER_DATA_ID_BONDING; testIterPeer++)
+    {
+        if(testPeer[testIterPeer].isBonded)
+        {
+            *p_peer_id             = testIterPeer;
+            p_data->data_id        = PM_PEER_DATA_ID_BONDING;
+            p_data->p_bonding_data = &testPeer[testIterPeer].bond;
+            testIterPeer++;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*********tests****************/
+static void testBond(pm_peer_id_t peerId, uint8_t value)
+{
+    ble_gap_id_key_t *idKey = &testPeer[peerId].bond.peer_ble_id;
+
+    testPeer[peerId].isBonded = true;
+    memset(idKey, 0, sizeof(*idKey));
+    idKey->id_addr_info.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    memset(idKey->id_addr_info.addr, value, BLE_GAP_ADDR_LEN);
+    memset(idKey->id_info.irk, value ^ 0xFF, BLE_GAP_SEC_KEY_LEN);
+}
+
+
+static void testEvt(pm_evt_id_t evtId, pm_peer_id_t peerId)
+{
+    pm_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.evt_id                                      = evtId;
+    evt.peer_id                                     = peerId;
+    evt.params.peer_data_update_succeeded.data_id   = PM_PEER_DATA_ID_BONDING;
+    evt.params.peer_data_update_succeeded.action    = PM_PEER_DATA_OP_UPDATE;
+    im_pdb_evt_handler(&evt);
+}
+
+
+// whitelist of one peer holds its bonded address
+static bool testWhitelistIs(pm_peer_id_t peerId)
+{
+    return hostSoftdevice.whitelistLen == 1 &&
+           memcmp(&hostSoftdevice.whitelist[0], &testPeer[peerId].bond.peer_ble_id.id_addr_info,
+                  sizeof(ble_gap_addr_t)) == 0;
+}
+
+
+static void testInit(void)
+{
+    pm_peer_id_t peers[TEST_BONDED];
+
+    for(pm_peer_id_t peerId = 0; peerId < TEST_BONDED; peerId++)
+    {
+        testBond(peerId, 0x10 + peerId);
+        peers[peerId] = peerId;
+    }
+    TEST_CHECK_EQ(im_init(), NRF_SUCCESS);
+    testReads = 0;
+
+    // lists of first and last peers, as many as SoftDevice takes
+    for(uint32_t first = 0; first + BLE_GAP_WHITELIST_ADDR_MAX_COUNT <= TEST_BONDED;
+        first += TEST_BONDED - BLE_GAP_WHITELIST_ADDR_MAX_COUNT)
+    {
+        TEST_CHECK_EQ(im_whitelist_set(&peers[first], BLE_GAP_WHITELIST_ADDR_MAX_COUNT), NRF_SUCCESS);
+        TEST_CHECK_EQ(im_device_identities_list_set(&peers[first], BLE_GAP_WHITELIST_ADDR_MAX_COUNT), NRF_SUCCESS);
+        TEST_CHECK_EQ(hostSoftdevice.whitelistLen, BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+        TEST_CHECK_EQ(hostSoftdevice.identitiesLen, BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+        for(uint32_t cnt = 0; cnt < BLE_GAP_WHITELIST_ADDR_MAX_COUNT; cnt++)
+        {
+            TEST_CHECK(memcmp(&hostSoftdevice.whitelist[cnt], &testPeer[first + cnt].bond.peer_ble_id.id_addr_info,
+                              sizeof(ble_gap_addr_t)) == 0);
+            TEST_CHECK(memcmp(&hostSoftdevice.identities[cnt], &testPeer[first + cnt].bond.peer_ble_id,
+                              sizeof(ble_gap_id_key_t)) == 0);
+        }
+    }
+    TEST_CHECK_EQ(testReads, 0);
+}
+
+
+static void testUpdateDelete(void)
+{
+    pm_peer_id_t peerId;
+
+    // new bonding data is read once, when written
+    peerId = 3;
+    testBond(peerId, 0x73);
+    testEvt(PM_EVT_PEER_DATA_UPDATE_SUCCEEDED, peerId);
+    TEST_CHECK_EQ(testReads, 1);
+    TEST_CHECK_EQ(im_whitelist_set(&peerId, 1), NRF_SUCCESS);
+    TEST_CHECK_EQ(testReads, 1);
+    TEST_CHECK(testWhitelistIs(peerId));
+
+    // deleted peer is looked up in flash each time
+    peerId = 5;
+    testPeer[peerId].isBonded = false;
+    testEvt(PM_EVT_PEER_DELETE_SUCCEEDED, peerId);
+    TEST_CHECK_EQ(im_whitelist_set(&peerId, 1), NRF_ERROR_NOT_FOUND);
+    TEST_CHECK_EQ(im_whitelist_set(&peerId, 1), NRF_ERROR_NOT_FOUND);
+    TEST_CHECK_EQ(testReads, 3);
+
+    // freed peer is dropped before flash is cleaned up
+    peerId = 2;
+    TEST_CHECK_EQ(im_peer_free(peerId), NRF_SUCCESS);
+    testPeer[peerId].isBonded = false;
+    TEST_CHECK_EQ(im_whitelist_set(&peerId, 1), NRF_ERROR_NOT_FOUND);
+    TEST_CHECK_EQ(testReads, 4);
+}
+
+
+static void testReadError(void)
+{
+    pm_peer_id_t peerId = 8;
+
+    // keys of failed read are passed on as before (zeroed), but read again next time
+    testBond(peerId, 0x88);
+    testPeer[peerId].readRet = NRF_ERROR_NO_MEM;
+    testReads                = 0;
+    TEST_CHECK_EQ(im_whitelist_set(&peerId, 1), NRF_SUCCESS);
+    TEST_CHECK_EQ(im_whitelist_set(&peerId, 1), NRF_SUCCESS);
+    TEST_CHECK_EQ(testReads, 2);
+    TEST_CHECK(!testWhitelistIs(peerId));
+
+    // successful read is cached
+    testPeer[peerId].readRet = NRF_SUCCESS;
+    TEST_CHECK_EQ(im_whitelist_set(&peerId, 1), NRF_SUCCESS);
+    TEST_CHECK(testWhitelistIs(peerId));
+    TEST_CHECK_EQ(im_device_identities_list_set(&peerId, 1), NRF_SUCCESS);
+    TEST_CHECK(memcmp(&hostSoftdevice.identities[0], &testPeer[peerId].bond.peer_ble_id,
+                      sizeof(ble_gap_id_key_t)) == 0);
+    TEST_CHECK_EQ(testReads, 3);
+}
+
+
+int main(void)
+{
+    testInit();
+    testUpdateDelete();
+    testReadError();
+    return testResult("idManagerTest");
+}
@@ -0,0 +1,78 @@
+/*file: nrf.h
+ *
+ * Host mock of device header: peripheral instances used by application modules and NVIC calls.
+ * NVIC enable state is kept, tests check that scheduler interrupt is not masked on return.
+ * NVIC_MOCK_THREAD: interrupt handler runs in its own thread, test implements nvicMockDisable() (wait for
+ * running handler, hold it off) and nvicMockEnable().
+*/
+
+#ifndef NRF_H_
+#define NRF_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+#define RTC_CC_QUANTITY      4
+
+typedef enum
+{
+    GPIOTE_IRQn = 6,
+    RTC2_IRQn   = 36,
+    IRQ_QUANTITY = 48,
+}IRQn_Type;
+
+// RTC: 24 bit counter, events are set by rtcMockAdvance() of nrf_rtc.h
+typedef struct
+{
+    volatile uint32_t counter;
+    volatile uint32_t cc[RTC_CC_QUANTITY];
+    volatile uint32_t intMask;
+    volatile bool     isRunning;
+    volatile bool     isOverflow;
+    volatile bool     isCompare[RTC_CC_QUANTITY];
+    volatile uint32_t ccSetStall;      // ticks counter runs before the next CC write (preemption stand-in)
+}NRF_RTC_Type;
+
+extern NRF_RTC_Type rtcMock2;
+extern bool         nvicIsEnabled[IRQ_QUANTITY];
+
+#define NRF_RTC2             (&rtcMock2)
+
+#ifdef NVIC_MOCK_THREAD
+void nvicMockDisable(IRQn_Type irq);
+void nvicMockEnable (IRQn_Type irq);
+#endif
+
+
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+    (void)irq;
+    (void)priority;
+}
+
+
+static inline void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+    (void)irq;
+}
+
+
+static inline void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    nvicIsEnabled[irq] = true;
+#ifdef NVIC_MOCK_THREAD
+    nvicMockEnable(irq);
+#endif
+}
+
+
+static inline void NVIC_DisableIRQ(IRQn_Type irq)
+{
+#ifdef NVIC_MOCK_THREAD
+    nvicMockDisable(irq);
+#endif
+    nvicIsEnabled[irq] = false;
+}
+
+#endif
@@ -0,0 +1,91 @@
+/*file: nrf_atfifo.h
+ *
+ * Host mock of nrf_atfifo: single producer / single consumer ring with acquire/release indexes, safe
+ * between interrupt stand-in thread and main thread (target version is multi-producer, modules use one).
+*/
+
+#ifndef NRF_ATFIFO_H_
+#define NRF_ATFIFO_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "string.h"
+
+#include "sdk_errors.h"
+
+typedef struct
+{
+    uint8_t  *buffer;
+    uint32_t itemSize;
+    uint32_t quantity;                 // items + 1, one slot is always free
+    uint32_t wrPos;
+    uint32_t rdPos;
+}nrf_atfifo_t;
+
+#define NRF_ATFIFO_DEF(NAME, TYPE, SIZE)                                    \
+    static TYPE          NAME##_data[(SIZE) + 1];                           \
+    static nrf_atfifo_t  NAME##_inst;                                       \
+    static nrf_atfifo_t *const NAME = &NAME##_inst
+
+#define NRF_ATFIFO_INIT(NAME)                                               \
+    nrf_atfifo_mock_init(NAME, NAME##_data, sizeof(NAME##_data[0]),         \
+                         sizeof(NAME##_data) / sizeof(NAME##_data[0]))
+
+
+static inline ret_code_t nrf_atfifo_mock_init(nrf_atfifo_t *fifo, void *data, uint32_t itemSize, uint32_t quantity)
+{
+    fifo->buffer   = data;
+    fifo->itemSize = itemSize;
+    fifo->quantity = quantity;
+    fifo->wrPos    = 0;
+    fifo->rdPos    = 0;
+    return NRF_SUCCESS;
+}
+
+
+static inline ret_code_t nrf_atfifo_alloc_put(nrf_atfifo_t *fifo, const void *data, size_t size, bool *visible)
+{
+    uint32_t wrPos = __atomic_load_n(&fifo->wrPos, __ATOMIC_RELAXED);
+    uint32_t next  = (wrPos + 1) % fifo->quantity;
+
+    if(next == __atomic_load_n(&fifo->rdPos, __ATOMIC_ACQUIRE))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    memcpy(fifo->buffer + wrPos * fifo->itemSize, data, size);
+    __atomic_store_n(&fifo->wrPos, next, __ATOMIC_RELEASE);
+    if(visible != NULL)
+    {
+        *visible = true;
+    }
+    return NRF_SUCCESS;
+}
+
+
+static inline ret_code_t nrf_atfifo_get_free(nrf_atfifo_t *fifo, void *data, size_t size, bool *released)
+{
+    uint32_t rdPos = __atomic_load_n(&fifo->rdPos, __ATOMIC_RELAXED);
+
+    if(rdPos == __atomic_load_n(&fifo->wrPos, __ATOMIC_ACQUIRE))
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    memcpy(data, fifo->buffer + rdPos * fifo->itemSize, size);
+    __atomic_store_n(&fifo->rdPos, (rdPos + 1) % fifo->quantity, __ATOMIC_RELEASE);
+    if(released != NULL)
+    {
+        *released = true;
+    }
+    return NRF_SUCCESS;
+}
+
+
+// consumer side only
+static inline ret_code_t nrf_atfifo_clear(nrf_atfifo_t *fifo)
+{
+    __atomic_store_n(&fifo->rdPos, __atomic_load_n(&fifo->wrPos, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    return NRF_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*file: nrf_drv_gpiote.h
+ *
+ * Host mock of GPIOTE driver input events: types and calls as in SDK, implemented by stand-in of the device on
+ * the pin. As on target, event enable clears event latched before.
+*/
+
+#ifndef NRF_DRV_GPIOTE_H_
+#define NRF_DRV_GPIOTE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "sdk_errors.h"
+#include "nrf_gpio.h"
+
+typedef uint32_t nrf_drv_gpiote_pin_t;
+
+typedef enum
+{
+    NRF_GPIOTE_POLARITY_LOTOHI = 1,
+    NRF_GPIOTE_POLARITY_HITOLO = 2,
+    NRF_GPIOTE_POLARITY_TOGGLE = 3,
+}nrf_gpiote_polarity_t;
+
+typedef struct
+{
+    nrf_gpiote_polarity_t sense;
+    nrf_gpio_pin_pull_t   pull;
+    bool                  is_watcher;
+    bool                  hi_accuracy;
+}nrf_drv_gpiote_in_config_t;
+
+typedef void (*nrf_drv_gpiote_evt_handler_t)(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+
+#define GPIOTE_CONFIG_IN_SENSE_HITOLO(hi_accu)                                          \
+    {                                                                                   \
+        .sense = NRF_GPIOTE_POLARITY_HITOLO, .pull = NRF_GPIO_PIN_NOPULL,              \
+        .is_watcher = false, .hi_accuracy = hi_accu,                                    \
+    }
+
+
+bool       nrf_drv_gpiote_is_init(void);
+ret_code_t nrf_drv_gpiote_init(void);
+ret_code_t nrf_drv_gpiote_in_init(nrf_drv_gpiote_pin_t pin, nrf_drv_gpiote_in_config_t const *p_config,
+                                  nrf_drv_gpiote_evt_handler_t evt_handler);
+void       nrf_drv_gpiote_in_event_enable(nrf_drv_gpiote_pin_t pin, bool int_enable);
+void       nrf_drv_gpiote_in_event_disable(nrf_drv_gpiote_pin_t pin);
+
+#endif
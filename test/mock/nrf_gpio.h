@@ -0,0 +1,21 @@
+/*file: nrf_gpio.h
+ *
+ * Host mock of nrf_gpio: pin read of application modules, implemented by stand-in of the device on the pin.
+*/
+
+#ifndef NRF_GPIO_H_
+#define NRF_GPIO_H_
+
+#include "stdint.h"
+
+typedef enum
+{
+    NRF_GPIO_PIN_NOPULL   = 0,
+    NRF_GPIO_PIN_PULLDOWN = 1,
+    NRF_GPIO_PIN_PULLUP   = 3,
+}nrf_gpio_pin_pull_t;
+
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+
+#endif
@@ -0,0 +1,38 @@
+/*file: nrf_log.h
+ *
+ * Host stand-in of nRF log: messages go to stdout only when nrfLogStubOn is set (verbose run),
+ * arguments are evaluated as on target, no format check as log backend takes them as 32-bit words.
+*/
+
+#ifndef NRF_LOG_H_
+#define NRF_LOG_H_
+
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdarg.h"
+
+extern bool nrfLogStubOn;
+
+static inline void nrfLogStub(const char *level, const char *format, ...)
+{
+    va_list args;
+
+    if(!nrfLogStubOn)
+    {
+        return;
+    }
+    va_start(args, format);
+    printf("<%s> ", level);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+#define NRF_LOG_ERROR(...)     nrfLogStub("error", __VA_ARGS__)
+#define NRF_LOG_WARNING(...)   nrfLogStub("warning", __VA_ARGS__)
+#define NRF_LOG_INFO(...)      nrfLogStub("info", __VA_ARGS__)
+#define NRF_LOG_DEBUG(...)     nrfLogStub("debug", __VA_ARGS__)
+#define NRF_LOG_PROCESS()      false
+#define NRF_LOG_FLUSH()
+
+#endif
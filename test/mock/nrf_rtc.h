@@ -0,0 +1,109 @@
+/*file: nrf_rtc.h
+ *
+ * Host mock of RTC HAL. Counter is moved by rtcMockAdvance(): it stops on each OVERFLOW/COMPARE event
+ * and calls interrupt handler when the event interrupt is enabled and NVIC line is not masked,
+ * so handler runs at the tick it would run on target. ccSetStall of RTC instance delays the next CC write.
+*/
+
+#ifndef NRF_RTC_H_
+#define NRF_RTC_H_
+
+#include "nrf.h"
+
+#define RTC_COUNTER_MOCK_MASK        0x00FFFFFF
+
+#define NRF_RTC_INT_OVERFLOW_MASK    0x00000002
+#define NRF_RTC_INT_COMPARE0_MASK    0x00010000
+
+typedef enum
+{
+    NRF_RTC_TASK_START,
+    NRF_RTC_TASK_STOP,
+    NRF_RTC_TASK_CLEAR,
+}nrf_rtc_task_t;
+
+typedef enum
+{
+    NRF_RTC_EVENT_OVERFLOW,
+    NRF_RTC_EVENT_COMPARE_0,
+}nrf_rtc_event_t;
+
+typedef void (*rtcMockIrqT)(void);
+
+uint32_t rtcMockAdvance(NRF_RTC_Type *rtc, IRQn_Type irq, rtcMockIrqT handler, uint32_t ticks);  // returns interrupts
+
+
+static inline void nrf_rtc_task_trigger(NRF_RTC_Type *rtc, nrf_rtc_task_t task)
+{
+    switch(task)
+    {
+    case NRF_RTC_TASK_START:
+        rtc->isRunning = true;
+        break;
+    case NRF_RTC_TASK_STOP:
+        rtc->isRunning = false;
+        break;
+    case NRF_RTC_TASK_CLEAR:
+        rtc->counter = 0;
+        break;
+    }
+}
+
+
+static inline void nrf_rtc_prescaler_set(NRF_RTC_Type *rtc, uint32_t prescaler)
+{
+    (void)rtc;
+    (void)prescaler;
+}
+
+
+static inline void nrf_rtc_event_clear(NRF_RTC_Type *rtc, nrf_rtc_event_t event)
+{
+    if(event == NRF_RTC_EVENT_OVERFLOW)
+    {
+        rtc->isOverflow = false;
+    }
+    else
+    {
+        rtc->isCompare[0] = false;
+    }
+}
+
+
+static inline uint32_t nrf_rtc_event_pending(NRF_RTC_Type *rtc, nrf_rtc_event_t event)
+{
+    return (event == NRF_RTC_EVENT_OVERFLOW) ? rtc->isOverflow : rtc->isCompare[0];
+}
+
+
+static inline void nrf_rtc_int_enable(NRF_RTC_Type *rtc, uint32_t mask)
+{
+    rtc->intMask |= mask;
+}
+
+
+static inline void nrf_rtc_int_disable(NRF_RTC_Type *rtc, uint32_t mask)
+{
+    rtc->intMask &= ~mask;
+}
+
+
+static inline uint32_t nrf_rtc_counter_get(NRF_RTC_Type *rtc)
+{
+    return rtc->counter;
+}
+
+
+// ccSetStall: counter runs on before the write as if code was preempted, events are latched, handler can't run
+static inline void nrf_rtc_cc_set(NRF_RTC_Type *rtc, uint32_t channel, uint32_t value)
+{
+    for(; rtc->ccSetStall != 0; rtc->ccSetStall--)
+    {
+        rtc->counter      = (rtc->counter + 1) & RTC_COUNTER_MOCK_MASK;
+        rtc->isOverflow   = rtc->isOverflow || (rtc->counter == 0);
+        rtc->isCompare[0] = rtc->isCompare[0] || (rtc->counter == rtc->cc[0]);
+    }
+    rtc->cc[channel] = value & RTC_COUNTER_MOCK_MASK;
+}
+
+#endif
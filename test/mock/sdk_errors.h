@@ -0,0 +1,19 @@
+/*file: sdk_errors.h
+ *
+ * Host mock of SDK error codes used by application modules, values as in nrf_error.h.
+*/
+
+#ifndef SDK_ERRORS_H_
+#define SDK_ERRORS_H_
+
+#include "stdint.h"
+
+#define NRF_SUCCESS                  0
+#define NRF_ERROR_NO_MEM             4
+#define NRF_ERROR_NOT_FOUND          5
+#define NRF_ERROR_INVALID_STATE      8
+#define NRF_ERROR_BUSY               17
+
+typedef uint32_t ret_code_t;
+
+#endif
@@ -0,0 +1,173 @@
+/*file: motionEncodeTest.c
+ *
+ * Unit test of motionEncodeXY() (C path, host has no SIMD): for boot (8 bit), 12 bit and 16 bit fields x/y is
+ * saturated to symmetric range -max..max, INT16_MIN/INT16_MAX and values beyond int16 included, the rest stays
+ * in xy with the sign of input, so repeated encoding gives back input exactly. Byte layout of each field is
+ * checked on fixed values, saturation on edges around each range and on sweep of int16 x against y.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+
+#include "motionEncode.h"
+#include "testCheck.h"
+
+static const int32_t testMax[] = {MOTION_ENCODE_BOOT_MAX, MOTION_ENCODE_12_MAX, MOTION_ENCODE_16_MAX};
+static const uint8_t testLen[] = {2, 3, 4};
+
+
+static int32_t testDecode(motionEncodeT encode, const uint8_t data[], uint32_t axis)
+{
+    int32_t value;
+
+    switch(encode)
+    {
+    case MOTION_ENCODE_BOOT:
+        return (int8_t)data[axis];
+    case MOTION_ENCODE_12:
+        value = (axis == 0) ? (data[0] | (data[1] & 0x0F) << 8) : (data[1] >> 4 | data[2] << 4);
+        return (value & 0x800) ? value - 0x1000 : value;
+    case MOTION_ENCODE_16:
+    default:
+        return (int16_t)(data[2 * axis] | data[2 * axis + 1] << 8);
+    }
+}
+
+
+static int32_t testClamp(int32_t value, int32_t max)
+{
+    return (value > max) ? max : (value < -max) ? -max : value;
+}
+
+
+// encodes x, y once, false if field, rest or length is not as expected
+static bool testEncode(motionEncodeT encode, int32_t x, int32_t y)
+{
+    int32_t in[2] = {x, y};
+    int32_t xy[2] = {x, y};
+    uint8_t data[4];
+    bool    isOk;
+
+    isOk = (motionEncodeXY(encode, xy, data) == testLen[encode]);
+    for(uint32_t axis = 0; axis < 2; axis++)
+    {
+        int32_t out = testDecode(encode, data, axis);
+
+        isOk = isOk && out == testClamp(in[axis], testMax[encode]) && xy[axis] == in[axis] - out;
+    }
+    return isOk;
+}
+
+
+static void testLayout(void)
+{
+    int32_t xy[2];
+    uint8_t data[4];
+
+    xy[0] = -1;
+    xy[1] = 100;
+    TEST_CHECK_EQ(motionEncodeXY(MOTION_ENCODE_BOOT, xy, data), 2);
+    TEST_CHECK(data[0] == 0xFF && data[1] == 0x64);
+
+    // x low byte, x high nibble | y low nibble << 4, y high byte
+    xy[0] = 0x123;
+    xy[1] = -2;
+    TEST_CHECK_EQ(motionEncodeXY(MOTION_ENCODE_12, xy, data), 3);
+    TEST_CHECK(data[0] == 0x23 && data[1] == 0xE1 && data[2] == 0xFF);
+
+    xy[0] = -0x1234;
+    xy[1] = 0x5678;
+    TEST_CHECK_EQ(motionEncodeXY(MOTION_ENCODE_16, xy, data), 4);
+    TEST_CHECK(data[0] == 0xCC && data[1] == 0xED && data[2] == 0x78 && data[3] == 0x56);
+    TEST_CHECK(xy[0] == 0 && xy[1] == 0);
+}
+
+
+static void testEdges(void)
+{
+    for(motionEncodeT encode = MOTION_ENCODE_BOOT; encode <= MOTION_ENCODE_16; encode++)
+    {
+        const int32_t max     = testMax[encode];
+        const int32_t value[] = {0, 1, -1, max - 1, -max + 1, max, -max, max + 1, -max - 1, -max - 2,
+                                 INT16_MAX, INT16_MIN, INT16_MAX + 1, INT16_MIN - 1, 1L << 22, -(1L << 22),
+                                 INT32_MAX / 2, INT32_MIN / 2};
+        const uint32_t values = sizeof(value) / sizeof(value[0]);
+
+        for(uint32_t cntX = 0; cntX < values; cntX++)
+        {
+            for(uint32_t cntY = 0; cntY < values; cntY++)
+            {
+                TEST_CHECK(testEncode(encode, value[cntX], value[cntY]));
+            }
+        }
+    }
+
+    // field is symmetric: the lowest value of two's complement field is never sent
+    for(motionEncodeT encode = MOTION_ENCODE_BOOT; encode <= MOTION_ENCODE_16; encode++)
+    {
+        int32_t xy[2] = {INT16_MIN, INT16_MIN};
+        uint8_t data[4];
+
+        motionEncodeXY(encode, xy, data);
+        TEST_CHECK_EQ(testDecode(encode, data, 0), -testMax[encode]);
+        TEST_CHECK_EQ(testDecode(encode, data, 1), -testMax[encode]);
+        TEST_CHECK_EQ(xy[0], INT16_MIN + testMax[encode]);
+    }
+}
+
+
+static void testSweep(void)
+{
+    for(motionEncodeT encode = MOTION_ENCODE_BOOT; encode <= MOTION_ENCODE_16; encode++)
+    {
+        uint32_t fails = 0;
+
+        for(int32_t x = INT16_MIN; x <= INT16_MAX; x++)
+        {
+            for(int32_t y = INT16_MIN; y <= INT16_MAX; y += 251)
+            {
+                fails += !testEncode(encode, x, y) + !testEncode(encode, y, x);
+            }
+            fails += !testEncode(encode, x, INT16_MAX) + !testEncode(encode, x, INT16_MIN);
+        }
+        TEST_CHECK_EQ(fails, 0);
+    }
+}
+
+
+// rest of each report goes in the next ones: any value is given back exactly, each report keeps its sign
+static void testCarry(void)
+{
+    for(motionEncodeT encode = MOTION_ENCODE_BOOT; encode <= MOTION_ENCODE_16; encode++)
+    {
+        uint32_t fails = 0;
+
+        for(int32_t value = -(1L << 22); value <= (1L << 22); value += 997)
+        {
+            int32_t xy[2] = {value, -value};
+            int64_t sum[2] = {0, 0};
+            uint8_t data[4];
+
+            while(xy[0] != 0 || xy[1] != 0)
+            {
+                motionEncodeXY(encode, xy, data);
+                sum[0] += testDecode(encode, data, 0);
+                sum[1] += testDecode(encode, data, 1);
+                fails  += (testDecode(encode, data, 0) * (int64_t)value < 0);
+            }
+            fails += (sum[0] != value || sum[1] != -value);
+        }
+        TEST_CHECK_EQ(fails, 0);
+    }
+}
+
+
+int main(void)
+{
+    testLayout();
+    testEdges();
+    testSweep();
+    testCarry();
+    return testResult("motionEncodeTest");
+}
@@ -0,0 +1,227 @@
+/*file: motionLeadTimeTest.c
+ *
+ * Test of synchronized mode of mouseMotion (motionSetSync()) on host model of connection event timeline:
+ * connection event every TEST_INTERVAL_US sends the queued notification (one TX buffer), its TX completion
+ * comes at end of event, sensor moves one count every TEST_MOTION_US, keys one count every TEST_KEY_US.
+ * Radio notification comes TEST_DISTANCE_US before event and reaches main context after TEST_LATENCY_US,
+ * as in main.c.
+ *   - current mode: motion is added and sent as soon as TX buffer is free
+ *   - synchronized mode: sensor is read and report is queued only in motionConnEventPrepare(), key motion is
+ *     added (motionAdd(), motionProcess()) when it comes and waits for it
+ * Age of motion (time from sensor count to its report going on air) is checked per report: newest count of
+ * synchronized report is no older than lead time and one sensor period, older motion than in current mode,
+ * no count is lost in either mode.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "mouseMotion.h"
+#include "testCheck.h"
+
+#define TEST_INTERVAL_US       7500            // connection interval
+#define TEST_EVENT_US          500             // connection event length, TX completion at its end
+#define TEST_DISTANCE_US       1740            // NRF_RADIO_NOTIFICATION_DISTANCE_1740US
+#define TEST_LATENCY_US        30              // app_scheduler latency of radio notification
+#define TEST_MOTION_US         1000            // sensor count period
+#define TEST_KEY_US            3330            // key count period (bsp_event_handler())
+#define TEST_STEP_US           10
+#define TEST_EVENTS            2000
+#define TEST_FIFO_SIZE         64              // sensor counts not yet on air
+
+
+/*********model****************/
+static struct
+{
+    bool     isPrepare;                        // motionConnEventPrepare() is running
+    uint32_t sensorCounts;                     // counts moved, not yet read from sensor
+    uint32_t fifo[TEST_FIFO_SIZE];             // move time of each count read, not yet reported
+    uint32_t fifoHead;
+    uint32_t fifoLen;
+    uint32_t queuedCounts;                     // counts of notification queued in TX buffer
+    uint32_t queuedNewest;
+    uint32_t queuedOldest;
+    bool     isQueued;
+    bool     isSent;                           // notification went on air in this event, TX completion follows
+    uint32_t sampleTime[TEST_FIFO_SIZE];       // time of count moved, sensor holds it till read
+    uint32_t sampleHead;
+    uint32_t reportsOutPrepare;
+    uint32_t countsIn;
+    uint32_t countsOut;
+    uint32_t reports;
+    uint32_t newestMax;
+    uint32_t newestMin;
+    uint32_t oldestMax;
+}testModel;
+
+static uint32_t testTime;
+
+
+/*********mouseMotion USER IMPLEMENTED FUNCTION****************/
+motionSendResultT motionReportSend(motionReportT report, const uint8_t data[], uint8_t len)
+{
+    int32_t x;
+
+    if(testModel.isQueued)
+    {
+        return MOTION_SEND_BUSY;
+    }
+    TEST_CHECK_EQ(report, MOTION_REPORT_MOVEMENT);
+    TEST_CHECK_EQ(len, MOTION_XY_LEN);
+    x = data[0] | (data[1] & 0x0F) << 8;
+    TEST_CHECK(x > 0 && (uint32_t)x <= testModel.fifoLen);
+    if(x <= 0 || (uint32_t)x > testModel.fifoLen)
+    {
+        return MOTION_SEND_DROP;
+    }
+    testModel.reportsOutPrepare += !testModel.isPrepare;
+    testModel.isQueued     = true;
+    testModel.queuedCounts = x;
+    testModel.queuedOldest = UINT32_MAX;
+    testModel.queuedNewest = 0;
+    for(; x > 0; x--)
+    {
+        uint32_t moved = testModel.fifo[testModel.fifoHead++ % TEST_FIFO_SIZE];
+
+        testModel.queuedOldest = (moved < testModel.queuedOldest) ? moved : testModel.queuedOldest;
+        testModel.queuedNewest = (moved > testModel.queuedNewest) ? moved : testModel.queuedNewest;
+        testModel.fifoLen--;
+    }
+    return MOTION_SEND_OK;
+}
+
+
+// counts held by sensor are read now, their age runs from the time they were moved
+void motionSensorSample(void)
+{
+    if(testModel.sensorCounts == 0)
+    {
+        return;
+    }
+    for(uint32_t cnt = 0; cnt < testModel.sensorCounts; cnt++)
+    {
+        uint32_t idx = (testModel.fifoHead + testModel.fifoLen++) % TEST_FIFO_SIZE;
+
+        testModel.fifo[idx] = testModel.sampleTime[(testModel.sampleHead + cnt) % TEST_FIFO_SIZE];
+    }
+    testModel.sampleHead  += testModel.sensorCounts;
+    motionAdd((int16_t)testModel.sensorCounts, 0, 0, 0);
+    testModel.sensorCounts = 0;
+}
+
+
+/*********test****************/
+// key count is added as it comes, in any mode
+static void testKey(void)
+{
+    testModel.fifo[(testModel.fifoHead + testModel.fifoLen++) % TEST_FIFO_SIZE] = testTime;
+    testModel.countsIn++;
+    motionAdd(1, 0, 0, 0);
+    motionProcess();
+}
+
+
+static void testOnAir(void)
+{
+    uint32_t newest;
+    uint32_t oldest;
+
+    if(!testModel.isQueued)
+    {
+        return;
+    }
+    newest = testTime - testModel.queuedNewest;
+    oldest = testTime - testModel.queuedOldest;
+    testModel.countsOut += testModel.queuedCounts;
+    testModel.reports++;
+    testModel.newestMax  = (newest > testModel.newestMax) ? newest : testModel.newestMax;
+    testModel.newestMin  = (newest < testModel.newestMin) ? newest : testModel.newestMin;
+    testModel.oldestMax  = (oldest > testModel.oldestMax) ? oldest : testModel.oldestMax;
+    testModel.isQueued   = false;
+    testModel.isSent     = true;
+}
+
+
+static void testRun(bool isSync)
+{
+    const uint32_t end = TEST_EVENTS * TEST_INTERVAL_US;
+
+    memset(&testModel, 0, sizeof(testModel));
+    testModel.newestMin = UINT32_MAX;
+    motionInit();
+    motionSetSync(isSync);
+    motionConnect(1);
+    for(testTime = TEST_STEP_US; testTime <= end; testTime += TEST_STEP_US)
+    {
+        uint32_t phase = testTime % TEST_INTERVAL_US;
+
+        if(testTime % TEST_MOTION_US == 0)
+        {
+            testModel.sampleTime[(testModel.sampleHead + testModel.sensorCounts++) % TEST_FIFO_SIZE] = testTime;
+            testModel.countsIn++;
+            TEST_CHECK(testModel.fifoLen + testModel.sensorCounts < TEST_FIFO_SIZE);
+            if(!isSync)
+            {
+                // current path: motion is read and processed as it comes
+                motionSensorSample();
+                motionProcess();
+            }
+        }
+        if(testTime % TEST_KEY_US == 0)
+        {
+            testKey();
+        }
+        if(isSync && phase == TEST_INTERVAL_US - TEST_DISTANCE_US + TEST_LATENCY_US)
+        {
+            testModel.isPrepare = true;
+            motionConnEventPrepare();
+            testModel.isPrepare = false;
+        }
+        if(phase == 0)
+        {
+            testOnAir();
+        }
+        if(phase == TEST_EVENT_US && testModel.isSent)
+        {
+            testModel.isSent = false;
+            motionTxComplete(1);
+        }
+    }
+    // motion of the last interval is reported in the next event
+    motionSensorSample();
+    testModel.countsIn -= testModel.fifoLen + testModel.queuedCounts * testModel.isQueued;
+}
+
+
+int main(void)
+{
+    uint32_t currentNewestMin;
+    uint32_t currentOldestMax;
+
+    testRun(false);
+    printf("current:      %u reports, motion age on air newest %u..%u us, oldest %u us\n",
+           testModel.reports, testModel.newestMin, testModel.newestMax, testModel.oldestMax);
+    TEST_CHECK_EQ(testModel.countsOut, testModel.countsIn);
+    TEST_CHECK(testModel.reports >= TEST_EVENTS - 2);
+    currentNewestMin = testModel.newestMin;
+    currentOldestMax = testModel.oldestMax;
+
+    testRun(true);
+    printf("synchronized: %u reports, motion age on air newest %u..%u us, oldest %u us\n",
+           testModel.reports, testModel.newestMin, testModel.newestMax, testModel.oldestMax);
+    TEST_CHECK_EQ(testModel.countsOut, testModel.countsIn);
+    TEST_CHECK(testModel.reports >= TEST_EVENTS - 2);
+    TEST_CHECK_EQ(testModel.reportsOutPrepare, 0);
+    TEST_CHECK(testModel.newestMax <= TEST_DISTANCE_US - TEST_LATENCY_US + TEST_MOTION_US);
+    TEST_CHECK(testModel.newestMax < currentNewestMin);
+    TEST_CHECK(testModel.oldestMax < currentOldestMax);
+
+    // notification before advertising event: nothing is sampled while disconnected
+    motionDisconnect();
+    testModel.sensorCounts = 1;
+    motionConnEventPrepare();
+    TEST_CHECK_EQ(testModel.sensorCounts, 1);
+    return testResult("motionLeadTimeTest");
+}
@@ -0,0 +1,368 @@
+/*file: motionReportMapTest.c
+ *
+ * Test of HID report map of mouseMotion (motionReportMapGet()) against reports the module builds, for layout of
+ * build options (MOTION_COMBINED_REPORT, MOTION_XY_BITS from make). Report map is parsed as host does (short
+ * items, global/local state), input reports are laid out field by field: report length, x/y size and logical
+ * range, wheel/pan, buttons are checked. Then random motion, wheel, pan and buttons go through the module and each
+ * report is decoded by the parsed layout: totals of axes and buttons state match what was given.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "mouseMotion.h"
+#include "testCheck.h"
+
+#define TEST_FIELDS_MAX        32
+#define TEST_USAGES_MAX        8
+#define TEST_REPORT_IDS        4
+#define TEST_STEPS             100000
+
+#define USAGE_BUTTON(n)        (0x00090000UL | (n))
+#define USAGE_X                0x00010030UL
+#define USAGE_Y                0x00010031UL
+#define USAGE_WHEEL            0x00010038UL
+#define USAGE_PAN              0x000C0238UL
+
+typedef struct
+{
+    uint8_t  reportId;
+    uint16_t bitOffset;
+    uint8_t  size;
+    uint32_t usage;               // usage page << 16 | usage
+    int32_t  logMin;
+    int32_t  logMax;
+    bool     isRelative;
+}testFieldT;
+
+static testFieldT testField[TEST_FIELDS_MAX];
+static uint32_t   testFieldCnt;
+static uint16_t   testReportBits[TEST_REPORT_IDS];
+
+
+/*********report map parser****************/
+static int32_t testItemData(const uint8_t data[], uint8_t size, bool isSigned)
+{
+    uint32_t value = 0;
+
+    for(uint8_t cnt = 0; cnt < size; cnt++)
+    {
+        value |= (uint32_t)data[cnt] << (8 * cnt);
+    }
+    if(isSigned && size != 0 && size < 4 && (value & (1UL << (8 * size - 1))))
+    {
+        value |= ~0UL << (8 * size);
+    }
+    return (int32_t)value;
+}
+
+
+// input fields of all reports, false on item this parser doesn't know or unbalanced collections
+static bool testMapParse(const uint8_t map[], uint16_t len)
+{
+    uint32_t usagePage = 0;
+    int32_t  logMin    = 0;
+    int32_t  logMax    = 0;
+    uint8_t  size      = 0;
+    uint8_t  count     = 0;
+    uint8_t  reportId  = 0;
+    uint32_t usage[TEST_USAGES_MAX];
+    uint32_t usageCnt  = 0;
+    uint32_t usageMin  = 0;
+    uint32_t usageMax  = 0;
+    int32_t  depth     = 0;
+
+    for(uint16_t pos = 0; pos < len;)
+    {
+        uint8_t  prefix   = map[pos];
+        uint8_t  dataSize = ((prefix & 3) == 3) ? 4 : (prefix & 3);
+        uint8_t  type     = (prefix >> 2) & 3;
+        uint8_t  tag      = prefix >> 4;
+        int32_t  sData;
+        uint32_t uData;
+
+        if(pos + 1 + dataSize > len)
+        {
+            return false;
+        }
+        sData = testItemData(&map[pos + 1], dataSize, true);
+        uData = (uint32_t)testItemData(&map[pos + 1], dataSize, false);
+        pos  += 1 + dataSize;
+        switch(type)
+        {
+        case 0:     // main
+            if(tag == 0x8)
+            {
+                for(uint8_t cnt = 0; cnt < count; cnt++)
+                {
+                    testFieldT *field = &testField[testFieldCnt];
+
+                    if(reportId >= TEST_REPORT_IDS || testFieldCnt >= TEST_FIELDS_MAX)
+                    {
+                        return false;
+                    }
+                    field->reportId   = reportId;
+                    field->bitOffset  = testReportBits[reportId];
+                    field->size       = size;
+                    field->logMin     = logMin;
+                    field->logMax     = logMax;
+                    field->isRelative = (uData & 0x04) != 0;
+                    if(uData & 0x01)
+                    {
+                        field->usage = 0;       // constant, padding
+                    }
+                    else if(usageCnt != 0)
+                    {
+                        field->usage = usage[(cnt < usageCnt) ? cnt : usageCnt - 1];
+                    }
+                    else
+                    {
+                        field->usage = usageMin + cnt;
+                        if(field->usage > usageMax)
+                        {
+                            return false;
+                        }
+                    }
+                    testReportBits[reportId] += size;
+                    testFieldCnt += (field->usage != 0);
+                }
+            }
+            else if(tag == 0xA)
+            {
+                depth++;
+            }
+            else if(tag == 0xC)
+            {
+                depth--;
+            }
+            else
+            {
+                return false;
+            }
+            usageCnt = 0;
+            usageMin = 0;
+            usageMax = 0;
+            break;
+        case 1:     // global
+            switch(tag)
+            {
+            case 0x0: usagePage = uData;            break;
+            case 0x1: logMin    = sData;            break;
+            case 0x2: logMax    = sData;            break;
+            case 0x7: size      = (uint8_t)uData;   break;
+            case 0x8: reportId  = (uint8_t)uData;   break;
+            case 0x9: count     = (uint8_t)uData;   break;
+            default:  return false;
+            }
+            break;
+        case 2:     // local, usage of 1/2 bytes is on current usage page
+            if(usageCnt >= TEST_USAGES_MAX)
+            {
+                return false;
+            }
+            uData = (dataSize == 4) ? uData : (usagePage << 16 | uData);
+            switch(tag)
+            {
+            case 0x0: usage[usageCnt++] = uData;    break;
+            case 0x1: usageMin          = uData;    break;
+            case 0x2: usageMax          = uData;    break;
+            default:  return false;
+            }
+            break;
+        default:
+            return false;
+        }
+        if(depth < 0)
+        {
+            return false;
+        }
+    }
+    return depth == 0;
+}
+
+
+static const testFieldT *testFieldFind(uint8_t reportId, uint32_t usage)
+{
+    for(uint32_t cnt = 0; cnt < testFieldCnt; cnt++)
+    {
+        if(testField[cnt].reportId == reportId && testField[cnt].usage == usage)
+        {
+            return &testField[cnt];
+        }
+    }
+    return NULL;
+}
+
+
+static int32_t testFieldGet(const testFieldT *field, const uint8_t data[])
+{
+    uint32_t value = 0;
+
+    for(uint8_t bit = 0; bit < field->size; bit++)
+    {
+        uint16_t pos = field->bitOffset + bit;
+
+        value |= (uint32_t)((data[pos / 8] >> (pos % 8)) & 1) << bit;
+    }
+    if(field->logMin < 0 && (value & (1UL << (field->size - 1))))
+    {
+        value |= ~0UL << field->size;
+    }
+    return (int32_t)value;
+}
+
+
+/*********mouseMotion USER IMPLEMENTED FUNCTION****************/
+static struct
+{
+    int32_t  sum[4];                // x, y, wheel, pan decoded
+    uint8_t  buttons;
+    uint32_t reports;
+    uint32_t outOfRange;
+    uint32_t badLen;
+}testDecode;
+
+
+motionSendResultT motionReportSend(motionReportT report, const uint8_t data[], uint8_t len)
+{
+    static const uint32_t axis[] = {USAGE_X, USAGE_Y, USAGE_WHEEL, USAGE_PAN};
+    uint8_t               reportId = (report == MOTION_REPORT_MOVEMENT) ? 2 : 1;
+
+    testDecode.reports++;
+    testDecode.badLen += (len * 8 != testReportBits[reportId]);
+    for(uint32_t cnt = 0; cnt < sizeof(axis) / sizeof(axis[0]); cnt++)
+    {
+        const testFieldT *field = testFieldFind(reportId, axis[cnt]);
+        int32_t           value;
+
+        if(field != NULL)
+        {
+            value = testFieldGet(field, data);
+            testDecode.outOfRange += (value < field->logMin || value > field->logMax);
+            testDecode.sum[cnt]   += value;
+        }
+    }
+    if(testFieldFind(reportId, USAGE_BUTTON(1)) != NULL)
+    {
+        testDecode.buttons = 0;
+        for(uint8_t cnt = 0; cnt < 5; cnt++)
+        {
+            testDecode.buttons |= testFieldGet(testFieldFind(reportId, USAGE_BUTTON(cnt + 1)), data) << cnt;
+        }
+    }
+    return MOTION_SEND_OK;
+}
+
+
+void motionSensorSample(void)
+{
+}
+
+
+/*********test****************/
+static void testLayout(void)
+{
+    const uint8_t    *map;
+    uint16_t          len;
+    const testFieldT *field;
+
+    map = motionReportMapGet(&len);
+    TEST_CHECK(len != 0);
+    TEST_CHECK(testMapParse(map, len));
+
+    // report lengths as module builds them and as main.c gives to HID service
+    TEST_CHECK_EQ(testReportBits[1], 8 * (MOTION_COMBINED_REPORT ? MOTION_COMBINED_LEN : 3));
+    TEST_CHECK_EQ(testReportBits[2], MOTION_COMBINED_REPORT ? 0 : 8 * MOTION_XY_LEN);
+    TEST_CHECK_EQ(testReportBits[3], 8);
+    TEST_CHECK(MOTION_REPORT_MAX_LEN * 8 >= testReportBits[MOTION_COMBINED_REPORT ? 1 : 2]);
+
+    for(uint32_t usage = USAGE_X; usage <= USAGE_Y; usage++)
+    {
+        field = testFieldFind(MOTION_COMBINED_REPORT ? 1 : 2, usage);
+        TEST_CHECK(field != NULL);
+        if(field != NULL)
+        {
+            TEST_CHECK_EQ(field->size, MOTION_XY_BITS);
+            TEST_CHECK_EQ(field->logMin, -MOTION_XY_MAX);
+            TEST_CHECK_EQ(field->logMax, MOTION_XY_MAX);
+            TEST_CHECK(field->isRelative);
+        }
+    }
+    for(uint32_t cnt = 0; cnt < 2; cnt++)
+    {
+        field = testFieldFind(1, (cnt == 0) ? USAGE_WHEEL : USAGE_PAN);
+        TEST_CHECK(field != NULL);
+        if(field != NULL)
+        {
+            TEST_CHECK_EQ(field->size, 8);
+            TEST_CHECK_EQ(field->logMin, -MOTION_WHEEL_MAX);
+            TEST_CHECK_EQ(field->logMax, MOTION_WHEEL_MAX);
+            TEST_CHECK(field->isRelative);
+        }
+    }
+    // buttons are the first byte: bits 0..4, padding
+    for(uint8_t cnt = 0; cnt < 5; cnt++)
+    {
+        field = testFieldFind(1, USAGE_BUTTON(cnt + 1));
+        TEST_CHECK(field != NULL && field->bitOffset == cnt && field->size == 1);
+    }
+    field = testFieldFind(1, USAGE_X);
+    TEST_CHECK(!MOTION_COMBINED_REPORT || (field != NULL && field->bitOffset == 8));
+}
+
+
+static void testRoundTrip(void)
+{
+    int32_t sum[4] = {0};
+    uint8_t buttons = 0;
+
+    srand(1);
+    memset(&testDecode, 0, sizeof(testDecode));
+    motionInit();
+    motionConnect(1);
+    for(uint32_t step = 0; step < TEST_STEPS; step++)
+    {
+        // deltas beyond field range from time to time
+        int16_t x     = (rand() % 8 == 0) ? (int16_t)rand() : (int16_t)(rand() % 200 - 100);
+        int16_t y     = (rand() % 8 == 0) ? (int16_t)-rand() : (int16_t)(rand() % 200 - 100);
+        int8_t  wheel = (int8_t)(rand() % 256 - 128);
+        int8_t  pan   = (int8_t)(rand() % 5 - 2);
+
+        motionAdd(x, y, wheel, pan);
+        sum[0] += x;
+        sum[1] += y;
+        sum[2] += wheel;
+        sum[3] += pan;
+        if(rand() % 16 == 0)
+        {
+            buttons = (uint8_t)(rand() % 32);
+            motionSetButtons(buttons);
+        }
+        motionTxComplete(1);
+    }
+    for(uint32_t cnt = 0; cnt < 1000 && motionIsPending(); cnt++)
+    {
+        motionTxComplete(1);
+    }
+    TEST_CHECK(!motionIsPending());
+    TEST_CHECK_EQ(testDecode.badLen, 0);
+    TEST_CHECK_EQ(testDecode.outOfRange, 0);
+    for(uint32_t cnt = 0; cnt < 4; cnt++)
+    {
+        TEST_CHECK_EQ(testDecode.sum[cnt], sum[cnt]);
+    }
+    TEST_CHECK_EQ(testDecode.buttons, buttons);
+}
+
+
+int main(void)
+{
+    testLayout();
+    testRoundTrip();
+    printf("MOTION_COMBINED_REPORT %u, MOTION_XY_BITS %u, %u reports: ", MOTION_COMBINED_REPORT, MOTION_XY_BITS,
+           testDecode.reports);
+    return testResult("motionReportMapTest");
+}
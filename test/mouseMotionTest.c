@@ -0,0 +1,328 @@
+/*file: mouseMotionTest.c
+ *
+ * Unit test of mouseMotion accumulator and TX completion pacing over motionReportSend() stand-in with SoftDevice
+ * like notification queue: motion added while all TX buffers are used is summed in integrator and sent whole
+ * in the next report, fraction of x/y scale and motion beyond report range are carried, one report is sent per
+ * free TX buffer and buffers come back only by motionTxComplete(). Buttons change goes before x/y, busy
+ * notification keeps motion, disabled notification drops it.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "mouseMotion.h"
+#include "testCheck.h"
+
+#define TEST_REPORTS_MAX       64
+
+
+/*********mouseMotion USER IMPLEMENTED FUNCTION****************/
+static struct
+{
+    uint32_t          queued;              // notifications taken by stand-in SoftDevice, not yet completed
+    uint32_t          queueSize;
+    motionSendResultT result;              // result other than MOTION_SEND_OK forced by test
+    uint32_t          reportCnt;
+    motionReportT     report[TEST_REPORTS_MAX];
+    int32_t           x[TEST_REPORTS_MAX];
+    int32_t           y[TEST_REPORTS_MAX];
+    uint8_t           buttons[TEST_REPORTS_MAX];
+    int8_t            wheel[TEST_REPORTS_MAX];
+    int32_t           sumX;
+    int32_t           sumY;
+}testLink;
+
+
+static int32_t testSignExtend(uint32_t value, uint32_t bits)
+{
+    value &= (1UL << bits) - 1;
+    return (value & (1UL << (bits - 1))) ? (int32_t)value - (int32_t)(1UL << bits) : (int32_t)value;
+}
+
+
+motionSendResultT motionReportSend(motionReportT report, const uint8_t data[], uint8_t len)
+{
+    uint32_t idx = testLink.reportCnt;
+
+    if(testLink.result != MOTION_SEND_OK)
+    {
+        return testLink.result;
+    }
+    if(testLink.queued >= testLink.queueSize)
+    {
+        return MOTION_SEND_BUSY;        // module should not send without free buffer
+    }
+    testLink.queued++;
+    if(idx >= TEST_REPORTS_MAX)
+    {
+        return MOTION_SEND_OK;
+    }
+    testLink.reportCnt++;
+    testLink.report[idx] = report;
+    switch(report)
+    {
+    case MOTION_REPORT_BUTTONS:
+        TEST_CHECK_EQ(len, 3);
+        testLink.buttons[idx] = data[0];
+        testLink.wheel[idx]   = (int8_t)data[1];
+        break;
+    case MOTION_REPORT_MOVEMENT:
+        TEST_CHECK_EQ(len, MOTION_XY_LEN);
+        if(MOTION_XY_BITS == 12)
+        {
+            testLink.x[idx] = testSignExtend(data[0] | (data[1] & 0x0F) << 8, 12);
+            testLink.y[idx] = testSignExtend(data[1] >> 4 | data[2] << 4, 12);
+        }
+        else
+        {
+            testLink.x[idx] = (int16_t)(data[0] | data[1] << 8);
+            testLink.y[idx] = (int16_t)(data[2] | data[3] << 8);
+        }
+        break;
+    default:
+        break;
+    }
+    testLink.sumX += testLink.x[idx];
+    testLink.sumY += testLink.y[idx];
+    return MOTION_SEND_OK;
+}
+
+
+void motionSensorSample(void)
+{
+}
+
+
+/*********test****************/
+static void testConnect(uint8_t txBuffers)
+{
+    memset(&testLink, 0, sizeof(testLink));
+    testLink.queueSize = txBuffers;
+    testLink.result    = MOTION_SEND_OK;
+    motionInit();
+    motionSetBootMode(false);
+    motionSetSync(false);
+    motionSetScale(MOTION_SCALE_ONE);
+    motionConnect(txBuffers);
+}
+
+
+// stand-in SoftDevice sends count notifications and reports BLE_GATTS_EVT_HVN_TX_COMPLETE
+static void testTxComplete(uint32_t count)
+{
+    testLink.queued -= count;
+    motionTxComplete(count);
+}
+
+
+static void testAdd(int16_t x, int16_t y)
+{
+    motionAdd(x, y, 0, 0);
+    motionProcess();
+}
+
+
+static void testAccumulate(void)
+{
+    motionStatT stat;
+
+    testConnect(1);
+    testAdd(5, -3);
+    TEST_CHECK_EQ(testLink.reportCnt, 1);
+    TEST_CHECK_EQ(testLink.x[0], 5);
+    TEST_CHECK_EQ(testLink.y[0], -3);
+
+    // link busy: motion is summed, not sent and not lost
+    for(int16_t cnt = 1; cnt <= 10; cnt++)
+    {
+        testAdd(cnt, -cnt);
+    }
+    TEST_CHECK_EQ(testLink.reportCnt, 1);
+    TEST_CHECK(motionIsPending());
+    testTxComplete(1);
+    TEST_CHECK_EQ(testLink.reportCnt, 2);
+    TEST_CHECK_EQ(testLink.x[1], 55);
+    TEST_CHECK_EQ(testLink.y[1], -55);
+    TEST_CHECK(!motionIsPending());
+
+    // buffer back with nothing to send is kept for the next motion
+    testTxComplete(1);
+    TEST_CHECK_EQ(testLink.reportCnt, 2);
+    testAdd(1, 1);
+    TEST_CHECK_EQ(testLink.reportCnt, 3);
+    motionGetStat(&stat);
+    TEST_CHECK_EQ(stat.reports, 3);
+    TEST_CHECK_EQ(stat.busy, 0);
+    TEST_CHECK_EQ(stat.carried, 0);
+    TEST_CHECK_EQ(stat.droppedCounts, 0);
+}
+
+
+static void testScaleCarry(void)
+{
+    motionStatT stat;
+
+    // fraction of scaled counts waits till it makes whole count
+    testConnect(4);
+    motionSetScale(MOTION_SCALE_ONE / 4);
+    testAdd(3, -3);
+    TEST_CHECK_EQ(testLink.reportCnt, 0);
+    TEST_CHECK(!motionIsPending());
+    testAdd(1, -1);
+    TEST_CHECK_EQ(testLink.reportCnt, 1);
+    TEST_CHECK_EQ(testLink.x[0], 1);
+    TEST_CHECK_EQ(testLink.y[0], -1);
+
+    // motion beyond report range goes in next reports, direction is kept
+    testConnect(1);
+    testAdd(MOTION_XY_MAX, 0);
+    testAdd(MOTION_XY_MAX, MOTION_XY_MAX / 2);
+    testAdd(10, -MOTION_XY_MAX);
+    TEST_CHECK_EQ(testLink.reportCnt, 1);
+    for(uint32_t cnt = 0; cnt < 4 && motionIsPending(); cnt++)
+    {
+        testTxComplete(1);
+    }
+    TEST_CHECK_EQ(testLink.reportCnt, 3);
+    TEST_CHECK_EQ(testLink.x[1], MOTION_XY_MAX);
+    TEST_CHECK_EQ(testLink.y[1], MOTION_XY_MAX / 2 - MOTION_XY_MAX);
+    TEST_CHECK_EQ(testLink.x[2], 10);
+    TEST_CHECK_EQ(testLink.y[2], 0);
+    TEST_CHECK_EQ(testLink.sumX, 2 * MOTION_XY_MAX + 10);
+    TEST_CHECK_EQ(testLink.sumY, MOTION_XY_MAX / 2 - MOTION_XY_MAX);
+    motionGetStat(&stat);
+    TEST_CHECK_EQ(stat.carried, 1);
+
+    testConnect(1);
+    testAdd(INT16_MAX, INT16_MIN);
+    while(motionIsPending() && testLink.reportCnt < TEST_REPORTS_MAX)
+    {
+        testTxComplete(1);
+    }
+    TEST_CHECK_EQ(testLink.sumX, INT16_MAX);
+    TEST_CHECK_EQ(testLink.sumY, INT16_MIN);
+    motionGetStat(&stat);
+    TEST_CHECK_EQ(stat.carried, testLink.reportCnt - 1);
+}
+
+
+static void testPacing(void)
+{
+    motionStatT stat;
+
+    // one report per free buffer
+    testConnect(3);
+    for(int16_t cnt = 0; cnt < 5; cnt++)
+    {
+        testAdd(1, 0);
+    }
+    TEST_CHECK_EQ(testLink.reportCnt, 3);
+    TEST_CHECK_EQ(testLink.queued, 3);
+    testTxComplete(2);
+    TEST_CHECK_EQ(testLink.reportCnt, 4);
+    TEST_CHECK_EQ(testLink.x[3], 2);
+
+    // completion of other notifications can't give more buffers than connection has
+    testLink.queued = 0;
+    motionTxComplete(10);
+    for(int16_t cnt = 0; cnt < 5; cnt++)
+    {
+        testAdd(1, 0);
+    }
+    TEST_CHECK_EQ(testLink.reportCnt, 7);
+    TEST_CHECK_EQ(testLink.sumX, 8);
+    motionGetStat(&stat);
+    TEST_CHECK_EQ(stat.busy, 0);
+
+    // buffer used by other notification: motion waits next completion
+    testLink.result = MOTION_SEND_BUSY;
+    testTxComplete(1);
+    testAdd(4, 4);
+    testAdd(4, 4);
+    testLink.result = MOTION_SEND_OK;
+    testAdd(1, 1);
+    TEST_CHECK_EQ(testLink.reportCnt, 7);
+    testTxComplete(1);
+    TEST_CHECK_EQ(testLink.reportCnt, 8);
+    TEST_CHECK_EQ(testLink.x[7], 11);
+    TEST_CHECK_EQ(testLink.y[7], 9);
+    motionGetStat(&stat);
+    TEST_CHECK_EQ(stat.busy, 1);
+    TEST_CHECK_EQ(stat.reports, 8);
+
+    // notification is off: motion is dropped and counted
+    testTxComplete(1);
+    testLink.result = MOTION_SEND_DROP;
+    testAdd(-6, 2);
+    TEST_CHECK(!motionIsPending());
+    testLink.result = MOTION_SEND_OK;
+    testAdd(1, 0);
+    TEST_CHECK_EQ(testLink.reportCnt, 9);
+    TEST_CHECK_EQ(testLink.x[8], 1);
+    motionGetStat(&stat);
+    TEST_CHECK_EQ(stat.droppedCounts, 8);
+
+    // disconnected: nothing is kept or sent
+    motionDisconnect();
+    testAdd(9, 9);
+    motionTxComplete(3);
+    TEST_CHECK(!motionIsPending());
+    TEST_CHECK_EQ(testLink.reportCnt, 9);
+}
+
+
+static void testButtonsFirst(void)
+{
+    testConnect(1);
+    testAdd(1, 0);
+    testAdd(20, 30);
+    motionSetButtons(0x01);
+    motionAdd(0, 0, -2, 0);
+    motionProcess();
+    TEST_CHECK_EQ(testLink.reportCnt, 1);
+    testTxComplete(1);
+    TEST_CHECK_EQ(testLink.report[1], MOTION_REPORT_BUTTONS);
+    TEST_CHECK_EQ(testLink.buttons[1], 0x01);
+    TEST_CHECK_EQ(testLink.wheel[1], -2);
+    testTxComplete(1);
+    TEST_CHECK_EQ(testLink.report[2], MOTION_REPORT_MOVEMENT);
+    TEST_CHECK_EQ(testLink.x[2], 20);
+    TEST_CHECK_EQ(testLink.y[2], 30);
+
+    // the same buttons are not sent again
+    testTxComplete(1);
+    motionSetButtons(0x01);
+    motionProcess();
+    TEST_CHECK_EQ(testLink.reportCnt, 3);
+}
+
+
+static void testBacklogLimit(void)
+{
+    motionStatT stat;
+    uint32_t    adds = (uint32_t)(MOTION_INTEGRATOR_MAX / INT16_MAX) + 2;
+
+    testConnect(1);
+    testAdd(1, 0);
+    for(uint32_t cnt = 0; cnt < adds; cnt++)
+    {
+        testAdd(INT16_MAX, 0);
+    }
+    motionGetStat(&stat);
+    TEST_CHECK_EQ(stat.droppedCounts, (uint32_t)(adds * INT16_MAX - MOTION_INTEGRATOR_MAX));
+    TEST_CHECK(motionIsPending());
+}
+
+
+int main(void)
+{
+    testAccumulate();
+    testScaleCarry();
+    testPacing();
+    testButtonsFirst();
+    testBacklogLimit();
+    printf("MOTION_XY_BITS %u: ", MOTION_XY_BITS);
+    return testResult("mouseMotionTest");
+}
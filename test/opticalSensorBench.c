@@ -0,0 +1,193 @@
+/*file: opticalSensorBench.c
+ *
+ * Host benchmark of ADNS2080 read path over sensor stand-in (stub/adns2080Stub), time runs by SDIO bus cost of
+ * each transfer (sdio.c timing) and sensor moves one frame every BENCH_FRAME_US at constant speed (1000 dpi,
+ * y half speed of x):
+ *   - poll: former path, motion bits and movement read by byte transfers once per connection interval
+ *   - interrupt: opticalSensor pipeline, MOTION pin interrupt burst reads to FIFO, drained once per interval
+ * Motion read is shown against motion moved, the difference is motion of the last interval not yet read.
+ * HOST_SENSOR_BURST_BIT_US sets clock of burst read (no delays in sdio_read_burst()).
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "adns2080.h"
+#include "opticalSensor.h"
+#include "adns2080Stub.h"
+
+#define BENCH_FRAME_US         (1e6 / 2300)    // sensor frame rate
+#define BENCH_INTERVAL_US      7500.0          // connection interval
+#define BENCH_SECONDS          2.0
+#define BENCH_DPI              1000
+
+static struct
+{
+    double  now;
+    double  nextFrame;
+    double  speedX;                            // counts per frame
+    double  speedY;
+    double  restX;                             // fraction of count
+    double  restY;
+    int64_t movedX;
+    int64_t movedY;
+    int64_t readX;
+    int64_t readY;
+    double  isrMaxUs;
+}bench;
+
+
+void sensorSampleReady(void)
+{
+}
+
+
+static void benchFrames(void)
+{
+    while(bench.nextFrame <= bench.now)
+    {
+        int32_t x;
+        int32_t y;
+
+        bench.restX     += bench.speedX;
+        bench.restY     += bench.speedY;
+        x                = (int32_t)bench.restX;
+        y                = (int32_t)bench.restY;
+        bench.restX     -= x;
+        bench.restY     -= y;
+        bench.movedX    += x;
+        bench.movedY    += y;
+        hostSensorMove(x, y);
+        bench.nextFrame += BENCH_FRAME_US;
+    }
+}
+
+
+static void benchBusHook(double us)
+{
+    bench.now += us;
+    benchFrames();
+}
+
+
+static void benchInterruptRun(void)
+{
+    double start = bench.now;
+
+    hostSensorInterruptRun();
+    if(bench.now - start > bench.isrMaxUs)
+    {
+        bench.isrMaxUs = bench.now - start;
+    }
+}
+
+
+static bool benchRun(bool isInterrupt, bool is12Bits, double ips)
+{
+    double      nextInterval;
+    double      end;
+    double      busUs;
+    sensorStatT stat;
+    sensorStatT statEnd;
+    int16_t     x;
+    int16_t     y;
+    uint32_t    polls = 0;
+
+    hostSensorReset();
+    memset(&bench, 0, sizeof(bench));
+    hostSensor.busHook = benchBusHook;
+    if(isInterrupt)
+    {
+        if(sensorInit(0, ADNS2080_RESOLUTION_1000DPI) != SENSOR_OK)
+        {
+            return false;
+        }
+        sensorStart();
+    }
+    else
+    {
+        adns2080_init();
+        adns2080_motion_bits_set(is12Bits ? ADNS2080_MOTION_BITS_12 : ADNS2080_MOTION_BITS_8);
+    }
+    if(((hostSensor.regs[0x0D] & 0x80) != 0) != is12Bits)
+    {
+        return false;
+    }
+    sensorGetStat(&stat);
+    busUs                 = hostSensor.busUs;
+    hostSensor.lostCounts = 0;
+    bench.nextFrame       = bench.now;
+    bench.speedX          = ips * BENCH_DPI / 2300.0;
+    bench.speedY          = -bench.speedX / 2;
+    bench.movedX          = 0;
+    bench.movedY          = 0;
+    nextInterval          = bench.now + BENCH_INTERVAL_US;
+    end                   = bench.now + BENCH_SECONDS * 1e6;
+    while(bench.now < end)
+    {
+        bench.now = (bench.nextFrame < nextInterval) ? bench.nextFrame : nextInterval;
+        benchFrames();
+        if(isInterrupt)
+        {
+            benchInterruptRun();
+        }
+        if(bench.now >= nextInterval)
+        {
+            if(isInterrupt)
+            {
+                while(sensorRead(&x, &y))
+                {
+                    bench.readX += x;
+                    bench.readY += y;
+                    benchInterruptRun();
+                }
+            }
+            else
+            {
+                (void)adns2080_motion_bits_read();             // as adns2080_movement_read() did on each read
+                adns2080_movement_read(&x, &y);
+                bench.readX += x;
+                bench.readY += y;
+                polls++;
+            }
+            nextInterval += BENCH_INTERVAL_US;
+        }
+    }
+    busUs = hostSensor.busUs - busUs;
+
+    printf("%-9s %2u bit %3.0f ips: x %lld/%lld y %lld/%lld lost %u, bus %5.1f%%, ", isInterrupt ? "interrupt" : "poll",
+           is12Bits ? 12 : 8, ips, (long long)bench.readX, (long long)bench.movedX, (long long)bench.readY,
+           (long long)bench.movedY, hostSensor.lostCounts, 100 * busUs / (BENCH_SECONDS * 1e6));
+    if(isInterrupt)
+    {
+        sensorGetStat(&statEnd);
+        sensorStop();
+        printf("%5.0f samples/s, %5.0f irq/s, isr max %4.0f us, carried %u, recovered %u\n",
+               (statEnd.samples - stat.samples) / BENCH_SECONDS, (statEnd.interrupts - stat.interrupts) / BENCH_SECONDS,
+               bench.isrMaxUs, statEnd.carried - stat.carried, statEnd.recovered - stat.recovered);
+    }
+    else
+    {
+        printf("%5.0f samples/s, read %4.0f us per sample\n", polls / BENCH_SECONDS, busUs / polls);
+    }
+    return true;
+}
+
+
+int main(void)
+{
+    const double speed[] = {5, 20, 60};
+
+    for(uint32_t cnt = 0; cnt < sizeof(speed) / sizeof(speed[0]); cnt++)
+    {
+        if(!benchRun(false, true, speed[cnt]) ||
+           !benchRun(true, SENSOR_MOTION_BITS == ADNS2080_MOTION_BITS_12, speed[cnt]))
+        {
+            printf("sensor setup failed\n");
+            return 1;
+        }
+    }
+    return 0;
+}
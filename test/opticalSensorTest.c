@@ -0,0 +1,289 @@
+/*file: opticalSensorTest.c
+ *
+ * Unit test of opticalSensor over SDK ADNS2080 driver and sensor stand-in (stub/adns2080Stub): init settings,
+ * interrupt burst read to FIFO, reads while MOTION pin stays active, pin already active when its event is
+ * enabled (sensorStart(), recovery read of sensorRead()) is read by main context and reported by
+ * sensorSampleReady(), FIFO full carry, motion of stopped sensor is discarded. Motion read by sensorRead() adds
+ * up to what sensor was moved.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "opticalSensor.h"
+#include "adns2080Stub.h"
+#include "testCheck.h"
+
+#define TEST_MOTION_PIN        11
+#define TEST_DELTA_MAX         ((SENSOR_MOTION_BITS == ADNS2080_MOTION_BITS_12) ? 2047 : 127)
+
+
+/*********opticalSensor USER IMPLEMENTED FUNCTION****************/
+static struct
+{
+    uint32_t readyCalls;
+    uint32_t readyMainCalls;           // out of interrupt
+    int32_t  moveX;                    // motion given to sensor while started
+    int32_t  moveY;
+    int32_t  readX;                    // motion taken by sensorRead()
+    int32_t  readY;
+    uint32_t burstMoves;               // next bursts with sensor moving during read, after DELTA_X
+    uint32_t burst;
+    uint32_t burstCalls;
+}testSensor;
+
+static sensorStatT testStatBase;           // module statistics run over all cases
+
+
+void sensorSampleReady(void)
+{
+    testSensor.readyCalls++;
+    testSensor.readyMainCalls += !hostSensor.isInterrupt;
+}
+
+
+/*********test****************/
+static void testMove(int32_t x, int32_t y)
+{
+    testSensor.moveX += x;
+    testSensor.moveY += y;
+    hostSensorMove(x, y);
+}
+
+
+static void testBusHook(double us)
+{
+    (void)us;
+    if(testSensor.burst != hostSensor.bursts)
+    {
+        testSensor.burst      = hostSensor.bursts;
+        testSensor.burstCalls = 0;
+    }
+    // the second bus call of burst comes after DELTA_X is read
+    if(testSensor.burstMoves != 0 && ++testSensor.burstCalls == 2)
+    {
+        testSensor.burstMoves--;
+        testMove(3, -1);
+    }
+}
+
+
+static uint32_t testDrain(void)
+{
+    int16_t  x;
+    int16_t  y;
+    uint32_t samples = 0;
+
+    while(sensorRead(&x, &y))
+    {
+        testSensor.readX += x;
+        testSensor.readY += y;
+        samples++;
+    }
+    return samples;
+}
+
+
+static void testStatGet(sensorStatT *stat)
+{
+    sensorGetStat(stat);
+    stat->interrupts -= testStatBase.interrupts;
+    stat->samples    -= testStatBase.samples;
+    stat->carried    -= testStatBase.carried;
+    stat->recovered  -= testStatBase.recovered;
+}
+
+
+static void testInitSensor(void)
+{
+    hostSensorReset();
+    memset(&testSensor, 0, sizeof(testSensor));
+    hostSensor.busHook = testBusHook;
+    TEST_CHECK_EQ(sensorInit(TEST_MOTION_PIN, ADNS2080_RESOLUTION_1000DPI), SENSOR_OK);
+    sensorGetStat(&testStatBase);
+}
+
+
+static void testStart(void)
+{
+    testInitSensor();
+    sensorStart();
+}
+
+
+static void testInit(void)
+{
+    testStart();
+    TEST_CHECK_EQ(hostSensor.motionPin, TEST_MOTION_PIN);
+    TEST_CHECK(hostSensor.isEventEnabled);
+    TEST_CHECK_EQ((hostSensor.regs[0x0D] & 0x80) != 0, SENSOR_MOTION_BITS == ADNS2080_MOTION_BITS_12);
+    TEST_CHECK_EQ(hostSensor.regs[0x44], (SENSOR_MOTION_BITS == ADNS2080_MOTION_BITS_12) ? 0x0C : 0x04);
+    TEST_CHECK_EQ(testSensor.readyCalls, 0);
+
+    // falling edge of MOTION pin: one burst read in interrupt, sample in FIFO
+    testMove(5, -3);
+    hostSensorInterruptRun();
+    TEST_CHECK_EQ(testSensor.readyCalls, 1);
+    TEST_CHECK(!hostSensorIsMotion());
+    TEST_CHECK_EQ(testDrain(), 1);
+    TEST_CHECK(testSensor.readX == 5 && testSensor.readY == -3);
+
+    // full DELTA register range
+    testMove(TEST_DELTA_MAX, -TEST_DELTA_MAX);
+    hostSensorInterruptRun();
+    testMove(-TEST_DELTA_MAX, TEST_DELTA_MAX - 1);
+    hostSensorInterruptRun();
+    TEST_CHECK_EQ(testDrain(), 2);
+    TEST_CHECK_EQ(testSensor.readX, testSensor.moveX);
+    TEST_CHECK_EQ(testSensor.readY, testSensor.moveY);
+    TEST_CHECK_EQ(hostSensor.lostCounts, 0);
+}
+
+
+// motion of the frame that came during discarding read of sensorStart() keeps pin active, no edge comes
+static void testStartActive(void)
+{
+    sensorStatT stat;
+
+    testInitSensor();
+    hostSensorMove(7, 7);
+    testSensor.burstMoves = 1;
+    sensorStart();
+    TEST_CHECK_EQ(testSensor.readyCalls, 1);
+    TEST_CHECK_EQ(testSensor.readyMainCalls, 1);
+    TEST_CHECK(!hostSensorIsMotion());
+    TEST_CHECK(hostSensor.isEventEnabled);
+    testStatGet(&stat);
+    TEST_CHECK_EQ(stat.recovered, 1);
+    TEST_CHECK_EQ(stat.interrupts, 0);
+
+    // the next motion gives edge again
+    testMove(2, 2);
+    hostSensorInterruptRun();
+    TEST_CHECK_EQ(testSensor.readyCalls, 2);
+    TEST_CHECK_EQ(testDrain(), 2);
+    TEST_CHECK_EQ(testSensor.readX, testSensor.moveX);
+    TEST_CHECK_EQ(testSensor.readY, testSensor.moveY);
+}
+
+
+// motion during each read keeps pin active: interrupt reads again, up to SENSOR_READ_MAX reads, edge of motion
+// that came after DELTA_X was read gives the next interrupt
+static void testReadMax(void)
+{
+    sensorStatT stat;
+
+    testStart();
+    testSensor.burstMoves = SENSOR_READ_MAX;
+    testMove(1, 1);
+    hostSensorInterruptRun();
+    TEST_CHECK(!hostSensorIsMotion());
+    TEST_CHECK_EQ(testSensor.readyCalls, 2);
+    testStatGet(&stat);
+    TEST_CHECK_EQ(stat.interrupts, 2);
+    TEST_CHECK_EQ(stat.samples, SENSOR_READ_MAX + 1);
+    TEST_CHECK_EQ(testDrain(), SENSOR_READ_MAX + 1);
+    TEST_CHECK_EQ(testSensor.readX, testSensor.moveX);
+    TEST_CHECK_EQ(testSensor.readY, testSensor.moveY);
+    TEST_CHECK_EQ(stat.recovered, 0);
+}
+
+
+// active pin without interrupt and empty FIFO: sensorRead() reads it, sample comes by the next call
+static void testRecover(void)
+{
+    sensorStatT stat;
+
+    testStart();
+    testMove(2, 2);
+    hostSensor.isEventPending = false;
+    TEST_CHECK_EQ(testDrain(), 0);
+    TEST_CHECK(!hostSensorIsMotion());
+    TEST_CHECK(hostSensor.isEventEnabled);
+    TEST_CHECK_EQ(testSensor.readyMainCalls, 0);
+    TEST_CHECK_EQ(testDrain(), 1);
+    testStatGet(&stat);
+    TEST_CHECK_EQ(stat.recovered, 1);
+    TEST_CHECK_EQ(stat.interrupts, 0);
+
+    // motion goes on during recovery read: pin is active again when event is enabled, it is read there too
+    testSensor.burstMoves = 2;
+    testMove(2, 2);
+    hostSensor.isEventPending = false;
+    TEST_CHECK_EQ(testDrain(), 0);
+    TEST_CHECK(!hostSensorIsMotion());
+    TEST_CHECK(hostSensor.isEventEnabled);
+    TEST_CHECK_EQ(testSensor.readyMainCalls, 1);
+    TEST_CHECK_EQ(testDrain(), 3);
+    TEST_CHECK_EQ(testSensor.readX, testSensor.moveX);
+    TEST_CHECK_EQ(testSensor.readY, testSensor.moveY);
+    testStatGet(&stat);
+    TEST_CHECK_EQ(stat.recovered, 3);
+    TEST_CHECK_EQ(stat.interrupts, 0);
+}
+
+
+static void testFifoFull(void)
+{
+    sensorStatT stat;
+
+    testStart();
+    for(uint32_t cnt = 0; cnt < SENSOR_FIFO_SIZE + 3; cnt++)
+    {
+        testMove(1, -2);
+        hostSensorInterruptRun();
+    }
+    testStatGet(&stat);
+    TEST_CHECK_EQ(stat.carried, 3);
+    TEST_CHECK_EQ(testDrain(), SENSOR_FIFO_SIZE);
+
+    // carry goes with the next sample
+    testMove(1, -2);
+    hostSensorInterruptRun();
+    TEST_CHECK_EQ(testDrain(), 1);
+    TEST_CHECK_EQ(testSensor.readX, testSensor.moveX);
+    TEST_CHECK_EQ(testSensor.readY, testSensor.moveY);
+}
+
+
+static void testStop(void)
+{
+    int16_t x;
+    int16_t y;
+
+    testStart();
+    sensorStop();
+    TEST_CHECK(!hostSensor.isEventEnabled);
+    hostSensorMove(5, 5);
+    hostSensorInterruptRun();
+    TEST_CHECK_EQ(testSensor.readyCalls, 0);
+
+    // stopped sensor is not read, bus is not touched
+    TEST_CHECK(!sensorRead(&x, &y));
+    TEST_CHECK(hostSensorIsMotion());
+
+    // motion collected while stopped is discarded
+    sensorStart();
+    TEST_CHECK(!hostSensorIsMotion());
+    TEST_CHECK_EQ(testSensor.readyCalls, 0);
+    TEST_CHECK_EQ(testDrain(), 0);
+    testMove(-4, 6);
+    hostSensorInterruptRun();
+    TEST_CHECK_EQ(testDrain(), 1);
+    TEST_CHECK(testSensor.readX == -4 && testSensor.readY == 6);
+}
+
+
+int main(void)
+{
+    testInit();
+    testStartActive();
+    testReadMax();
+    testRecover();
+    testFifoFull();
+    testStop();
+    printf("SENSOR_MOTION_BITS %u: ", (SENSOR_MOTION_BITS == ADNS2080_MOTION_BITS_12) ? 12 : 8);
+    return testResult("opticalSensorTest");
+}
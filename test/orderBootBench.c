@@ -0,0 +1,282 @@
+/*file: orderBootBench.c
+ *
+ * Host benchmark of boot read of device order over FDS on file backed fstorage (nrf_fstorage_file).
+ * Flash hooks are copied from ble_app_hids_mouse main.c: cached record descriptor opened in place, and
+ * former flashMemReadBytes() (all records of order file/key are found with new token and copied to RAM, last
+ * one is kept) behind the same flashMemOpen(). Flash has BENCH_OTHER_RECORDS other records (peer data)
+ * before order record. Boot read is orderReadFlash() with descriptor not found yet, next read uses cached
+ * descriptor (after writes and garbage collection on target). Built with and without FDS RAM index
+ * (FDS_RAM_INDEX_ENABLED from make). Both reads are checked to give the same order before timing.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "fds.h"
+#include "nrf_fstorage_file.h"
+#include "orderProcessing.h"
+#include "systemTimeStub.h"
+
+#define FILE_ORDER             0xBAAB          // as in main.c
+#define RECORD_KEY_ORDER       0xABBA
+#define BENCH_FILE_OTHER       0xC000          // peer manager file IDs start here
+#define BENCH_FLASH_ADDRESS    0               // not used by FDS hooks
+#define BENCH_READS            20000
+
+static const uint32_t benchOtherRecords[] = {0, 8, 32};
+
+static bool benchIsFormerRead;
+
+
+/*********flash hooks of main.c****************/
+static struct
+{
+    fds_record_desc_t desc;
+    bool              isValid;
+} orderRecord;
+
+
+static bool orderRecordFind(void)
+{
+    fds_find_token_t ftok;
+
+    memset(&ftok, 0x00, sizeof(fds_find_token_t));
+    orderRecord.isValid = (fds_record_find(FILE_ORDER, RECORD_KEY_ORDER, &orderRecord.desc, &ftok) == FDS_SUCCESS);
+    return orderRecord.isValid;
+}
+
+
+/*********former flashMemReadBytes()****************/
+static uint32_t formerBuffer[64];
+
+
+static uint32_t formerReadBytes(uint8_t buffer[], uint32_t bufferSize)
+{
+    fds_flash_record_t  flash_record;
+    fds_record_desc_t   record_desc;
+    fds_find_token_t    ftok;
+    uint32_t            recordSize = 0;
+
+    memset(&ftok, 0x00, sizeof(fds_find_token_t));
+    while (fds_record_find(FILE_ORDER, RECORD_KEY_ORDER, &record_desc, &ftok) == FDS_SUCCESS)
+    {
+        if (fds_record_open(&record_desc, &flash_record) != FDS_SUCCESS)
+        {
+            continue;
+        }
+        recordSize = flash_record.p_header->length_words * sizeof(uint32_t);
+        if(recordSize > bufferSize)
+        {
+            recordSize = bufferSize;
+        }
+        memcpy(buffer, (uint8_t*)flash_record.p_data, recordSize);
+        memset(&buffer[recordSize], 0xFF, bufferSize - recordSize);
+        (void)fds_record_close(&record_desc);
+    }
+    return recordSize;
+}
+
+
+/*********orderProcessing USER IMPLEMENTED FUNCTION****************/
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+{
+    fds_record_t record;
+    ret_code_t   ret;
+
+    (void)flashAddress;
+    record.file_id           = FILE_ORDER;
+    record.key               = RECORD_KEY_ORDER;
+    record.data.p_data       = buffer;
+    record.data.length_words = (bufferSize + 3) / 4;
+    if(orderRecord.isValid || orderRecordFind())
+    {
+        ret = fds_record_update(&orderRecord.desc, &record);
+    }
+    else
+    {
+        ret = fds_record_write(&orderRecord.desc, &record);
+    }
+    orderRecord.isValid = (ret == FDS_SUCCESS);
+    return ret;
+}
+
+
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
+{
+    fds_flash_record_t flash_record;
+
+    (void)flashAddress;
+    if(benchIsFormerRead)
+    {
+        *size = formerReadBytes((uint8_t *)formerBuffer, sizeof(formerBuffer));
+        return (*size != 0) ? (const uint8_t *)formerBuffer : NULL;
+    }
+    if(!orderRecord.isValid && !orderRecordFind())
+    {
+        return NULL;
+    }
+    if(fds_record_open(&orderRecord.desc, &flash_record) != FDS_SUCCESS)
+    {
+        if(!orderRecordFind() || fds_record_open(&orderRecord.desc, &flash_record) != FDS_SUCCESS)
+        {
+            orderRecord.isValid = false;
+            return NULL;
+        }
+    }
+    *size = flash_record.p_header->length_words * sizeof(uint32_t);
+    return (const uint8_t *)flash_record.p_data;
+}
+
+
+void flashMemClose(uint32_t flashAddress)
+{
+    (void)flashAddress;
+    if(!benchIsFormerRead)
+    {
+        (void)fds_record_close(&orderRecord.desc);
+    }
+}
+
+
+/*********benchmark****************/
+static volatile uint32_t benchSink;             // keeps result of timed loops
+static bool              benchIsInit;
+
+
+static void benchFdsHandler(fds_evt_t const *p_evt)
+{
+    if(p_evt->id == FDS_EVT_INIT)
+    {
+        benchIsInit = (p_evt->result == FDS_SUCCESS);
+    }
+}
+
+
+static uint64_t benchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+// other records first, then order record written by orderProcessing through flash hooks
+static bool benchFlashFill(orderT order, uint32_t otherRecords)
+{
+    static uint32_t data[2];
+    fds_record_desc_t desc;
+    fds_record_t      record = {.data = {.p_data = data, .length_words = 2}};
+
+    for(uint32_t cnt = 0; cnt < otherRecords; cnt++)
+    {
+        data[0]        = cnt;
+        record.file_id = BENCH_FILE_OTHER + cnt % 4;
+        record.key     = 1 + cnt;
+        if(fds_record_write(&desc, &record) != FDS_SUCCESS)
+        {
+            return false;
+        }
+    }
+    for(uint8_t peer = 0; peer < ORDER_ITEM_QUANTITY; peer++)
+    {
+        orderUsageConnect(order, peer);
+    }
+    orderWriteFlash(order, BENCH_FLASH_ADDRESS);
+    return orderFlushAll() && !orderIsDirty(order);
+}
+
+
+static bool benchIsEqual(orderT order, orderT copy)
+{
+    if(orderGetQuantity(copy) != orderGetQuantity(order))
+    {
+        return false;
+    }
+    for(uint8_t pos = 0; pos < orderGetQuantity(order); pos++)
+    {
+        if(orderGetItem(copy, pos) != orderGetItem(order, pos))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// ns per orderReadFlash(), descriptor is forgotten before each boot read
+static double benchRead(orderT copy, bool isFormer, bool isBoot)
+{
+    uint64_t start;
+
+    benchIsFormerRead = isFormer;
+    start = benchNow();
+    for(uint32_t cnt = 0; cnt < BENCH_READS; cnt++)
+    {
+        orderRecord.isValid = orderRecord.isValid && !isBoot;
+        orderClean(copy);
+        benchSink += orderReadFlash(copy, BENCH_FLASH_ADDRESS);
+    }
+    return (double)(benchNow() - start) / BENCH_READS;
+}
+
+
+int main(void)
+{
+    for(uint32_t cnt = 0; cnt < sizeof(benchOtherRecords) / sizeof(benchOtherRecords[0]); cnt++)
+    {
+        orderT order;
+        orderT copy;
+        double formerNs;
+        double bootNs;
+        double cachedNs;
+
+        // each flash content in its own process: FDS is initialized once
+        if(fork() != 0)
+        {
+            int status;
+
+            wait(&status);
+            if(status != 0)
+            {
+                return 1;
+            }
+            continue;
+        }
+        order = orderMalloc();
+        copy  = orderMalloc();
+        unlink(NRF_FSTORAGE_FILE_NAME);
+        hostTimeReset();
+        if(fds_register(benchFdsHandler) != FDS_SUCCESS || fds_init() != FDS_SUCCESS || !benchIsInit ||
+           !benchFlashFill(order, benchOtherRecords[cnt]))
+        {
+            printf("flash setup with %u other records failed\n", benchOtherRecords[cnt]);
+            return 1;
+        }
+        for(uint32_t former = 0; former < 2; former++)
+        {
+            orderRecord.isValid = false;
+            benchIsFormerRead   = (former != 0);
+            orderClean(copy);
+            if(!orderReadFlash(copy, BENCH_FLASH_ADDRESS) || !benchIsEqual(order, copy))
+            {
+                printf("%s read differs from written order\n", (former != 0) ? "former" : "cached descriptor");
+                return 1;
+            }
+        }
+
+        formerNs = benchRead(copy, true,  true);
+        bootNs   = benchRead(copy, false, true);
+        cachedNs = benchRead(copy, false, false);
+        printf("RAM index %u, other records %2u: former read %7.1f ns, boot read %7.1f ns, cached descriptor %7.1f ns\n",
+               FDS_RAM_INDEX_ENABLED, benchOtherRecords[cnt], formerNs, bootNs, cachedNs);
+        return 0;
+    }
+    return 0;
+}
@@ -0,0 +1,283 @@
+/*file: orderFlashTest.c
+ *
+ * Unit test of orderProcessing flash write-behind against in-memory flash with injected write errors.
+ * Connect storms (connections/disconnections closer than ORDER_FLUSH_QUIET_TIME) are counted in flash writes:
+ * one write per storm, flash content is read back equal to the order. Write that isn't queued keeps order dirty
+ * and last written image, it is retried after ORDER_FLUSH_RETRY_TIME; shutdown flush doesn't report started
+ * write on error; failed queued write (orderFlushFailed()) is written again.
+ * Queued write is completed TEST_WRITE_TIME later as FDS does (write event calls orderFlushDone()), flash gets
+ * the buffer content of that time: buffer must be unchanged since flashMemWriteBytes(), order changed meanwhile
+ * is written after the event.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "orderProcessing.h"
+#include "systemTimeStub.h"
+#include "testCheck.h"
+
+#define TEST_FLASH_ADDRESS     0x000FE000
+#define TEST_PEER_QUANTITY     8
+#define TEST_STORM_EVENTS      500
+#define TEST_STORMS            20
+#define TEST_WRITE_TIME        20              // ms, queued write to write event
+
+static struct
+{
+    uint32_t      data[256];                   // word aligned record
+    uint32_t      size;                        // bytes, 0 - no record
+    uint32_t      attempts;                    // flashMemWriteBytes() calls
+    uint32_t      writes;                      // queued writes
+    uint32_t      failCnt;                     // next attempts to fail
+    uint32_t      queued[256];                 // buffer content at flashMemWriteBytes()
+    uint8_t      *buffer;                      // buffer of queued write, NULL - no write queued
+    uint32_t      bufferSize;
+    uint32_t      writeTime;                   // ms, queued write to write event
+    bool          isWriteFail;                 // write event reports failure
+    orderT        order;
+    timerCallbacT doneTimer;
+}testFlash;
+
+
+/*********orderProcessing USER IMPLEMENTED FUNCTION****************/
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+{
+    (void)flashAddress;
+    testFlash.attempts++;
+    if(testFlash.failCnt != 0)
+    {
+        testFlash.failCnt--;
+        return NRF_ERROR_BUSY;
+    }
+    TEST_CHECK(testFlash.buffer == NULL);
+    memcpy(testFlash.queued, buffer, bufferSize);
+    testFlash.buffer     = buffer;
+    testFlash.bufferSize = bufferSize;
+    testFlash.writes++;
+    timerRun(testFlash.doneTimer, testFlash.writeTime);
+    return NRF_SUCCESS;
+}
+
+
+// write event of FDS: buffer is read now
+static void testWriteDone(void *context)
+{
+    (void)context;
+    TEST_CHECK(memcmp(testFlash.queued, testFlash.buffer, testFlash.bufferSize) == 0);
+    testFlash.buffer = NULL;
+    if(testFlash.isWriteFail)
+    {
+        testFlash.isWriteFail = false;
+        orderFlushFailed(testFlash.order);
+        return;
+    }
+    memcpy(testFlash.data, testFlash.queued, testFlash.bufferSize);
+    testFlash.size = testFlash.bufferSize;
+    orderFlushDone(testFlash.order);
+}
+
+
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
+{
+    (void)flashAddress;
+    if(testFlash.size == 0)
+    {
+        return NULL;
+    }
+    *size = testFlash.size;
+    return (const uint8_t *)testFlash.data;
+}
+
+
+void flashMemClose(uint32_t flashAddress)
+{
+    (void)flashAddress;
+}
+
+
+/*********test****************/
+static void testEvent(orderT order)
+{
+    uint8_t peer = rand() % TEST_PEER_QUANTITY;
+
+    if(rand() % 2)
+    {
+        orderUsageConnect(order, peer);
+    }
+    else
+    {
+        orderUsageDisconnect(order, peer, (rand() % 120) * 60000);
+    }
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+}
+
+
+// flash is read back to other order
+static bool testFlashIsEqual(orderT order)
+{
+    orderT copy   = orderMalloc();
+    bool   isOk   = orderReadFlash(copy, TEST_FLASH_ADDRESS) && orderGetQuantity(copy) == orderGetQuantity(order);
+
+    for(uint8_t pos = 0; isOk && pos < orderGetQuantity(order); pos++)
+    {
+        uint16_t item = orderGetItem(order, pos);
+
+        isOk = orderGetItem(copy, pos) == item && orderGetScore(copy, item) == orderGetScore(order, item);
+    }
+    orderFree(copy);
+    return isOk;
+}
+
+
+static void testStorm(orderT order)
+{
+    uint32_t writes = testFlash.writes;
+
+    // one storm: quiet time is restarted by each event
+    for(uint32_t cnt = 0; cnt < TEST_STORM_EVENTS; cnt++)
+    {
+        hostTimeRun(getTime() + 1 + rand() % (ORDER_FLUSH_QUIET_TIME - 1));
+        testEvent(order);
+    }
+    TEST_CHECK_EQ(testFlash.writes, writes);
+    hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME + TEST_WRITE_TIME);
+    TEST_CHECK_EQ(testFlash.writes, writes + 1);
+    TEST_CHECK(!orderIsDirty(order));
+    TEST_CHECK(testFlashIsEqual(order));
+
+    // storms apart: one write per storm
+    writes = testFlash.writes;
+    for(uint32_t storm = 0; storm < TEST_STORMS; storm++)
+    {
+        for(uint32_t cnt = 0; cnt < TEST_STORM_EVENTS / TEST_STORMS; cnt++)
+        {
+            hostTimeRun(getTime() + 1 + rand() % 100);
+            testEvent(order);
+        }
+        hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME + TEST_WRITE_TIME + rand() % 60000);
+    }
+    TEST_CHECK_EQ(testFlash.writes, writes + TEST_STORMS);
+    TEST_CHECK_EQ(testFlash.attempts, testFlash.writes);
+    TEST_CHECK(testFlashIsEqual(order));
+    printf("storm of %u events: 1 write, %u storms: %u writes\n", TEST_STORM_EVENTS, TEST_STORMS,
+           testFlash.writes - writes);
+}
+
+
+static void testWriteError(orderT order)
+{
+    uint32_t writes   = testFlash.writes;
+    uint32_t attempts = testFlash.attempts;
+
+    testFlash.failCnt = 3;
+    orderUsageConnect(order, 1);
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+    hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME);
+    TEST_CHECK_EQ(testFlash.attempts, attempts + 1);
+    TEST_CHECK(orderIsDirty(order));
+
+    // unchanged order is compared with flash content, not with the image that wasn't written
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+    TEST_CHECK(orderIsDirty(order));
+    hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME + 2 * ORDER_FLUSH_RETRY_TIME + TEST_WRITE_TIME);
+    TEST_CHECK_EQ(testFlash.attempts, attempts + 4);
+    TEST_CHECK_EQ(testFlash.writes, writes + 1);
+    TEST_CHECK(!orderIsDirty(order));
+    TEST_CHECK(testFlashIsEqual(order));
+}
+
+
+static void testShutdown(orderT order)
+{
+    uint32_t writes = testFlash.writes;
+
+    // shutdown with write error: nothing to wait for, order stays dirty
+    testFlash.failCnt = 1;
+    orderUsageConnect(order, 2);
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+    TEST_CHECK(!orderFlushAll());
+    TEST_CHECK(orderIsDirty(order));
+    TEST_CHECK(orderFlushAll());
+    TEST_CHECK_EQ(testFlash.writes, writes + 1);
+
+    // queued write is waited for, order changed meanwhile is written after its event
+    orderUsageConnect(order, 5);
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+    TEST_CHECK(orderFlushAll());
+    TEST_CHECK_EQ(testFlash.writes, writes + 1);
+    hostTimeRun(getTime() + TEST_WRITE_TIME);
+    TEST_CHECK(orderFlushAll());
+    TEST_CHECK_EQ(testFlash.writes, writes + 2);
+    hostTimeRun(getTime() + TEST_WRITE_TIME);
+    TEST_CHECK(!orderFlushAll());
+    TEST_CHECK(testFlashIsEqual(order));
+}
+
+
+// order changed while write is queued: image buffer of the write isn't reused, flush waits for write event
+static void testWriteQueued(orderT order)
+{
+    uint32_t writes = testFlash.writes;
+
+    testFlash.writeTime = 2 * ORDER_FLUSH_QUIET_TIME;
+    orderUsageConnect(order, 4);
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+    hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME);
+    TEST_CHECK_EQ(testFlash.writes, writes + 1);
+    orderUsageDisconnect(order, 4, 30 * 60000);
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+    hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME);
+    TEST_CHECK(!orderFlush(order));
+    TEST_CHECK_EQ(testFlash.writes, writes + 1);
+    TEST_CHECK(orderIsDirty(order));
+
+    // write event comes 2 * ORDER_FLUSH_QUIET_TIME after the first write, retry writes the change
+    testFlash.writeTime = TEST_WRITE_TIME;
+    hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME + ORDER_FLUSH_RETRY_TIME + TEST_WRITE_TIME);
+    TEST_CHECK_EQ(testFlash.writes, writes + 2);
+    TEST_CHECK(!orderIsDirty(order));
+    TEST_CHECK(testFlashIsEqual(order));
+}
+
+
+static void testFlushFailed(orderT order)
+{
+    uint32_t writes = testFlash.writes;
+
+    testFlash.isWriteFail = true;
+    orderUsageConnect(order, 3);
+    orderWriteFlash(order, TEST_FLASH_ADDRESS);
+    hostTimeRun(getTime() + ORDER_FLUSH_QUIET_TIME + TEST_WRITE_TIME);
+    TEST_CHECK_EQ(testFlash.writes, writes + 1);
+
+    // FDS event reported failed write: written again even if order isn't changed
+    TEST_CHECK(orderIsDirty(order));
+    hostTimeRun(getTime() + ORDER_FLUSH_RETRY_TIME + TEST_WRITE_TIME);
+    TEST_CHECK_EQ(testFlash.writes, writes + 2);
+    TEST_CHECK(!orderIsDirty(order));
+    TEST_CHECK(testFlashIsEqual(order));
+}
+
+
+int main(void)
+{
+    orderT order;
+
+    srand(11);
+    hostTimeReset();
+    order               = orderMalloc();
+    testFlash.order     = order;
+    testFlash.writeTime = TEST_WRITE_TIME;
+    testFlash.doneTimer = timerGetCallback(testWriteDone, NULL);
+    TEST_CHECK(!orderReadFlash(order, TEST_FLASH_ADDRESS));
+    testStorm(order);
+    testWriteError(order);
+    testShutdown(order);
+    testWriteQueued(order);
+    testFlushFailed(order);
+    return testResult("orderFlashTest");
+}
@@ -0,0 +1,156 @@
+/*file: orderProcessingBench.c
+ *
+ * Host benchmark of orderSetFirst() (linked slots + slot by peer ID table) against former shift loop
+ * (linear search of peer ID and element by element shift, copied below). Built once per capacity
+ * (ORDER_ITEM_QUANTITY from make). Both lists get the same random move to front sequence over twice
+ * as many peer IDs as capacity, so new peer replaces last one half of the time; order of both lists is
+ * compared after every step before timing, so benchmark also checks module against the reference.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#include "orderProcessing.h"
+
+#define BENCH_STEPS          1000000
+#define BENCH_CHECK_STEPS    20000
+#define BENCH_PEER_QUANTITY  ((2 * ORDER_ITEM_QUANTITY < ORDER_PEER_ID_QUANTITY) ? 2 * ORDER_ITEM_QUANTITY : ORDER_PEER_ID_QUANTITY)
+
+
+/*********former shift loop****************/
+static uint16_t shiftOrder[ORDER_ITEM_QUANTITY];
+
+
+static bool shiftGetPos(uint16_t *pos, uint8_t item)
+{
+    for(uint16_t cnt = 0; cnt < ORDER_ITEM_QUANTITY; cnt++)
+    {
+        if(item != shiftOrder[cnt])
+        {
+            continue;
+        }
+        *pos = cnt;
+        return true;
+    }
+    return false;
+}
+
+
+static void shiftSetFirst(uint8_t item)
+{
+    uint16_t pos;
+
+    if(!shiftGetPos(&pos, item))
+    {
+        pos = ORDER_ITEM_QUANTITY - 1;
+    }
+    for(; pos > 0; pos--)
+    {
+        shiftOrder[pos] = shiftOrder[pos - 1];
+    }
+    shiftOrder[0] = item;
+}
+
+
+/*********orderProcessing USER IMPLEMENTED FUNCTION****************/
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+{
+    (void)flashAddress;
+    (void)buffer;
+    (void)bufferSize;
+    return NRF_SUCCESS;
+}
+
+
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
+{
+    (void)flashAddress;
+    (void)size;
+    return NULL;
+}
+
+
+void flashMemClose(uint32_t flashAddress)
+{
+    (void)flashAddress;
+}
+
+
+/*********benchmark****************/
+static volatile uint32_t benchSink;             // keeps result of timed loops
+
+
+static uint64_t benchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static bool benchIsEqual(orderT order)
+{
+    for(uint16_t pos = 0; pos < ORDER_ITEM_QUANTITY; pos++)
+    {
+        if(orderGetItem(order, pos) != shiftOrder[pos])
+        {
+            printf("position %u: order %u, shift loop %u\n", pos, orderGetItem(order, pos), shiftOrder[pos]);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int main(void)
+{
+    static uint8_t sequence[BENCH_STEPS];
+    orderT         order = orderMalloc();
+    uint64_t       start;
+    uint64_t       orderNs;
+    uint64_t       shiftNs;
+
+    srand(ORDER_ITEM_QUANTITY);
+    for(uint32_t cnt = 0; cnt < BENCH_STEPS; cnt++)
+    {
+        sequence[cnt] = rand() % BENCH_PEER_QUANTITY;
+    }
+
+    memset(shiftOrder, 0xFF, sizeof(shiftOrder));
+    for(uint32_t cnt = 0; cnt < BENCH_CHECK_STEPS; cnt++)
+    {
+        orderSetFirst(order, sequence[cnt]);
+        shiftSetFirst(sequence[cnt]);
+        if(!benchIsEqual(order))
+        {
+            printf("capacity %u: order differs from shift loop at step %u\n", ORDER_ITEM_QUANTITY, cnt);
+            return 1;
+        }
+    }
+
+    orderClean(order);
+    start = benchNow();
+    for(uint32_t cnt = 0; cnt < BENCH_STEPS; cnt++)
+    {
+        orderSetFirst(order, sequence[cnt]);
+    }
+    orderNs = benchNow() - start;
+
+    memset(shiftOrder, 0xFF, sizeof(shiftOrder));
+    start = benchNow();
+    for(uint32_t cnt = 0; cnt < BENCH_STEPS; cnt++)
+    {
+        shiftSetFirst(sequence[cnt]);
+    }
+    shiftNs = benchNow() - start;
+
+    benchSink = orderGetItem(order, 0) + shiftOrder[0];
+    printf("capacity %3u peers %3u: orderSetFirst %6.1f ns, shift loop %6.1f ns per move to front\n",
+           ORDER_ITEM_QUANTITY, BENCH_PEER_QUANTITY, (double)orderNs / BENCH_STEPS, (double)shiftNs / BENCH_STEPS);
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*file: orderProcessingTest.c
+ *
+ * Unit test of orderProcessing rank: random connections, disconnections and moves to front over more
+ * peers than capacity. After each step rank is checked against scores: positions and slots agree, scores
+ * don't increase along rank, connected/moved peer is ahead of all peers with equal score, replaced peer
+ * was rank last.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+#include "orderProcessing.h"
+#include "testCheck.h"
+
+#define TEST_STEPS             200000
+#define TEST_PEER_QUANTITY     (2 * ORDER_ITEM_QUANTITY)
+
+
+/*********orderProcessing USER IMPLEMENTED FUNCTION****************/
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+{
+    (void)flashAddress;
+    (void)buffer;
+    (void)bufferSize;
+    return NRF_SUCCESS;
+}
+
+
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
+{
+    (void)flashAddress;
+    (void)size;
+    return NULL;
+}
+
+
+void flashMemClose(uint32_t flashAddress)
+{
+    (void)flashAddress;
+}
+
+
+/*********test****************/
+static bool testRankIsConsistent(orderT order)
+{
+    uint16_t quantity = orderGetQuantity(order);
+    bool     isOk     = true;
+
+    for(uint8_t pos = 0; pos < quantity; pos++)
+    {
+        uint16_t item = orderGetRankItem(order, pos);
+        uint8_t  rankPos;
+
+        isOk &= orderGetRankPos(order, item, &rankPos) && rankPos == pos;
+        isOk &= orderIsContain(order, item);
+        if(pos > 0)
+        {
+            isOk &= orderGetScore(order, orderGetRankItem(order, pos - 1)) >= orderGetScore(order, item);
+        }
+    }
+    isOk &= orderGetRankItem(order, quantity) == ORDER_ITEM_FREE;
+    return isOk;
+}
+
+
+// first peer with equal score
+static bool testIsAheadOfEqual(orderT order, uint8_t peer)
+{
+    uint8_t pos;
+
+    if(!orderGetRankPos(order, peer, &pos))
+    {
+        return false;
+    }
+    return pos == 0 || orderGetScore(order, orderGetRankItem(order, pos - 1)) > orderGetScore(order, peer);
+}
+
+
+int main(void)
+{
+    orderT   order = orderMalloc();
+    uint32_t inconsistent = 0;
+    uint32_t notAhead     = 0;
+    uint32_t wrongReplace = 0;
+
+    srand(7);
+    for(uint32_t step = 0; step < TEST_STEPS; step++)
+    {
+        uint8_t  peer     = rand() % TEST_PEER_QUANTITY;
+        uint32_t action   = rand() % 8;
+        uint16_t rankLast = orderGetRankItem(order, orderGetQuantity(order) - 1);
+        bool     isFull   = orderGetQuantity(order) == ORDER_ITEM_QUANTITY;
+        bool     isNew    = !orderIsContain(order, peer);
+
+        if(action == 0)
+        {
+            orderSetFirst(order, peer);
+        }
+        else if(action < 5)
+        {
+            orderUsageConnect(order, peer);
+        }
+        else
+        {
+            orderUsageDisconnect(order, peer, (rand() % 300) * 60000);
+        }
+        if(!testRankIsConsistent(order))
+        {
+            inconsistent++;
+        }
+        if(action < 5 && (!testIsAheadOfEqual(order, peer) || orderGetItem(order, 0) != peer))
+        {
+            notAhead++;
+        }
+        if(action < 5 && isNew && isFull && orderIsContain(order, rankLast))
+        {
+            wrongReplace++;
+        }
+    }
+    TEST_CHECK_EQ(inconsistent, 0);
+    TEST_CHECK_EQ(notAhead, 0);
+    TEST_CHECK_EQ(wrongReplace, 0);
+    return testResult("orderProcessingTest");
+}
@@ -0,0 +1,1363 @@
+/*file: reconnectSim.c
+ *
+ * Discrete-event simulator of reconnect after power on. advReconnect, orderProcessing, advInterval and
+ * reconnectTrace run unchanged against stand-in SoftDevice/peer manager (advertising, white list, connections)
+ * and the simulated clock of systemTimeStub. Glue between them follows main.c: appAdvStart(), appAdvStop(),
+ * appDisconnect(), appProcessing() and the BLE/PM/advertising event handlers.
+ * Hosts are bonded peers, peer ID is rank position (0 - rank first). Host scans with its own duty cycle and
+ * connects on advertising event it receives while it is present and white list allows it.
+ * Runs are consecutive reconnects of one device: advInterval keeps time to first connection learned by
+ * previous runs. Energy model: radio is on SIM_ADV_EVENT_RADIO_US per advertising event (3 channels) and
+ * SIM_CONN_EVENT_RADIO_US per connection event while connected.
+ *
+ * Usage: reconnectSim [-n runs] [-s seed] [-p serial|parallel] [-h horizon_ms] [-r run] [-v] [-t] [-c] [-a adaptive|fixed]
+ *                    [-l file|synthetic] [host ...]
+ *   host:  present | absent | late:<ms>[-<ms>] | leave:<ms>[-<ms>] | rand    (default: rand rand rand)
+ *          late  - host appears at given time, leave - host is present at power on and leaves at given time,
+ *          range is sampled per run, rand - one of the four per run
+ *   -r     only given run, with log of modules and stand-in events (-v)
+ *   -t     dump reconnect trace of each run as main.c does on shutdown, report goes to stderr
+ *          (reconnectSim -t | reconnectTraceDecode)
+ *   -c     compare strategies: serial and parallel on the same runs (seeds), report side by side
+ *   -a     advertising interval policy: adaptive (advInterval, default) or fixed (former 21 ms / 60 s)
+ *   -l     replay usage log: file of "<host> <connected minutes>" lines ('#' comment) or synthetic (-n entries of
+ *          work laptop, home PC, tablet and phone). Each entry is one reconnect: all hosts of log are present, the
+ *          logged one connects, the others accept one connection (scan phase) and go away. Log is replayed with
+ *          order by orderSetFirst() only (MRU, former order) and with usage score (orderUsageConnect(),
+ *          orderUsageDisconnect() of logged time), report is white list switches of connect phase per reconnect
+ * Report: time from power on to secured connection (percentiles over reconnected runs), rank of connected
+ * host, runs without reconnect although host was available, SoftDevice calls in wrong state (faults),
+ * radio on time per reconnect.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "advReconnect.h"
+#include "advInterval.h"
+#include "orderProcessing.h"
+#include "reconnectTrace.h"
+#include "systemTimeStub.h"
+#include "nrf_log.h"
+
+#define SIM_HOST_MAX            ADV_RECONNECT_PEER_QUANTITY
+#define SIM_RUNS_DEFAULT        10000
+#define SIM_HORIZON_DEFAULT     120000      // ms, run without secured connection is counted as not reconnected
+#define SIM_EVENT_QUANTITY      64
+
+// radio timing, us
+#define SIM_ADV_DELAY_MAX       10000       // random advDelay added to each advertising event
+#define SIM_SECURE_TIME         60000       // connection to PM_EVT_CONN_SEC_SUCCEEDED, encryption with stored keys
+#define SIM_DISCONNECT_TIME     22500       // LL_TERMINATE_IND acknowledged, 3 connection intervals of 7.5 ms
+
+// energy model, us of radio on
+#define SIM_ADV_EVENT_RADIO_US  1700        // 3 x (ramp up, ADV_IND 31 bytes payload, listen for request)
+#define SIM_CONN_INTERVAL_US    7500
+#define SIM_CONN_EVENT_RADIO_US 350         // ramp up, empty/short PDU exchange
+
+// former fixed advertising interval policy
+#define SIM_FIXED_INTERVAL      0x0023      // 21 ms
+#define SIM_FIXED_PERIOD        60          // s
+
+// host model
+#define SIM_SCAN_DUTY_MIN       10          // %, scan window / scan interval of host
+#define SIM_SCAN_DUTY_MAX       50
+#define SIM_LATE_MIN            1000        // ms, range of rand late host
+#define SIM_LATE_MAX            30000
+#define SIM_LEAVE_MIN           500         // ms, range of rand leaving host
+#define SIM_LEAVE_MAX           15000
+
+// synthetic usage log
+#define SIM_USAGE_HOSTS         4           // work laptop, home PC, tablet, phone
+#define SIM_USAGE_LINE_MAX      128
+
+#define SIM_US(MS)              ((uint64_t)(MS) * 1000)
+#define SIM_PEER_NONE           0xFFFF
+
+
+typedef enum
+{
+    HOST_PRESENT,
+    HOST_ABSENT,
+    HOST_LATE,
+    HOST_LEAVE,
+    HOST_RANDOM,
+}simHostModeT;
+
+typedef struct
+{
+    simHostModeT mode;
+    uint32_t     timeMin;              // ms, late/leave time range
+    uint32_t     timeMax;
+}simScenarioT;
+
+typedef enum
+{
+    EV_ADV,                            // advertising event
+    EV_ADV_TIMEOUT,                    // advertising period is over
+    EV_SECURED,                        // PM_EVT_CONN_SEC_SUCCEEDED
+    EV_DISCONNECTED,                   // BLE_GAP_EVT_DISCONNECTED
+    EV_HOST_COME,
+    EV_HOST_LEAVE,
+}simEventTypeT;
+
+typedef struct
+{
+    uint64_t      time;                // us
+    uint32_t      seq;                 // equal time - in scheduling order
+    simEventTypeT type;
+    uint32_t      arg;                 // host or generation
+}simEventT;
+
+typedef enum
+{
+    CONNECTION_CONNECT          = 0x0,
+    CONNECTION_START_DISCONNECT = 0x1,
+    CONNECTION_DISCONNECT       = 0x2,
+}connectionStateT;
+
+typedef struct
+{
+    bool     isReconnected;
+    bool     isHostAvailable;          // some host is present at horizon
+    bool     isFault;
+    uint32_t time;                     // ms, power on to secured connection
+    uint16_t peer;
+    uint32_t advEvents;
+    uint32_t connections;
+    uint64_t connectedTime;            // us, all connections of run
+}simResultT;
+
+typedef struct
+{
+    uint32_t  reconnected;
+    uint32_t  notReconnected;          // host available
+    uint32_t  noHost;
+    uint32_t  faults;
+    uint32_t  rank[SIM_HOST_MAX];
+    uint64_t  advEvents;
+    uint64_t  connections;
+    uint64_t  radioReconnected;        // us, sum over reconnected runs
+    uint64_t  radioOther;              // us, sum over other runs (radio on up to horizon)
+    uint32_t *times;                   // ms, sorted after all runs
+}simStatT;
+
+typedef struct
+{
+    uint8_t  host;
+    uint32_t connectedMin;             // minutes of connection
+}simUsageT;
+
+typedef struct
+{
+    uint32_t  reconnected;             // to logged host
+    uint32_t  notReconnected;
+    uint32_t  faults;
+    uint64_t  switches;                // TRACE_WHITELIST_SWITCH of reconnected runs
+    uint32_t  traceLost;
+    uint64_t  radioReconnected;        // us
+    uint32_t *times;                   // ms, sorted after all entries
+}simReplayStatT;
+
+
+static struct
+{
+    uint32_t            runs;
+    uint32_t            seed;
+    uint32_t            horizon;
+    advConnectStrategyT strategy;
+    int32_t             onlyRun;       // -1 - all runs
+    bool                isTraceDump;
+    bool                isCompare;     // both strategies on the same runs
+    bool                isFixedInterval;
+    const char         *usageLog;      // -l, NULL - no replay
+    uint8_t             hostQuantity;
+    simScenarioT        scenario[SIM_HOST_MAX];
+}simConfig =
+{
+    .runs         = SIM_RUNS_DEFAULT,
+    .seed         = 1,
+    .horizon      = SIM_HORIZON_DEFAULT,
+    .strategy     = ADV_CONNECT_SERIAL,
+    .onlyRun      = -1,
+};
+
+static struct
+{
+    simEventT heap[SIM_EVENT_QUANTITY];
+    uint32_t  size;
+    uint32_t  seq;
+    uint64_t  now;                     // us
+    uint64_t  rng;
+}simQueue;
+
+static struct
+{
+    bool     isPresent;
+    bool     isSeenOnly;               // accepts one connection and goes away
+    uint8_t  duty;                     // %
+}simHost[SIM_HOST_MAX];
+
+// usage log replay
+static struct
+{
+    simUsageT *log;
+    uint32_t   quantity;
+    uint8_t    host;                   // logged host of current entry
+    bool       isMru;                  // order by orderSetFirst() only
+}simReplay;
+
+// stand-in of SoftDevice, peer manager and ble_advertising
+static struct
+{
+    bool     isAdv;
+    uint32_t advGen;
+    uint16_t whitelist[SIM_HOST_MAX];  // pm_whitelist_set()
+    uint32_t whitelistCnt;
+    uint16_t advWhitelist[SIM_HOST_MAX];  // white list of running advertising
+    uint32_t advWhitelistCnt;
+    bool     isConnected;
+    bool     isDisconnecting;
+    uint16_t connPeer;
+    uint32_t connGen;
+    uint64_t connStart;                // us
+}sd;
+
+// main.c application state
+static struct
+{
+    bool             isRealAdv;
+    bool             isAppAdv;
+    bool             isPrevConn;
+    connectionStateT connectState;
+}appState;
+
+static orderT     deviceOrder;
+static simResultT simResult;
+
+
+/*********random, event queue****************/
+static uint32_t simRandom(void)
+{
+    simQueue.rng ^= simQueue.rng >> 12;
+    simQueue.rng ^= simQueue.rng << 25;
+    simQueue.rng ^= simQueue.rng >> 27;
+    return (uint32_t)((simQueue.rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+static uint32_t simRandomRange(uint32_t min, uint32_t max)
+{
+    return min + simRandom() % (max - min + 1);
+}
+
+
+static bool simEventBefore(const simEventT *a, const simEventT *b)
+{
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+
+static void simEventAdd(uint64_t delay, simEventTypeT type, uint32_t arg)
+{
+    uint32_t  pos = simQueue.size++;
+    simEventT event = {.time = simQueue.now + delay, .seq = simQueue.seq++, .type = type, .arg = arg};
+
+    if(simQueue.size > SIM_EVENT_QUANTITY)
+    {
+        fprintf(stderr, "event queue overflow\n");
+        exit(2);
+    }
+    for(; pos > 0 && simEventBefore(&event, &simQueue.heap[(pos - 1) / 2]); pos = (pos - 1) / 2)
+    {
+        simQueue.heap[pos] = simQueue.heap[(pos - 1) / 2];
+    }
+    simQueue.heap[pos] = event;
+}
+
+
+static simEventT simEventTake(void)
+{
+    simEventT first = simQueue.heap[0];
+    simEventT last  = simQueue.heap[--simQueue.size];
+    uint32_t  pos   = 0;
+
+    for(;;)
+    {
+        uint32_t child = 2 * pos + 1;
+        if(child >= simQueue.size)
+        {
+            break;
+        }
+        if(child + 1 < simQueue.size && simEventBefore(&simQueue.heap[child + 1], &simQueue.heap[child]))
+        {
+            child++;
+        }
+        if(!simEventBefore(&simQueue.heap[child], &last))
+        {
+            break;
+        }
+        simQueue.heap[pos] = simQueue.heap[child];
+        pos = child;
+    }
+    simQueue.heap[pos] = last;
+    return first;
+}
+
+
+static void simFault(const char *call)
+{
+    // APP_ERROR_CHECK() on target: reset
+    NRF_LOG_INFO("SIM fault: %s in wrong state", call);
+    simResult.isFault = true;
+}
+
+
+static bool simListContain(const uint16_t list[], uint32_t quantity, uint16_t peer)
+{
+    for(uint32_t cnt = 0; cnt < quantity; cnt++)
+    {
+        if(list[cnt] == peer)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*********stand-in SoftDevice/peer manager****************/
+// interval and period of advertising_interval_update()
+static advIntervalT simAdvIntervalGet(void)
+{
+    advIntervalT fixed = {.interval = SIM_FIXED_INTERVAL, .period = SIM_FIXED_PERIOD};
+
+    return simConfig.isFixedInterval ? fixed : advIntervalGet();
+}
+
+
+static void simConnectedTimeAdd(void)
+{
+    simResult.connectedTime += simQueue.now - sd.connStart;
+}
+
+
+static void sdAdvStart(void)
+{
+    advIntervalT advInterval = simAdvIntervalGet();
+
+    if(sd.isAdv || sd.isConnected)
+    {
+        simFault("ble_advertising_start");
+        return;
+    }
+    sd.isAdv           = true;
+    sd.advGen++;
+    sd.advWhitelistCnt = sd.whitelistCnt;          // BLE_ADV_EVT_WHITELIST_REQUEST
+    memcpy(sd.advWhitelist, sd.whitelist, sizeof(sd.advWhitelist));
+    NRF_LOG_INFO("SIM adv start interval %d period %d WL %d", advInterval.interval, advInterval.period,
+                 sd.advWhitelistCnt);
+    simEventAdd(simRandomRange(0, SIM_ADV_DELAY_MAX), EV_ADV, sd.advGen);
+    simEventAdd(SIM_US(advInterval.period * 1000), EV_ADV_TIMEOUT, sd.advGen);
+}
+
+
+static void sdAdvStop(void)
+{
+    if(!sd.isAdv)
+    {
+        simFault("sd_ble_gap_adv_stop");
+        return;
+    }
+    sd.isAdv = false;
+    sd.advGen++;
+}
+
+
+static void sdDisconnect(void)
+{
+    if(!sd.isConnected || sd.isDisconnecting)
+    {
+        simFault("sd_ble_gap_disconnect");
+        return;
+    }
+    sd.isDisconnecting = true;
+    simEventAdd(SIM_DISCONNECT_TIME, EV_DISCONNECTED, sd.connGen);
+}
+
+
+/*********main.c glue****************/
+static void appDisconnect(void)
+{
+    if(appState.connectState != CONNECTION_CONNECT)
+    {
+        return;
+    }
+    appState.connectState = CONNECTION_START_DISCONNECT;
+    appState.isRealAdv    = true;
+    sdDisconnect();
+}
+
+
+static void appAdvStop(void)
+{
+    switch(appState.connectState)
+    {
+    case CONNECTION_CONNECT:
+    case CONNECTION_START_DISCONNECT:
+        appState.isAppAdv = false;
+        break;
+    case CONNECTION_DISCONNECT:
+        appState.isAppAdv = false;
+        if(!appState.isRealAdv)
+        {
+            return;
+        }
+        appState.isRealAdv = false;
+        sdAdvStop();
+        break;
+    }
+}
+
+
+static void appAdvStart(void)
+{
+    switch(appState.connectState)
+    {
+    case CONNECTION_CONNECT:
+        appState.isAppAdv = true;
+        appDisconnect();
+        break;
+    case CONNECTION_START_DISCONNECT:
+        appState.isAppAdv = true;
+        break;
+    case CONNECTION_DISCONNECT:
+        if(appState.isRealAdv)
+        {
+            break;
+        }
+        appState.isAppAdv  = true;
+        appState.isRealAdv = true;
+        sdAdvStart();               // advertising_interval_update() and ble_advertising_start()
+        break;
+    }
+}
+
+
+static void appProcessing(void)
+{
+    if(appState.isAppAdv != appState.isRealAdv)
+    {
+        if(appState.isAppAdv)
+        {
+            appAdvStart();
+        }
+        else
+        {
+            appAdvStop();
+        }
+    }
+}
+
+
+// on_adv_evt()
+static void onAdvEvt(bool isIdle)
+{
+    if(!appState.isAppAdv && !isIdle)
+    {
+        appAdvStop();
+        return;
+    }
+    if(isIdle)
+    {
+        appState.isRealAdv = false;
+        advIntervalNext();
+    }
+}
+
+
+static void simConnected(uint16_t peer)
+{
+    sd.isAdv           = false;     // connection ends advertising
+    sd.advGen++;
+    sd.isConnected     = true;
+    sd.isDisconnecting = false;
+    sd.connPeer        = peer;
+    sd.connGen++;
+    sd.connStart       = simQueue.now;
+    simResult.connections++;
+    NRF_LOG_INFO("SIM host %d connected", peer);
+
+    // peer manager observer: PM_EVT_BONDED_PEER_CONNECTED
+    appState.isPrevConn   = true;
+    appState.isRealAdv    = false;
+    appState.connectState = CONNECTION_CONNECT;
+    advReconnectProcessing(ADV_PROC_START_CONNECT, peer);
+
+    // application observer: BLE_GAP_EVT_CONNECTED
+    if(!appState.isPrevConn)
+    {
+        appState.connectState = CONNECTION_CONNECT;
+        advReconnectProcessing(ADV_PROC_CONNECT, 0);
+    }
+    if(!sd.isDisconnecting)
+    {
+        simEventAdd(SIM_SECURE_TIME, EV_SECURED, sd.connGen);
+    }
+}
+
+
+static void simSecured(void)
+{
+    // PM_EVT_CONN_SEC_SUCCEEDED
+    reconnectTraceAdd(TRACE_CONN_SEC_SUCCEEDED, sd.connPeer);
+    advIntervalConnected(getTime());   // only accepted connection is host found
+    if(simReplay.isMru)
+    {
+        (void)orderSetFirst(deviceOrder, sd.connPeer);
+    }
+    else
+    {
+        orderUsageConnect(deviceOrder, sd.connPeer);
+    }
+    orderWriteFlash(deviceOrder, 0);
+    simResult.isReconnected = true;
+    simResult.time          = getTime();
+    simResult.peer          = sd.connPeer;
+    NRF_LOG_INFO("SIM host %d secured at %d ms", sd.connPeer, simResult.time);
+}
+
+
+static void simDisconnected(void)
+{
+    sd.isConnected     = false;
+    sd.isDisconnecting = false;
+    simConnectedTimeAdd();
+    NRF_LOG_INFO("SIM host %d disconnected", sd.connPeer);
+    if(simHost[sd.connPeer].isSeenOnly)
+    {
+        simHost[sd.connPeer].isPresent = false;
+    }
+
+    // application observer: BLE_GAP_EVT_DISCONNECTED, ble_advertising doesn't restart
+    // (ble_adv_on_disconnect_disabled = true); run is over on secured connection, so disconnected one
+    // was rejected by reconnect and advertising goes on if it is wanted
+    appState.isPrevConn   = false;
+    appState.connectState = CONNECTION_DISCONNECT;
+    appState.isRealAdv    = false;
+    if(appState.isAppAdv)
+    {
+        appAdvStart();
+    }
+}
+
+
+static void simAdvEvent(void)
+{
+    uint16_t     candidate[SIM_HOST_MAX];
+    uint32_t     candidateCnt = 0;
+    advIntervalT advInterval  = simAdvIntervalGet();
+
+    simResult.advEvents++;
+    for(uint16_t host = 0; host < simConfig.hostQuantity; host++)
+    {
+        if(!simHost[host].isPresent ||
+           (sd.advWhitelistCnt != 0 && !simListContain(sd.advWhitelist, sd.advWhitelistCnt, host)))
+        {
+            continue;
+        }
+        if(simRandomRange(1, 100) <= simHost[host].duty)
+        {
+            candidate[candidateCnt++] = host;
+        }
+    }
+    if(candidateCnt != 0)
+    {
+        simConnected(candidate[simRandomRange(0, candidateCnt - 1)]);
+        return;
+    }
+    simEventAdd(advInterval.interval * 625ULL + simRandomRange(0, SIM_ADV_DELAY_MAX), EV_ADV, sd.advGen);
+}
+
+
+static void simEventProcess(const simEventT *event)
+{
+    switch(event->type)
+    {
+    case EV_ADV:
+        if(sd.isAdv && event->arg == sd.advGen)
+        {
+            simAdvEvent();
+        }
+        break;
+    case EV_ADV_TIMEOUT:
+        if(sd.isAdv && event->arg == sd.advGen)
+        {
+            sd.isAdv = false;
+            sd.advGen++;
+            onAdvEvt(true);
+        }
+        break;
+    case EV_SECURED:
+        if(sd.isConnected && !sd.isDisconnecting && event->arg == sd.connGen)
+        {
+            simSecured();
+        }
+        break;
+    case EV_DISCONNECTED:
+        if(sd.isConnected && event->arg == sd.connGen)
+        {
+            simDisconnected();
+        }
+        break;
+    case EV_HOST_COME:
+        simHost[event->arg].isPresent = true;
+        break;
+    case EV_HOST_LEAVE:
+        simHost[event->arg].isPresent = false;
+        break;
+    }
+}
+
+
+/*********advReconnect USER IMPLEMENTED FUNCTION****************/
+void advReconnectAdvStart(void)
+{
+    appAdvStart();
+}
+
+
+void advReconnectAdvStop(void)
+{
+    appAdvStop();
+}
+
+
+void advReconnectDisconnect(void)
+{
+    appDisconnect();
+}
+
+
+void advReconnectWhitelistSet(const uint16_t peers[], uint32_t peersQuantity)
+{
+    // pm_device_identities_list_set() fails while advertising uses white list
+    if(sd.isAdv && sd.advWhitelistCnt != 0)
+    {
+        simFault("pm_device_identities_list_set");
+    }
+    memcpy(sd.whitelist, peers, peersQuantity * sizeof(peers[0]));
+    sd.whitelistCnt = peersQuantity;
+}
+
+
+uint32_t advReconnectPeerListGet(uint16_t peers[], uint32_t peersMaxQuantity)
+{
+    uint32_t cnt = 0;
+
+    for(; cnt < simConfig.hostQuantity && cnt < peersMaxQuantity; cnt++)
+    {
+        peers[cnt] = cnt;
+    }
+    return cnt;
+}
+
+
+/*********orderProcessing USER IMPLEMENTED FUNCTION****************/
+ret_code_t flashMemWriteBytes(uint32_t flashAddress, uint8_t buffer[], uint32_t bufferSize)
+{
+    (void)flashAddress;
+    (void)buffer;
+    (void)bufferSize;
+    return NRF_SUCCESS;
+}
+
+
+const uint8_t *flashMemOpen(uint32_t flashAddress, uint32_t *size)
+{
+    (void)flashAddress;
+    (void)size;
+    return NULL;
+}
+
+
+void flashMemClose(uint32_t flashAddress)
+{
+    (void)flashAddress;
+}
+
+
+/*********run****************/
+static void simHostSetup(uint8_t host)
+{
+    simScenarioT scenario = simConfig.scenario[host];
+
+    if(scenario.mode == HOST_RANDOM)
+    {
+        scenario.mode = (simHostModeT)simRandomRange(HOST_PRESENT, HOST_LEAVE);
+        if(scenario.mode == HOST_LATE)
+        {
+            scenario.timeMin = SIM_LATE_MIN;
+            scenario.timeMax = SIM_LATE_MAX;
+        }
+        else
+        {
+            scenario.timeMin = SIM_LEAVE_MIN;
+            scenario.timeMax = SIM_LEAVE_MAX;
+        }
+    }
+    simHost[host].duty      = simRandomRange(SIM_SCAN_DUTY_MIN, SIM_SCAN_DUTY_MAX);
+    simHost[host].isPresent = (scenario.mode == HOST_PRESENT || scenario.mode == HOST_LEAVE);
+    switch(scenario.mode)
+    {
+    case HOST_LATE:
+        simEventAdd(SIM_US(simRandomRange(scenario.timeMin, scenario.timeMax)), EV_HOST_COME, host);
+        simResult.isHostAvailable = true;
+        break;
+    case HOST_LEAVE:
+        simEventAdd(SIM_US(simRandomRange(scenario.timeMin, scenario.timeMax)), EV_HOST_LEAVE, host);
+        break;
+    case HOST_PRESENT:
+        simResult.isHostAvailable = true;
+        break;
+    default:
+        break;
+    }
+}
+
+
+// replay: all hosts present, only logged one stays after connection
+static void simReplayHostSetup(uint8_t host)
+{
+    simHost[host].duty        = simRandomRange(SIM_SCAN_DUTY_MIN, SIM_SCAN_DUTY_MAX);
+    simHost[host].isPresent   = true;
+    simHost[host].isSeenOnly  = (host != simReplay.host);
+    simResult.isHostAvailable = true;
+}
+
+
+static void simRun(uint32_t run)
+{
+    memset(&simQueue, 0, sizeof(simQueue));
+    memset(&sd, 0, sizeof(sd));
+    memset(&simResult, 0, sizeof(simResult));
+    simQueue.rng          = ((uint64_t)simConfig.seed << 32) ^ (run * 0x9E3779B97F4A7C15ULL) ^ 0x5DEECE66DULL;
+    appState.isRealAdv    = false;
+    appState.isAppAdv     = false;
+    appState.isPrevConn   = false;
+    appState.connectState = CONNECTION_DISCONNECT;
+    hostTimeReset();
+
+    // main(): bonded hosts ranked by peer ID - last connected one has highest score, replay keeps order of
+    // previous entries
+    reconnectTraceInit();
+    reconnectTraceAdd(TRACE_POWER_ON, TRACE_PEER_NONE);
+    if(simConfig.usageLog == NULL)
+    {
+        orderClean(deviceOrder);
+        for(uint8_t host = simConfig.hostQuantity; host > 0; host--)
+        {
+            orderUsageConnect(deviceOrder, host - 1);
+        }
+    }
+    advReconnectInit(deviceOrder);
+    advReconnectSetStrategy(simConfig.strategy);
+    for(uint8_t host = 0; host < simConfig.hostQuantity; host++)
+    {
+        if(simConfig.usageLog == NULL)
+        {
+            simHostSetup(host);
+        }
+        else
+        {
+            simReplayHostSetup(host);
+        }
+    }
+    advIntervalRestart(getTime());
+    advReconnectSetStart(ADV_RECONNECT_SCAN, 0);
+
+    while(!simResult.isReconnected && !simResult.isFault)
+    {
+        uint32_t deadline;
+        bool     isTimer = hostTimeNext(&deadline);
+
+        if(simQueue.size == 0 && !isTimer)
+        {
+            break;
+        }
+        if(isTimer && (simQueue.size == 0 || SIM_US(deadline) <= simQueue.heap[0].time))
+        {
+            simQueue.now = SIM_US(deadline);
+            if(deadline > simConfig.horizon)
+            {
+                break;
+            }
+            hostTimeRun(deadline);
+        }
+        else
+        {
+            simEventT event = simEventTake();
+
+            simQueue.now = event.time;
+            if(simQueue.now > SIM_US(simConfig.horizon))
+            {
+                break;
+            }
+            hostTimeSet((uint32_t)(simQueue.now / 1000));
+            simEventProcess(&event);
+        }
+        appProcessing();
+    }
+    if(sd.isConnected)
+    {
+        simConnectedTimeAdd();
+    }
+}
+
+
+static uint64_t simRadioTime(void)
+{
+    return (uint64_t)simResult.advEvents * SIM_ADV_EVENT_RADIO_US +
+           simResult.connectedTime / SIM_CONN_INTERVAL_US * SIM_CONN_EVENT_RADIO_US;
+}
+
+
+// trace_shutdown_handler() of main.c
+static void simTraceDump(void)
+{
+    traceItemT item;
+
+    printf("<info> app: TRACE lost %u\n", reconnectTraceGetLost());
+    while(reconnectTraceRead(&item, 1) != 0)
+    {
+        printf("<info> app: TRACE %u %u %u %u\n", item.seq, item.phase, item.peerId, item.time);
+    }
+}
+
+
+/*********report****************/
+static int simCompare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+static uint32_t simPercentile(const uint32_t sorted[], uint32_t quantity, uint32_t percent)
+{
+    uint32_t pos = (quantity * percent + 99) / 100;
+
+    return sorted[(pos == 0) ? 0 : pos - 1];
+}
+
+
+static bool simParseHost(const char *arg, simScenarioT *scenario)
+{
+    const char *range = strchr(arg, ':');
+    char       *end;
+
+    if(strcmp(arg, "present") == 0 || strcmp(arg, "absent") == 0 || strcmp(arg, "rand") == 0)
+    {
+        scenario->mode = (arg[0] == 'p') ? HOST_PRESENT : (arg[0] == 'a') ? HOST_ABSENT : HOST_RANDOM;
+        return true;
+    }
+    if(range == NULL)
+    {
+        return false;
+    }
+    if(strncmp(arg, "late:", 5) == 0)
+    {
+        scenario->mode = HOST_LATE;
+    }
+    else if(strncmp(arg, "leave:", 6) == 0)
+    {
+        scenario->mode = HOST_LEAVE;
+    }
+    else
+    {
+        return false;
+    }
+    scenario->timeMin = strtoul(range + 1, &end, 10);
+    scenario->timeMax = (*end == '-') ? strtoul(end + 1, &end, 10) : scenario->timeMin;
+    return *end == 0 && scenario->timeMin <= scenario->timeMax;
+}
+
+
+static void simUsage(void)
+{
+    fprintf(stderr, "usage: reconnectSim [-n runs] [-s seed] [-p serial|parallel] [-h horizon_ms] [-r run] [-v] [-t] [-c] "
+                    "[-a adaptive|fixed] [-l file|synthetic] "
+                    "[present|absent|late:<ms>[-<ms>]|leave:<ms>[-<ms>]|rand ...]\n");
+    exit(2);
+}
+
+
+static void simRunAll(advConnectStrategyT strategy, simStatT *stat)
+{
+    simConfig.strategy = strategy;
+    memset(stat, 0, sizeof(*stat));
+    advIntervalInit(0);
+    stat->times = malloc(simConfig.runs * sizeof(stat->times[0]));
+    for(uint32_t run = 0; run < simConfig.runs; run++)
+    {
+        simRun((simConfig.onlyRun >= 0) ? (uint32_t)simConfig.onlyRun : run);
+        if(simConfig.isTraceDump)
+        {
+            simTraceDump();
+        }
+        stat->advEvents   += simResult.advEvents;
+        stat->connections += simResult.connections;
+        if(simResult.isFault)
+        {
+            stat->faults++;
+        }
+        else if(simResult.isReconnected)
+        {
+            stat->times[stat->reconnected++] = simResult.time;
+            stat->rank[simResult.peer]++;
+            stat->radioReconnected += simRadioTime();
+            continue;
+        }
+        else if(simResult.isHostAvailable)
+        {
+            stat->notReconnected++;
+        }
+        else
+        {
+            stat->noHost++;
+        }
+        stat->radioOther += simRadioTime();
+    }
+    qsort(stat->times, stat->reconnected, sizeof(stat->times[0]), simCompare);
+}
+
+
+static const char *simStrategyName(advConnectStrategyT strategy)
+{
+    return (strategy == ADV_CONNECT_SERIAL) ? "serial" : "parallel";
+}
+
+
+static void simReportHeader(FILE *report, const char *strategyName)
+{
+    fprintf(report, "runs %u seed %u strategy %s interval %s horizon %u ms hosts", simConfig.runs, simConfig.seed,
+            strategyName, simConfig.isFixedInterval ? "fixed" : "adaptive", simConfig.horizon);
+    for(uint8_t host = 0; host < simConfig.hostQuantity; host++)
+    {
+        static const char *const modeName[] = {"present", "absent", "late", "leave", "rand"};
+        simScenarioT             scenario   = simConfig.scenario[host];
+
+        fprintf(report, " %s", modeName[scenario.mode]);
+        if(scenario.mode == HOST_LATE || scenario.mode == HOST_LEAVE)
+        {
+            fprintf(report, ":%u-%u", scenario.timeMin, scenario.timeMax);
+        }
+    }
+    fprintf(report, "\n");
+}
+
+
+// ms per run, 0 - no runs
+static double simRadioPerRun(uint64_t radioTime, uint32_t runs)
+{
+    return (runs == 0) ? 0.0 : (double)radioTime / 1000 / runs;
+}
+
+
+static void simReport(FILE *report, const simStatT *stat)
+{
+    simReportHeader(report, simStrategyName(simConfig.strategy));
+    fprintf(report, "reconnected      %u\n", stat->reconnected);
+    fprintf(report, "not reconnected  %u (host available)\n", stat->notReconnected);
+    fprintf(report, "no host          %u\n", stat->noHost);
+    fprintf(report, "faults           %u\n", stat->faults);
+    if(stat->reconnected != 0)
+    {
+        fprintf(report, "time to reconnect, ms: p50 %u p90 %u p99 %u max %u\n",
+                simPercentile(stat->times, stat->reconnected, 50), simPercentile(stat->times, stat->reconnected, 90),
+                simPercentile(stat->times, stat->reconnected, 99), stat->times[stat->reconnected - 1]);
+        fprintf(report, "connected rank:");
+        for(uint8_t host = 0; host < simConfig.hostQuantity; host++)
+        {
+            fprintf(report, " %u: %.1f%%", host, 100.0 * stat->rank[host] / stat->reconnected);
+        }
+        fprintf(report, "\n");
+    }
+    fprintf(report, "per run: advertising events %.1f connections %.2f\n",
+            (double)stat->advEvents / simConfig.runs, (double)stat->connections / simConfig.runs);
+    fprintf(report, "radio on, ms: per reconnect %.1f, per other run %.1f\n", simRadioPerRun(stat->radioReconnected,
+            stat->reconnected), simRadioPerRun(stat->radioOther, simConfig.runs - stat->reconnected));
+}
+
+
+// percentile of time to reconnect, 0 - no reconnected run
+static uint32_t simStatPercentile(const simStatT *stat, uint32_t percent)
+{
+    return (stat->reconnected == 0) ? 0 : simPercentile(stat->times, stat->reconnected, percent);
+}
+
+
+static void simCompareReport(FILE *report, const simStatT stat[2])
+{
+    simReportHeader(report, "serial/parallel");
+    fprintf(report, "                          serial   parallel\n");
+    fprintf(report, "reconnected            %9u  %9u\n", stat[0].reconnected, stat[1].reconnected);
+    fprintf(report, "not reconnected        %9u  %9u\n", stat[0].notReconnected, stat[1].notReconnected);
+    fprintf(report, "no host                %9u  %9u\n", stat[0].noHost, stat[1].noHost);
+    fprintf(report, "faults                 %9u  %9u\n", stat[0].faults, stat[1].faults);
+    for(uint32_t cnt = 0; cnt < 3; cnt++)
+    {
+        static const uint32_t percent[] = {50, 90, 99};
+
+        fprintf(report, "time to reconnect p%u %9u  %9u ms\n", percent[cnt], simStatPercentile(&stat[0], percent[cnt]),
+                simStatPercentile(&stat[1], percent[cnt]));
+    }
+    for(uint8_t host = 0; host < simConfig.hostQuantity; host++)
+    {
+        fprintf(report, "connected rank %u       %8.1f%%  %8.1f%%\n", host,
+                (stat[0].reconnected == 0) ? 0.0 : 100.0 * stat[0].rank[host] / stat[0].reconnected,
+                (stat[1].reconnected == 0) ? 0.0 : 100.0 * stat[1].rank[host] / stat[1].reconnected);
+    }
+    fprintf(report, "advertising events/run %9.1f  %9.1f\n", (double)stat[0].advEvents / simConfig.runs,
+            (double)stat[1].advEvents / simConfig.runs);
+    fprintf(report, "connections/run        %9.2f  %9.2f\n", (double)stat[0].connections / simConfig.runs,
+            (double)stat[1].connections / simConfig.runs);
+    fprintf(report, "radio on/reconnect     %9.1f  %9.1f ms\n", simRadioPerRun(stat[0].radioReconnected, stat[0].reconnected),
+            simRadioPerRun(stat[1].radioReconnected, stat[1].reconnected));
+    fprintf(report, "radio on/other run     %9.1f  %9.1f ms\n",
+            simRadioPerRun(stat[0].radioOther, simConfig.runs - stat[0].reconnected),
+            simRadioPerRun(stat[1].radioOther, simConfig.runs - stat[1].reconnected));
+}
+
+
+/*********usage log replay****************/
+static void simUsageAdd(uint8_t host, uint32_t minMin, uint32_t maxMin)
+{
+    if(simReplay.quantity < simConfig.runs)
+    {
+        simReplay.log[simReplay.quantity].host         = host;
+        simReplay.log[simReplay.quantity].connectedMin = simRandomRange(minMin, maxMin);
+        simReplay.quantity++;
+    }
+}
+
+
+// days of work laptop (0) and home PC (1) sessions, tablet (2) sometimes, phone (3) for a few minutes
+static void simUsageSynthetic(void)
+{
+    simQueue.rng = ((uint64_t)simConfig.seed << 32) ^ 0x5DEECE66DULL;
+    for(uint32_t day = 0; simReplay.quantity < simConfig.runs; day++)
+    {
+        if(day % 7 < 5)
+        {
+            for(uint32_t session = simRandomRange(2, 4); session > 0; session--)
+            {
+                simUsageAdd(0, 45, 240);
+                if(simRandomRange(1, 100) <= 25)
+                {
+                    simUsageAdd(3, 1, 5);
+                }
+            }
+            if(simRandomRange(1, 100) <= 70)
+            {
+                simUsageAdd(1, 30, 180);
+            }
+            if(simRandomRange(1, 100) <= 30)
+            {
+                simUsageAdd(2, 10, 60);
+            }
+        }
+        else
+        {
+            for(uint32_t session = simRandomRange(1, 2); session > 0; session--)
+            {
+                simUsageAdd(1, 30, 240);
+            }
+            if(simRandomRange(1, 100) <= 50)
+            {
+                simUsageAdd(2, 10, 90);
+            }
+            if(simRandomRange(1, 100) <= 30)
+            {
+                simUsageAdd(3, 1, 5);
+            }
+        }
+    }
+    simConfig.hostQuantity = SIM_USAGE_HOSTS;
+}
+
+
+static bool simUsageRead(const char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    char  line[SIM_USAGE_LINE_MAX];
+
+    if(file == NULL)
+    {
+        return false;
+    }
+    simConfig.hostQuantity = 0;
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        unsigned host;
+        unsigned connectedMin;
+
+        if(line[0] == '#' || sscanf(line, "%u %u", &host, &connectedMin) != 2)
+        {
+            continue;
+        }
+        if(host >= SIM_HOST_MAX)
+        {
+            fclose(file);
+            return false;
+        }
+        if(simReplay.quantity == simConfig.runs)
+        {
+            simConfig.runs *= 2;
+            simReplay.log   = realloc(simReplay.log, simConfig.runs * sizeof(simReplay.log[0]));
+        }
+        simReplay.log[simReplay.quantity].host         = (uint8_t)host;
+        simReplay.log[simReplay.quantity].connectedMin = connectedMin;
+        simReplay.quantity++;
+        if(host >= simConfig.hostQuantity)
+        {
+            simConfig.hostQuantity = (uint8_t)(host + 1);
+        }
+    }
+    fclose(file);
+    return simReplay.quantity != 0;
+}
+
+
+// white list switches of connect phase, trace of the run is read out
+static uint32_t simReplaySwitches(simReplayStatT *stat)
+{
+    traceItemT item;
+    uint32_t   switches = 0;
+
+    stat->traceLost += reconnectTraceGetLost();
+    while(reconnectTraceRead(&item, 1) != 0)
+    {
+        switches += (item.phase == TRACE_WHITELIST_SWITCH);
+    }
+    return switches;
+}
+
+
+static void simReplayRun(bool isMru, simReplayStatT *stat)
+{
+    simReplay.isMru = isMru;
+    memset(stat, 0, sizeof(*stat));
+    advIntervalInit(0);
+    stat->times = malloc(simReplay.quantity * sizeof(stat->times[0]));
+
+    // bonded hosts ranked by peer ID as simRun() does, by policy of replay
+    orderClean(deviceOrder);
+    for(uint8_t host = simConfig.hostQuantity; host > 0; host--)
+    {
+        if(isMru)
+        {
+            (void)orderSetFirst(deviceOrder, host - 1);
+        }
+        else
+        {
+            orderUsageConnect(deviceOrder, host - 1);
+        }
+    }
+    for(uint32_t entry = 0; entry < simReplay.quantity; entry++)
+    {
+        uint32_t switches;
+
+        simReplay.host = simReplay.log[entry].host;
+        simRun(entry);
+        switches = simReplaySwitches(stat);
+        if(simResult.isFault)
+        {
+            stat->faults++;
+            continue;
+        }
+        if(!simResult.isReconnected || simResult.peer != simReplay.host)
+        {
+            stat->notReconnected++;
+            continue;
+        }
+        stat->times[stat->reconnected++] = simResult.time;
+        stat->switches         += switches;
+        stat->radioReconnected += simRadioTime();
+        if(!isMru)
+        {
+            orderUsageDisconnect(deviceOrder, simReplay.host, simReplay.log[entry].connectedMin * 60000);
+        }
+    }
+    qsort(stat->times, stat->reconnected, sizeof(stat->times[0]), simCompare);
+}
+
+
+// per reconnect, 0 - no reconnect
+static double simReplayPerReconnect(uint64_t sum, const simReplayStatT *stat)
+{
+    return (stat->reconnected == 0) ? 0.0 : (double)sum / stat->reconnected;
+}
+
+
+static int simReplayAll(void)
+{
+    simReplayStatT stat[2];
+    uint32_t       faults;
+
+    simReplay.log = malloc(simConfig.runs * sizeof(simReplay.log[0]));
+    if(strcmp(simConfig.usageLog, "synthetic") == 0)
+    {
+        simUsageSynthetic();
+    }
+    else if(!simUsageRead(simConfig.usageLog))
+    {
+        fprintf(stderr, "usage log %s: not read\n", simConfig.usageLog);
+        return 2;
+    }
+    simReplayRun(true, &stat[0]);
+    simReplayRun(false, &stat[1]);
+
+    printf("usage log %s: %u reconnects of %u hosts, seed %u strategy %s interval %s horizon %u ms\n",
+           simConfig.usageLog, simReplay.quantity, simConfig.hostQuantity, simConfig.seed,
+           simStrategyName(simConfig.strategy), simConfig.isFixedInterval ? "fixed" : "adaptive", simConfig.horizon);
+    printf("                             MRU     scored\n");
+    printf("reconnected            %9u  %9u\n", stat[0].reconnected, stat[1].reconnected);
+    printf("not reconnected        %9u  %9u (to logged host)\n", stat[0].notReconnected, stat[1].notReconnected);
+    printf("faults                 %9u  %9u\n", stat[0].faults, stat[1].faults);
+    printf("WL switches/reconnect  %9.3f  %9.3f (connect phase)\n", simReplayPerReconnect(stat[0].switches, &stat[0]),
+           simReplayPerReconnect(stat[1].switches, &stat[1]));
+    for(uint32_t cnt = 0; cnt < 2; cnt++)
+    {
+        static const uint32_t percent[] = {50, 90};
+
+        printf("time to reconnect p%u %9u  %9u ms\n", percent[cnt],
+               (stat[0].reconnected == 0) ? 0 : simPercentile(stat[0].times, stat[0].reconnected, percent[cnt]),
+               (stat[1].reconnected == 0) ? 0 : simPercentile(stat[1].times, stat[1].reconnected, percent[cnt]));
+    }
+    printf("radio on/reconnect     %9.1f  %9.1f ms\n", simReplayPerReconnect(stat[0].radioReconnected, &stat[0]) / 1000,
+           simReplayPerReconnect(stat[1].radioReconnected, &stat[1]) / 1000);
+    if(stat[0].traceLost + stat[1].traceLost != 0)
+    {
+        printf("trace lost             %9u  %9u\n", stat[0].traceLost, stat[1].traceLost);
+    }
+    faults = stat[0].faults + stat[1].faults;
+    free(stat[0].times);
+    free(stat[1].times);
+    free(simReplay.log);
+    return (faults != 0) ? 1 : 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    FILE     *report;
+    simStatT  stat[2];
+    uint32_t  faults;
+    int       arg;
+
+    for(arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        const char *value = (arg + 1 < argc) ? argv[arg + 1] : NULL;
+
+        if(strcmp(argv[arg], "-v") == 0)
+        {
+            nrfLogStubOn = true;
+            continue;
+        }
+        if(strcmp(argv[arg], "-t") == 0)
+        {
+            simConfig.isTraceDump = true;
+            continue;
+        }
+        if(strcmp(argv[arg], "-c") == 0)
+        {
+            simConfig.isCompare = true;
+            continue;
+        }
+        if(value == NULL)
+        {
+            simUsage();
+        }
+        arg++;
+        switch(argv[arg - 1][1])
+        {
+        case 'n': simConfig.runs    = strtoul(value, NULL, 10); break;
+        case 's': simConfig.seed    = strtoul(value, NULL, 10); break;
+        case 'h': simConfig.horizon = strtoul(value, NULL, 10); break;
+        case 'r': simConfig.onlyRun = strtol(value, NULL, 10);  break;
+        case 'l': simConfig.usageLog = value;                   break;
+        case 'a':
+            if(strcmp(value, "adaptive") != 0 && strcmp(value, "fixed") != 0)
+            {
+                simUsage();
+            }
+            simConfig.isFixedInterval = (value[0] == 'f');
+            break;
+        case 'p':
+            if(strcmp(value, "serial") == 0)
+            {
+                simConfig.strategy = ADV_CONNECT_SERIAL;
+            }
+            else if(strcmp(value, "parallel") == 0)
+            {
+                simConfig.strategy = ADV_CONNECT_PARALLEL;
+            }
+            else
+            {
+                simUsage();
+            }
+            break;
+        default:
+            simUsage();
+        }
+    }
+    for(; arg < argc; arg++)
+    {
+        if(simConfig.hostQuantity >= SIM_HOST_MAX || !simParseHost(argv[arg], &simConfig.scenario[simConfig.hostQuantity]))
+        {
+            simUsage();
+        }
+        simConfig.hostQuantity++;
+    }
+    if(simConfig.hostQuantity == 0)
+    {
+        simConfig.hostQuantity = 3;
+        for(uint8_t host = 0; host < simConfig.hostQuantity; host++)
+        {
+            simConfig.scenario[host].mode = HOST_RANDOM;
+        }
+    }
+    if(simConfig.onlyRun >= 0)
+    {
+        simConfig.runs = 1;
+    }
+
+    deviceOrder = orderMalloc();
+    report      = simConfig.isTraceDump ? stderr : stdout;
+    if(simConfig.usageLog != NULL)
+    {
+        return simReplayAll();
+    }
+    if(simConfig.isCompare)
+    {
+        simRunAll(ADV_CONNECT_SERIAL, &stat[0]);
+        simRunAll(ADV_CONNECT_PARALLEL, &stat[1]);
+        simCompareReport(report, stat);
+        faults = stat[0].faults + stat[1].faults;
+        free(stat[1].times);
+    }
+    else
+    {
+        simRunAll(simConfig.strategy, &stat[0]);
+        simReport(report, &stat[0]);
+        faults = stat[0].faults;
+    }
+    free(stat[0].times);
+    return (faults != 0) ? 1 : 0;
+}
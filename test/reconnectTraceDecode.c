@@ -0,0 +1,221 @@
+/*file: reconnectTraceDecode.c
+ *
+ * Host decoder of reconnect trace dump (trace_shutdown_handler() of main.c, reconnectSim -t).
+ * Reads log from stdin, takes lines "TRACE <seq> <phase> <peer> <time>" (any log prefix before TRACE),
+ * splits them in reconnects and prints latency histogram of each phase from reconnect start.
+ *   - reconnect starts on TRACE_POWER_ON, or on TRACE_SCAN_START after secured connection of previous one
+ *   - only first item of phase in reconnect counts (white list switches are counted separately)
+ *   - gap of sequence number (trace overwritten or log dropped) discards reconnect in progress
+ *
+ * Usage: reconnectTraceDecode < log
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "reconnectTrace.h"
+
+#define DECODE_BUCKET_QUANTITY   20        // log2 ms buckets, last one is open
+#define DECODE_SAMPLE_MAX        100000
+#define DECODE_BAR_WIDTH         40
+
+typedef struct
+{
+    uint32_t  histogram[DECODE_BUCKET_QUANTITY];
+    uint32_t *sample;
+    uint32_t  quantity;
+}decodePhaseT;
+
+static const char *const phaseName[TRACE_PHASE_QUANTITY] =
+{
+    "power on",
+    "scan start",
+    "first bonded connected",
+    "scan stop",
+    "white list switch",
+    "connection secured",
+};
+
+static decodePhaseT decodePhase[TRACE_PHASE_QUANTITY];
+static decodePhaseT decodeSwitches;         // white list switches per reconnect, in place of ms
+
+static struct
+{
+    bool     isActive;
+    bool     isSecured;
+    uint32_t start;
+    uint32_t switches;
+    bool     isSeen[TRACE_PHASE_QUANTITY];
+    uint32_t time[TRACE_PHASE_QUANTITY];
+}reconnect;
+
+
+static void decodeAdd(decodePhaseT *phase, uint32_t value)
+{
+    uint32_t bucket = 0;
+
+    while(bucket < DECODE_BUCKET_QUANTITY - 1 && value >= (1UL << bucket))
+    {
+        bucket++;
+    }
+    phase->histogram[bucket]++;
+    if(phase->quantity < DECODE_SAMPLE_MAX)
+    {
+        if(phase->sample == NULL)
+        {
+            phase->sample = malloc(DECODE_SAMPLE_MAX * sizeof(phase->sample[0]));
+        }
+        phase->sample[phase->quantity++] = value;
+    }
+}
+
+
+// reconnect is counted when it reached secured connection
+static void decodeClose(void)
+{
+    if(reconnect.isActive && reconnect.isSecured)
+    {
+        for(uint32_t phase = 0; phase < TRACE_PHASE_QUANTITY; phase++)
+        {
+            if(reconnect.isSeen[phase])
+            {
+                decodeAdd(&decodePhase[phase], reconnect.time[phase] - reconnect.start);
+            }
+        }
+        decodeAdd(&decodeSwitches, reconnect.switches);
+    }
+    memset(&reconnect, 0, sizeof(reconnect));
+}
+
+
+static void decodeItem(const traceItemT *item)
+{
+    if(item->phase == TRACE_POWER_ON || (item->phase == TRACE_SCAN_START && (!reconnect.isActive || reconnect.isSecured)))
+    {
+        decodeClose();
+        reconnect.isActive = true;
+        reconnect.start    = item->time;
+    }
+    if(!reconnect.isActive || reconnect.isSecured)
+    {
+        return;
+    }
+    if(item->phase == TRACE_WHITELIST_SWITCH)
+    {
+        reconnect.switches++;
+    }
+    if(!reconnect.isSeen[item->phase])
+    {
+        reconnect.isSeen[item->phase] = true;
+        reconnect.time[item->phase]   = item->time;
+    }
+    if(item->phase == TRACE_CONN_SEC_SUCCEEDED)
+    {
+        reconnect.isSecured = true;
+    }
+}
+
+
+static int decodeCompare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+static void decodePrint(const char *name, const char *unit, decodePhaseT *phase)
+{
+    uint32_t first = DECODE_BUCKET_QUANTITY;
+    uint32_t last  = 0;
+    uint32_t max   = 0;
+
+    if(phase->quantity == 0)
+    {
+        return;
+    }
+    qsort(phase->sample, phase->quantity, sizeof(phase->sample[0]), decodeCompare);
+    printf("%s: %u, %s p50 %u p90 %u p99 %u max %u\n", name, phase->quantity, unit,
+           phase->sample[phase->quantity * 50 / 100], phase->sample[phase->quantity * 90 / 100],
+           phase->sample[phase->quantity * 99 / 100], phase->sample[phase->quantity - 1]);
+    for(uint32_t bucket = 0; bucket < DECODE_BUCKET_QUANTITY; bucket++)
+    {
+        if(phase->histogram[bucket] != 0)
+        {
+            first = (first == DECODE_BUCKET_QUANTITY) ? bucket : first;
+            last  = bucket;
+            max   = (phase->histogram[bucket] > max) ? phase->histogram[bucket] : max;
+        }
+    }
+    for(uint32_t bucket = first; bucket <= last; bucket++)
+    {
+        uint32_t width = (uint32_t)((uint64_t)phase->histogram[bucket] * DECODE_BAR_WIDTH / max);
+
+        printf("  %8lu .. %-8lu %7u ", (bucket == 0) ? 0UL : (1UL << (bucket - 1)), 1UL << bucket,
+               phase->histogram[bucket]);
+        while(width-- != 0)
+        {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+}
+
+
+int main(void)
+{
+    char       line[256];
+    uint32_t   items = 0;
+    uint32_t   gaps  = 0;
+    uint32_t   lost  = 0;
+    uint8_t    nextSeq = 0;
+    bool       isFirst = true;
+
+    while(fgets(line, sizeof(line), stdin) != NULL)
+    {
+        const char  *trace = strstr(line, "TRACE ");
+        unsigned int seq, phase, peer, time, value;
+        traceItemT   item;
+
+        if(trace == NULL)
+        {
+            continue;
+        }
+        if(sscanf(trace, "TRACE lost %u", &value) == 1)
+        {
+            lost += value;
+            continue;
+        }
+        if(sscanf(trace, "TRACE %u %u %u %u", &seq, &phase, &peer, &time) != 4 || phase >= TRACE_PHASE_QUANTITY)
+        {
+            continue;
+        }
+        item.seq    = (uint8_t)seq;
+        item.phase  = (uint8_t)phase;
+        item.peerId = (uint16_t)peer;
+        item.time   = time;
+        items++;
+        if(!isFirst && item.seq != nextSeq && item.phase != TRACE_POWER_ON)
+        {
+            gaps++;
+            memset(&reconnect, 0, sizeof(reconnect));
+        }
+        isFirst = false;
+        nextSeq = item.seq + 1;
+        decodeItem(&item);
+    }
+    decodeClose();
+
+    printf("items %u, lost on target %u, sequence gaps %u\n", items, lost, gaps);
+    printf("latency from reconnect start, ms\n");
+    for(uint32_t phase = TRACE_SCAN_START; phase < TRACE_PHASE_QUANTITY; phase++)
+    {
+        decodePrint(phaseName[phase], "ms", &decodePhase[phase]);
+    }
+    decodePrint("white list switches per reconnect", "count", &decodeSwitches);
+    return 0;
+}
@@ -0,0 +1,18 @@
+/*file: app_util_platform.h
+ *
+ * Host mock of app_util_platform: SDK libraries run in one thread, critical region is empty.
+*/
+
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#include "stdint.h"
+
+#include "nrf_assert.h"
+
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
+#define ANON_UNIONS_ENABLE
+#define ANON_UNIONS_DISABLE
+
+#endif
@@ -0,0 +1,84 @@
+/*file: nrf_atfifo.h
+ *
+ * Host mock of nrf_atfifo item interface used by FDS operation queue: plain ring, one producer and one
+ * consumer in the same thread, item is put/freed right after alloc/get.
+*/
+
+#ifndef NRF_ATFIFO_H__
+#define NRF_ATFIFO_H__
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+#include "sdk_errors.h"
+
+typedef struct
+{
+    uint8_t  *buffer;
+    uint32_t itemSize;
+    uint32_t quantity;
+    uint32_t wrPos;
+    uint32_t rdPos;
+    uint32_t used;
+}nrf_atfifo_t;
+
+typedef struct
+{
+    void *p_item;
+}nrf_atfifo_item_put_t;
+
+typedef struct
+{
+    void *p_item;
+}nrf_atfifo_item_get_t;
+
+#define NRF_ATFIFO_DEF(NAME, TYPE, SIZE)                                    \
+    static TYPE          NAME##_data[SIZE];                                 \
+    static nrf_atfifo_t  NAME##_inst = {(uint8_t *)NAME##_data, sizeof(TYPE), (SIZE), 0, 0, 0}; \
+    static nrf_atfifo_t *const NAME = &NAME##_inst
+
+#define NRF_ATFIFO_INIT(NAME)  (NAME->wrPos = NAME->rdPos = NAME->used = 0, NRF_SUCCESS)
+
+
+static inline void *nrf_atfifo_item_alloc(nrf_atfifo_t *fifo, nrf_atfifo_item_put_t *context)
+{
+    if(fifo->used == fifo->quantity)
+    {
+        return NULL;
+    }
+    context->p_item = fifo->buffer + fifo->wrPos * fifo->itemSize;
+    fifo->wrPos     = (fifo->wrPos + 1) % fifo->quantity;
+    fifo->used++;
+    return context->p_item;
+}
+
+
+static inline bool nrf_atfifo_item_put(nrf_atfifo_t *fifo, nrf_atfifo_item_put_t *context)
+{
+    (void)fifo;
+    (void)context;
+    return true;
+}
+
+
+static inline void *nrf_atfifo_item_get(nrf_atfifo_t *fifo, nrf_atfifo_item_get_t *context)
+{
+    if(fifo->used == 0)
+    {
+        return NULL;
+    }
+    context->p_item = fifo->buffer + fifo->rdPos * fifo->itemSize;
+    return context->p_item;
+}
+
+
+static inline bool nrf_atfifo_item_free(nrf_atfifo_t *fifo, nrf_atfifo_item_get_t *context)
+{
+    (void)context;
+    fifo->rdPos = (fifo->rdPos + 1) % fifo->quantity;
+    fifo->used--;
+    return true;
+}
+
+#endif
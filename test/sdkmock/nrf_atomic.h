@@ -0,0 +1,44 @@
+/*file: nrf_atomic.h
+ *
+ * Host mock of nrf_atomic: operations used by FDS, on GCC atomic builtins.
+*/
+
+#ifndef NRF_ATOMIC_H__
+#define NRF_ATOMIC_H__
+
+#include "stdint.h"
+
+typedef volatile uint32_t nrf_atomic_u32_t;
+typedef volatile uint32_t nrf_atomic_flag_t;
+
+
+static inline uint32_t nrf_atomic_u32_add(nrf_atomic_u32_t *p_data, uint32_t value)
+{
+    return __atomic_add_fetch(p_data, value, __ATOMIC_SEQ_CST);
+}
+
+
+static inline uint32_t nrf_atomic_u32_sub(nrf_atomic_u32_t *p_data, uint32_t value)
+{
+    return __atomic_sub_fetch(p_data, value, __ATOMIC_SEQ_CST);
+}
+
+
+static inline uint32_t nrf_atomic_u32_fetch_add(nrf_atomic_u32_t *p_data, uint32_t value)
+{
+    return __atomic_fetch_add(p_data, value, __ATOMIC_SEQ_CST);
+}
+
+
+static inline uint32_t nrf_atomic_flag_set_fetch(nrf_atomic_flag_t *p_data)
+{
+    return __atomic_exchange_n(p_data, 1, __ATOMIC_SEQ_CST);
+}
+
+
+static inline uint32_t nrf_atomic_flag_clear(nrf_atomic_flag_t *p_data)
+{
+    return __atomic_exchange_n(p_data, 0, __ATOMIC_SEQ_CST);
+}
+
+#endif
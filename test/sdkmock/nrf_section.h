@@ -0,0 +1,25 @@
+/*file: nrf_section.h
+ *
+ * Host mock of nrf_section: items are placed in ELF section named without leading dot, so host linker
+ * defines __start_/__stop_ symbols of it without linker script.
+*/
+
+#ifndef NRF_SECTION_H__
+#define NRF_SECTION_H__
+
+#include "stddef.h"
+
+#define NRF_SECTION_DEF(section_name, data_type)                            \
+    extern data_type __start_##section_name[];                              \
+    extern data_type __stop_##section_name[]
+
+#define NRF_SECTION_ITEM_REGISTER(section_name, section_var)                \
+    section_var __attribute__((section(#section_name))) __attribute__((used))
+
+#define NRF_SECTION_ITEM_GET(section_name, data_type, i)                    \
+    (&((data_type *)__start_##section_name)[i])
+
+#define NRF_SECTION_ITEM_COUNT(section_name, data_type)                     \
+    ((size_t)((data_type *)__stop_##section_name - (data_type *)__start_##section_name))
+
+#endif
@@ -0,0 +1,67 @@
+/*file: sdk_config.h
+ *
+ * Host configuration of SDK libraries built by test Makefile: FDS on file backed fstorage (nrf_fstorage_file),
+ * values as in ble_app_hids_mouse pca10056/s140 config. Each value may be redefined from compiler options.
+*/
+
+#ifndef SDK_CONFIG_H
+#define SDK_CONFIG_H
+
+#define NRF_FSTORAGE_ENABLED        1
+
+#define FDS_ENABLED                 1
+#ifndef FDS_VIRTUAL_PAGES
+#define FDS_VIRTUAL_PAGES           3
+#endif
+#ifndef FDS_VIRTUAL_PAGE_SIZE
+#define FDS_VIRTUAL_PAGE_SIZE       1024
+#endif
+#define FDS_BACKEND                 3      // NRF_FSTORAGE_FILE
+#ifndef FDS_OP_QUEUE_SIZE
+#define FDS_OP_QUEUE_SIZE           4
+#endif
+#ifndef FDS_CRC_CHECK_ON_READ
+#define FDS_CRC_CHECK_ON_READ       0
+#endif
+#ifndef FDS_CRC_CHECK_ON_WRITE
+#define FDS_CRC_CHECK_ON_WRITE      0
+#endif
+#ifndef FDS_MAX_USERS
+#define FDS_MAX_USERS               8
+#endif
+#ifndef FDS_RAM_INDEX_ENABLED
+#define FDS_RAM_INDEX_ENABLED       1
+#endif
+#ifndef FDS_RAM_INDEX_SIZE
+#define FDS_RAM_INDEX_SIZE          64
+#endif
+#ifndef FDS_GC_IDLE_DIRTY_PERCENT
+#define FDS_GC_IDLE_DIRTY_PERCENT   25
+#endif
+#ifndef FDS_TELEMETRY_ENABLED
+#define FDS_TELEMETRY_ENABLED       1
+#endif
+#ifndef FDS_TELEMETRY_FILES
+#define FDS_TELEMETRY_FILES         4
+#endif
+#ifndef FDS_TX_ENABLED
+#define FDS_TX_ENABLED              1
+#endif
+#ifndef FDS_TX_MAX_RECORDS
+#define FDS_TX_MAX_RECORDS          4
+#endif
+
+#define PEER_MANAGER_ENABLED        1
+#define PM_MAX_REGISTRANTS          3
+#define PM_FLASH_BUFFERS            2
+#define PM_CENTRAL_ENABLED          0
+#ifndef PM_ID_CACHE_SIZE
+#define PM_ID_CACHE_SIZE            8
+#endif
+
+#define CRC16_ENABLED               1
+#ifndef CRC16_KERNEL
+#define CRC16_KERNEL                1
+#endif
+
+#endif
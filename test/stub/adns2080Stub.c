@@ -0,0 +1,219 @@
+/*file: adns2080Stub.c
+ *
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+
+#include "sdio.h"
+#include "nrf_gpio.h"
+#include "nrf_drv_gpiote.h"
+#include "adns2080Stub.h"
+
+#define REG_PROD_ID          0x00
+#define REG_DELTA_X          0x03
+#define REG_DELTA_Y          0x04
+#define REG_DELTA_XY_HIGH    0x0C
+#define REG_MOUSE_CTRL       0x0D
+#define REG_RESET            0x3A
+#define REG_MOTION_CTRL      0x41
+#define REG_BURST_READ_FIRST 0x42
+#define REG_BURST_READ_LAST  0x44
+
+#define PRODUCT_ID           0x2A
+
+hostSensorT hostSensor;
+
+
+static void hostSensorDefault(void)
+{
+    memset(hostSensor.regs, 0, sizeof(hostSensor.regs));
+    hostSensor.regs[REG_PROD_ID]          = PRODUCT_ID;
+    hostSensor.regs[REG_MOUSE_CTRL]       = 0x01;
+    hostSensor.regs[REG_MOTION_CTRL]      = 0x40;
+    hostSensor.regs[REG_BURST_READ_FIRST] = REG_DELTA_X;
+    hostSensor.regs[REG_BURST_READ_LAST]  = 0x09;
+    hostSensor.deltaX                     = 0;
+    hostSensor.deltaY                     = 0;
+}
+
+
+void hostSensorReset(void)
+{
+    memset(&hostSensor, 0, sizeof(hostSensor));
+    hostSensorDefault();
+}
+
+
+bool hostSensorIsMotion(void)
+{
+    return hostSensor.deltaX != 0 || hostSensor.deltaY != 0;
+}
+
+
+static int32_t hostSensorSaturate(int32_t value)
+{
+    int32_t max = (hostSensor.regs[REG_MOUSE_CTRL] & 0x80) ? 2047 : 127;
+
+    if(value > max)
+    {
+        hostSensor.lostCounts += value - max;
+        return max;
+    }
+    if(value < -max)
+    {
+        hostSensor.lostCounts += -max - value;
+        return -max;
+    }
+    return value;
+}
+
+
+void hostSensorMove(int32_t x, int32_t y)
+{
+    bool isMotion = hostSensorIsMotion();
+
+    hostSensor.deltaX = hostSensorSaturate(hostSensor.deltaX + x);
+    hostSensor.deltaY = hostSensorSaturate(hostSensor.deltaY + y);
+    if(!isMotion && hostSensorIsMotion() && hostSensor.isEventEnabled)
+    {
+        hostSensor.isEventPending = true;
+    }
+}
+
+
+void hostSensorInterruptRun(void)
+{
+    while(hostSensor.isEventPending && hostSensor.isEventEnabled && !hostSensor.isInterrupt)
+    {
+        hostSensor.isEventPending = false;
+        hostSensor.isInterrupt    = true;
+        hostSensor.handler(hostSensor.motionPin, NRF_GPIOTE_POLARITY_HITOLO);
+        hostSensor.isInterrupt    = false;
+    }
+}
+
+
+static void hostSensorBus(double us)
+{
+    hostSensor.busUs += us;
+    if(hostSensor.busHook != NULL)
+    {
+        hostSensor.busHook(us);
+    }
+}
+
+
+static uint8_t hostSensorRegRead(uint8_t address)
+{
+    switch(address)
+    {
+    case REG_DELTA_X:
+        hostSensor.sampleX = hostSensor.deltaX;
+        hostSensor.sampleY = hostSensor.deltaY;
+        hostSensor.deltaX  = 0;
+        hostSensor.deltaY  = 0;
+        return (uint8_t)hostSensor.sampleX;
+    case REG_DELTA_Y:
+        return (uint8_t)hostSensor.sampleY;
+    case REG_DELTA_XY_HIGH:
+        return (uint8_t)(((hostSensor.sampleX >> 8) & 0x0F) << 4 | ((hostSensor.sampleY >> 8) & 0x0F));
+    default:
+        return hostSensor.regs[address & 0x7F];
+    }
+}
+
+
+/*********sdio****************/
+void sdio_init(void)
+{
+}
+
+
+uint8_t sdio_read_byte(uint8_t address)
+{
+    uint8_t value;
+
+    hostSensorBus(8 * HOST_SENSOR_BIT_US + HOST_SENSOR_TSRAD_US);
+    value = hostSensorRegRead(address);
+    hostSensorBus(8 * HOST_SENSOR_BIT_US + 10);
+    return value;
+}
+
+
+// burst runs from REG_BURST_READ_FIRST
+void sdio_read_burst(uint8_t *target_buffer, uint8_t target_buffer_size)
+{
+    hostSensor.bursts++;
+    hostSensorBus(8 * HOST_SENSOR_BURST_BIT_US);
+    for(uint8_t cnt = 0; cnt < target_buffer_size; cnt++)
+    {
+        target_buffer[cnt] = hostSensorRegRead(hostSensor.regs[REG_BURST_READ_FIRST] + cnt);
+        hostSensorBus(8 * HOST_SENSOR_BURST_BIT_US);
+    }
+}
+
+
+void sdio_write_byte(uint8_t address, uint8_t data_byte)
+{
+    hostSensorBus(16 * HOST_SENSOR_BIT_US + 20);
+    if(address == REG_RESET)
+    {
+        hostSensorDefault();
+    }
+    else
+    {
+        hostSensor.regs[address & 0x7F] = data_byte;
+    }
+}
+
+
+/*********MOTION pin****************/
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    (void)pin_number;
+    return hostSensorIsMotion() ? 0 : 1;
+}
+
+
+bool nrf_drv_gpiote_is_init(void)
+{
+    return true;
+}
+
+
+ret_code_t nrf_drv_gpiote_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_drv_gpiote_in_init(nrf_drv_gpiote_pin_t pin, nrf_drv_gpiote_in_config_t const *p_config,
+                                  nrf_drv_gpiote_evt_handler_t evt_handler)
+{
+    if(p_config->sense != NRF_GPIOTE_POLARITY_HITOLO)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    hostSensor.motionPin = pin;
+    hostSensor.handler   = evt_handler;
+    return NRF_SUCCESS;
+}
+
+
+// as on target: latched event is cleared, pin active before gives no event
+void nrf_drv_gpiote_in_event_enable(nrf_drv_gpiote_pin_t pin, bool int_enable)
+{
+    (void)pin;
+    hostSensor.isEventEnabled = int_enable;
+    hostSensor.isEventPending = false;
+}
+
+
+void nrf_drv_gpiote_in_event_disable(nrf_drv_gpiote_pin_t pin)
+{
+    (void)pin;
+    hostSensor.isEventEnabled = false;
+    hostSensor.isEventPending = false;
+}
@@ -0,0 +1,54 @@
+/*file: adns2080Stub.h
+ *
+ * Host stand-in of ADNS2080 sensor behind sdio_* calls of the SDK driver (adns2080.c is built as is) and of its
+ * MOTION pin behind nrf_gpio/GPIOTE driver mocks:
+ *   - registers keep what is written, reset (REG_RESET) loads defaults, product ID reads 0x2A
+ *   - hostSensorMove() adds motion of one sensor frame to DELTA registers (saturated to 8/12 bit range of
+ *     REG_MOUSE_CTRL), DELTA_X read takes it, DELTA_Y/DELTA_XY_HIGH give the rest of the same sample
+ *   - MOTION pin is active (low) while DELTA registers hold motion, its falling edge latches GPIOTE event when
+ *     event is enabled, hostSensorInterruptRun() calls handler of latched event (interrupt stand-in)
+ *   - each SDIO transfer costs bus time of sdio.c timing, hostSensor.busHook is called with it before data is
+ *     taken, so motion of frames coming during transfer can be added by caller
+*/
+
+#ifndef ADNS2080STUB_H_
+#define ADNS2080STUB_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "nrf_drv_gpiote.h"
+
+#define HOST_SENSOR_BIT_US         20.0    // sdio.c: two SDIO_DELAY(10 us) per clock
+#define HOST_SENSOR_TSRAD_US       20.0    // sdio.c: delay between address and data
+#ifndef HOST_SENSOR_BURST_BIT_US
+#define HOST_SENSOR_BURST_BIT_US   1.0     // sdio_read_burst() clock without delays
+#endif
+
+typedef struct
+{
+    uint8_t                      regs[0x80];
+    int32_t                      deltaX;             // motion in DELTA registers
+    int32_t                      deltaY;
+    int32_t                      sampleX;            // sample taken by DELTA_X read
+    int32_t                      sampleY;
+    uint32_t                     lostCounts;         // beyond DELTA register range
+    bool                         isEventEnabled;
+    bool                         isEventPending;     // GPIOTE event latched on falling edge
+    bool                         isInterrupt;
+    nrf_drv_gpiote_evt_handler_t handler;
+    uint32_t                     motionPin;
+    uint32_t                     bursts;
+    double                       busUs;
+    void                         (*busHook)(double us);
+}hostSensorT;
+
+extern hostSensorT hostSensor;
+
+
+void hostSensorReset       (void);                 // power on: registers default, no motion, no pin handler
+void hostSensorMove        (int32_t x, int32_t y);
+bool hostSensorIsMotion    (void);                 // MOTION pin is active
+void hostSensorInterruptRun(void);
+
+#endif
@@ -0,0 +1,7 @@
+/*file: nrfLogStub.c
+ *
+*/
+
+#include "nrf_log.h"
+
+bool nrfLogStubOn;
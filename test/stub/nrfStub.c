@@ -0,0 +1,54 @@
+/*file: nrfStub.c
+ *
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "nrf.h"
+#include "nrf_rtc.h"
+
+NRF_RTC_Type rtcMock2;
+bool         nvicIsEnabled[IRQ_QUANTITY];
+
+
+static bool rtcMockIsIrq(const NRF_RTC_Type *rtc)
+{
+    return (rtc->isOverflow && (rtc->intMask & NRF_RTC_INT_OVERFLOW_MASK)) ||
+           (rtc->isCompare[0] && (rtc->intMask & NRF_RTC_INT_COMPARE0_MASK));
+}
+
+
+uint32_t rtcMockAdvance(NRF_RTC_Type *rtc, IRQn_Type irq, rtcMockIrqT handler, uint32_t ticks)
+{
+    uint32_t interrupts = 0;
+
+    while(ticks != 0 && rtc->isRunning)
+    {
+        uint32_t toOverflow = RTC_COUNTER_MOCK_MASK + 1 - rtc->counter;
+        uint32_t toCompare  = (rtc->cc[0] - rtc->counter) & RTC_COUNTER_MOCK_MASK;
+        uint32_t step       = ticks;
+
+        toCompare = (toCompare == 0) ? (RTC_COUNTER_MOCK_MASK + 1) : toCompare;
+        step      = (toOverflow < step) ? toOverflow : step;
+        step      = (toCompare < step) ? toCompare : step;
+
+        rtc->counter = (rtc->counter + step) & RTC_COUNTER_MOCK_MASK;
+        ticks       -= step;
+        if(rtc->counter == 0)
+        {
+            rtc->isOverflow = true;
+        }
+        if(rtc->counter == rtc->cc[0])
+        {
+            rtc->isCompare[0] = true;
+        }
+        // event stays pending while interrupt is masked, handler runs when it is enabled again
+        if(nvicIsEnabled[irq] && rtcMockIsIrq(rtc))
+        {
+            handler();
+            interrupts++;
+        }
+    }
+    return interrupts;
+}
@@ -0,0 +1,136 @@
+/*file: peerManagerStub.c
+ *
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+
+#include "ble_gap.h"
+#include "nrf_soc.h"
+#include "ble_conn_state.h"
+#include "peer_manager_types.h"
+#include "peerManagerStub.h"
+
+hostSoftdeviceT hostSoftdevice;
+
+extern void im_pdb_evt_handler(pm_evt_t *p_event);
+
+
+/*********SoftDevice****************/
+uint32_t sd_ble_gap_whitelist_set(ble_gap_addr_t const *const *pp_wl_addrs, uint8_t len)
+{
+    if(len > BLE_GAP_WHITELIST_ADDR_MAX_COUNT)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    hostSoftdevice.whitelistSets++;
+    hostSoftdevice.whitelistLen = len;
+    for(uint8_t cnt = 0; cnt < len; cnt++)
+    {
+        hostSoftdevice.whitelist[cnt] = *pp_wl_addrs[cnt];
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_device_identities_set(ble_gap_id_key_t const *const *pp_id_keys,
+                                          ble_gap_irk_t const *const *pp_local_irks, uint8_t len)
+{
+    (void)pp_local_irks;
+    if(len > BLE_GAP_DEVICE_IDENTITIES_MAX_COUNT)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    hostSoftdevice.identitiesSets++;
+    hostSoftdevice.identitiesLen = len;
+    for(uint8_t cnt = 0; cnt < len; cnt++)
+    {
+        hostSoftdevice.identities[cnt] = *pp_id_keys[cnt];
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_addr_set(ble_gap_addr_t const *p_addr)
+{
+    (void)p_addr;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_addr_get(ble_gap_addr_t *p_addr)
+{
+    memset(p_addr, 0, sizeof(*p_addr));
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_privacy_set(ble_gap_privacy_params_t const *p_privacy_params)
+{
+    (void)p_privacy_params;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_privacy_get(ble_gap_privacy_params_t *p_privacy_params)
+{
+    (void)p_privacy_params;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ecb_block_encrypt(nrf_ecb_hal_data_t *p_ecb_data)
+{
+    (void)p_ecb_data;
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+
+/*********connection state****************/
+ble_conn_state_user_flag_id_t ble_conn_state_user_flag_acquire(void)
+{
+    return BLE_CONN_STATE_USER_FLAG0;
+}
+
+
+bool ble_conn_state_user_flag_get(uint16_t conn_handle, ble_conn_state_user_flag_id_t flag_id)
+{
+    (void)conn_handle;
+    (void)flag_id;
+    return false;
+}
+
+
+void ble_conn_state_user_flag_set(uint16_t conn_handle, ble_conn_state_user_flag_id_t flag_id, bool value)
+{
+    (void)conn_handle;
+    (void)flag_id;
+    (void)value;
+}
+
+
+/*********Peer Manager modules****************/
+void pdb_pds_evt_handler(pm_evt_t *p_event)
+{
+    im_pdb_evt_handler(p_event);
+}
+
+
+ret_code_t pdb_peer_free(pm_peer_id_t peer_id)
+{
+    (void)peer_id;
+    return NRF_SUCCESS;
+}
+
+
+void pm_im_evt_handler(pm_evt_t *p_event)
+{
+    (void)p_event;
+}
+
+
+void gcm_im_evt_handler(pm_evt_t *p_event)
+{
+    (void)p_event;
+}
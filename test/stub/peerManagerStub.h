@@ -0,0 +1,28 @@
+/*file: peerManagerStub.h
+ *
+ * Host stand-in of what Identity Manager (id_manager.c) calls outside of itself and Peer Data Storage:
+ * SoftDevice GAP whitelist, device identity, address and privacy calls, connection state flags, Peer Database
+ * (events of Peer Data Storage are passed to Identity Manager, as peer_database.c does) and event handlers
+ * of other Peer Manager modules. Lists given to SoftDevice are copied to hostSoftdevice.
+*/
+
+#ifndef PEERMANAGERSTUB_H_
+#define PEERMANAGERSTUB_H_
+
+#include "stdint.h"
+
+#include "ble_gap.h"
+
+typedef struct
+{
+    uint32_t         whitelistSets;
+    uint8_t          whitelistLen;
+    ble_gap_addr_t   whitelist[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+    uint32_t         identitiesSets;
+    uint8_t          identitiesLen;
+    ble_gap_id_key_t identities[BLE_GAP_DEVICE_IDENTITIES_MAX_COUNT];
+}hostSoftdeviceT;
+
+extern hostSoftdeviceT hostSoftdevice;
+
+#endif
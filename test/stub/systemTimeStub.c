@@ -0,0 +1,174 @@
+/*file: systemTimeStub.c
+ *
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+#include "systemTimeStub.h"
+
+#define TIME_BEFORE(A, B)   ((int32_t)((A) - (B)) < 0)
+
+struct timerCallback
+{
+    timerCallbackFunT fun;
+    void              *context;
+    uint32_t          timeCallback;
+    uint32_t          period;           // 0 - one-shot
+    uint32_t          armSeq;           // order of equal deadlines
+    bool              isArmed;
+    bool              isBusy;
+};
+
+static struct timerCallback timerCallbackList[CALLBACK_QUANTITY];
+static uint32_t             timeNow;
+static uint32_t             armSeq;
+
+
+void hostTimeReset(void)
+{
+    timeNow = 0;
+    for(uint32_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    {
+        timerCallbackList[cnt].isArmed = false;
+    }
+}
+
+
+void hostTimeSet(uint32_t time)
+{
+    timeNow = time;
+}
+
+
+static struct timerCallback *hostTimeFirst(void)
+{
+    struct timerCallback *first = NULL;
+
+    for(uint32_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    {
+        struct timerCallback *callback = &timerCallbackList[cnt];
+
+        if(!callback->isArmed)
+        {
+            continue;
+        }
+        if(first == NULL || TIME_BEFORE(callback->timeCallback, first->timeCallback) ||
+           (callback->timeCallback == first->timeCallback && callback->armSeq < first->armSeq))
+        {
+            first = callback;
+        }
+    }
+    return first;
+}
+
+
+bool hostTimeNext(uint32_t *deadline)
+{
+    struct timerCallback *first = hostTimeFirst();
+
+    if(first == NULL)
+    {
+        return false;
+    }
+    *deadline = first->timeCallback;
+    return true;
+}
+
+
+void hostTimeRun(uint32_t time)
+{
+    struct timerCallback *callback;
+
+    while((callback = hostTimeFirst()) != NULL && !TIME_BEFORE(time, callback->timeCallback))
+    {
+        if(TIME_BEFORE(timeNow, callback->timeCallback))
+        {
+            timeNow = callback->timeCallback;
+        }
+        if(callback->period == 0)
+        {
+            callback->isArmed = false;
+        }
+        else
+        {
+            callback->timeCallback += callback->period;
+            callback->armSeq        = armSeq++;
+        }
+        callback->fun(callback->context);
+    }
+    timeNow = time;
+}
+
+
+/*********systemTime.h****************/
+void initUserTimer(void)
+{
+    hostTimeReset();
+}
+
+
+uint32_t getTime(void)
+{
+    return timeNow;
+}
+
+
+timerCallbacT timerGetCallback(timerCallbackFunT timerCallbackFun, void *context)
+{
+    for(uint32_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    {
+        if(timerCallbackList[cnt].isBusy)
+        {
+            continue;
+        }
+        timerCallbackList[cnt].isBusy  = true;
+        timerCallbackList[cnt].isArmed = false;
+        timerCallbackList[cnt].fun     = timerCallbackFun;
+        timerCallbackList[cnt].context = context;
+        return &timerCallbackList[cnt];
+    }
+    return NULL;
+}
+
+
+static void timerArm(timerCallbacT inTimerCallbac, int32_t waitTime, uint32_t period)
+{
+    struct timerCallback *callback = (struct timerCallback *)inTimerCallbac;
+
+    callback->timeCallback = timeNow + waitTime;
+    callback->period       = period;
+    callback->armSeq       = armSeq++;
+    callback->isArmed      = true;
+}
+
+
+void timerRun(timerCallbacT inTimerCallbac, int32_t waitTime)
+{
+    timerArm(inTimerCallbac, waitTime, 0);
+}
+
+
+void timerRunPeriodic(timerCallbacT inTimerCallbac, int32_t period)
+{
+    timerArm(inTimerCallbac, period, period);
+}
+
+
+void timerStop(timerCallbacT inTimerCallbac)
+{
+    ((struct timerCallback *)inTimerCallbac)->isArmed = false;
+}
+
+
+uint32_t timerGetLost(void)
+{
+    return 0;
+}
+
+
+// callbacks are called by hostTimeRun()
+void userProcessingTimerCallbackFun(void)
+{
+}
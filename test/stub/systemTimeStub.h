@@ -0,0 +1,20 @@
+/*file: systemTimeStub.h
+ *
+ * Host stand-in of systemTime: simulated millisecond clock, callbacks are called by hostTimeRun() in deadline
+ * order (equal deadlines - in arm order), so runs are deterministic. API of systemTime.h is implemented as is.
+*/
+
+#ifndef SYSTEMTIMESTUB_H_
+#define SYSTEMTIMESTUB_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "systemTime.h"
+
+void     hostTimeReset(void);                  // clock to 0, all timers stopped, callbacks stay allocated
+void     hostTimeSet  (uint32_t time);         // move clock without calling callbacks
+bool     hostTimeNext (uint32_t *deadline);    // earliest armed deadline
+void     hostTimeRun  (uint32_t time);         // call callbacks due up to time, clock ends at time
+
+#endif
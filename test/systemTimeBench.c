@@ -0,0 +1,228 @@
+/*file: systemTimeBench.c
+ *
+ * Host benchmark of systemTime interrupt cost against number of armed timers.
+ *   scan - 1 ms tick interrupt scanning all CALLBACK_QUANTITY slots (systemTime.c before min-heap/tickless,
+ *          copied below, with today's slot count), periodic timer re-armed by its callback
+ *   heap - RTC2_IRQHandler() of systemTime.c on mocked RTC, interrupt only on due deadline, head check
+ * N periodic timers with random periods 10..1000 ms run 10 simulated seconds. Reported: interrupts per
+ * second, host ns per interrupt and per second of interrupt time, main loop drain ns per second.
+ * Host ns don't equal target cycles, ratio between the two columns is the point.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+
+#include "systemTime.h"
+#include "nrf.h"
+#include "nrf_rtc.h"
+
+#define BENCH_TIME_MS          10000
+#define BENCH_PERIOD_MIN       10
+#define BENCH_PERIOD_MAX       1000
+#define BENCH_RTC_FREQUENCY    32768
+
+void RTC2_IRQHandler(void);
+
+static uint64_t benchOverheadNs;             // benchNow() pair, subtracted from each measurement
+static uint64_t benchIrqNs;
+static uint64_t benchMainNs;
+static uint32_t benchCalls;
+
+
+static uint64_t benchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static void benchCalibrate(void)
+{
+    uint64_t total = 0;
+
+    for(uint32_t cnt = 0; cnt < 100000; cnt++)
+    {
+        uint64_t start = benchNow();
+        total += benchNow() - start;
+    }
+    benchOverheadNs = total / 100000;
+}
+
+
+static uint64_t benchSince(uint64_t start)
+{
+    uint64_t ns = benchNow() - start;
+
+    return (ns > benchOverheadNs) ? ns - benchOverheadNs : 0;
+}
+
+
+/*********scan: tick interrupt of previous systemTime.c****************/
+static volatile uint32_t scanCntMs;
+static bool              scanIsNewTick;
+
+static volatile struct
+{
+    uint32_t period;
+    uint32_t timeCallback;
+    bool     runCallback;
+    bool     waiteCallback;
+}scanCallback[CALLBACK_QUANTITY];
+
+
+static void scanIrq(void)
+{
+    scanCntMs++;
+    for(uint16_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    {
+        if(scanCallback[cnt].waiteCallback && (scanCallback[cnt].timeCallback <= scanCntMs))
+        {
+            scanCallback[cnt].waiteCallback = false;
+            scanCallback[cnt].runCallback   = true;
+        }
+    }
+    scanIsNewTick = true;
+}
+
+
+static void scanProcessing(void)
+{
+    if(!scanIsNewTick)
+    {
+        return;
+    }
+    scanIsNewTick = false;
+    for(uint16_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    {
+        if(!scanCallback[cnt].runCallback)
+        {
+            continue;
+        }
+        scanCallback[cnt].runCallback   = false;
+        benchCalls++;
+        scanCallback[cnt].timeCallback  = scanCntMs + scanCallback[cnt].period;     // timerRun() in callback
+        scanCallback[cnt].waiteCallback = true;
+    }
+}
+
+
+static uint32_t scanRun(uint32_t timers)
+{
+    uint64_t start;
+
+    srand(timers);
+    scanCntMs = 0;
+    for(uint32_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    {
+        scanCallback[cnt].waiteCallback = cnt < timers;
+        scanCallback[cnt].runCallback   = false;
+        scanCallback[cnt].period        = BENCH_PERIOD_MIN + rand() % (BENCH_PERIOD_MAX - BENCH_PERIOD_MIN + 1);
+        scanCallback[cnt].timeCallback  = scanCallback[cnt].period;
+    }
+    for(uint32_t ms = 0; ms < BENCH_TIME_MS; ms++)
+    {
+        start = benchNow();
+        scanIrq();
+        benchIrqNs += benchSince(start);
+        start = benchNow();
+        scanProcessing();
+        benchMainNs += benchSince(start);
+    }
+    return BENCH_TIME_MS;
+}
+
+
+/*********heap: systemTime.c on mocked RTC****************/
+static void benchCallback(void *context)
+{
+    (void)context;
+    benchCalls++;
+}
+
+
+static void heapIrq(void)
+{
+    uint64_t start = benchNow();
+
+    RTC2_IRQHandler();
+    benchIrqNs += benchSince(start);
+}
+
+
+static uint32_t heapRun(uint32_t timers)
+{
+    static timerCallbacT callback[CALLBACK_QUANTITY];
+    uint32_t             interrupts = 0;
+    uint64_t             start;
+
+    srand(timers);
+    for(uint32_t cnt = 0; cnt < CALLBACK_QUANTITY; cnt++)
+    {
+        uint32_t period = BENCH_PERIOD_MIN + rand() % (BENCH_PERIOD_MAX - BENCH_PERIOD_MIN + 1);
+
+        if(callback[cnt] == NULL)
+        {
+            callback[cnt] = timerGetCallback(benchCallback, NULL);
+        }
+        timerStop(callback[cnt]);
+        if(cnt < timers)
+        {
+            timerRunPeriodic(callback[cnt], period);
+        }
+    }
+    for(uint32_t ms = 0; ms < BENCH_TIME_MS; ms++)
+    {
+        uint32_t ticks = (ms + 1) * BENCH_RTC_FREQUENCY / 1000 - ms * BENCH_RTC_FREQUENCY / 1000;
+
+        interrupts += rtcMockAdvance(NRF_RTC2, RTC2_IRQn, heapIrq, ticks);
+        start = benchNow();
+        userProcessingTimerCallbackFun();
+        benchMainNs += benchSince(start);
+    }
+    return interrupts;
+}
+
+
+static void benchPrint(uint32_t interrupts)
+{
+    printf("  %7.0f %7.1f %8.1f %8.1f", (double)interrupts * 1000 / BENCH_TIME_MS,
+           (interrupts != 0) ? (double)benchIrqNs / interrupts : 0.0, (double)benchIrqNs * 1000 / BENCH_TIME_MS / 1000,
+           (double)benchMainNs * 1000 / BENCH_TIME_MS / 1000);
+}
+
+
+int main(void)
+{
+    static const uint32_t timersList[] = {1, 2, 4, 8, 16, 24, 32};
+
+    initUserTimer();
+    benchCalibrate();
+    printf("%u simulated ms, periodic timers %u..%u ms\n", BENCH_TIME_MS, BENCH_PERIOD_MIN, BENCH_PERIOD_MAX);
+    printf("timers  | scan:   irq/s  ns/irq  irq us/s main us/s | heap:   irq/s  ns/irq  irq us/s main us/s\n");
+    for(uint32_t cnt = 0; cnt < sizeof(timersList) / sizeof(timersList[0]); cnt++)
+    {
+        uint32_t interrupts;
+        uint32_t scanCalls;
+
+        printf("%6u  |      ", timersList[cnt]);
+        benchIrqNs  = 0;
+        benchMainNs = 0;
+        benchCalls  = 0;
+        interrupts  = scanRun(timersList[cnt]);
+        scanCalls   = benchCalls;
+        benchPrint(interrupts);
+        printf(" |      ");
+        benchIrqNs  = 0;
+        benchMainNs = 0;
+        benchCalls  = 0;
+        interrupts  = heapRun(timersList[cnt]);
+        benchPrint(interrupts);
+        printf("   callbacks %u/%u\n", scanCalls, benchCalls);
+    }
+    return 0;
+}
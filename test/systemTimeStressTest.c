@@ -0,0 +1,201 @@
+/*file: systemTimeStressTest.c
+ *
+ * Stress test of handoff between systemTime interrupt and main loop. Interrupt stand-in thread moves
+ * mocked RTC by random steps and runs RTC2_IRQHandler() on its events, NVIC_DisableIRQ() of module holds
+ * it off (mutex), so module critical sections are exercised as on target. Main thread randomly arms,
+ * re-arms and stops callbacks and drains expired ones at the same time.
+ * Checked: each one-shot arm that is not stopped or re-armed is called exactly once, never before its
+ * deadline, stopped/re-armed arm is never called with stale event, periodic callbacks are not lost
+ * (call count against elapsed time), FIFO never overflows (timerGetLost()).
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "pthread.h"
+#include "sched.h"
+
+#include "systemTime.h"
+#include "nrf.h"
+#include "nrf_rtc.h"
+#include "testCheck.h"
+
+#define STRESS_TIMER_QUANTITY   16
+#define STRESS_PERIODIC_QUANTITY 4              // first slots are periodic
+#define STRESS_TIME_MS          20000           // simulated
+#define STRESS_DELAY_MAX        20              // ms
+#define STRESS_PERIOD_MIN       5
+#define STRESS_STEP_MAX         40              // RTC ticks per interrupt thread step
+
+void RTC2_IRQHandler(void);
+
+typedef struct
+{
+    timerCallbacT callback;
+    bool          isPending;                    // one-shot armed and not called yet
+    uint32_t      deadline;
+    uint32_t      period;
+    uint32_t      periodStart;
+    uint32_t      calls;
+    uint32_t      early;
+    uint32_t      stale;
+}stressTimerT;
+
+static stressTimerT    stressTimer[STRESS_TIMER_QUANTITY];
+static pthread_mutex_t nvicLock = PTHREAD_MUTEX_INITIALIZER;
+static bool            isNvicHeld;             // main thread only
+static volatile bool   isStressDone;
+
+
+void nvicMockDisable(IRQn_Type irq)
+{
+    (void)irq;
+    pthread_mutex_lock(&nvicLock);
+    isNvicHeld = true;
+}
+
+
+void nvicMockEnable(IRQn_Type irq)
+{
+    (void)irq;
+    if(isNvicHeld)
+    {
+        isNvicHeld = false;
+        pthread_mutex_unlock(&nvicLock);
+    }
+}
+
+
+static void *stressIrqThread(void *arg)
+{
+    uint32_t seed = 12345;
+
+    (void)arg;
+    while(!isStressDone)
+    {
+        seed = seed * 1103515245 + 12345;
+        pthread_mutex_lock(&nvicLock);
+        rtcMockAdvance(NRF_RTC2, RTC2_IRQn, RTC2_IRQHandler, 1 + (seed >> 16) % STRESS_STEP_MAX);
+        pthread_mutex_unlock(&nvicLock);
+        if(((seed >> 8) & 0x3) == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+
+static void stressCallback(void *context)
+{
+    stressTimerT *timer = context;
+    uint32_t      now   = getTime();
+
+    timer->calls++;
+    if(timer->period != 0)
+    {
+        return;
+    }
+    if(!timer->isPending)
+    {
+        timer->stale++;
+        return;
+    }
+    if((int32_t)(now - timer->deadline) < 0)
+    {
+        timer->early++;
+    }
+    timer->isPending = false;
+}
+
+
+static void stressOperation(stressTimerT *timer, uint32_t random)
+{
+    if(timer->period != 0)
+    {
+        return;
+    }
+    if((random & 0x7) == 0)
+    {
+        timerStop(timer->callback);
+        timer->isPending = false;
+        return;
+    }
+    // deadline is taken before arm: arm reads clock again, never earlier
+    timer->deadline  = getTime() + random % (STRESS_DELAY_MAX + 1);
+    timerRun(timer->callback, timer->deadline - getTime());
+    timer->isPending = true;
+}
+
+
+int main(void)
+{
+    pthread_t thread;
+    uint32_t  seed    = 1;
+    uint32_t  oneShotCalls = 0;
+    uint32_t  operations   = 0;
+    uint32_t  end;
+
+    initUserTimer();
+    for(uint32_t cnt = 0; cnt < STRESS_TIMER_QUANTITY; cnt++)
+    {
+        stressTimer[cnt].callback = timerGetCallback(stressCallback, &stressTimer[cnt]);
+    }
+    pthread_create(&thread, NULL, stressIrqThread, NULL);
+    for(uint32_t cnt = 0; cnt < STRESS_PERIODIC_QUANTITY; cnt++)
+    {
+        stressTimer[cnt].period      = STRESS_PERIOD_MIN + cnt * 3;
+        stressTimer[cnt].periodStart = getTime();
+        timerRunPeriodic(stressTimer[cnt].callback, stressTimer[cnt].period);
+    }
+
+    while(getTime() < STRESS_TIME_MS)
+    {
+        seed = seed * 1103515245 + 12345;
+        stressOperation(&stressTimer[(seed >> 16) % STRESS_TIMER_QUANTITY], seed >> 8);
+        operations++;
+        if((seed & 0x3) == 0)
+        {
+            userProcessingTimerCallbackFun();
+        }
+        if((seed & 0x30) == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    // let all armed deadlines pass, stop interrupt thread (clock), then drain rest
+    end = getTime() + STRESS_DELAY_MAX + 2;
+    while((int32_t)(getTime() - end) < 0)
+    {
+        userProcessingTimerCallbackFun();
+    }
+    isStressDone = true;
+    pthread_join(thread, NULL);
+    end = getTime();
+    userProcessingTimerCallbackFun();
+
+    for(uint32_t cnt = 0; cnt < STRESS_TIMER_QUANTITY; cnt++)
+    {
+        stressTimerT *timer = &stressTimer[cnt];
+
+        TEST_CHECK_EQ(timer->early, 0);
+        TEST_CHECK_EQ(timer->stale, 0);
+        TEST_CHECK(!timer->isPending);
+        if(timer->period != 0)
+        {
+            uint32_t expected = (end - timer->periodStart) / timer->period;
+
+            // last deadline can be 1 ms late
+            TEST_CHECK(timer->calls + 1 >= expected && timer->calls <= expected);
+        }
+        else
+        {
+            oneShotCalls += timer->calls;
+        }
+    }
+    TEST_CHECK_EQ(timerGetLost(), 0);
+    printf("simulated %u ms, operations %u, one-shot calls %u\n", end, operations, oneShotCalls);
+    return testResult("systemTimeStressTest");
+}
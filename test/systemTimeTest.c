@@ -0,0 +1,327 @@
+/*file: systemTimeTest.c
+ *
+ * Unit test of tickless systemTime against mocked RTC (mock/nrf_rtc.h): counter runs in 1 ms steps,
+ * RTC2_IRQHandler() is called on the tick its OVERFLOW/COMPARE event is raised, main loop drains
+ * expired callbacks after each step. Checks deadlines (never early, at most 1 ms late), periodic drift,
+ * stop/re-arm of already expired callback (also 256 times), deadlines longer than compare range, counter
+ * overflow (also with masked interrupt), counter passing CC before it is written, 2^32 ms wraparound, and that
+ * RTC wakes CPU only for due callbacks.
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "systemTime.h"
+#include "nrf.h"
+#include "nrf_rtc.h"
+#include "testCheck.h"
+
+#define TEST_RTC_FREQUENCY     32768
+#define TEST_TIMER_QUANTITY    8
+#define TEST_CALL_MAX          64
+
+void RTC2_IRQHandler(void);
+
+typedef struct
+{
+    timerCallbacT callback;
+    uint32_t      calls;
+    uint32_t      callTime[TEST_CALL_MAX];
+}testTimerT;
+
+static testTimerT testTimer[TEST_TIMER_QUANTITY];
+static uint64_t   testTicks;                  // absolute RTC ticks since initUserTimer()
+static uint32_t   testInterrupts;
+
+
+static void testCallback(void *context)
+{
+    testTimerT *timer = context;
+
+    if(timer->calls < TEST_CALL_MAX)
+    {
+        timer->callTime[timer->calls] = getTime();
+    }
+    timer->calls++;
+}
+
+
+static void testTimersReset(void)
+{
+    for(uint32_t cnt = 0; cnt < TEST_TIMER_QUANTITY; cnt++)
+    {
+        timerStop(testTimer[cnt].callback);
+        testTimer[cnt].calls = 0;
+    }
+    userProcessingTimerCallbackFun();
+    testInterrupts = 0;
+}
+
+
+// counter to absolute tick without main loop
+static void testAdvanceTicks(uint64_t ticks)
+{
+    while(ticks != 0)
+    {
+        uint32_t step = (ticks > 0x100000) ? 0x100000 : (uint32_t)ticks;
+
+        testInterrupts += rtcMockAdvance(NRF_RTC2, RTC2_IRQn, RTC2_IRQHandler, step);
+        testTicks      += step;
+        ticks          -= step;
+    }
+}
+
+
+// ms steps, main loop drains after each one
+static void testRunMs(uint32_t ms)
+{
+    for(uint32_t cnt = 0; cnt < ms; cnt++)
+    {
+        uint64_t target = ((testTicks * 1000 / TEST_RTC_FREQUENCY) + 1) * TEST_RTC_FREQUENCY / 1000;
+
+        // next tick where getTime() changes
+        while((target * 1000 / TEST_RTC_FREQUENCY) <= (testTicks * 1000 / TEST_RTC_FREQUENCY))
+        {
+            target++;
+        }
+        testAdvanceTicks(target - testTicks);
+        userProcessingTimerCallbackFun();
+        TEST_CHECK(nvicIsEnabled[RTC2_IRQn]);
+    }
+}
+
+
+static void testOneShot(void)
+{
+    static const uint32_t delay[TEST_TIMER_QUANTITY] = {0, 1, 2, 7, 100, 999, 2500, 65535};
+    uint32_t start;
+
+    testTimersReset();
+    start = getTime();
+    for(uint32_t cnt = 0; cnt < TEST_TIMER_QUANTITY; cnt++)
+    {
+        timerRun(testTimer[cnt].callback, delay[cnt]);
+    }
+    testRunMs(70000);
+    for(uint32_t cnt = 0; cnt < TEST_TIMER_QUANTITY; cnt++)
+    {
+        TEST_CHECK_EQ(testTimer[cnt].calls, 1);
+        TEST_CHECK(testTimer[cnt].callTime[0] >= start + delay[cnt]);
+        TEST_CHECK(testTimer[cnt].callTime[0] <= start + delay[cnt] + 1);
+    }
+    // tickless: one compare per distinct deadline (0 and 1 ms can share one), nothing else
+    TEST_CHECK(testInterrupts <= TEST_TIMER_QUANTITY);
+}
+
+
+static void testPeriodic(void)
+{
+    uint32_t start;
+
+    testTimersReset();
+    start = getTime();
+    timerRunPeriodic(testTimer[0].callback, 10);
+    timerRunPeriodic(testTimer[1].callback, 333);
+    testRunMs(10005);                           // last deadline can be taken 1 ms late
+    TEST_CHECK_EQ(testTimer[0].calls, 1000);
+    TEST_CHECK_EQ(testTimer[1].calls, 30);
+    for(uint32_t cnt = 0; cnt < TEST_CALL_MAX; cnt++)
+    {
+        // next deadline is counted from previous one, rounding of ticks does not add up
+        TEST_CHECK(testTimer[0].callTime[cnt] - (start + 10 * (cnt + 1)) <= 1);
+    }
+    for(uint32_t cnt = 0; cnt < 30; cnt++)
+    {
+        TEST_CHECK(testTimer[1].callTime[cnt] - (start + 333 * (cnt + 1)) <= 1);
+    }
+    timerStop(testTimer[0].callback);
+    timerStop(testTimer[1].callback);
+    testRunMs(1000);
+    TEST_CHECK_EQ(testTimer[0].calls, 1000);
+    TEST_CHECK_EQ(testTimer[1].calls, 30);
+}
+
+
+// callback expired in interrupt but main loop has not taken it yet
+static void testStopExpired(void)
+{
+    uint32_t start;
+
+    testTimersReset();
+    start = getTime();
+    timerRun(testTimer[0].callback, 20);
+    timerRun(testTimer[1].callback, 20);
+    timerRun(testTimer[2].callback, 20);
+    testAdvanceTicks(TEST_RTC_FREQUENCY / 10);  // 100 ms without main loop
+    timerStop(testTimer[0].callback);
+    timerRun(testTimer[1].callback, 50);
+    userProcessingTimerCallbackFun();
+    TEST_CHECK_EQ(testTimer[0].calls, 0);
+    TEST_CHECK_EQ(testTimer[1].calls, 0);
+    TEST_CHECK_EQ(testTimer[2].calls, 1);
+    testRunMs(100);
+    TEST_CHECK_EQ(testTimer[0].calls, 0);
+    TEST_CHECK_EQ(testTimer[1].calls, 1);
+    TEST_CHECK(testTimer[1].callTime[0] >= start + 150);
+    TEST_CHECK_EQ(testTimer[2].calls, 1);
+}
+
+
+// expired event stays queued while callback is re-armed/stopped a multiple of 256 times
+static void testGenerationWrap(void)
+{
+    uint32_t start;
+
+    testTimersReset();
+    timerRun(testTimer[0].callback, 10);
+    testAdvanceTicks(TEST_RTC_FREQUENCY / 50);  // 20 ms without main loop
+    for(uint32_t cnt = 0; cnt < 127; cnt++)
+    {
+        timerStop(testTimer[0].callback);
+        timerRun(testTimer[0].callback, 10);
+    }
+    timerStop(testTimer[0].callback);
+    start = getTime();
+    timerRun(testTimer[0].callback, 500);
+    userProcessingTimerCallbackFun();
+    TEST_CHECK_EQ(testTimer[0].calls, 0);
+    testRunMs(600);
+    TEST_CHECK_EQ(testTimer[0].calls, 1);
+    TEST_CHECK(testTimer[0].callTime[0] - (start + 500) <= 1);
+}
+
+
+// longer than RTC_MAX_DELTA_MS and than half of the counter range: compare is reprogrammed on the way
+static void testLongDeadline(void)
+{
+    uint32_t start;
+
+    testTimersReset();
+    start = getTime();
+    timerRun(testTimer[0].callback, 300000);
+    testAdvanceTicks((uint64_t)299990 * TEST_RTC_FREQUENCY / 1000);
+    userProcessingTimerCallbackFun();
+    TEST_CHECK_EQ(testTimer[0].calls, 0);
+    testRunMs(20);
+    TEST_CHECK_EQ(testTimer[0].calls, 1);
+    TEST_CHECK(testTimer[0].callTime[0] - (start + 300000) <= 1);
+    TEST_CHECK(testInterrupts < 10);
+}
+
+
+static void testCounterOverflow(void)
+{
+    uint32_t before;
+    uint32_t start;
+
+    testTimersReset();
+    // close to counter overflow, masked interrupt: getTime() counts pending OVERFLOW event itself
+    testAdvanceTicks(RTC_COUNTER_MOCK_MASK + 1 - NRF_RTC2->counter - 10);
+    before = getTime();
+    NVIC_DisableIRQ(RTC2_IRQn);
+    testAdvanceTicks(20);
+    TEST_CHECK(NRF_RTC2->isOverflow);
+    TEST_CHECK(getTime() - before <= 1);
+    NVIC_EnableIRQ(RTC2_IRQn);
+    testAdvanceTicks(1);
+    TEST_CHECK(!NRF_RTC2->isOverflow);
+    TEST_CHECK(getTime() - before <= 1);
+
+    // deadline across overflow
+    testAdvanceTicks(RTC_COUNTER_MOCK_MASK + 1 - NRF_RTC2->counter - TEST_RTC_FREQUENCY / 100);
+    start = getTime();
+    timerRun(testTimer[0].callback, 30);
+    testRunMs(40);
+    TEST_CHECK_EQ(testTimer[0].calls, 1);
+    TEST_CHECK(testTimer[0].callTime[0] - (start + 30) <= 1);
+}
+
+
+// ticks from counter to compare
+static uint32_t testCompareAhead(void)
+{
+    return (NRF_RTC2->cc[0] - NRF_RTC2->counter) & RTC_COUNTER_MOCK_MASK;
+}
+
+
+// counter runs past the fresh CC value before it is written (preemption): COMPARE must come without counter wrap
+static void testPreemptedCompare(void)
+{
+    uint32_t start;
+
+    testTimersReset();
+    start = getTime();
+    NRF_RTC2->ccSetStall = 5;
+    timerRun(testTimer[0].callback, 0);
+    TEST_CHECK(testCompareAhead() >= 2 && testCompareAhead() <= TEST_RTC_FREQUENCY / 1000);
+    testRunMs(2);
+    TEST_CHECK_EQ(testTimer[0].calls, 1);
+    TEST_CHECK(testTimer[0].callTime[0] - start <= 1);
+
+    // stall longer than the whole delay: deadline has passed when CC is written
+    start = getTime();
+    NRF_RTC2->ccSetStall = 4 * TEST_RTC_FREQUENCY / 1000;
+    timerRun(testTimer[1].callback, 3);
+    TEST_CHECK(testCompareAhead() >= 2 && testCompareAhead() <= TEST_RTC_FREQUENCY / 1000);
+    testRunMs(3);
+    TEST_CHECK_EQ(testTimer[1].calls, 1);
+    TEST_CHECK(testTimer[1].callTime[0] - (start + 3) <= 2);
+
+    // in interrupt: the next compare of periodic callback
+    start = getTime();
+    timerRunPeriodic(testTimer[2].callback, 1);
+    NRF_RTC2->ccSetStall = 2 * TEST_RTC_FREQUENCY / 1000;
+    testRunMs(10);
+    TEST_CHECK_EQ(NRF_RTC2->ccSetStall, 0);
+    TEST_CHECK(testTimer[2].calls >= 9);
+    timerStop(testTimer[2].callback);
+}
+
+
+// getTime() wraps at 2^32 ms (~49.7 days), deadlines are compared wraparound-safe
+static void testWraparound(void)
+{
+    uint32_t start;
+
+    testTimersReset();
+    testAdvanceTicks((((uint64_t)1 << 32) - 500 - getTime()) * TEST_RTC_FREQUENCY / 1000);
+    start = getTime();
+    TEST_CHECK(start > UINT32_MAX - 1000);
+    timerRun(testTimer[0].callback, 1000);
+    timerRunPeriodic(testTimer[1].callback, 100);
+    testRunMs(1105);
+    TEST_CHECK(getTime() < 1000);
+    TEST_CHECK_EQ(testTimer[0].calls, 1);
+    TEST_CHECK(testTimer[0].callTime[0] - (start + 1000) <= 1);
+    TEST_CHECK_EQ(testTimer[1].calls, 11);
+    for(uint32_t cnt = 0; cnt < 11; cnt++)
+    {
+        TEST_CHECK(testTimer[1].callTime[cnt] - (start + 100 * (cnt + 1)) <= 1);
+    }
+}
+
+
+int main(void)
+{
+    initUserTimer();
+    for(uint32_t cnt = 0; cnt < TEST_TIMER_QUANTITY; cnt++)
+    {
+        testTimer[cnt].callback = timerGetCallback(testCallback, &testTimer[cnt]);
+        TEST_CHECK(testTimer[cnt].callback != NULL);
+    }
+    TEST_CHECK(nvicIsEnabled[RTC2_IRQn]);
+    TEST_CHECK(NRF_RTC2->isRunning);
+
+    testOneShot();
+    testPeriodic();
+    testStopExpired();
+    testGenerationWrap();
+    testLongDeadline();
+    testCounterOverflow();
+    testPreemptedCompare();
+    testWraparound();
+    TEST_CHECK_EQ(timerGetLost(), 0);
+    return testResult("systemTimeTest");
+}
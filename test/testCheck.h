@@ -0,0 +1,48 @@
+/*file: testCheck.h
+ *
+ * Check macros of host tests: failed check is printed with its location and test goes on,
+ * testResult() prints summary and gives exit code.
+*/
+
+#ifndef TESTCHECK_H_
+#define TESTCHECK_H_
+
+#include "stdint.h"
+#include "stdio.h"
+
+static uint32_t testCheckCnt;
+static uint32_t testFailCnt;
+
+#define TEST_CHECK(COND)                                                                        \
+    do                                                                                          \
+    {                                                                                           \
+        testCheckCnt++;                                                                         \
+        if(!(COND))                                                                             \
+        {                                                                                       \
+            testFailCnt++;                                                                      \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND);                     \
+        }                                                                                       \
+    } while(0)
+
+#define TEST_CHECK_EQ(A, B)                                                                     \
+    do                                                                                          \
+    {                                                                                           \
+        long long testA = (long long)(A);                                                       \
+        long long testB = (long long)(B);                                                       \
+        testCheckCnt++;                                                                         \
+        if(testA != testB)                                                                      \
+        {                                                                                       \
+            testFailCnt++;                                                                      \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #A, #B, \
+                   testA, testB);                                                               \
+        }                                                                                       \
+    } while(0)
+
+
+static inline int testResult(const char *name)
+{
+    printf("%s: %u checks, %u failed\n", name, testCheckCnt, testFailCnt);
+    return (testFailCnt != 0) ? 1 : 0;
+}
+
+#endif